@@ -0,0 +1,847 @@
+#include "ComputePipeline.h"
+#include "../render/GpuTrace.h"
+#include "../render/ShaderProgram.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Uniforms of the default tint, shared by the compute pass and the fused draw
+static const float kBrightThreshold = 0.5f;
+static const float kBrightGain = 1.2f;
+
+static bool hasExtension(const char* name) {
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    return extensions && strstr(extensions, name) != nullptr;
+}
+
+ComputePipeline::ComputePipeline()
+    : shaderReloader(nullptr), frameStats(nullptr), quad(nullptr), processedTexture(0), processedWidth(0),
+      processedHeight(0), presentPath(PresentPath::Blit), presentFramebuffer(0), highPrecision(false),
+      inputFormat(GL_RGBA8), intermediateFormat(GL_RGBA8), floatRenderable(false), quantizeProgram(0),
+      uQuantizeStepLocation(-1), quantizeStep(1.0f / 255.0f), quantizeShaderId(-1), lutProgram(0),
+      uLutScaleLocation(-1), uLutOffsetLocation(-1), lutShaderId(-1), scaleFramebuffers{0, 0}, yuvProgram(0),
+      uYuvChromaSelectLocation(-1), yuvShaderId(-1), workGroupTuning(false),
+      tintVariants({"TINT", "BRIGHTEN", "FLIP"},
+                   [this](const std::vector<std::string>& sources) { return buildTintProgram(sources[0]); }),
+      tintFeatures(TintShadows | BrightenHighlights), activeTintFeatures(AllTintFeatures),
+      fusedVariants({"TINT", "BRIGHTEN", "FLIP"},
+                    [this](const std::vector<std::string>& sources) { return buildFusedProgram(sources); }),
+      tintPass(-1), tintGroupSize{16, 16}, batchSize(1), batchProgram(0), batchFeatures(0), batchOutput(0),
+      batchWidth(0), batchHeight(0), batchVerified(false), luminanceStats(false), histogramShaderId(-1),
+      hasLuminance(false), timingMode(TimingMode::Off) {
+}
+
+void ComputePipeline::addEffect(PassGraph::PassType type, const std::string& source) {
+    // Programs are built in initialize, once the context exists
+    effectSources.push_back({type, source});
+}
+
+void ComputePipeline::setWorkGroupTuning(bool enabled, const std::string& cachePath) {
+    workGroupTuning = enabled;
+    workGroupCachePath = cachePath;
+}
+
+void ComputePipeline::addShaders(ShaderReloader& reloader) {
+    display.addShaders(reloader);
+    tintVariants.addShaders(reloader, {"tint.comp"});
+    fusedVariants.addShaders(reloader, {"display.vert", "tint.frag"});
+    quantizeShaderId = reloader.addProgram({"display.vert", "quantize.frag"},
+        [](const std::vector<std::string>& sources) { return ShaderProgram::create(sources[0].c_str(), sources[1].c_str()); });
+    yuvShaderId = reloader.addProgram({"yuv.comp"},
+        [](const std::vector<std::string>& sources) { return ShaderProgram::createCompute(sources[0].c_str()); });
+    histogramShaderId = reloader.addProgram({"histogram.comp"},
+        [this](const std::vector<std::string>& sources) { return buildHistogramProgram(sources[0]); });
+    lutShaderId = reloader.addProgram({"lut.comp"},
+        [this](const std::vector<std::string>& sources) { return buildLutProgram(sources[0]); });
+}
+
+bool ComputePipeline::initialize(PipelineSetup& setup) {
+    shaderReloader = setup.shaderReloader;
+    frameStats = setup.frameStats;
+    quad = setup.quad;
+
+    // The display program draws the last pass's result
+    if (!display.initialize(setup)) {
+        return false;
+    }
+    floatRenderable = hasExtension("GL_EXT_color_buffer_half_float") || hasExtension("GL_EXT_color_buffer_float");
+    if (!createPasses(*setup.imageLoader)) {
+        return false;
+    }
+    if (intermediateFormat == GL_RGBA16F) {
+        // shaders/display.vert + quantize.frag replace the built-in shaders when present
+        std::vector<std::string> sources;
+        GLuint program = 0;
+        if (shaderReloader->readSources(quantizeShaderId, sources)) {
+            program = ShaderProgram::create(sources[0].c_str(), sources[1].c_str());
+            if (!program) {
+                std::cerr << "quantize.frag failed to build, using the built-in shader" << std::endl;
+            }
+        }
+        if (!program) {
+            program = ShaderProgram::create(display.getVertexShaderSource(), quantizeFragmentSource);
+        }
+        if (!program) {
+            std::cerr << "Failed to create the quantize program" << std::endl;
+            return false;
+        }
+        setQuantizeProgram(program);
+
+        // Dither by one step of the back buffer: 1/255 for 8 bits, 1/1023 on a 10-bit surface
+        GLint redBits = 8;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_BACK, GL_FRAMEBUFFER_ATTACHMENT_RED_SIZE, &redBits);
+        redBits = std::min(std::max(redBits, 1), 16);
+        quantizeStep = 1.0f / static_cast<float>((1 << redBits) - 1);
+        std::cout << "RGBA16F intermediates, quantized to " << redBits << " bits per channel on present" << std::endl;
+    }
+    scaledInput.create(true);
+    glGenFramebuffers(2, scaleFramebuffers);
+
+    // shaders/yuv.comp replaces the built-in conversion shader when present
+    std::vector<std::string> yuvFile;
+    GLuint yuv = 0;
+    if (shaderReloader->readSources(yuvShaderId, yuvFile)) {
+        yuv = ShaderProgram::createCompute(yuvFile[0].c_str());
+        if (!yuv) {
+            std::cerr << "yuv.comp failed to build, using the built-in shader" << std::endl;
+        }
+    }
+    if (!yuv) {
+        yuv = ShaderProgram::createCompute(yuvComputeSource);
+    }
+    if (!yuv) {
+        std::cerr << "Failed to create the YUV conversion program" << std::endl;
+        return false;
+    }
+    setYuvProgram(yuv);
+    glGenFramebuffers(1, &presentFramebuffer);
+
+    // shaders/lut.comp replaces the built-in grading shader when present. It
+    // is built even without a selection, so selecting a LUT never compiles
+    // anything; without it frames are presented ungraded.
+    luts.setFormat(intermediateFormat);
+    gradedOutput.create(true);
+    std::vector<std::string> lutFile;
+    GLuint lut = 0;
+    if (shaderReloader->readSources(lutShaderId, lutFile)) {
+        lut = buildLutProgram(lutFile[0]);
+        if (!lut) {
+            std::cerr << "lut.comp failed to build, using the built-in shader" << std::endl;
+        }
+    }
+    if (!lut) {
+        lut = buildLutProgram(lutComputeSource);
+    }
+    if (lut) {
+        setLutProgram(lut);
+    } else {
+        std::cerr << "Failed to create the LUT program, LUTs are not applied" << std::endl;
+    }
+
+    // shaders/histogram.comp replaces the built-in statistics shader when present;
+    // without it the frames are still drawn, only unmeasured
+    if (luminanceStats) {
+        std::vector<std::string> histogramFile;
+        GLuint program = 0;
+        if (shaderReloader->readSources(histogramShaderId, histogramFile)) {
+            program = buildHistogramProgram(histogramFile[0]);
+            if (!program) {
+                std::cerr << "histogram.comp failed to build, using the built-in shader" << std::endl;
+            }
+        }
+        if (!program) {
+            program = buildHistogramProgram(LuminanceHistogram::getDefaultSource());
+        }
+        if (program && histogram.initialize()) {
+            histogram.setProgram(program);
+        } else {
+            std::cerr << "Failed to set up luminance statistics, frames are not measured" << std::endl;
+            if (program) {
+                glDeleteProgram(program);
+            }
+            luminanceStats = false;
+        }
+    }
+
+    // GPU timer queries for non-blocking frame timing
+    timingMode = setup.timingMode;
+    if (timingMode == TimingMode::GpuTimer && !computeTimer.initialize()) {
+        std::cout << "GL_EXT_disjoint_timer_query not available, compute timing disabled" << std::endl;
+        timingMode = TimingMode::Off;
+    }
+
+    checkGLError("ComputePipeline::initialize");
+    return true;
+}
+
+bool ComputePipeline::parsePresentPath(const std::string& name, PresentPath& path) {
+    if (name == "draw") {
+        path = PresentPath::Draw;
+    } else if (name == "blit") {
+        path = PresentPath::Blit;
+    } else if (name == "fused") {
+        path = PresentPath::Fused;
+    } else {
+        std::cerr << "Unknown present path: " << name << " (use draw, blit or fused)" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ComputePipeline::createPasses(ImageLoader& imageLoader) {
+    // Build the post-processing chain; the tint pass runs when no effects were added
+    if (!passGraph.create()) {
+        std::cerr << "Failed to create pass graph" << std::endl;
+        return false;
+    }
+    if (presentPath == PresentPath::Fused && !effectSources.empty()) {
+        std::cout << "Custom effects cannot be fused into the present draw, blitting their result" << std::endl;
+        presentPath = PresentPath::Blit;
+    }
+    if (presentPath == PresentPath::Fused && luts.hasSelection()) {
+        std::cout << "A LUT cannot be fused into the present draw, blitting the graded result" << std::endl;
+        presentPath = PresentPath::Blit;
+    }
+
+    // The first frame decides the format the first pass binds; render() skips frames of another format
+    std::shared_ptr<const ImageData> firstFrame = imageLoader.getImageCount() > 0 ? imageLoader.acquireImage(0) : nullptr;
+    inputFormat = firstFrame && firstFrame->sampleFormat == SampleFormat::Float16 ? GL_RGBA16F : GL_RGBA8;
+    intermediateFormat = highPrecision && presentPath != PresentPath::Fused ? GL_RGBA16F : GL_RGBA8;
+    bool fragmentEffects = std::any_of(effectSources.begin(), effectSources.end(),
+        [](const EffectSource& effect) { return effect.type == PassGraph::PassType::Fragment; });
+    if (intermediateFormat == GL_RGBA16F && fragmentEffects && !floatRenderable) {
+        std::cout << "Fragment effects cannot render to RGBA16F here, keeping RGBA8 intermediates" << std::endl;
+        intermediateFormat = GL_RGBA8;
+    }
+    passGraph.setTargetFormat(intermediateFormat);
+
+    if (presentPath == PresentPath::Fused) {
+        // No passes at all; shaders/display.vert + tint.frag replace the built-in shaders when present
+        std::vector<std::string> fusedFiles;
+        bool built = fusedVariants.readSources(*shaderReloader, fusedFiles) && fusedVariants.build(fusedFiles);
+        if (!built) {
+            built = fusedVariants.build({display.getVertexShaderSource(), fusedFragmentSource});
+        }
+        if (!built) {
+            std::cerr << "Failed to create the fused tint program" << std::endl;
+            return false;
+        }
+        activeTintFeatures = tintFeatures;
+        return true;
+    }
+    if (effectSources.empty()) {
+        // shaders/tint.comp replaces the built-in tint shader when present
+        std::vector<std::string> tintFile;
+        tintTemplate = tintVariants.readSources(*shaderReloader, tintFile) ? tintFile[0] : computeShaderSource;
+        // Tuned on the variant with every feature, the most expensive one, at the formats it will run with
+        if (workGroupTuning && firstFrame && firstFrame->isValid()) {
+            auto compile = [](const char* source) { return ShaderProgram::createCompute(source); };
+            std::string tuned = PassGraph::withImageFormats(tintVariants.specialize({tintTemplate}, AllTintFeatures)[0],
+                                                            inputFormat, intermediateFormat);
+            const char* shaderName = intermediateFormat == GL_RGBA16F ? "tint rgba16f" : "tint";
+            tintGroupSize = WorkGroupTuner::select(tuned.c_str(), shaderName, *firstFrame, compile, workGroupCachePath,
+                                                   intermediateFormat);
+        }
+        bool built = tintVariants.build({tintTemplate});
+        if (!built && !tintFile.empty()) {
+            std::cerr << "tint.comp failed to build, using the built-in shader" << std::endl;
+            tintTemplate = computeShaderSource;
+            built = tintVariants.build({tintTemplate});
+        }
+        // Uniforms are looked up in the variant that uses them all, then the
+        // requested one is selected, as exports never reach applyReloadedShaders.
+        // The variants keep ownership.
+        tintPass = built ? passGraph.addComputePass("tint", tintVariants.get(AllTintFeatures)) : -1;
+        if (tintPass < 0) {
+            std::cerr << "Failed to create compute shader program" << std::endl;
+            return false;
+        }
+        passGraph.selectProgram(tintPass, tintVariants.get(AllTintFeatures));
+        activeTintFeatures = AllTintFeatures;
+        passGraph.setUniform(tintPass, "uBrightThreshold", kBrightThreshold);
+        passGraph.setUniform(tintPass, "uBrightGain", kBrightGain);
+        passGraph.selectProgram(tintPass, tintVariants.get(tintFeatures));
+        activeTintFeatures = tintFeatures;
+    }
+    for (size_t i = 0; i < effectSources.size(); ++i) {
+        const EffectSource& effect = effectSources[i];
+        std::string name = "effect " + std::to_string(i);
+        GLenum effectInput = passGraph.getPassCount() == 0 ? inputFormat : intermediateFormat;
+        int pass = effect.type == PassGraph::PassType::Compute
+            ? passGraph.addComputePass(name, ShaderProgram::createCompute(
+                  PassGraph::withImageFormats(effect.source, effectInput, intermediateFormat).c_str()))
+            : passGraph.addFragmentPass(name, ShaderProgram::create(display.getVertexShaderSource(), effect.source.c_str()));
+        if (pass < 0) {
+            std::cerr << "Failed to create " << name << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void ComputePipeline::destroy() {
+    computeTimer.destroy();
+    histogram.destroy();
+    passGraph.destroy();
+    tintVariants.destroy();
+    fusedVariants.destroy();
+    tintPass = -1;
+    processedTexture = 0;
+    scaledInput.destroy();
+    gradedOutput.destroy();
+    luts.destroy();
+    if (lutProgram) {
+        glDeleteProgram(lutProgram);
+        lutProgram = 0;
+    }
+    if (scaleFramebuffers[0]) {
+        glDeleteFramebuffers(2, scaleFramebuffers);
+        scaleFramebuffers[0] = scaleFramebuffers[1] = 0;
+    }
+    if (presentFramebuffer) {
+        glDeleteFramebuffers(1, &presentFramebuffer);
+        presentFramebuffer = 0;
+    }
+    if (quantizeProgram) {
+        glDeleteProgram(quantizeProgram);
+        quantizeProgram = 0;
+    }
+    if (yuvProgram) {
+        glDeleteProgram(yuvProgram);
+        yuvProgram = 0;
+    }
+    if (batchProgram) {
+        glDeleteProgram(batchProgram);
+        batchProgram = 0;
+    }
+    if (batchOutput) {
+        glDeleteTextures(1, &batchOutput);
+        batchOutput = 0;
+        batchWidth = batchHeight = 0;
+    }
+    display.destroy();
+}
+
+GLuint ComputePipeline::buildTintProgram(const std::string& source) {
+    // The default pass is the only pass, so it reads the input and writes an intermediate
+    std::string formatted = PassGraph::withImageFormats(source, inputFormat, intermediateFormat);
+    return ShaderProgram::createCompute(WorkGroupTuner::withLocalSize(formatted.c_str(), tintGroupSize).c_str());
+}
+
+GLuint ComputePipeline::buildFusedProgram(const std::vector<std::string>& sources) {
+    GLuint program = ShaderProgram::create(sources[0].c_str(), sources[1].c_str());
+    if (program) {
+        // The uniforms never change, so they are set once per program (also on the reload thread)
+        glUseProgram(program);
+        glUniform1i(glGetUniformLocation(program, "uTexture"), 0);
+        glUniform1f(glGetUniformLocation(program, "uBrightThreshold"), kBrightThreshold);
+        glUniform1f(glGetUniformLocation(program, "uBrightGain"), kBrightGain);
+        glUseProgram(0);
+    }
+    return program;
+}
+
+bool ComputePipeline::applyReloadedShaders() {
+    bool reloaded = display.applyReloadedShaders();
+    if (tintVariants.applyReloaded(*shaderReloader)) {
+        // Custom effect stacks do not include the tint pass
+        if (tintPass >= 0) {
+            passGraph.selectProgram(tintPass, tintVariants.get(activeTintFeatures));
+            reloaded = true;
+        }
+        // The batch variant is rebuilt from the new source on the next batch
+        std::vector<std::string> tintFile;
+        if (tintVariants.readSources(*shaderReloader, tintFile)) {
+            tintTemplate = tintFile[0];
+        }
+        if (batchProgram) {
+            glDeleteProgram(batchProgram);
+            batchProgram = 0;
+        }
+    }
+    if (fusedVariants.applyReloaded(*shaderReloader) && presentPath == PresentPath::Fused) {
+        reloaded = true;
+    }
+    GLuint program = 0;
+    if (shaderReloader->takeProgram(quantizeShaderId, program)) {
+        // The quantize program only exists with RGBA16F intermediates
+        if (quantizeProgram) {
+            setQuantizeProgram(program);
+            reloaded = true;
+        } else {
+            glDeleteProgram(program);
+        }
+    }
+    if (shaderReloader->takeProgram(yuvShaderId, program)) {
+        setYuvProgram(program);
+        reloaded = true;
+    }
+    if (shaderReloader->takeProgram(lutShaderId, program)) {
+        setLutProgram(program);
+        reloaded = luts.hasSelection() || reloaded;
+    }
+    if (shaderReloader->takeProgram(histogramShaderId, program)) {
+        // Only measured when enabled; the picture does not change
+        if (luminanceStats) {
+            histogram.setProgram(program);
+        } else {
+            glDeleteProgram(program);
+        }
+    }
+
+    // A feature switch is a swap to another prebuilt variant
+    ShaderVariants::Key features = tintFeatures;
+    if (features != activeTintFeatures) {
+        if (presentPath == PresentPath::Fused) {
+            activeTintFeatures = features;
+            reloaded = true;
+        } else if (tintPass >= 0 && passGraph.selectProgram(tintPass, tintVariants.get(features))) {
+            activeTintFeatures = features;
+            reloaded = true;
+        }
+    }
+    return reloaded;
+}
+
+void ComputePipeline::render(const PipelineFrame& frame, const PipelineOutput& output) {
+    // Compute passes bind the input as an image of the first frame's format;
+    // binding other storage would be invalid, so such a frame keeps the
+    // previous result on screen. YUV frames are converted to RGBA8 first.
+    bool fused = presentPath == PresentPath::Fused;
+    bool planar = frame.planes != PlaneFormat::Interleaved;
+    if (frame.texture && frame.target == GL_TEXTURE_2D &&
+        (planar ? inputFormat == GL_RGBA8 : frame.internalFormat == inputFormat)) {
+        TRACE_GPU_ZONE(fused ? "Fused tint" : "Compute passes");
+
+        // Precise profiling drains the pipeline before timing starts
+        if (timingMode == TimingMode::Precise) {
+            glFinish();
+        }
+        auto computeStartTime = std::chrono::high_resolution_clock::now();
+        if (timingMode == TimingMode::GpuTimer) {
+            computeTimer.begin();
+        }
+
+        // A YUV frame is drawn or processed as its RGBA8 conversion at the render size
+        PipelineFrame converted;
+        bool ready = !planar || convertPlanarInput(frame, output, converted);
+        const PipelineFrame& source = planar ? converted : frame;
+        if (!ready) {
+            // Conversion failed; the previous result stays up
+        } else if (fused) {
+            // The effect is the present draw; its cost follows the output size
+            drawFused(source, output);
+            if (luminanceStats) {
+                histogram.measure(source.texture, inputFormat, source.width, source.height);
+            }
+        } else {
+            // Run the effect chain at the render size; intermediate targets are only
+            // reallocated when that size changes
+            GLuint input = scaleInput(source, output);
+            processedWidth = input == source.texture ? source.width : output.renderWidth;
+            processedHeight = input == source.texture ? source.height : output.renderHeight;
+            bool blit = presentPath == PresentPath::Blit && intermediateFormat != GL_RGBA16F;
+            GLbitfield resultAccess = blit ? GL_FRAMEBUFFER_BARRIER_BIT : GL_TEXTURE_FETCH_BARRIER_BIT;
+            // A selected LUT reads the chain's result as an image; it is uploaded with its first frame
+            const LutTexture* lut = lutProgram ? luts.getSelected() : nullptr;
+            processedTexture = passGraph.execute(input, inputFormat, processedWidth, processedHeight, *quad,
+                                                 lut ? GL_SHADER_IMAGE_ACCESS_BARRIER_BIT : resultAccess);
+            if (lut) {
+                processedTexture = gradeWithLut(*lut, processedTexture, resultAccess);
+            }
+            if (luminanceStats) {
+                histogram.measure(input, inputFormat, processedWidth, processedHeight);
+            }
+        }
+
+        if (timingMode == TimingMode::GpuTimer) {
+            computeTimer.end();
+            collectGpuTimes();
+        } else if (timingMode == TimingMode::Precise) {
+            glFinish();
+            double computeTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - computeStartTime).count();
+            frameStats->record(FrameStage::Compute, computeTime);
+        }
+        if (luminanceStats) {
+            collectLuminance();
+        }
+        checkGLError("ComputePipeline::render");
+    }
+
+    if (!fused && processedTexture) {
+        present(output);
+    }
+}
+
+void ComputePipeline::drawFused(const PipelineFrame& frame, const PipelineOutput& output) {
+    GLuint program = fusedVariants.get(activeTintFeatures);
+    if (!program) {
+        return;
+    }
+    glViewport(output.x, output.y, output.width, output.height);
+    glUseProgram(program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, frame.texture);
+    quad->draw();
+    glUseProgram(0);
+}
+
+void ComputePipeline::present(const PipelineOutput& output) {
+    if (intermediateFormat == GL_RGBA16F) {
+        // The one place the half-float result is rounded to the back buffer's precision
+        drawQuantized(output);
+        return;
+    }
+    if (presentPath == PresentPath::Draw) {
+        // The display draw scales the result up to the output viewport
+        PipelineFrame processed = { processedTexture, GL_TEXTURE_2D, 0, processedWidth, processedHeight, intermediateFormat };
+        display.render(processed, output);
+        return;
+    }
+
+    // Copy (or filter, when the render size is smaller) straight into the back
+    // buffer; the quad's texture coordinates put row 0 at the bottom, as the blit does
+    TRACE_GPU_ZONE("Blit frame");
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, presentFramebuffer);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, processedTexture, 0);
+    blitToOutput(processedWidth, processedHeight, output);
+    checkGLError("ComputePipeline::present");
+}
+
+void ComputePipeline::blitToOutput(int width, int height, const PipelineOutput& output) {
+    bool scaled = width != output.width || height != output.height;
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, output.x, output.y, output.x + output.width, output.y + output.height,
+                      GL_COLOR_BUFFER_BIT, scaled ? GL_LINEAR : GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+int ComputePipeline::getBatchSize() const {
+    // Any other pass chain, present path or format goes frame by frame
+    bool batchable = tintPass >= 0 && passGraph.getPassCount() == 1 && presentPath == PresentPath::Blit &&
+                     inputFormat == GL_RGBA8 && intermediateFormat == GL_RGBA8 && !luts.hasSelection();
+    return batchable ? batchSize : 1;
+}
+
+bool ComputePipeline::processBatch(const PipelineFrame& layers, int count) {
+    if (getBatchSize() <= 1 || count <= 0 || count > batchSize || layers.target != GL_TEXTURE_2D_ARRAY ||
+        layers.internalFormat != GL_RGBA8) {
+        return false;
+    }
+    // Built on first use and whenever the feature set or shader changed
+    if (!batchProgram || batchFeatures != activeTintFeatures) {
+        if (batchProgram) {
+            glDeleteProgram(batchProgram);
+        }
+        std::string source = tintVariants.specialize({tintTemplate}, activeTintFeatures)[0];
+        batchProgram = buildTintProgram(ShaderVariants::insertDefines(source, "#define BATCH 1\n"));
+        batchFeatures = activeTintFeatures;
+        if (!batchProgram) {
+            std::cerr << "Failed to build the batched tint program, exporting frame by frame" << std::endl;
+            batchSize = 1;
+            return false;
+        }
+        glUseProgram(batchProgram);
+        glUniform1f(glGetUniformLocation(batchProgram, "uBrightThreshold"), kBrightThreshold);
+        glUniform1f(glGetUniformLocation(batchProgram, "uBrightGain"), kBrightGain);
+        glUseProgram(0);
+        batchVerified = false;
+    }
+    if (!ensureBatchOutput(layers.width, layers.height)) {
+        return false;
+    }
+
+    TRACE_GPU_ZONE("Batched tint");
+    if (timingMode == TimingMode::Precise) {
+        glFinish();
+    }
+    auto computeStartTime = std::chrono::high_resolution_clock::now();
+    if (timingMode == TimingMode::GpuTimer) {
+        computeTimer.begin();
+    }
+
+    // One dispatch covers every frame: z walks the layers. The frames run at
+    // their own size; presentBatchLayer() scales each one to the output.
+    glUseProgram(batchProgram);
+    glBindImageTexture(0, layers.texture, 0, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA8);
+    glBindImageTexture(1, batchOutput, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    GLuint numGroupsX = (layers.width + tintGroupSize.x - 1) / tintGroupSize.x;
+    GLuint numGroupsY = (layers.height + tintGroupSize.y - 1) / tintGroupSize.y;
+    glDispatchCompute(numGroupsX, numGroupsY, static_cast<GLuint>(count));
+    glUseProgram(0);
+    // Read next by the blits
+    glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+
+    if (timingMode == TimingMode::GpuTimer) {
+        computeTimer.end();
+        collectGpuTimes();
+    } else if (timingMode == TimingMode::Precise) {
+        glFinish();
+        double computeTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - computeStartTime).count();
+        frameStats->record(FrameStage::Compute, computeTime);
+    }
+    // Outside the timing, as it reads both results back
+    if (!batchVerified && !verifyBatch(layers)) {
+        batchSize = 1;
+        return false;
+    }
+    checkGLError("ComputePipeline::processBatch");
+    return true;
+}
+
+bool ComputePipeline::verifyBatch(const PipelineFrame& layers) {
+    // Layer 0 once more through the tint pass on its own, at the batch's size
+    // (scaledInput is free during batches: they run at the frame size)
+    batchVerified = true;
+    if (!scaledInput.ensureStorage(layers.width, layers.height, GL_RGBA8)) {
+        return true; // Nothing to compare with; keep batching
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, scaleFramebuffers[0]);
+    glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, layers.texture, 0, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, scaleFramebuffers[1]);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, scaledInput.getTexture(), 0);
+    glBlitFramebuffer(0, 0, layers.width, layers.height, 0, 0, layers.width, layers.height, GL_COLOR_BUFFER_BIT,
+                      GL_NEAREST);
+    GLuint single = passGraph.execute(scaledInput.getTexture(), GL_RGBA8, layers.width, layers.height, *quad,
+                                      GL_FRAMEBUFFER_BARRIER_BIT);
+
+    // One readback of each result, once per batch program
+    size_t bytes = static_cast<size_t>(layers.width) * layers.height * 4;
+    std::vector<unsigned char> batched(bytes);
+    std::vector<unsigned char> expected(bytes);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, presentFramebuffer);
+    glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, batchOutput, 0, 0);
+    glReadPixels(0, 0, layers.width, layers.height, GL_RGBA, GL_UNSIGNED_BYTE, batched.data());
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, single, 0);
+    glReadPixels(0, 0, layers.width, layers.height, GL_RGBA, GL_UNSIGNED_BYTE, expected.data());
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // Both run the same variant on the same texels, so they may only differ by rounding
+    size_t mismatches = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        mismatches += std::abs(batched[i] - expected[i]) > 1 ? 1 : 0;
+    }
+    if (mismatches > 0) {
+        std::cerr << "Batched tint differs from the frame-by-frame result in " << mismatches
+                  << " channels, exporting frame by frame" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ComputePipeline::presentBatchLayer(int layer, const PipelineOutput& output) {
+    if (!batchOutput) {
+        return;
+    }
+    TRACE_GPU_ZONE("Blit frame");
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, presentFramebuffer);
+    glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, batchOutput, 0, layer);
+    blitToOutput(batchWidth, batchHeight, output);
+    checkGLError("ComputePipeline::presentBatchLayer");
+}
+
+bool ComputePipeline::ensureBatchOutput(int width, int height) {
+    if (batchOutput && batchWidth == width && batchHeight == height) {
+        return true;
+    }
+    if (batchOutput) {
+        glDeleteTextures(1, &batchOutput);
+    }
+    // Immutable storage, so every layer can be bound as an image
+    glGenTextures(1, &batchOutput);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, batchOutput);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, width, height, batchSize);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    if (glGetError() != GL_NO_ERROR) {
+        std::cerr << "Failed to allocate the batch output (" << width << "x" << height << ", " << batchSize
+                  << " layers)" << std::endl;
+        glDeleteTextures(1, &batchOutput);
+        batchOutput = 0;
+        batchWidth = batchHeight = 0;
+        return false;
+    }
+    batchWidth = width;
+    batchHeight = height;
+    return true;
+}
+
+void ComputePipeline::setQuantizeProgram(GLuint program) {
+    if (quantizeProgram && quantizeProgram != program) {
+        glDeleteProgram(quantizeProgram);
+    }
+    quantizeProgram = program;
+    uQuantizeStepLocation = glGetUniformLocation(quantizeProgram, "uQuantizeStep");
+    glUseProgram(quantizeProgram);
+    glUniform1i(glGetUniformLocation(quantizeProgram, "uTexture"), 0);
+    glUseProgram(0);
+}
+
+void ComputePipeline::drawQuantized(const PipelineOutput& output) {
+    if (!quantizeProgram) {
+        return;
+    }
+    TRACE_GPU_ZONE("Quantize frame");
+    // The sampler filters the render-size result up to the output viewport
+    glViewport(output.x, output.y, output.width, output.height);
+    glUseProgram(quantizeProgram);
+    glUniform1f(uQuantizeStepLocation, quantizeStep);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, processedTexture);
+    quad->draw();
+    glUseProgram(0);
+    checkGLError("ComputePipeline::drawQuantized");
+}
+
+GLuint ComputePipeline::scaleInput(const PipelineFrame& frame, const PipelineOutput& output) {
+    if (output.renderWidth >= frame.width && output.renderHeight >= frame.height) {
+        return frame.texture;
+    }
+    // Blitting half floats needs them to be framebuffer attachments; otherwise the passes run at full size
+    if (inputFormat == GL_RGBA16F && !floatRenderable) {
+        return frame.texture;
+    }
+    if (!scaledInput.ensureStorage(output.renderWidth, output.renderHeight, inputFormat)) {
+        return frame.texture;
+    }
+
+    // Framebuffer writes are coherent with the image loads of the first pass, so no barrier is needed
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, scaleFramebuffers[0]);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frame.texture, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, scaleFramebuffers[1]);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, scaledInput.getTexture(), 0);
+    glBlitFramebuffer(0, 0, frame.width, frame.height, 0, 0, output.renderWidth, output.renderHeight,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return scaledInput.getTexture();
+}
+
+void ComputePipeline::setYuvProgram(GLuint program) {
+    if (yuvProgram && yuvProgram != program) {
+        glDeleteProgram(yuvProgram);
+    }
+    yuvProgram = program;
+    uYuvChromaSelectLocation = glGetUniformLocation(yuvProgram, "uChromaSelect");
+}
+
+bool ComputePipeline::convertPlanarInput(const PipelineFrame& frame, const PipelineOutput& output,
+                                         PipelineFrame& converted) {
+    if (!yuvProgram || !scaledInput.ensureStorage(output.renderWidth, output.renderHeight, GL_RGBA8)) {
+        return false;
+    }
+    TRACE_GPU_ZONE("YUV to RGB");
+
+    // Sampler units are fixed by the shader's bindings; NV12 reads U and V from one texture
+    bool nv12 = frame.planes == PlaneFormat::NV12;
+    glUseProgram(yuvProgram);
+    glUniform2f(uYuvChromaSelectLocation, nv12 ? 0.0f : 1.0f, nv12 ? 1.0f : 0.0f);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, frame.chromaTextures[0]);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, frame.chromaTextures[nv12 ? 0 : 1]);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, frame.texture);
+    glBindImageTexture(1, scaledInput.getTexture(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    glDispatchCompute((output.renderWidth + 7) / 8, (output.renderHeight + 7) / 8, 1);
+    glUseProgram(0);
+
+    // Read next as an image by the first pass, or sampled by the fused draw
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    converted = { scaledInput.getTexture(), GL_TEXTURE_2D, 0, output.renderWidth, output.renderHeight, GL_RGBA8 };
+    return true;
+}
+
+GLuint ComputePipeline::buildLutProgram(const std::string& source) {
+    // Reads and writes intermediates
+    return ShaderProgram::createCompute(PassGraph::withImageFormats(source, intermediateFormat, intermediateFormat).c_str());
+}
+
+void ComputePipeline::setLutProgram(GLuint program) {
+    if (lutProgram && lutProgram != program) {
+        glDeleteProgram(lutProgram);
+    }
+    lutProgram = program;
+    uLutScaleLocation = glGetUniformLocation(lutProgram, "uLutScale");
+    uLutOffsetLocation = glGetUniformLocation(lutProgram, "uLutOffset");
+}
+
+GLuint ComputePipeline::gradeWithLut(const LutTexture& lut, GLuint texture, GLbitfield resultAccess) {
+    if (!gradedOutput.ensureStorage(processedWidth, processedHeight, intermediateFormat)) {
+        glMemoryBarrier(resultAccess);
+        return texture;
+    }
+    TRACE_GPU_ZONE("LUT grade");
+
+    // The LUT's sampler unit is fixed by the shader's binding
+    glUseProgram(lutProgram);
+    glUniform3fv(uLutScaleLocation, 1, lut.scale);
+    glUniform3fv(uLutOffsetLocation, 1, lut.offset);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_3D, lut.texture);
+    glActiveTexture(GL_TEXTURE0);
+    glBindImageTexture(0, texture, 0, GL_FALSE, 0, GL_READ_ONLY, intermediateFormat);
+    glBindImageTexture(1, gradedOutput.getTexture(), 0, GL_FALSE, 0, GL_WRITE_ONLY, intermediateFormat);
+    glDispatchCompute((processedWidth + 15) / 16, (processedHeight + 15) / 16, 1);
+    glUseProgram(0);
+    glMemoryBarrier(resultAccess);
+    return gradedOutput.getTexture();
+}
+
+GLuint ComputePipeline::buildHistogramProgram(const std::string& source) {
+    // Reads the frame the passes read, in its format
+    return ShaderProgram::createCompute(PassGraph::withImageFormats(source, inputFormat, inputFormat).c_str());
+}
+
+void ComputePipeline::collectLuminance() {
+    // Results arrive a few frames late; keep the newest the GPU has finished
+    LuminanceStats stats;
+    bool collected = false;
+    while (histogram.collect(stats)) {
+        collected = true;
+    }
+    if (collected) {
+        std::lock_guard<std::mutex> lock(luminanceMutex);
+        latestLuminance = stats;
+        hasLuminance = true;
+    }
+}
+
+bool ComputePipeline::getLuminanceStats(LuminanceStats& stats) const {
+    std::lock_guard<std::mutex> lock(luminanceMutex);
+    if (hasLuminance) {
+        stats = latestLuminance;
+    }
+    return hasLuminance;
+}
+
+void ComputePipeline::reportStats(std::ostream& out) {
+    LuminanceStats stats;
+    if (!luminanceStats || !getLuminanceStats(stats)) {
+        return;
+    }
+    out << "Luminance (measurement " << stats.frame << "): min " << stats.minimum << ", mean " << stats.mean
+        << ", max " << stats.maximum << ", median " << stats.percentile(0.5) << ", p99 " << stats.percentile(0.99)
+        << " (" << histogram.getSkippedCount() << " frames skipped)" << std::endl;
+}
+
+void ComputePipeline::addGpuAllocations(std::vector<GpuAllocation>& allocations) const {
+    allocations.push_back({ "Pass targets", passGraph.getMemoryBytes() });
+    allocations.push_back({ "Scaled input", scaledInput.getMemoryBytes() });
+    allocations.push_back({ "Graded output", gradedOutput.getMemoryBytes() });
+    allocations.push_back({ "LUTs", luts.getMemoryBytes() });
+    if (batchOutput) {
+        allocations.push_back({ "Batch output", TextureUploader::estimateBytes(GL_RGBA8, batchWidth, batchHeight, batchSize) });
+    }
+}
+
+void ComputePipeline::collectGpuTimes() {
+    // Results arrive a few frames late; drain whatever the GPU has finished
+    double computeTime;
+    while (computeTimer.collect(computeTime)) {
+        frameStats->record(FrameStage::Compute, computeTime);
+        TRACE_GPU_TIME("Compute passes", computeTime);
+    }
+}
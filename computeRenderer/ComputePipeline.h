@@ -0,0 +1,391 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../render/RenderPipeline.h"
+#include "../render/FragmentPipeline.h"
+#include "../render/LutCache.h"
+#include "../render/ShaderVariants.h"
+#include "LuminanceHistogram.h"
+#include "PassGraph.h"
+#include "WorkGroupTuner.h"
+
+// Runs the frame through a chain of post-processing passes (compute shaders
+// by default) at the output's render size and presents the result (see
+// PresentPath). Needs ES 3.1; frames are stored RGBA8 (RGBA16F for half-float
+// frames) so the first pass can bind them as an image, which also rules out
+// resident sequences and compressed uploads. YUV frames arrive as planes and
+// a first compute stage (shaders/yuv.comp) converts them to RGBA8 at the
+// render size, in place of the downscale blit.
+//
+// With high precision the passes exchange RGBA16F intermediates instead of
+// RGBA8, so grading chains do not band, and a single quantize draw
+// (shaders/quantize.frag) dithers the result into the back buffer. The input
+// stays in the frame's own format and only the intermediates pay for fp16.
+//
+// A selected 3D LUT grades the chain's result in one more dispatch
+// (shaders/lut.comp); the LUTs are stored in the intermediate format.
+class ComputePipeline : public RenderPipeline {
+public:
+    // Optional features of the default tint pass, combined into a variant key
+    enum TintFeature : ShaderVariants::Key {
+        TintShadows = 1,         // Cool tint on dark areas
+        BrightenHighlights = 2,  // Gain on bright areas
+        FlipVertical = 4,
+        AllTintFeatures = 7
+    };
+
+    // How the processed frame reaches the back buffer
+    enum class PresentPath {
+        Draw,   // Fullscreen draw with the display program (applies edits to display.frag)
+        Blit,   // glBlitFramebuffer of the last pass's result, no extra program
+        Fused   // No passes: the default tint runs in the fragment shader drawing the
+                // input to the screen (shaders/tint.frag), saving a full write and read
+                // of an intermediate target. Needs the default tint and no LUT
+                // selected when the pipeline starts; otherwise Blit.
+    };
+
+    ComputePipeline();
+
+    const char* getName() const override { return "compute"; }
+    int getMinimumClientVersion() const override { return 3; }
+    bool requiresRGBA() const override { return true; }
+    bool supportsPlanarFrames() const override { return true; }
+
+    // Append a post-processing pass (call before start). Compute effects read
+    // image unit 0 and write image unit 1, declared with the INPUT_FORMAT and
+    // OUTPUT_FORMAT qualifiers (see PassGraph::withImageFormats); fragment effects
+    // sample uTexture and use the display vertex shader. Without effects the
+    // default tint pass runs.
+    void addEffect(PassGraph::PassType type, const std::string& source);
+
+    // Time the default pass with several work-group sizes on the first frame and
+    // keep the fastest (call before start). The winner is cached per GPU and
+    // driver in cachePath, so only the first run on a machine pays for tuning.
+    void setWorkGroupTuning(bool enabled, const std::string& cachePath = "workgroup_tuning.cache");
+    // Work-group size of the default pass without tuning (call before start; default 16x16)
+    void setWorkGroupSize(WorkGroupTuner::Size size) { tintGroupSize = size; }
+
+    // TintFeature bits the default pass applies (any thread; default
+    // TintShadows | BrightenHighlights). Every combination is compiled when the
+    // pipeline starts, so switching takes effect on the next frame without a compile.
+    void setTintFeatures(ShaderVariants::Key features) { tintFeatures = features & AllTintFeatures; }
+    ShaderVariants::Key getTintFeatures() const { return tintFeatures; }
+
+    // Present path (call before start; default Blit)
+    void setPresentPath(PresentPath path) { presentPath = path; }
+    // "draw", "blit" or "fused"; returns false for other names
+    static bool parsePresentPath(const std::string& name, PresentPath& path);
+
+    // RGBA16F intermediates and the quantize present instead of Draw or Blit
+    // (call before start). Fused has no intermediates and ignores it. Fragment
+    // effects need EXT_color_buffer_half_float for it, otherwise RGBA8 is kept.
+    void setHighPrecision(bool enabled) { highPrecision = enabled; }
+
+    // Grade with a 3D LUT after the passes (see LutCache). The fused path has
+    // no pass to grade in and ignores LUTs selected after it started; batches
+    // go frame by frame while one is selected.
+    void setLut(const std::string& path) override { luts.select(path); }
+
+    // Batched export (call before start; default 1 = off): up to frames
+    // frames are bound as layers of an array image and tinted by a single
+    // dispatch over them, so small frames keep the GPU busy and the per-frame
+    // cost of issuing passes is paid once per batch. Needs the default tint,
+    // Blit presentation and RGBA8 frames and intermediates; batches run at the
+    // frame size and the blit scales each layer to the output.
+    void setBatchSize(int frames) { batchSize = std::max(frames, 1); }
+    int getBatchSize() const override;
+    bool processBatch(const PipelineFrame& layers, int count) override;
+    void presentBatchLayer(int layer, const PipelineOutput& output) override;
+
+    // Luminance statistics of every frame (call before start; default off):
+    // a histogram and min/max/mean of the frame the passes read, reduced on
+    // the GPU (shaders/histogram.comp, see LuminanceHistogram) and read back a
+    // few frames late without stalling. getLuminanceStats() returns the
+    // newest result, from any thread; reportStats() prints it with the stats.
+    void setLuminanceStats(bool enabled) { luminanceStats = enabled; }
+    bool getLuminanceStats(LuminanceStats& stats) const;
+    void reportStats(std::ostream& out) override;
+    void addGpuAllocations(std::vector<GpuAllocation>& allocations) const override;
+
+    void addShaders(ShaderReloader& reloader) override;
+    bool initialize(PipelineSetup& setup) override;
+    void destroy() override;
+    bool applyReloadedShaders() override;
+    void render(const PipelineFrame& frame, const PipelineOutput& output) override;
+
+private:
+    // Final draw of the processed frame to the back buffer
+    FragmentPipeline display;
+    ShaderReloader* shaderReloader;
+    FrameStats* frameStats;
+    FullscreenQuad* quad;
+
+    // Post-processing passes between the input texture and the display
+    struct EffectSource {
+        PassGraph::PassType type;
+        std::string source;
+    };
+    std::vector<EffectSource> effectSources;
+    PassGraph passGraph;
+    GLuint processedTexture;  // Result of the last passGraph run
+    int processedWidth;
+    int processedHeight;
+
+    // Presentation of the result
+    PresentPath presentPath;
+    GLuint presentFramebuffer;  // Read framebuffer of the blit
+
+    // Storage of the frames the first pass reads (from the first frame) and of
+    // the intermediates; RGBA16F intermediates are presented by the quantize draw
+    bool highPrecision;
+    GLenum inputFormat;
+    GLenum intermediateFormat;
+    bool floatRenderable;  // RGBA16F can be a framebuffer attachment (blits, fragment passes)
+    GLuint quantizeProgram;
+    GLint uQuantizeStepLocation;
+    float quantizeStep;    // One step of the back buffer's precision
+    int quantizeShaderId;
+
+    // 3D LUT grading of the result into gradedOutput, rebuilt from shaders/lut.comp when it changes
+    LutCache luts;
+    GLuint lutProgram;
+    GLint uLutScaleLocation;
+    GLint uLutOffsetLocation;
+    int lutShaderId;
+    TextureUploader gradedOutput;
+
+    // The frame reduced to the render size when that is smaller, so the
+    // passes only process the pixels that end up on screen
+    TextureUploader scaledInput;
+    GLuint scaleFramebuffers[2];  // Read (frame) and draw (scaledInput) for the blit
+
+    // YUV to RGBA8 conversion into scaledInput, rebuilt from shaders/yuv.comp when it changes
+    GLuint yuvProgram;
+    GLint uYuvChromaSelectLocation;
+    int yuvShaderId;
+
+    // Work-group size selection for the default pass
+    bool workGroupTuning;
+    std::string workGroupCachePath;
+
+    // The default pass: a variant per tint feature combination, rebuilt from
+    // shaders/tint.comp when it changes
+    ShaderVariants tintVariants;
+    std::atomic<ShaderVariants::Key> tintFeatures;
+    ShaderVariants::Key activeTintFeatures;  // Variant tintPass (or the fused draw) runs
+    ShaderVariants fusedVariants;            // The same features drawn by the fused path
+    int tintPass;  // Index of the default pass in passGraph, -1 with custom effects
+    std::string tintTemplate;  // Source the variants are built from
+    WorkGroupTuner::Size tintGroupSize;
+
+    // Batched export: the tint variant with BATCH defined (built for
+    // batchFeatures on first use) and the array it writes
+    int batchSize;
+    GLuint batchProgram;
+    ShaderVariants::Key batchFeatures;
+    GLuint batchOutput;
+    int batchWidth;
+    int batchHeight;
+    bool batchVerified;  // The current batch program was compared with the tint pass
+
+    // Luminance statistics, rebuilt from shaders/histogram.comp when it changes
+    bool luminanceStats;
+    LuminanceHistogram histogram;
+    int histogramShaderId;
+    mutable std::mutex luminanceMutex;
+    LuminanceStats latestLuminance;  // Newest collected result (under luminanceMutex)
+    bool hasLuminance;
+
+    // Performance measurement; the display pipeline times the draw
+    TimingMode timingMode;
+    GpuTimer computeTimer;  // The pass graph
+
+    // Built-in tint shader; the work-group size and image formats are defined when the program is built
+    const char* computeShaderSource = R"(
+        #version 310 es
+        layout(local_size_x = LOCAL_SIZE_X, local_size_y = LOCAL_SIZE_Y) in;
+        #ifdef BATCH
+        // Batched export: each layer of the arrays is a frame, gl_GlobalInvocationID.z picks it
+        layout(binding = 0, INPUT_FORMAT) uniform readonly highp image2DArray inputImage;
+        layout(binding = 1, OUTPUT_FORMAT) uniform writeonly highp image2DArray outputImage;
+        #else
+        layout(binding = 0, INPUT_FORMAT) uniform readonly highp image2D inputImage;
+        layout(binding = 1, OUTPUT_FORMAT) uniform writeonly highp image2D outputImage;
+        #endif
+        uniform float uBrightThreshold;
+        uniform float uBrightGain;
+
+        // Each combination of TINT (cool tint on dark areas), BRIGHTEN (gain on
+        // bright areas) and FLIP (vertical flip) is compiled as its own variant
+        void main() {
+            // Get the pixel coordinate
+        #ifdef BATCH
+            ivec3 pixelCoord = ivec3(gl_GlobalInvocationID);
+        #else
+            ivec2 pixelCoord = ivec2(gl_GlobalInvocationID.xy);
+        #endif
+
+            // Read the input pixel
+            vec4 texColor = imageLoad(inputImage, pixelCoord);
+
+        #if defined(TINT) || defined(BRIGHTEN)
+            // 1.0 for bright pixels, 0.0 for dark ones: picks the effect without branching
+            float luminance = dot(texColor.rgb, vec3(0.299, 0.587, 0.114));
+            float bright = step(uBrightThreshold, luminance);
+        #endif
+        #ifdef BRIGHTEN
+            texColor.rgb *= mix(1.0, uBrightGain, bright);
+        #endif
+        #ifdef TINT
+            texColor.rgb *= mix(vec3(0.8, 0.9, 1.1), vec3(1.0), bright);
+        #endif
+
+            // Ensure values are in valid range
+            texColor = clamp(texColor, 0.0, 1.0);
+
+        #ifdef FLIP
+            pixelCoord.y = imageSize(outputImage).y - 1 - pixelCoord.y;
+        #endif
+
+            // Write the output pixel
+            imageStore(outputImage, pixelCoord, texColor);
+        }
+    )";
+
+    // Built-in YUV conversion shader
+    const char* yuvComputeSource = R"(
+        #version 310 es
+        layout(local_size_x = 8, local_size_y = 8) in;
+        layout(binding = 0) uniform mediump sampler2D uTexture;   // Y plane
+        layout(binding = 1) uniform mediump sampler2D uChromaU;   // U plane (I420), or the interleaved U,V pairs (NV12)
+        layout(binding = 2) uniform mediump sampler2D uChromaV;   // V plane (I420), or the U,V pairs again (NV12)
+        layout(binding = 1, rgba8) uniform writeonly mediump image2D outputImage;
+        uniform mediump vec2 uChromaSelect;  // Picks V from uChromaV: (1, 0) for I420, (0, 1) for NV12
+
+        // The compute pipeline's first stage for YUV frames: 4:2:0 planes to RGBA8
+        // at the render size, video-range BT.709 as in yuv.frag. Filtered sampling
+        // scales the planes in the same step, so no separate downscale is needed.
+        void main() {
+            ivec2 pixelCoord = ivec2(gl_GlobalInvocationID.xy);
+            ivec2 size = imageSize(outputImage);
+            if (pixelCoord.x >= size.x || pixelCoord.y >= size.y) {
+                return;
+            }
+            vec2 texCoord = (vec2(pixelCoord) + 0.5) / vec2(size);
+
+            mediump vec3 yuv = vec3(texture(uTexture, texCoord).r,
+                                    texture(uChromaU, texCoord).r,
+                                    dot(texture(uChromaV, texCoord).rg, uChromaSelect));
+            yuv -= vec3(0.0627451, 0.5019608, 0.5019608);
+            mediump vec3 rgb = mat3(1.1643836, 1.1643836, 1.1643836,
+                                    0.0, -0.2132486, 2.1124018,
+                                    1.7927411, -0.5329093, 0.0) * yuv;
+            imageStore(outputImage, pixelCoord, vec4(clamp(rgb, 0.0, 1.0), 1.0));
+        }
+    )";
+
+    // Built-in LUT grading shader; the image formats are defined when the program is built
+    const char* lutComputeSource = R"(
+        #version 310 es
+        layout(local_size_x = 16, local_size_y = 16) in;
+        layout(binding = 0, INPUT_FORMAT) uniform readonly highp image2D inputImage;
+        layout(binding = 1, OUTPUT_FORMAT) uniform writeonly highp image2D outputImage;
+        layout(binding = 2) uniform highp sampler3D uLut;
+        uniform vec3 uLutScale;   // Maps a color in the LUT's domain to texel centers
+        uniform vec3 uLutOffset;
+
+        // One trilinear lookup per pixel replaces the whole grade; alpha is kept
+        void main() {
+            ivec2 pixelCoord = ivec2(gl_GlobalInvocationID.xy);
+            ivec2 size = imageSize(inputImage);
+            if (pixelCoord.x >= size.x || pixelCoord.y >= size.y) {
+                return;
+            }
+            vec4 color = imageLoad(inputImage, pixelCoord);
+            vec3 graded = textureLod(uLut, color.rgb * uLutScale + uLutOffset, 0.0).rgb;
+            imageStore(outputImage, pixelCoord, vec4(graded, color.a));
+        }
+    )";
+
+    // Built-in fused present shader, drawn with the display vertex shader
+    const char* fusedFragmentSource = R"(
+        precision mediump float;
+        varying vec2 vTexCoord;
+        uniform sampler2D uTexture;
+        uniform float uBrightThreshold;
+        uniform float uBrightGain;
+
+        // The default tint effect applied while drawing to the screen (the compute
+        // pipeline's fused present path). Variants as in tint.comp.
+        void main() {
+            vec2 texCoord = vTexCoord;
+        #ifdef FLIP
+            texCoord.y = 1.0 - texCoord.y;
+        #endif
+            vec4 texColor = texture2D(uTexture, texCoord);
+
+        #if defined(TINT) || defined(BRIGHTEN)
+            float luminance = dot(texColor.rgb, vec3(0.299, 0.587, 0.114));
+            float bright = step(uBrightThreshold, luminance);
+        #endif
+        #ifdef BRIGHTEN
+            texColor.rgb *= mix(1.0, uBrightGain, bright);
+        #endif
+        #ifdef TINT
+            texColor.rgb *= mix(vec3(0.8, 0.9, 1.1), vec3(1.0), bright);
+        #endif
+
+            gl_FragColor = clamp(texColor, 0.0, 1.0);
+        }
+    )";
+
+    // Built-in quantize present shader, drawn with the display vertex shader
+    const char* quantizeFragmentSource = R"(
+        precision highp float;
+        varying vec2 vTexCoord;
+        uniform sampler2D uTexture;
+        uniform float uQuantizeStep;
+
+        // Writes the half-float result of the passes to the back buffer. Up to
+        // half a step of ordered noise per pixel turns the rounding into a fine,
+        // stable grain instead of bands in smooth gradients.
+        void main() {
+            vec4 color = texture2D(uTexture, vTexCoord);
+            float noise = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+            color.rgb += (noise - 0.5) * uQuantizeStep;
+            gl_FragColor = clamp(color, 0.0, 1.0);
+        }
+    )";
+
+    GLuint buildTintProgram(const std::string& source);
+    GLuint buildFusedProgram(const std::vector<std::string>& sources);
+    void drawFused(const PipelineFrame& frame, const PipelineOutput& output);
+    void present(const PipelineOutput& output);
+    // Blit the attachment of presentFramebuffer (width x height) into the output viewport
+    void blitToOutput(int width, int height, const PipelineOutput& output);
+    bool ensureBatchOutput(int width, int height);
+    // Compare layer 0 of the first batch with the tint pass run on it alone;
+    // false if they differ
+    bool verifyBatch(const PipelineFrame& layers);
+    GLuint buildHistogramProgram(const std::string& source);
+    void collectLuminance();
+    void setQuantizeProgram(GLuint program);
+    void drawQuantized(const PipelineOutput& output);
+    // The frame at the render size: the frame itself, or scaledInput after a filtered blit
+    GLuint scaleInput(const PipelineFrame& frame, const PipelineOutput& output);
+    void setYuvProgram(GLuint program);
+    GLuint buildLutProgram(const std::string& source);
+    void setLutProgram(GLuint program);
+    // Grade texture (the chain's result) into gradedOutput, made visible to
+    // resultAccess; returns the texture to present
+    GLuint gradeWithLut(const LutTexture& lut, GLuint texture, GLbitfield resultAccess);
+    // Convert a YUV frame into scaledInput at the render size; false if it cannot be
+    bool convertPlanarInput(const PipelineFrame& frame, const PipelineOutput& output, PipelineFrame& converted);
+    bool createPasses(ImageLoader& imageLoader);
+    // Read back finished compute timings into frameStats
+    void collectGpuTimes();
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+// Weight tables of the effect library (see EffectLibrary), generated at
+// compile time. Every radius up to kMaxRadius has its own table, so a shader
+// gets its weights as literals from a table the compiler already built and
+// checked, instead of fetching a uniform array per pixel.
+namespace EffectKernels {
+
+// Largest blur radius with a table; a (2 * 8 + 1)^2 unsharp tile still fits
+// in the shared memory ES 3.1 guarantees (see TiledKernels)
+constexpr int kMaxRadius = 8;
+// Entries of the tone curve, spread evenly over 0-1
+constexpr int kCurvePoints = 33;
+
+// e^x for constant expressions (std::exp is not constexpr): a Taylor series
+// of x / 2^k, squared k times
+constexpr double exponential(double x) {
+    int halvings = 0;
+    while (x > 0.5 || x < -0.5) {
+        x /= 2.0;
+        ++halvings;
+    }
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 16; ++n) {
+        term *= x / n;
+        sum += term;
+    }
+    for (; halvings > 0; --halvings) {
+        sum *= sum;
+    }
+    return sum;
+}
+
+template <size_t N>
+constexpr float sum(const std::array<float, N>& weights) {
+    float total = 0.0f;
+    for (size_t i = 0; i < N; ++i) {
+        total += weights[i];
+    }
+    return total;
+}
+
+constexpr bool isNormalized(float total) {
+    return total > 0.99999f && total < 1.00001f;
+}
+
+// Normalized 1D Gaussian with sigma = radius / 2 (taps up to 2 sigma out)
+template <int Radius>
+constexpr std::array<float, 2 * Radius + 1> gaussian() {
+    std::array<float, 2 * Radius + 1> weights{};
+    double total = 0.0;
+    for (int i = -Radius; i <= Radius; ++i) {
+        double w = Radius == 0 ? 1.0 : exponential(-2.0 * i * i / (static_cast<double>(Radius) * Radius));
+        weights[i + Radius] = static_cast<float>(w);
+        total += w;
+    }
+    for (float& w : weights) {
+        w = static_cast<float>(w / total);
+    }
+    return weights;
+}
+
+template <int Radius>
+constexpr std::array<float, 2 * Radius + 1> box() {
+    std::array<float, 2 * Radius + 1> weights{};
+    for (float& w : weights) {
+        w = 1.0f / (2 * Radius + 1);
+    }
+    return weights;
+}
+
+// Outer product of a 1D kernel with itself, row-major, for single-pass 2D filters
+template <size_t N>
+constexpr std::array<float, N * N> outer(const std::array<float, N>& weights) {
+    std::array<float, N * N> product{};
+    for (size_t y = 0; y < N; ++y) {
+        for (size_t x = 0; x < N; ++x) {
+            product[y * N + x] = weights[y] * weights[x];
+        }
+    }
+    return product;
+}
+
+// Contrast S-curve (halfway between identity and smoothstep) as a 1D LUT
+template <int Points>
+constexpr std::array<float, Points> contrastCurve() {
+    std::array<float, Points> curve{};
+    for (int i = 0; i < Points; ++i) {
+        double x = static_cast<double>(i) / (Points - 1);
+        curve[i] = static_cast<float>(0.5 * x + 0.5 * x * x * (3.0 - 2.0 * x));
+    }
+    return curve;
+}
+
+template <int Radius>
+inline constexpr std::array<float, 2 * Radius + 1> kGaussian = gaussian<Radius>();
+template <int Radius>
+inline constexpr std::array<float, (2 * Radius + 1) * (2 * Radius + 1)> kGaussian2D = outer(kGaussian<Radius>);
+template <int Radius>
+inline constexpr std::array<float, 2 * Radius + 1> kBox = box<Radius>();
+inline constexpr std::array<float, kCurvePoints> kContrastCurve = contrastCurve<kCurvePoints>();
+
+static_assert(isNormalized(sum(kGaussian<1>)) && isNormalized(sum(kGaussian<kMaxRadius>)),
+              "Gaussian weights must sum to 1");
+static_assert(isNormalized(sum(kGaussian2D<kMaxRadius>)), "2D Gaussian weights must sum to 1");
+static_assert(isNormalized(sum(kBox<kMaxRadius>)), "Box weights must sum to 1");
+static_assert(kContrastCurve[0] == 0.0f && kContrastCurve[kCurvePoints - 1] == 1.0f, "The curve must keep black and white");
+
+// The tables of every radius, indexed by radius (2 * radius + 1 weights
+// each, or (2 * radius + 1)^2 in row-major order for the 2D ones)
+template <size_t... Radii>
+constexpr std::array<const float*, sizeof...(Radii)> gaussianTables(std::index_sequence<Radii...>) {
+    return { { kGaussian<static_cast<int>(Radii)>.data()... } };
+}
+template <size_t... Radii>
+constexpr std::array<const float*, sizeof...(Radii)> gaussian2DTables(std::index_sequence<Radii...>) {
+    return { { kGaussian2D<static_cast<int>(Radii)>.data()... } };
+}
+template <size_t... Radii>
+constexpr std::array<const float*, sizeof...(Radii)> boxTables(std::index_sequence<Radii...>) {
+    return { { kBox<static_cast<int>(Radii)>.data()... } };
+}
+inline constexpr std::array<const float*, kMaxRadius + 1> kGaussianTables =
+    gaussianTables(std::make_index_sequence<kMaxRadius + 1>());
+inline constexpr std::array<const float*, kMaxRadius + 1> kGaussian2DTables =
+    gaussian2DTables(std::make_index_sequence<kMaxRadius + 1>());
+inline constexpr std::array<const float*, kMaxRadius + 1> kBoxTables =
+    boxTables(std::make_index_sequence<kMaxRadius + 1>());
+
+} // namespace EffectKernels
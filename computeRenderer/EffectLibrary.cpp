@@ -0,0 +1,144 @@
+#include "EffectLibrary.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include "ComputePipeline.h"
+#include "EffectKernels.h"
+#include "TiledKernels.h"
+
+// Image declarations shared by the library's own (untiled) shaders
+static const char* kImageHeader =
+    "#version 310 es\n"
+    "#ifndef INPUT_FORMAT\n"
+    "#define INPUT_FORMAT rgba8\n"
+    "#define OUTPUT_FORMAT rgba8\n"
+    "#endif\n"
+    "layout(local_size_x = 16, local_size_y = 16) in;\n"
+    "layout(binding = 0, INPUT_FORMAT) uniform readonly highp image2D inputImage;\n"
+    "layout(binding = 1, OUTPUT_FORMAT) uniform writeonly highp image2D outputImage;\n";
+
+static bool hasTable(int radius) {
+    if (radius < 0 || radius > EffectKernels::kMaxRadius) {
+        std::cerr << "Effect radius " << radius << " has no kernel table (0-" << EffectKernels::kMaxRadius << ")"
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static std::vector<std::string> separable(const float* table, int radius) {
+    std::vector<float> weights(table, table + 2 * radius + 1);
+    std::vector<std::string> passes = { TiledKernels::separablePass(radius, weights, true),
+                                        TiledKernels::separablePass(radius, weights, false) };
+    if (passes[0].empty() || passes[1].empty()) {
+        passes.clear();
+    }
+    return passes;
+}
+
+std::vector<std::string> EffectLibrary::gaussianBlur(int radius) {
+    return hasTable(radius) ? separable(EffectKernels::kGaussianTables[radius], radius) : std::vector<std::string>();
+}
+
+std::vector<std::string> EffectLibrary::boxBlur(int radius) {
+    return hasTable(radius) ? separable(EffectKernels::kBoxTables[radius], radius) : std::vector<std::string>();
+}
+
+std::string EffectLibrary::sharpen(float amount) {
+    return TiledKernels::convolution(1, TiledKernels::sharpenWeights(amount));
+}
+
+std::string EffectLibrary::unsharpMask(int radius, float amount) {
+    if (!hasTable(radius)) {
+        return std::string();
+    }
+    const float* table = EffectKernels::kGaussian2DTables[radius];
+    size_t side = static_cast<size_t>(2 * radius + 1);
+    return TiledKernels::unsharpMask(radius, std::vector<float>(table, table + side * side), amount);
+}
+
+std::string EffectLibrary::toneCurve(float amount) {
+    std::ostringstream src;
+    src << std::fixed << std::setprecision(8) << kImageHeader
+        << "const int CURVE_SEGMENTS = " << EffectKernels::kCurvePoints - 1 << ";\n"
+        << "const float AMOUNT = " << amount << ";\n"
+        << "const float CURVE[" << EffectKernels::kCurvePoints << "] = float[](";
+    for (int i = 0; i < EffectKernels::kCurvePoints; ++i) {
+        src << (i ? ", " : "") << EffectKernels::kContrastCurve[i];
+    }
+    src << ");\n";
+    src << R"(
+// Linear between the two entries around x
+float curve(float x) {
+    float position = clamp(x, 0.0, 1.0) * float(CURVE_SEGMENTS);
+    int entry = min(int(position), CURVE_SEGMENTS - 1);
+    return mix(CURVE[entry], CURVE[entry + 1], position - float(entry));
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    if (pixel.x >= imageSize(inputImage).x || pixel.y >= imageSize(inputImage).y) {
+        return;
+    }
+    vec4 color = imageLoad(inputImage, pixel);
+    vec3 graded = vec3(curve(color.r), curve(color.g), curve(color.b));
+    imageStore(outputImage, pixel, vec4(mix(color.rgb, graded, AMOUNT), color.a));
+}
+)";
+    return src.str();
+}
+
+// A parameter of a list entry, or fallback when the entry has no more
+static bool nextParameter(std::istringstream& fields, double fallback, double& value) {
+    std::string text;
+    if (!std::getline(fields, text, ':')) {
+        value = fallback;
+        return true;
+    }
+    char* end = nullptr;
+    value = strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0';
+}
+
+bool EffectLibrary::addEffects(ComputePipeline& pipeline, const std::string& list) {
+    std::istringstream entries(list);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        std::istringstream fields(entry);
+        std::string name;
+        std::getline(fields, name, ':');
+        double radius = 0.0;
+        double amount = 0.0;
+        std::vector<std::string> sources;
+        bool ok = true;
+        if (name == "blur" || name == "box") {
+            ok = nextParameter(fields, 2.0, radius);
+            sources = ok ? (name == "blur" ? gaussianBlur(static_cast<int>(radius)) : boxBlur(static_cast<int>(radius)))
+                         : sources;
+        } else if (name == "sharpen") {
+            ok = nextParameter(fields, 0.5, amount);
+            sources = { sharpen(static_cast<float>(amount)) };
+        } else if (name == "unsharp") {
+            ok = nextParameter(fields, 2.0, radius) && nextParameter(fields, 0.8, amount);
+            sources = { unsharpMask(static_cast<int>(radius), static_cast<float>(amount)) };
+        } else if (name == "curve") {
+            ok = nextParameter(fields, 1.0, amount);
+            sources = { toneCurve(static_cast<float>(amount)) };
+        } else {
+            ok = false;
+        }
+        std::string extra;
+        if (!ok || std::getline(fields, extra) || sources.empty() || sources[0].empty()) {
+            std::cerr << "Invalid effect: " << entry
+                      << " (use blur[:radius], box[:radius], sharpen[:amount], unsharp[:radius[:amount]] or curve[:amount])"
+                      << std::endl;
+            return false;
+        }
+        for (const std::string& source : sources) {
+            pipeline.addEffect(PassGraph::PassType::Compute, source);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+class ComputePipeline;
+
+// Image-space effects for the compute pipeline's pass chain, built as
+// compute sources for ComputePipeline::addEffect (image unit 0 in, unit 1
+// out, formats from PassGraph::withImageFormats, rgba8 without it).
+//
+// The weights come from the compile-time tables of EffectKernels and are
+// written into the source as literals, one unrolled statement per tap, so
+// each effect and radius is its own specialized shader and no pass reads a
+// uniform weight array. Neighborhood filters run on shared-memory tiles (see
+// TiledKernels). The builders return no sources for radii without a table
+// (0 to EffectKernels::kMaxRadius).
+class EffectLibrary {
+public:
+    // Separable Gaussian (sigma = radius / 2) or box blur: a horizontal and a vertical pass
+    static std::vector<std::string> gaussianBlur(int radius);
+    static std::vector<std::string> boxBlur(int radius);
+
+    // 3x3 sharpen: identity plus amount times a Laplacian
+    static std::string sharpen(float amount);
+    // Adds amount times each pixel's difference from its Gaussian blur of
+    // the radius, in one pass over a (2 * radius + 1)^2 tile
+    static std::string unsharpMask(int radius, float amount);
+
+    // Contrast S-curve as a 1D LUT per channel, blended with the input by amount
+    static std::string toneCurve(float amount);
+
+    // Append the effects of a comma-separated list to the pipeline, in order:
+    //   blur[:radius]             Gaussian blur (radius 2 by default)
+    //   box[:radius]              box blur (radius 2)
+    //   sharpen[:amount]          3x3 sharpen (0.5)
+    //   unsharp[:radius[:amount]] unsharp mask (radius 2, amount 0.8)
+    //   curve[:amount]            contrast curve (1)
+    // Returns false, naming the entry, for unknown effects and bad parameters.
+    static bool addEffects(ComputePipeline& pipeline, const std::string& list);
+};
@@ -0,0 +1,215 @@
+#include "LuminanceHistogram.h"
+
+#include <algorithm>
+#include <iostream>
+
+// Layout of the storage buffer (std430): the bins, then the reduced values.
+// Luma is 16-bit fixed point; the sum carries into a second word, so frames
+// of any size fit.
+enum StatsWord {
+    MinimumWord = LuminanceStats::kBins,
+    MaximumWord,
+    SumLowWord,
+    SumHighWord,
+    StatsWordCount
+};
+static const GLsizeiptr kBufferBytes = StatsWordCount * sizeof(uint32_t);
+static const double kLumaScale = 65535.0;
+
+static const char* kHistogramSource = R"(#version 310 es
+layout(local_size_x = 16, local_size_y = 16) in;
+layout(binding = 0, INPUT_FORMAT) uniform readonly highp image2D inputImage;
+layout(std430, binding = 0) buffer LuminanceStats {
+    uint bins[256];
+    uint minimum;
+    uint maximum;
+    uint sumLow;
+    uint sumHigh;
+} stats;
+
+// One slot per invocation: the group's histogram, then the reduction
+shared uint localBins[256];
+shared uint localMin[256];
+shared uint localMax[256];
+shared uint localSum[256];
+
+void main() {
+    uint index = gl_LocalInvocationIndex;
+    localBins[index] = 0u;
+    memoryBarrierShared();
+    barrier();
+
+    ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+    bool inside = all(lessThan(coord, imageSize(inputImage)));
+    uint luma = 0u;
+    if (inside) {
+        vec3 rgb = clamp(imageLoad(inputImage, coord).rgb, 0.0, 1.0);
+        luma = uint(dot(rgb, vec3(0.299, 0.587, 0.114)) * 65535.0 + 0.5);
+        atomicAdd(localBins[luma >> 8], 1u);
+    }
+    localMin[index] = inside ? luma : 65535u;
+    localMax[index] = luma;
+    localSum[index] = luma;
+    memoryBarrierShared();
+    barrier();
+
+    // Tree reduction of the group's minimum, maximum and sum (at most 256 * 65535)
+    for (uint stride = 128u; stride > 0u; stride >>= 1u) {
+        if (index < stride) {
+            localMin[index] = min(localMin[index], localMin[index + stride]);
+            localMax[index] = max(localMax[index], localMax[index + stride]);
+            localSum[index] += localSum[index + stride];
+        }
+        memoryBarrierShared();
+        barrier();
+    }
+
+    // One global atomic per non-empty bin and per reduced value
+    uint count = localBins[index];
+    if (count > 0u) {
+        atomicAdd(stats.bins[index], count);
+    }
+    if (index == 0u) {
+        atomicMin(stats.minimum, localMin[0]);
+        atomicMax(stats.maximum, localMax[0]);
+        uint previous = atomicAdd(stats.sumLow, localSum[0]);
+        if (previous + localSum[0] < previous) {
+            atomicAdd(stats.sumHigh, 1u); // The low word wrapped
+        }
+    }
+}
+)";
+
+float LuminanceStats::percentile(double fraction) const {
+    if (pixelCount == 0) {
+        return 0.0f;
+    }
+    double target = std::min(std::max(fraction, 0.0), 1.0) * static_cast<double>(pixelCount);
+    uint64_t below = 0;
+    for (int i = 0; i < kBins; ++i) {
+        below += bins[i];
+        if (static_cast<double>(below) >= target) {
+            return static_cast<float>(i + 1) / kBins;
+        }
+    }
+    return 1.0f;
+}
+
+LuminanceHistogram::LuminanceHistogram()
+    : program(0), writeIndex(0), readIndex(0), measured(0), skipped(0) {
+}
+
+const char* LuminanceHistogram::getDefaultSource() {
+    return kHistogramSource;
+}
+
+bool LuminanceHistogram::initialize(int latencyFrames) {
+    destroy();
+    slots.resize(std::max(latencyFrames, 1));
+    for (Slot& slot : slots) {
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, kBufferBytes, nullptr, GL_DYNAMIC_READ);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    if (glGetError() != GL_NO_ERROR) {
+        std::cerr << "Failed to create the luminance statistics buffers" << std::endl;
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+void LuminanceHistogram::destroy() {
+    for (Slot& slot : slots) {
+        if (slot.fence) {
+            glDeleteSync(slot.fence);
+        }
+        glDeleteBuffers(1, &slot.buffer);
+    }
+    slots.clear();
+    writeIndex = readIndex = 0;
+    if (program) {
+        glDeleteProgram(program);
+        program = 0;
+    }
+}
+
+void LuminanceHistogram::setProgram(GLuint newProgram) {
+    if (program && program != newProgram) {
+        glDeleteProgram(program);
+    }
+    program = newProgram;
+}
+
+bool LuminanceHistogram::measure(GLuint texture, GLenum format, int width, int height) {
+    if (!isReady() || width <= 0 || height <= 0) {
+        return false;
+    }
+    Slot& slot = slots[writeIndex];
+    if (slot.pending) {
+        ++skipped; // Never wait for the GPU: this frame goes unmeasured
+        return false;
+    }
+
+    // Reset the buffer: empty bins, minimum at the top of the range
+    uint32_t initial[StatsWordCount] = {};
+    initial[MinimumWord] = 65535u;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.buffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, kBufferBytes, initial);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glUseProgram(program);
+    glBindImageTexture(0, texture, 0, GL_FALSE, 0, GL_READ_ONLY, format);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, slot.buffer);
+    glDispatchCompute((width + 15) / 16, (height + 15) / 16, 1);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glUseProgram(0);
+    // Mapped by collect()
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    slot.pending = true;
+    slot.frame = ++measured;
+    slot.pixelCount = static_cast<uint64_t>(width) * height;
+    writeIndex = (writeIndex + 1) % slots.size();
+    return true;
+}
+
+bool LuminanceHistogram::collect(LuminanceStats& stats) {
+    if (slots.empty()) {
+        return false;
+    }
+    Slot& slot = slots[readIndex];
+    if (!slot.pending) {
+        return false;
+    }
+    // Poll only: an unfinished dispatch is collected on a later frame
+    GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        return false;
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    slot.pending = false;
+    readIndex = (readIndex + 1) % slots.size();
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.buffer);
+    const uint32_t* words = static_cast<const uint32_t*>(
+        glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, kBufferBytes, GL_MAP_READ_BIT));
+    bool mapped = words != nullptr;
+    if (mapped) {
+        stats.frame = slot.frame;
+        stats.pixelCount = slot.pixelCount;
+        std::copy(words, words + LuminanceStats::kBins, stats.bins);
+        stats.minimum = static_cast<float>(words[MinimumWord] / kLumaScale);
+        stats.maximum = static_cast<float>(words[MaximumWord] / kLumaScale);
+        uint64_t sum = static_cast<uint64_t>(words[SumHighWord]) << 32 | words[SumLowWord];
+        stats.mean = static_cast<float>(sum / kLumaScale / slot.pixelCount);
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+    } else {
+        std::cerr << "Failed to map the luminance statistics" << std::endl;
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return mapped;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <angle_gl.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Luminance statistics of one frame (Rec. 601 luma of the clamped RGB)
+struct LuminanceStats {
+    static const int kBins = 256;
+
+    uint64_t frame = 0;        // Number of the measurement (LuminanceHistogram::measure calls)
+    uint64_t pixelCount = 0;
+    uint32_t bins[kBins] = {};  // Pixels per 1/256 of the luma range
+    float minimum = 0.0f;      // In [0, 1], 16-bit precision
+    float maximum = 0.0f;
+    float mean = 0.0f;
+
+    // Luma below which the given fraction of pixels lies, to bin precision
+    // (e.g. 0.5 for the median, 0.99 for an auto-exposure white point)
+    float percentile(double fraction) const;
+};
+
+// GPU reduction of a frame into a luminance histogram plus min/max/mean,
+// for auto-exposure and QC without reading the frame back.
+//
+// measure() dispatches shaders/histogram.comp over an image: every 16x16 work
+// group counts its pixels into a 256-bin histogram in shared memory and
+// reduces its minimum, maximum and sum there, then adds the results to a
+// storage buffer with one atomic per bin, so global atomics do not scale
+// with the pixel count. Each measurement goes into the next buffer of a ring
+// (about 1 KB each) and is fenced; collect() maps buffers only once their fence
+// has signalled, typically a couple of frames later, so the CPU never waits
+// for the GPU. Like GpuTimer, a frame is skipped when the whole ring is in flight.
+class LuminanceHistogram {
+public:
+    LuminanceHistogram();
+
+    // Create the buffers (needs a current ES 3.1 context)
+    bool initialize(int latencyFrames = 3);
+    void destroy();
+
+    // Compute program of histogram.comp (the source, with INPUT_FORMAT set);
+    // takes ownership
+    void setProgram(GLuint program);
+    bool isReady() const { return program != 0 && !slots.empty(); }
+
+    // Measure a width x height image of the given format. Returns false if
+    // the frame was skipped (no program, or every buffer still in flight).
+    bool measure(GLuint texture, GLenum format, int width, int height);
+
+    // Fetch the oldest finished measurement. Returns false if none is ready yet.
+    bool collect(LuminanceStats& stats);
+
+    uint64_t getSkippedCount() const { return skipped; }
+
+    // Built-in histogram.comp, used when the file is missing or does not build
+    static const char* getDefaultSource();
+
+private:
+    struct Slot {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;  // Signalled once the dispatch into the buffer is complete
+        bool pending = false;
+        uint64_t frame = 0;
+        uint64_t pixelCount = 0;
+    };
+
+    GLuint program;
+    std::vector<Slot> slots;
+    size_t writeIndex;
+    size_t readIndex;
+    uint64_t measured;
+    uint64_t skipped;
+};
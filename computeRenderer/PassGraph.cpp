@@ -0,0 +1,300 @@
+#include "PassGraph.h"
+#include "../render/GpuTrace.h"
+#include "../render/ShaderVariants.h"
+
+#include <iostream>
+
+// Accesses that must see the results of an image store through a barrier
+static const GLbitfield kImageStoreConsumers =
+    GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT;
+
+// Image format qualifier matching a target or source storage format
+static const char* imageFormatName(GLenum format) {
+    return format == GL_RGBA16F ? "rgba16f" : "rgba8";
+}
+
+PassGraph::PassGraph()
+    : targetFormat(GL_RGBA8), framebuffers{0, 0}, attachedTextures{0, 0}, unsyncedBits{0, 0} {
+}
+
+std::string PassGraph::withImageFormats(const std::string& source, GLenum inputFormat, GLenum outputFormat) {
+    std::string defines = std::string("#define INPUT_FORMAT ") + imageFormatName(inputFormat) + "\n" +
+                          "#define OUTPUT_FORMAT " + imageFormatName(outputFormat) + "\n";
+    if (outputFormat == GL_RGBA16F) {
+        defines += "#define HALF_FLOAT_IMAGES\n";
+    }
+    return ShaderVariants::insertDefines(source, defines);
+}
+
+int PassGraph::addComputePass(const std::string& name, GLuint program) {
+    return addPass(name, PassType::Compute, program);
+}
+
+int PassGraph::addFragmentPass(const std::string& name, GLuint program) {
+    return addPass(name, PassType::Fragment, program);
+}
+
+int PassGraph::addPass(const std::string& name, PassType type, GLuint program) {
+    if (!program) {
+        std::cerr << "Pass " << name << " has no program" << std::endl;
+        return -1;
+    }
+
+    Pass pass;
+    pass.name = name;
+    pass.type = type;
+    pass.program = 0;
+    pass.ownsProgram = true;
+    bindProgram(pass, program);
+
+    passes.push_back(pass);
+    return static_cast<int>(passes.size() - 1);
+}
+
+bool PassGraph::replaceProgram(int pass, GLuint program) {
+    return switchProgram(pass, program, true);
+}
+
+bool PassGraph::selectProgram(int pass, GLuint program) {
+    return switchProgram(pass, program, false);
+}
+
+bool PassGraph::switchProgram(int pass, GLuint program, bool owned) {
+    if (pass < 0 || pass >= static_cast<int>(passes.size()) || !program) {
+        return false;
+    }
+    Pass& target = passes[pass];
+    if (target.program != program) {
+        if (target.ownsProgram) {
+            glDeleteProgram(target.program);
+        }
+        bindProgram(target, program);
+
+        // Uniform locations belong to the program. A uniform the new program
+        // does not use (e.g. of a feature another variant compiled out) keeps
+        // its value for the programs that do.
+        for (Uniform& uniform : target.uniforms) {
+            uniform.location = glGetUniformLocation(program, uniform.name.c_str());
+        }
+    }
+    target.ownsProgram = owned;
+    return true;
+}
+
+void PassGraph::bindProgram(Pass& pass, GLuint program) {
+    pass.program = program;
+    pass.groupSizeX = 1;
+    pass.groupSizeY = 1;
+
+    if (pass.type == PassType::Compute) {
+        // The dispatch size follows the local size the shader declares
+        GLint groupSize[3] = {1, 1, 1};
+        glGetProgramiv(program, GL_COMPUTE_WORK_GROUP_SIZE, groupSize);
+        pass.groupSizeX = groupSize[0] > 0 ? groupSize[0] : 1;
+        pass.groupSizeY = groupSize[1] > 0 ? groupSize[1] : 1;
+    } else {
+        glUseProgram(program);
+        glUniform1i(glGetUniformLocation(program, "uTexture"), 0);
+        glUseProgram(0);
+    }
+}
+
+bool PassGraph::setUniform(int pass, const char* name, float x) {
+    Uniform value = {name, -1, 1, {x, 0.0f, 0.0f, 0.0f}, 0};
+    return storeUniform(pass, name, value);
+}
+
+bool PassGraph::setUniform(int pass, const char* name, float x, float y) {
+    Uniform value = {name, -1, 2, {x, y, 0.0f, 0.0f}, 0};
+    return storeUniform(pass, name, value);
+}
+
+bool PassGraph::setUniform(int pass, const char* name, float x, float y, float z, float w) {
+    Uniform value = {name, -1, 4, {x, y, z, w}, 0};
+    return storeUniform(pass, name, value);
+}
+
+bool PassGraph::setUniform(int pass, const char* name, int intValue) {
+    Uniform value = {name, -1, 0, {0.0f, 0.0f, 0.0f, 0.0f}, intValue};
+    return storeUniform(pass, name, value);
+}
+
+bool PassGraph::storeUniform(int pass, const char* name, const Uniform& value) {
+    if (pass < 0 || pass >= static_cast<int>(passes.size())) {
+        return false;
+    }
+    Pass& target = passes[pass];
+
+    GLint location = glGetUniformLocation(target.program, name);
+    if (location < 0) {
+        std::cerr << "Pass " << target.name << " has no uniform " << name << std::endl;
+        return false;
+    }
+
+    // Setting the same uniform again replaces its value
+    for (Uniform& uniform : target.uniforms) {
+        if (uniform.name == name) {
+            uniform = value;
+            uniform.location = location;
+            return true;
+        }
+    }
+    target.uniforms.push_back(value);
+    target.uniforms.back().location = location;
+    return true;
+}
+
+void PassGraph::applyUniforms(const Pass& pass) {
+    for (const Uniform& uniform : pass.uniforms) {
+        switch (uniform.components) {
+            case 0: glUniform1i(uniform.location, uniform.intValue); break;
+            case 1: glUniform1fv(uniform.location, 1, uniform.values); break;
+            case 2: glUniform2fv(uniform.location, 1, uniform.values); break;
+            case 4: glUniform4fv(uniform.location, 1, uniform.values); break;
+            default: break;
+        }
+    }
+}
+
+bool PassGraph::create() {
+    for (int i = 0; i < 2; ++i) {
+        // Image units require immutable storage
+        targets[i].create(true);
+    }
+    glGenFramebuffers(2, framebuffers);
+    return framebuffers[0] != 0 && framebuffers[1] != 0;
+}
+
+void PassGraph::destroy() {
+    for (int i = 0; i < 2; ++i) {
+        targets[i].destroy();
+        attachedTextures[i] = 0;
+        unsyncedBits[i] = 0;
+    }
+    if (framebuffers[0] || framebuffers[1]) {
+        glDeleteFramebuffers(2, framebuffers);
+        framebuffers[0] = framebuffers[1] = 0;
+    }
+    for (const Pass& pass : passes) {
+        if (pass.ownsProgram) {
+            glDeleteProgram(pass.program);
+        }
+    }
+    passes.clear();
+}
+
+GLbitfield PassGraph::pendingBits(int target, GLbitfield access) const {
+    // The source is written by uploads, which are ordered like any other GL command
+    if (target == Source) {
+        return 0;
+    }
+    return unsyncedBits[target] & access;
+}
+
+void PassGraph::issueBarrier(GLbitfield bits) {
+    if (!bits) {
+        return;
+    }
+    glMemoryBarrier(bits);
+    unsyncedBits[0] &= ~bits;
+    unsyncedBits[1] &= ~bits;
+}
+
+GLuint PassGraph::textureOf(int target, GLuint sourceTexture) const {
+    return target == Source ? sourceTexture : targets[target].getTexture();
+}
+
+bool PassGraph::bindFramebuffer(int target) {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[target]);
+
+    // Immutable targets get a new texture object when the frame size changes
+    GLuint texture = targets[target].getTexture();
+    if (attachedTextures[target] != texture) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        attachedTextures[target] = texture;
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "Pass graph framebuffer is incomplete" << std::endl;
+            attachedTextures[target] = 0;
+            return false;
+        }
+    }
+    return true;
+}
+
+GLuint PassGraph::execute(GLuint sourceTexture, GLenum sourceFormat, int width, int height, FullscreenQuad& quad,
+                          GLbitfield resultAccess) {
+    if (passes.empty() || !sourceTexture) {
+        return sourceTexture;
+    }
+
+    // No-ops unless the frame size or target format changed
+    for (int i = 0; i < 2; ++i) {
+        if (!targets[i].ensureStorage(width, height, targetFormat)) {
+            return sourceTexture;
+        }
+    }
+
+    GLint viewport[4] = {0, 0, 0, 0};
+    bool changedViewport = false;
+    int input = Source;
+
+    for (const Pass& pass : passes) {
+        TRACE_GPU_ZONE(pass.name.c_str());
+        int output = input == 0 ? 1 : 0;
+
+        // Reads in earlier commands are ordered before later writes, so only the
+        // image stores of earlier compute passes need barriers: before they are
+        // read, and before the same target is written again.
+        GLbitfield bits = 0;
+        if (pass.type == PassType::Compute) {
+            bits |= pendingBits(input, GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            bits |= pendingBits(output, GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        } else {
+            bits |= pendingBits(input, GL_TEXTURE_FETCH_BARRIER_BIT);
+            bits |= pendingBits(output, GL_FRAMEBUFFER_BARRIER_BIT);
+        }
+        issueBarrier(bits);
+
+        glUseProgram(pass.program);
+        applyUniforms(pass);
+
+        if (pass.type == PassType::Compute) {
+            GLenum inputFormat = input == Source ? sourceFormat : targetFormat;
+            glBindImageTexture(0, textureOf(input, sourceTexture), 0, GL_FALSE, 0, GL_READ_ONLY, inputFormat);
+            glBindImageTexture(1, textureOf(output, sourceTexture), 0, GL_FALSE, 0, GL_WRITE_ONLY, targetFormat);
+            GLuint numGroupsX = (width + pass.groupSizeX - 1) / pass.groupSizeX;
+            GLuint numGroupsY = (height + pass.groupSizeY - 1) / pass.groupSizeY;
+            glDispatchCompute(numGroupsX, numGroupsY, 1);
+            unsyncedBits[output] = kImageStoreConsumers;
+        } else {
+            if (!bindFramebuffer(output)) {
+                break;
+            }
+            if (!changedViewport) {
+                glGetIntegerv(GL_VIEWPORT, viewport);
+                glViewport(0, 0, width, height);
+                changedViewport = true;
+            }
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, textureOf(input, sourceTexture));
+            quad.draw();
+        }
+
+        input = output;
+    }
+
+    if (changedViewport) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+    glUseProgram(0);
+
+    // The caller reads the result. When that target is also the first one the
+    // next frame writes, fold the write-after-write barrier into the same call.
+    GLbitfield finalAccess = resultAccess;
+    if (input == 0 && passes.front().type == PassType::Compute) {
+        finalAccess |= GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+    }
+    issueBarrier(pendingBits(input, finalAccess));
+    return textureOf(input, sourceTexture);
+}
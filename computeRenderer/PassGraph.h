@@ -0,0 +1,121 @@
+#pragma once
+
+#include <angle_gl.h>
+#include <string>
+#include <vector>
+#include "../render/TextureUploader.h"
+#include "../render/FullscreenQuad.h"
+
+// Chain of post-processing passes run on every frame.
+// Each pass reads the previous pass's result and writes into one of two
+// ping-pong targets (RGBA8, or RGBA16F to keep precision between passes),
+// which are allocated once per frame size and reused.
+//   Compute passes read image unit 0 and write image unit 1. Their image
+//   format qualifiers are INPUT_FORMAT and OUTPUT_FORMAT, defined per pass by
+//   withImageFormats() to match what execute() binds.
+//   Fragment passes sample texture unit 0 through the uniform uTexture and
+//   draw the fullscreen quad into the target.
+//
+// Image stores are the only incoherent writes in the chain, so the graph
+// tracks, per target, which kinds of access still need a barrier after the
+// last image store and issues one folded glMemoryBarrier with just those bits
+// before the next access that needs them (and none between fragment passes).
+class PassGraph {
+public:
+    enum class PassType {
+        Compute,
+        Fragment
+    };
+
+    PassGraph();
+
+    // Append a pass. The graph takes ownership of the linked program.
+    // Returns the index of the pass, or -1 if the program is invalid.
+    int addComputePass(const std::string& name, GLuint program);
+    int addFragmentPass(const std::string& name, GLuint program);
+
+    // Swap a pass's program (e.g. after a shader reload), keeping its uniform
+    // values. The graph takes ownership and deletes the old program.
+    bool replaceProgram(int pass, GLuint program);
+
+    // Run a pass with a program owned elsewhere (e.g. a ShaderVariants set),
+    // keeping its uniform values. The graph never deletes such a program.
+    bool selectProgram(int pass, GLuint program);
+
+    // Per-pass uniforms, applied every time the pass runs (needs a current context)
+    bool setUniform(int pass, const char* name, float x);
+    bool setUniform(int pass, const char* name, float x, float y);
+    bool setUniform(int pass, const char* name, float x, float y, float z, float w);
+    bool setUniform(int pass, const char* name, int value);
+
+    // Create the render targets and framebuffers (needs a current context)
+    bool create();
+    // Delete the targets, framebuffers and pass programs
+    void destroy();
+
+    size_t getPassCount() const { return passes.size(); }
+    // Estimated texture memory of the ping-pong targets
+    size_t getMemoryBytes() const { return targets[0].getMemoryBytes() + targets[1].getMemoryBytes(); }
+
+    // Storage of the ping-pong targets: GL_RGBA8 (default) or GL_RGBA16F.
+    // Fragment passes need EXT_color_buffer_(half_)float to render to RGBA16F.
+    void setTargetFormat(GLenum format) { targetFormat = format; }
+    GLenum getTargetFormat() const { return targetFormat; }
+
+    // Define INPUT_FORMAT and OUTPUT_FORMAT (rgba8 or rgba16f) after the
+    // #version line of a compute source, plus HALF_FLOAT_IMAGES when the
+    // output is RGBA16F. The first pass reads the source's format, later
+    // passes the target format.
+    static std::string withImageFormats(const std::string& source, GLenum inputFormat, GLenum outputFormat);
+
+    // Run every pass on a source texture of sourceFormat (GL_RGBA8 or
+    // GL_RGBA16F) and return the texture holding the result, ready for
+    // resultAccess (a glMemoryBarrier bit: sampling by default,
+    // GL_FRAMEBUFFER_BARRIER_BIT to blit from it). Returns the source if there
+    // are no passes.
+    GLuint execute(GLuint sourceTexture, GLenum sourceFormat, int width, int height, FullscreenQuad& quad,
+                   GLbitfield resultAccess = GL_TEXTURE_FETCH_BARRIER_BIT);
+
+private:
+    struct Uniform {
+        std::string name;
+        GLint location;
+        int components;  // 1-4 floats, or 0 for an int
+        float values[4];
+        GLint intValue;
+    };
+
+    struct Pass {
+        std::string name;
+        PassType type;
+        GLuint program;
+        bool ownsProgram;
+        GLint groupSizeX;
+        GLint groupSizeY;
+        std::vector<Uniform> uniforms;
+    };
+
+    // Index of the source texture in the access tracking below
+    static const int Source = -1;
+
+    std::vector<Pass> passes;
+    TextureUploader targets[2];
+    GLenum targetFormat;
+    GLuint framebuffers[2];
+    GLuint attachedTextures[2];  // Texture each framebuffer currently renders into
+    GLbitfield unsyncedBits[2];  // Barrier bits not issued since the target's last image store
+
+    int addPass(const std::string& name, PassType type, GLuint program);
+    void bindProgram(Pass& pass, GLuint program);
+    bool switchProgram(int pass, GLuint program, bool owned);
+    bool storeUniform(int pass, const char* name, const Uniform& value);
+    void applyUniforms(const Pass& pass);
+
+    // Barrier bits an access to a target needs before it may happen
+    GLbitfield pendingBits(int target, GLbitfield access) const;
+    // Issue one barrier for all bits and mark them as synchronized for every target
+    void issueBarrier(GLbitfield bits);
+
+    GLuint textureOf(int target, GLuint sourceTexture) const;
+    bool bindFramebuffer(int target);
+};
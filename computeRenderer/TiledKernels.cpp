@@ -0,0 +1,144 @@
+#include "TiledKernels.h"
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// GL_MAX_COMPUTE_SHARED_MEMORY_SIZE is at least 16384 bytes on ES 3.1; tiles
+// are sized for half-float texels, so every kernel builds for either format
+static const size_t kMaxSharedTexels = 16384 / 8;
+
+std::string TiledKernels::convolution(int radius, const std::vector<float>& weights) {
+    size_t side = static_cast<size_t>(2 * radius + 1);
+    if (radius < 0 || weights.size() != side * side) {
+        std::cerr << "Convolution needs " << side * side << " weights" << std::endl;
+        return std::string();
+    }
+    return tiledSource(radius, radius, 16, 16, weights, "sum.rgb");
+}
+
+std::string TiledKernels::unsharpMask(int radius, const std::vector<float>& weights, float amount) {
+    size_t side = static_cast<size_t>(2 * radius + 1);
+    if (radius < 0 || weights.size() != side * side) {
+        std::cerr << "Unsharp mask needs " << side * side << " weights" << std::endl;
+        return std::string();
+    }
+    // The blur is only the reference the detail is measured against
+    std::ostringstream result;
+    result << std::fixed << std::setprecision(8) << "center.rgb + " << amount << " * (center.rgb - sum.rgb)";
+    return tiledSource(radius, radius, 16, 16, weights, result.str());
+}
+
+std::string TiledKernels::separablePass(int radius, const std::vector<float>& weights, bool horizontal) {
+    if (radius < 0 || weights.size() != static_cast<size_t>(2 * radius + 1)) {
+        std::cerr << "Separable pass needs " << 2 * radius + 1 << " weights" << std::endl;
+        return std::string();
+    }
+    // Wide tiles along the filter direction keep the apron small relative to the tile
+    return horizontal ? tiledSource(radius, 0, 64, 4, weights, "sum.rgb")
+                      : tiledSource(0, radius, 4, 64, weights, "sum.rgb");
+}
+
+std::vector<float> TiledKernels::gaussianWeights(int radius, float sigma) {
+    std::vector<float> weights(2 * radius + 1);
+    float sum = 0.0f;
+    for (int i = -radius; i <= radius; ++i) {
+        float w = std::exp(-static_cast<float>(i * i) / (2.0f * sigma * sigma));
+        weights[i + radius] = w;
+        sum += w;
+    }
+    for (float& w : weights) {
+        w /= sum;
+    }
+    return weights;
+}
+
+std::vector<float> TiledKernels::boxWeights(int radius) {
+    return std::vector<float>(2 * radius + 1, 1.0f / (2 * radius + 1));
+}
+
+std::vector<float> TiledKernels::sharpenWeights(float amount) {
+    return {
+        0.0f,    -amount,               0.0f,
+        -amount, 1.0f + 4.0f * amount, -amount,
+        0.0f,    -amount,               0.0f
+    };
+}
+
+std::string TiledKernels::tiledSource(int radiusX, int radiusY, int groupSizeX, int groupSizeY,
+                                      const std::vector<float>& weights, const std::string& result) {
+    size_t tileWidth = static_cast<size_t>(groupSizeX + 2 * radiusX);
+    size_t tileHeight = static_cast<size_t>(groupSizeY + 2 * radiusY);
+    if (tileWidth * tileHeight > kMaxSharedTexels) {
+        std::cerr << "Kernel radius " << (radiusX > radiusY ? radiusX : radiusY)
+                  << " does not fit in shared memory" << std::endl;
+        return std::string();
+    }
+
+    std::ostringstream src;
+    src << std::fixed << std::setprecision(8);
+    src << "#version 310 es\n"
+        << "#ifndef INPUT_FORMAT\n"
+        << "#define INPUT_FORMAT rgba8\n"
+        << "#define OUTPUT_FORMAT rgba8\n"
+        << "#endif\n"
+        << "layout(local_size_x = " << groupSizeX << ", local_size_y = " << groupSizeY << ") in;\n"
+        << "layout(binding = 0, INPUT_FORMAT) uniform readonly highp image2D inputImage;\n"
+        << "layout(binding = 1, OUTPUT_FORMAT) uniform writeonly highp image2D outputImage;\n"
+        << "const int RADIUS_X = " << radiusX << ";\n"
+        << "const int RADIUS_Y = " << radiusY << ";\n"
+        << "const int TILE_WIDTH = " << tileWidth << ";\n"
+        << "const int TILE_SIZE = " << tileWidth * tileHeight << ";\n"
+        << "const int GROUP_INVOCATIONS = " << groupSizeX * groupSizeY << ";\n";
+
+    src << R"(
+// The tile and its apron, packed to 8 bits per channel, or to half floats
+// when the intermediates keep more precision than that
+#ifdef HALF_FLOAT_IMAGES
+shared uvec2 tile[TILE_SIZE];
+uvec2 packTexel(vec4 c) { return uvec2(packHalf2x16(c.rg), packHalf2x16(c.ba)); }
+vec4 unpackTexel(uvec2 t) { return vec4(unpackHalf2x16(t.x), unpackHalf2x16(t.y)); }
+#else
+shared uint tile[TILE_SIZE];
+uint packTexel(vec4 c) { return packUnorm4x8(c); }
+vec4 unpackTexel(uint t) { return unpackUnorm4x8(t); }
+#endif
+
+void main() {
+    ivec2 size = imageSize(inputImage);
+    ivec2 tileOrigin = ivec2(gl_WorkGroupID.xy * gl_WorkGroupSize.xy) - ivec2(RADIUS_X, RADIUS_Y);
+
+    // Cooperative load; texels outside the image repeat the edge
+    for (int i = int(gl_LocalInvocationIndex); i < TILE_SIZE; i += GROUP_INVOCATIONS) {
+        ivec2 coord = clamp(tileOrigin + ivec2(i % TILE_WIDTH, i / TILE_WIDTH), ivec2(0), size - 1);
+        tile[i] = packTexel(imageLoad(inputImage, coord));
+    }
+    memoryBarrierShared();
+    barrier();
+
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    if (pixel.x >= size.x || pixel.y >= size.y) {
+        return;
+    }
+
+    ivec2 local = ivec2(gl_LocalInvocationID.xy);
+    int base = local.y * TILE_WIDTH + local.x;
+    vec4 center = unpackTexel(tile[base + RADIUS_Y * TILE_WIDTH + RADIUS_X]);
+    vec4 sum = vec4(0.0);
+)";
+    // Every tap is its own statement with its weight as a literal: no weight
+    // array is fetched, no loop is left for the compiler, and zero taps vanish
+    for (int dy = 0; dy <= 2 * radiusY; ++dy) {
+        for (int dx = 0; dx <= 2 * radiusX; ++dx) {
+            float weight = weights[static_cast<size_t>(dy * (2 * radiusX + 1) + dx)];
+            if (weight != 0.0f) {
+                src << "    sum += " << weight << " * unpackTexel(tile[base + " << dy * static_cast<int>(tileWidth) + dx << "]);\n";
+            }
+        }
+    }
+    // Filters apply to color; alpha is kept from the center texel
+    src << "    imageStore(outputImage, pixel, vec4(clamp(" << result << ", 0.0, 1.0), center.a));\n"
+        << "}\n";
+    return src.str();
+}
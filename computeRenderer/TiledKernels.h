@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Compute shader sources for neighborhood filters (blur, sharpen, convolution),
+// for use as PassGraph compute passes (input on image unit 0, output on unit 1,
+// formats from PassGraph::withImageFormats, rgba8 without it).
+//
+// Every work group loads its tile plus the apron the kernel reaches into
+// shared memory once, packed to one uint per texel (two half-float uints with
+// HALF_FLOAT_IMAGES), and all taps then read the shared copy instead of
+// re-fetching overlapping neighborhoods with imageLoad. The taps are
+// unrolled, each with its weight as a literal, so every kernel and radius
+// compiles to its own specialized shader.
+// Edges are clamped. Large kernels should use the separable variant: two 1D
+// passes with wide tiles need far fewer taps and much less shared memory.
+//
+// The builders return an empty string if the weights do not match the radius
+// or the tile would not fit in the 16 KB of shared memory ES 3.1 guarantees.
+class TiledKernels {
+public:
+    // Full 2D convolution with (2 * radius + 1)^2 weights in row-major order
+    static std::string convolution(int radius, const std::vector<float>& weights);
+
+    // Sharpen by amount times the difference of each pixel from its blur,
+    // given as (2 * radius + 1)^2 normalized weights in row-major order
+    static std::string unsharpMask(int radius, const std::vector<float>& weights, float amount);
+
+    // One pass of a separable filter with 2 * radius + 1 weights
+    static std::string separablePass(int radius, const std::vector<float>& weights, bool horizontal);
+
+    // Normalized 1D weights
+    static std::vector<float> gaussianWeights(int radius, float sigma);
+    static std::vector<float> boxWeights(int radius);
+
+    // 3x3 unsharp kernel (identity plus amount times a Laplacian), for convolution(1, ...)
+    static std::vector<float> sharpenWeights(float amount);
+
+private:
+    static std::string tiledSource(int radiusX, int radiusY, int groupSizeX, int groupSizeY,
+                                   const std::vector<float>& weights, const std::string& result);
+};
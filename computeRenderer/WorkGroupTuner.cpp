@@ -0,0 +1,180 @@
+#include "WorkGroupTuner.h"
+#include "../render/GpuTimer.h"
+#include "../render/ShaderVariants.h"
+#include "../render/TextureUploader.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+// Candidate shapes; the ones the context cannot run are skipped
+static const WorkGroupTuner::Size kCandidates[] = {
+    {8, 8}, {16, 8}, {8, 16}, {16, 16}, {32, 8}, {8, 32}, {32, 4}, {64, 4}, {32, 16}, {32, 32}
+};
+
+// Dispatches per measurement, after one untimed warm-up dispatch
+static const int kTimedDispatches = 8;
+
+static const WorkGroupTuner::Size kDefaultSize = {16, 16};
+
+std::string WorkGroupTuner::withLocalSize(const char* source, Size size) {
+    std::string defines = "#define LOCAL_SIZE_X " + std::to_string(size.x) + "\n" +
+                          "#define LOCAL_SIZE_Y " + std::to_string(size.y) + "\n";
+    return ShaderVariants::insertDefines(source, defines);
+}
+
+std::string WorkGroupTuner::contextKey(const std::string& shaderName) {
+    const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    return shaderName + "|" + (renderer ? renderer : "") + "|" + (version ? version : "");
+}
+
+// Cache lines are "<shader>|<GL_RENDERER>|<GL_VERSION>\t<x>\t<y>"
+static std::vector<std::pair<std::string, WorkGroupTuner::Size>> readCache(const std::string& cachePath) {
+    std::vector<std::pair<std::string, WorkGroupTuner::Size>> entries;
+    std::ifstream file(cachePath);
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos) {
+            continue;
+        }
+        std::istringstream values(line.substr(tab + 1));
+        WorkGroupTuner::Size size = {0, 0};
+        if (values >> size.x >> size.y && size.x > 0 && size.y > 0) {
+            entries.emplace_back(line.substr(0, tab), size);
+        }
+    }
+    return entries;
+}
+
+bool WorkGroupTuner::loadCached(const std::string& cachePath, const std::string& shaderName, Size& size) {
+    std::string key = contextKey(shaderName);
+    for (const auto& entry : readCache(cachePath)) {
+        if (entry.first == key) {
+            size = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkGroupTuner::storeCached(const std::string& cachePath, const std::string& shaderName, Size size) {
+    std::string key = contextKey(shaderName);
+    auto entries = readCache(cachePath);
+    bool replaced = false;
+    for (auto& entry : entries) {
+        if (entry.first == key) {
+            entry.second = size;
+            replaced = true;
+        }
+    }
+    if (!replaced) {
+        entries.emplace_back(key, size);
+    }
+
+    std::ofstream file(cachePath, std::ios::trunc);
+    if (!file) {
+        std::cerr << "Failed to write work group cache " << cachePath << std::endl;
+        return;
+    }
+    for (const auto& entry : entries) {
+        file << entry.first << '\t' << entry.second.x << '\t' << entry.second.y << '\n';
+    }
+}
+
+bool WorkGroupTuner::tune(const char* source, const ImageData& frame, const CompileFn& compile, Size& best,
+                          GLenum outputFormat) {
+    GLint maxInvocations = 0;
+    GLint maxSizeX = 0;
+    GLint maxSizeY = 0;
+    glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &maxInvocations);
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 0, &maxSizeX);
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 1, &maxSizeY);
+
+    // Scratch images at the frame's size, filled with the frame itself
+    TextureUploader input;
+    TextureUploader output;
+    input.setRequireRGBA(true);
+    input.create(true);
+    output.create(true);
+    if (!input.upload(frame) || !output.ensureStorage(frame.width, frame.height, outputFormat)) {
+        input.destroy();
+        output.destroy();
+        return false;
+    }
+
+    GpuTimer timer;
+    bool gpuTiming = timer.initialize(2);
+
+    double bestTime = -1.0;
+    for (const Size& candidate : kCandidates) {
+        if (candidate.x * candidate.y > maxInvocations || candidate.x > maxSizeX || candidate.y > maxSizeY) {
+            continue;
+        }
+        GLuint program = compile(withLocalSize(source, candidate).c_str());
+        if (!program) {
+            continue;
+        }
+
+        glUseProgram(program);
+        glBindImageTexture(0, input.getTexture(), 0, GL_FALSE, 0, GL_READ_ONLY, input.getInternalFormat());
+        glBindImageTexture(1, output.getTexture(), 0, GL_FALSE, 0, GL_WRITE_ONLY, outputFormat);
+        GLuint numGroupsX = (frame.width + candidate.x - 1) / candidate.x;
+        GLuint numGroupsY = (frame.height + candidate.y - 1) / candidate.y;
+
+        // Warm up so driver-side compilation is not measured
+        glDispatchCompute(numGroupsX, numGroupsY, 1);
+        glFinish();
+
+        auto start = std::chrono::steady_clock::now();
+        timer.begin();
+        for (int i = 0; i < kTimedDispatches; ++i) {
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            glDispatchCompute(numGroupsX, numGroupsY, 1);
+        }
+        timer.end();
+        glFinish();
+
+        double elapsed = 0.0;
+        if (!gpuTiming || !timer.collect(elapsed)) {
+            elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        elapsed /= kTimedDispatches;
+        std::cout << "Work group " << candidate.x << "x" << candidate.y << ": " << elapsed << " ms" << std::endl;
+
+        if (bestTime < 0.0 || elapsed < bestTime) {
+            bestTime = elapsed;
+            best = candidate;
+        }
+        glDeleteProgram(program);
+    }
+    glUseProgram(0);
+
+    timer.destroy();
+    input.destroy();
+    output.destroy();
+    return bestTime >= 0.0;
+}
+
+WorkGroupTuner::Size WorkGroupTuner::select(const char* source, const std::string& shaderName, const ImageData& frame,
+                                            const CompileFn& compile, const std::string& cachePath,
+                                            GLenum outputFormat) {
+    Size size = kDefaultSize;
+    if (loadCached(cachePath, shaderName, size)) {
+        std::cout << "Using cached work group size " << size.x << "x" << size.y << " for " << shaderName << std::endl;
+        return size;
+    }
+
+    if (!tune(source, frame, compile, size, outputFormat)) {
+        // Nothing measured (e.g. no frame could be uploaded); do not cache the default
+        std::cerr << "Work group tuning failed for " << shaderName << std::endl;
+        return kDefaultSize;
+    }
+    std::cout << "Selected work group size " << size.x << "x" << size.y << " for " << shaderName << std::endl;
+    storeCached(cachePath, shaderName, size);
+    return size;
+}
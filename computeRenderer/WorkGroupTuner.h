@@ -0,0 +1,47 @@
+#pragma once
+
+#include <angle_gl.h>
+#include <functional>
+#include <string>
+#include "../reader/ImageLoader.h"
+
+// Picks the compute work-group size for a shader on the current GPU.
+// The shader declares its size as
+//     layout(local_size_x = LOCAL_SIZE_X, local_size_y = LOCAL_SIZE_Y) in;
+// and each candidate is compiled with the two values defined after #version,
+// dispatched over a representative frame and timed with GPU timer queries
+// (glFinish and the CPU clock when the extension is missing). The winner is
+// recorded per shader, GL_RENDERER and GL_VERSION in a small text file, so
+// later runs on the same GPU and driver skip the measurement.
+class WorkGroupTuner {
+public:
+    struct Size {
+        int x;
+        int y;
+    };
+
+    // Builds a compute program from source, returning 0 on failure
+    using CompileFn = std::function<GLuint(const char* source)>;
+
+    // Insert the LOCAL_SIZE_X/LOCAL_SIZE_Y defines after the #version line
+    static std::string withLocalSize(const char* source, Size size);
+
+    // Cached winner for this shader on the current context's GPU and driver
+    static bool loadCached(const std::string& cachePath, const std::string& shaderName, Size& size);
+    static void storeCached(const std::string& cachePath, const std::string& shaderName, Size size);
+
+    // Time every candidate the context can run (reading image unit 0, writing
+    // unit 1 of outputFormat at the frame's size) and return the fastest in
+    // best. The input is the frame as uploaded (RGBA8, or RGBA16F for half-float
+    // frames). Needs a current ES 3.1 context; returns false if no candidate
+    // could be measured.
+    static bool tune(const char* source, const ImageData& frame, const CompileFn& compile, Size& best,
+                     GLenum outputFormat = GL_RGBA8);
+
+    // Cached size if there is one, otherwise tune and cache the result (16x16 if tuning fails)
+    static Size select(const char* source, const std::string& shaderName, const ImageData& frame,
+                       const CompileFn& compile, const std::string& cachePath, GLenum outputFormat = GL_RGBA8);
+
+private:
+    static std::string contextKey(const std::string& shaderName);
+};
@@ -1,35 +1,111 @@
 #include <iostream>
 #include <Windows.h>
+#include <string>
+#include <filesystem>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 #include <thread>
+#include <vector>
 #include "reader/ImageLoader.h"
+#include "reader/FrameCache.h"
 #include "render/Renderer.h"
+#include "render/RunConfig.h"
+#include "render/ControlRecording.h"
+#include "render/Trace.h"
+#include "computeRenderer/ComputePipeline.h"
 
 // Global variables
-HWND hWnd = nullptr;
-const int WINDOW_WIDTH = 800;
-const int WINDOW_HEIGHT = 600;
 ImageLoader imageLoader;
-static Renderer* renderer = nullptr;
+const long long scrubStep = 30; // Frames moved per Page Up / Page Down
+ControlRecording controlRecording; // Controls given in the windows, with --record
+bool recordingControls = false;
+bool replayingControls = false;    // Keys other than Esc are ignored while a recording drives playback
+
+// A window and the renderer presenting in it; the window's user data points here
+struct Output {
+    int index = 0;  // Position in the window list, as control recordings name it
+    HWND hWnd = nullptr;
+    Renderer* renderer = nullptr;
+    ComputePipeline* computePipeline = nullptr; // Set when the window runs the compute pipeline
+};
 
 // Window procedure
 LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
+    // Keys control the focused window's renderer only; every output plays on its own
+    Output* output = reinterpret_cast<Output*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+    Renderer* renderer = output ? output->renderer : nullptr;
+    ComputePipeline* computePipeline = output ? output->computePipeline : nullptr;
 
     switch (message) {
     case WM_CLOSE:
         PostQuitMessage(0);
         break;
-    case WM_KEYDOWN:
+    case WM_SIZE:  // The frame is refitted and drawn at the new client size
         if (renderer) {
+            renderer->resize(LOWORD(lParam), HIWORD(lParam));
+        }
+        break;
+    case WM_DPICHANGED: {  // Moved to a monitor with another scale: take the suggested size
+        const RECT* suggested = reinterpret_cast<const RECT*>(lParam);
+        SetWindowPos(hWnd, NULL, suggested->left, suggested->top, suggested->right - suggested->left,
+                     suggested->bottom - suggested->top, SWP_NOZORDER | SWP_NOACTIVATE);
+        break;
+    }
+    case WM_KEYDOWN:
+        if (wParam == VK_ESCAPE) {  // Esc - quit, e.g. from the borderless low-latency window
+            PostQuitMessage(0);
+        } else if (renderer && !replayingControls) {
+            ControlEvent event = { 0.0, output->index, ControlAction::TogglePause, 0 };
+            bool control = true;
             switch (wParam) {
             case VK_SPACE:  // Space key - toggle pause
-                renderer->togglePause();
+                event.action = ControlAction::TogglePause;
                 break;
             case VK_LEFT:  // Left arrow key - step backward
-                renderer->stepBackward();
+                event.action = ControlAction::StepBackward;
                 break;
             case VK_RIGHT:  // Right arrow key - step forward
-                renderer->stepForward();
+                event.action = ControlAction::StepForward;
+                break;
+            case VK_HOME:  // Home - jump to the first frame
+                event.action = ControlAction::Seek;
+                event.value = 0;
+                break;
+            case VK_END:  // End - jump to the last frame
+                event.action = ControlAction::Seek;
+                event.value = static_cast<long long>(imageLoader.getImageCount()) - 1;
+                break;
+            case VK_PRIOR:  // Page Up - scrub back
+                event.action = ControlAction::Scrub;
+                event.value = -scrubStep;
                 break;
+            case VK_NEXT:  // Page Down - scrub forward
+                event.action = ControlAction::Scrub;
+                event.value = scrubStep;
+                break;
+            case 'T':  // T / B / F - toggle the compute tint, brighten and flip variants
+            case 'B':
+            case 'F':
+                event.action = ControlAction::ToggleFeatures;
+                event.value = wParam == 'T' ? ComputePipeline::TintShadows
+                            : wParam == 'B' ? ComputePipeline::BrightenHighlights
+                                            : ComputePipeline::FlipVertical;
+                control = computePipeline != nullptr;
+                break;
+            case 'L':  // L - grade with the next LUT of the luts setting
+                event.action = ControlAction::CycleLut;
+                break;
+            default:
+                control = false;
+                break;
+            }
+            if (control) {
+                ControlRecording::apply(event, *renderer, computePipeline);
+                if (recordingControls) {
+                    controlRecording.record(event.window, event.action, event.value);
+                }
             }
         }
         break;
@@ -39,8 +115,8 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
     return 0;
 }
 
-// Create Windows window
-HWND CreateWin32Window(HINSTANCE hInstance, int nCmdShow, int width, int height) {
+// Create Windows window; a borderless one covers monitorRect
+HWND CreateWin32Window(HINSTANCE hInstance, int nCmdShow, int width, int height, const RECT* monitorRect) {
     // Register window class
     const char CLASS_NAME[] = "ShaderDemoClass";
     
@@ -52,15 +128,30 @@ HWND CreateWin32Window(HINSTANCE hInstance, int nCmdShow, int width, int height)
     
     RegisterClass(&wc);
     
+    // The requested size is the client area at 100% scaling; scale it to the
+    // system DPI and add the borders so the back buffer gets exactly that
+    UINT dpi = GetDpiForSystem();
+    RECT windowRect = { 0, 0, MulDiv(width, dpi, 96), MulDiv(height, dpi, 96) };
+    AdjustWindowRectExForDpi(&windowRect, WS_OVERLAPPEDWINDOW, FALSE, 0, dpi);
+    int x = CW_USEDEFAULT;
+    int y = CW_USEDEFAULT;
+    DWORD style = WS_OVERLAPPEDWINDOW;
+    if (monitorRect) {
+        x = monitorRect->left;
+        y = monitorRect->top;
+        windowRect = *monitorRect;
+        style = WS_POPUP;
+    }
+    
     // Create window
     HWND hWnd = CreateWindowEx(
         0,                              // Optional window styles
         CLASS_NAME,                     // Window class
         "ANGLE Shader Demo",            // Window title
-        WS_OVERLAPPEDWINDOW,            // Window style
+        style,                          // Window style
         
         // Size and position
-        CW_USEDEFAULT, CW_USEDEFAULT, width, height,
+        x, y, windowRect.right - windowRect.left, windowRect.bottom - windowRect.top,
         
         NULL,       // Parent window    
         NULL,       // Menu
@@ -80,76 +171,324 @@ HWND CreateWin32Window(HINSTANCE hInstance, int nCmdShow, int width, int height)
     return hWnd;
 }
 
-int main() {
+// Record each monitor's desktop rectangle, primary first
+BOOL CALLBACK CollectMonitor(HMONITOR monitor, HDC, LPRECT, LPARAM data) {
+    std::vector<RECT>& monitors = *reinterpret_cast<std::vector<RECT>*>(data);
+    MONITORINFO info = {};
+    info.cbSize = sizeof(info);
+    if (GetMonitorInfo(monitor, &info)) {
+        if (info.dwFlags & MONITORINFOF_PRIMARY) {
+            monitors.insert(monitors.begin(), info.rcMonitor);
+        } else {
+            monitors.push_back(info.rcMonitor);
+        }
+    }
+    return TRUE;
+}
+
+// Pipeline by name with the configuration's compute settings; compute is set for the compute pipeline
+std::unique_ptr<RenderPipeline> CreatePipeline(const std::string& name, const RunConfig& config,
+                                               ComputePipeline*& compute) {
+    std::unique_ptr<RenderPipeline> pipeline = RenderPipeline::create(name);
+    if (!pipeline) {
+        std::cerr << "Unknown pipeline: " << name << std::endl;
+        return nullptr;
+    }
+    compute = dynamic_cast<ComputePipeline*>(pipeline.get());
+    if (compute && !config.applyTo(*compute)) {
+        return nullptr;
+    }
+    return pipeline;
+}
+
+// Usage: shaderDemo [--config PATH] [--<setting> VALUE]... [--help]
+//                   [--layer DIR [--layer-opacity 0-1] [--layer-blend normal|add|multiply|screen]]...
+// Settings (photo directory, window size, pacing, backend, thread counts,
+// cache budgets, compute options, ...; see RunConfig or --help) come from
+// --config files and the command line, the last one given winning.
+// --pipeline takes a comma-separated list, cycled over the windows (e.g. fragment,compute)
+int main(int argc, char* argv[]) {
+    TRACE_INITIALIZE();
     try {
-        std::string photoDir = R"(E:\code\shaderDemo\photo)";
-        std::cout << "Looking for photos in: " << photoDir << std::endl;
+        RunConfig config;
+        // Sequences composited over the photos; --layer-opacity and --layer-blend apply to the last --layer
+        struct LayerOption {
+            std::string directory;
+            float opacity;
+            LayerCompositor::BlendMode mode;
+        };
+        std::vector<LayerOption> layerOptions;
+        for (int i = 1; i < argc; ++i) {
+            bool hasValue = i + 1 < argc;
+            int taken = config.parseOption(argc, argv, i);
+            if (taken < 0) {
+                return -1;
+            } else if (taken > 0) {
+                continue;
+            } else if (strcmp(argv[i], "--help") == 0) {
+                RunConfig::printUsage(std::cout);
+                return 0;
+            } else if (strcmp(argv[i], "--layer") == 0 && hasValue) {
+                layerOptions.push_back({ argv[++i], 1.0f, LayerCompositor::BlendMode::Normal });
+            } else if (strcmp(argv[i], "--layer-opacity") == 0 && hasValue && !layerOptions.empty()) {
+                layerOptions.back().opacity = static_cast<float>(atof(argv[++i]));
+            } else if (strcmp(argv[i], "--layer-blend") == 0 && hasValue && !layerOptions.empty()) {
+                if (!LayerCompositor::parseBlendMode(argv[++i], layerOptions.back().mode)) {
+                    return -1;
+                }
+            } else {
+                std::cerr << "Unknown option: " << argv[i] << std::endl;
+                RunConfig::printUsage(std::cerr);
+                return -1;
+            }
+        }
+        config.print(std::cout);
+        int windowCount = std::max(config.windows, 1);
+        
+        // A replay drives the windows from a recording instead of the keyboard
+        ControlRecording replayRecording;
+        if (!config.replayControls.empty() && !replayRecording.load(config.replayControls)) {
+            return -1;
+        }
+        replayingControls = !config.replayControls.empty();
+        recordingControls = !config.recordControls.empty() && !replayingControls;
+        
+        // A pipeline per window, cycling through the --pipeline list
+        std::vector<std::string> pipelineNames;
+        for (size_t begin = 0; begin <= config.pipeline.size();) {
+            size_t end = std::min(config.pipeline.find(',', begin), config.pipeline.size());
+            pipelineNames.push_back(config.pipeline.substr(begin, end - begin));
+            begin = end + 1;
+        }
+        std::vector<Output> outputs(windowCount);
+        std::vector<std::unique_ptr<RenderPipeline>> pipelines;
+        int minimumClientVersion = 2;
+        bool requireRGBA = false;
+        for (int i = 0; i < windowCount; ++i) {
+            pipelines.push_back(CreatePipeline(pipelineNames[i % pipelineNames.size()], config,
+                                               outputs[i].computePipeline));
+            if (!pipelines.back()) {
+                return -1;
+            }
+            minimumClientVersion = std::max(minimumClientVersion, pipelines.back()->getMinimumClientVersion());
+            requireRGBA = requireRGBA || pipelines.back()->requiresRGBA();
+        }
+
+        std::cout << "Looking for photos in: " << config.photos << std::endl;
 
-        // Load images from photo directory
+        // Stream images from photo directory: only a window of frames around
+        // the playhead is decoded, so the sequence length is not limited by RAM
+        // Frame limit, decode threads, cache budgets, prefetch window and I/O come from the configuration
         ImageLoadOptions opt;
-        opt.maxImages = 60;
-        if (imageLoader.loadImagesFromDirectory(photoDir, opt)) {
-            std::cout << "Successfully loaded images from " << photoDir << std::endl;
+        config.applyTo(opt);
+        opt.expandToRGBA = true; // 4-byte pixels upload without driver-side conversion
+        opt.streaming = true;
+        opt.blockCompression = true; // BC1/BC3 frames, transcoded once into photo\.bccache
+        opt.cacheDecodedFrames = true; // Frames BC cannot take are cached decoded; hits are memory-mapped
+        opt.proxyWidth = config.windowWidth; // 4K/8K sources are reduced to a tier near the window size
+        opt.proxyHeight = config.windowHeight;
+        opt.largePages = true; // Falls back to normal pages without the lock-pages privilege
+        opt.uniformFrames = true; // Validated up front; outliers are converted to one sequence format
+        // The photos and every layer prefetch with the same threads within one
+        // budget, which the memory limit caps as well
+        unsigned hardwareThreads = std::thread::hardware_concurrency();
+        int prefetchThreads = config.decodeThreads > 0 ? config.decodeThreads
+                                                       : hardwareThreads > 0 ? static_cast<int>(hardwareThreads) : 2;
+        opt.prefetchScheduler = std::make_shared<PrefetchScheduler>(ImageLoader::resolveCacheBudget(opt),
+                                                                    prefetchThreads);
+        
+        // A packed sequence (built by the packPhotos target) opens without decoding anything
+        std::string sequencePath = config.photos + ".sdseq";
+        bool loaded = std::filesystem::exists(sequencePath) ? imageLoader.loadSequenceFile(sequencePath, opt)
+                                                            : imageLoader.loadImagesFromDirectory(config.photos, opt);
+        if (loaded) {
+            std::cout << "Successfully loaded images from " << config.photos << std::endl;
             
-            // Get all loaded image names
-            auto imageNames = imageLoader.getImageNames();
-            std::cout << "Loaded images:" << std::endl;
-            for (const auto& name : imageNames) {
-                const ImageData* img = imageLoader.getImage(name);
-                if (img) {
-                    std::cout << "  - " << name << ": " << img->width << "x" << img->height 
-                              << ", " << img->channels << " channels, " 
-                              << img->data.size() << " bytes" << std::endl;
+            if (imageLoader.isStreaming()) {
+                std::cout << "Streaming " << imageLoader.getImageCount() << " images" << std::endl;
+            } else {
+                std::cout << "Loaded images:" << std::endl;
+                for (size_t i = 0; i < imageLoader.getImageCount(); ++i) {
+                    const ImageData* img = imageLoader.getImage(i);
+                    if (img) {
+                        std::cout << "  - " << imageLoader.getImageName(i) << ": " << img->width << "x" << img->height 
+                                  << ", " << img->channels << " channels, " 
+                                  << img->data.size() << " bytes" << std::endl;
+                    }
                 }
             }
         } else {
-            std::cout << "No images found in " << photoDir << " directory" << std::endl;
+            std::cout << "No images found in " << config.photos << " directory" << std::endl;
             return -1;
         }
         
-        // Create window
-        HINSTANCE hInstance = GetModuleHandle(NULL);
-        hWnd = CreateWin32Window(hInstance, SW_SHOW, WINDOW_WIDTH, WINDOW_HEIGHT);
-        if (!hWnd) {
-            std::cerr << "Failed to create window" << std::endl;
-            return -1;
+        // Layers load like the photos; a packed sequence is used where one exists
+        std::vector<std::unique_ptr<ImageLoader>> layerLoaders;
+        for (const LayerOption& layer : layerOptions) {
+            std::unique_ptr<ImageLoader> loader(new ImageLoader());
+            std::string layerSequence = layer.directory + ".sdseq";
+            bool layerLoaded = std::filesystem::exists(layerSequence) ? loader->loadSequenceFile(layerSequence, opt)
+                                                                      : loader->loadImagesFromDirectory(layer.directory, opt);
+            if (!layerLoaded) {
+                std::cout << "No images found in layer directory " << layer.directory << std::endl;
+                return -1;
+            }
+            layerLoaders.push_back(std::move(loader));
+        }
+        
+        // Draw at the monitor's native resolution instead of being bitmap-stretched
+        // by Windows; WM_DPICHANGED keeps the window size right across monitors
+        SetProcessDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
+        
+        // Several windows share one display, share group and set of frame
+        // textures, so each frame is decoded and uploaded once for all of them
+        std::unique_ptr<OutputGroup> outputGroup;
+        if (windowCount > 1) {
+            outputGroup.reset(new OutputGroup(imageLoader, 2 * windowCount + 2));
+            if (!outputGroup->open(config.backend, minimumClientVersion, requireRGBA)) {
+                return -1;
+            }
+        }
+        
+        // Borderless low-latency windows cover one monitor each
+        std::vector<RECT> monitors;
+        if (config.lowLatency) {
+            EnumDisplayMonitors(NULL, NULL, CollectMonitor, reinterpret_cast<LPARAM>(&monitors));
         }
+        
+        HINSTANCE hInstance = GetModuleHandle(NULL);
+        std::vector<HANDLE> stepEvents;
+        for (int i = 0; i < windowCount; ++i) {
+            Output& output = outputs[i];
+            output.index = i;
+            
+            // Create window
+            const RECT* monitor = monitors.empty() ? nullptr : &monitors[i % monitors.size()];
+            output.hWnd = CreateWin32Window(hInstance, SW_SHOW, config.windowWidth, config.windowHeight, monitor);
+            if (!output.hWnd) {
+                std::cerr << "Failed to create window" << std::endl;
+                return -1;
+            }
 
-        // Create renderer
-        renderer = new Renderer(hWnd, WINDOW_WIDTH, WINDOW_HEIGHT, imageLoader);
+            // Create renderer
+            output.renderer = new Renderer(output.hWnd, config.windowWidth, config.windowHeight, imageLoader, std::move(pipelines[i]));
+            // Stage timing percentiles of each run go to frame_stats.csv/.json for comparing builds
+            std::string statsLabel = std::string("build ") + __DATE__ + " " + __TIME__;
+            if (windowCount > 1) {
+                statsLabel += " window " + std::to_string(i + 1);
+            }
+            output.renderer->setStatsExport("frame_stats", statsLabel);
+            // Pacing, vsync, timing, backend, render scale, adaptive quality and lazy frames
+            config.applyTo(*output.renderer);
+            output.renderer->setOutputGroup(outputGroup.get());
+            // Flip-model presentation with one queued frame; Esc closes the borderless window
+            output.renderer->setLowLatencyPresentation(config.lowLatency);
+            for (size_t j = 0; j < layerLoaders.size(); ++j) {
+                if (!output.renderer->addLayer(*layerLoaders[j], layerOptions[j].opacity, layerOptions[j].mode)) {
+                    return -1;
+                }
+            }
 
-        // Store renderer pointer for window procedure
-        SetWindowLongPtr(hWnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(renderer));
-        
-        // Start renderer in a separate thread
-        if (!renderer->start()) {
-            std::cerr << "Failed to start renderer" << std::endl;
-            return -1;
+            // Store the output for the window procedure
+            SetWindowLongPtr(output.hWnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(&output));
+            
+            // Start renderer in a separate thread
+            if (!output.renderer->start()) {
+                std::cerr << "Failed to start renderer" << std::endl;
+                return -1;
+            }
+            stepEvents.push_back(output.renderer->getStepEvent());
         }
         
-        // Message loop
+        // Message loop: block until input arrives or a renderer reports a
+        // finished step, instead of polling
         MSG msg = {};
         bool running = true;
+        DWORD eventCount = static_cast<DWORD>(stepEvents.size());
+        
+        // Both clocks start with every renderer running, so a replay's events
+        // land at the same points of the session as when they were recorded
+        ControlReplay replay(replayRecording);
+        if (replayingControls) {
+            std::cout << "Replaying " << replayRecording.getEvents().size() << " control events from "
+                      << config.replayControls << std::endl;
+            replay.start();
+        } else if (recordingControls) {
+            controlRecording.start();
+        }
         
         std::cout << "Application running..." << std::endl;
         
         while (running) {
+            DWORD timeout = replayingControls ? replay.getWaitMilliseconds() : INFINITE;
+            DWORD wake = MsgWaitForMultipleObjectsEx(eventCount, stepEvents.data(), timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+            for (const ControlEvent* event = replay.takeDue(); replayingControls && event; event = replay.takeDue()) {
+                Output& output = outputs[event->window % outputs.size()];
+                if (event->action == ControlAction::Quit) {
+                    running = false;
+                    break;
+                }
+                ControlRecording::apply(*event, *output.renderer, output.computePipeline);
+            }
+            if (replayingControls && replay.isFinished()) {
+                running = false; // Only without a quit to end on, i.e. an empty recording
+            }
+            if (!running || wake == WAIT_TIMEOUT) {
+                continue;
+            }
+            if (wake - WAIT_OBJECT_0 < eventCount) {
+                // The stepped-to frame is on screen in that window
+                Output& output = outputs[wake - WAIT_OBJECT_0];
+                size_t frame = output.renderer->getPresentedFrame();
+                std::string title = "ANGLE Shader Demo - " + std::to_string(frame + 1) + "/" +
+                                    std::to_string(imageLoader.getImageCount()) + " " + imageLoader.getImageName(frame);
+                SetWindowText(output.hWnd, title.c_str());
+                continue;
+            }
+            if (wake == WAIT_FAILED) {
+                std::cerr << "Message wait failed (error " << GetLastError() << ")" << std::endl;
+                break;
+            }
+            
             // Process Windows messages
             while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
                 if (msg.message == WM_QUIT) {
+                    if (recordingControls) {
+                        controlRecording.record(0, ControlAction::Quit);
+                    }
                     running = false;
                     break;
                 }
                 TranslateMessage(&msg);
                 DispatchMessage(&msg);
             }
-            
-            // Sleep to avoid excessive CPU usage
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        
+        if (recordingControls) {
+            controlRecording.save(config.recordControls);
         }
         
         std::cout << "Stopping renderer..." << std::endl;
-        renderer->stop();
+        for (Output& output : outputs) {
+            // Clear the user data first, so late window messages no longer reach the renderer
+            SetWindowLongPtr(output.hWnd, GWLP_USERDATA, 0);
+            output.renderer->stop();
+        }
+        if (replayingControls) {
+            // The per-stage timings of the replayed session, for comparing builds;
+            // read once the render threads, which report them too, have exited
+            for (Output& output : outputs) {
+                std::cout << "\n===== Replay statistics, window " << output.index + 1 << " =====" << std::endl;
+                output.renderer->getFrameStats().report(std::cout);
+            }
+        }
+        for (Output& output : outputs) {
+            delete output.renderer;
+        }
+        if (outputGroup) {
+            outputGroup->close();
+        }
+        TRACE_SHUTDOWN();
         
         std::cout << "Program exited normally" << std::endl;
     } catch (const std::exception& e) {
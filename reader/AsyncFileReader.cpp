@@ -0,0 +1,230 @@
+#include "AsyncFileReader.h"
+
+#include <algorithm>
+#include <iostream>
+
+// Unbuffered reads must start at and cover whole sectors; 4 KB covers 512-byte
+// and 4K-native disks as well as the page alignment of the buffer
+static const uint64_t kSectorAlignment = 4096;
+
+// Large files are read in several requests of this size (a sector multiple)
+static const uint64_t kChunkBytes = 4ull * 1024 * 1024;
+
+// Release callback for the page-aligned buffers of unbuffered reads
+static void releaseAligned(unsigned char* ptr, size_t, void*) {
+    VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+AsyncFileReader::AsyncFileReader(int queueDepth, bool unbuffered)
+    : queueDepth(std::max(queueDepth, 1)), unbuffered(unbuffered), port(nullptr), nextFile(0),
+      handedOut(0), stopping(false), readerDone(false) {
+}
+
+AsyncFileReader::~AsyncFileReader() {
+    stop();
+}
+
+bool AsyncFileReader::start(const std::vector<std::filesystem::path>& files) {
+    stop();
+    this->files = files;
+    nextFile = 0;
+    handedOut = 0;
+    stopping = false;
+    readerDone = false;
+
+    port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+    if (!port) {
+        std::cerr << "Failed to create an I/O completion port (error " << GetLastError() << ")" << std::endl;
+        return false;
+    }
+    worker = std::thread(&AsyncFileReader::readLoop, this);
+    return true;
+}
+
+bool AsyncFileReader::next(size_t& index, PixelBuffer& contents) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finishedAvailable.wait(lock, [this] { return !finished.empty() || handedOut >= files.size() || stopping || readerDone; });
+        if (finished.empty()) {
+            return false;
+        }
+        index = finished.front().index;
+        contents = std::move(finished.front().contents);
+        finished.pop_front();
+        ++handedOut;
+    }
+    // A slot is free: wake the reader thread to issue the next file
+    PostQueuedCompletionStatus(port, 0, 0, nullptr);
+    return true;
+}
+
+void AsyncFileReader::stop() {
+    if (!worker.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    finishedAvailable.notify_all();
+    PostQueuedCompletionStatus(port, 0, 0, nullptr);
+    worker.join();
+    CloseHandle(port);
+    port = nullptr;
+    finished.clear();
+}
+
+void AsyncFileReader::readLoop() {
+    bool cancelled = false;
+    for (;;) {
+        bool stop;
+        size_t occupied;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = stopping;
+            occupied = active.size() + finished.size();
+        }
+
+        if (stop) {
+            // Abort the reads in flight once; their completions still arrive below
+            if (!cancelled) {
+                for (const std::unique_ptr<Request>& request : active) {
+                    CancelIoEx(request->file, nullptr);
+                }
+                cancelled = true;
+            }
+        } else {
+            // Keep queueDepth files in flight or waiting to be taken
+            for (; occupied < static_cast<size_t>(queueDepth) && issueNext(); ++occupied) {
+            }
+        }
+
+        if (active.empty() && (stop || nextFile >= files.size())) {
+            break; // Everything issued has completed
+        }
+
+        DWORD bytes = 0;
+        ULONG_PTR key = 0;
+        OVERLAPPED* overlapped = nullptr;
+        BOOL ok = GetQueuedCompletionStatus(port, &bytes, &key, &overlapped, INFINITE);
+        if (!overlapped) {
+            if (!ok) {
+                std::cerr << "I/O completion port wait failed (error " << GetLastError() << ")" << std::endl;
+                break;
+            }
+            continue; // Woken by next() or stop()
+        }
+
+        Request* request = reinterpret_cast<Request*>(overlapped);
+        if (!ok || bytes == 0) {
+            complete(request, false); // Failed, cancelled or cut short
+            continue;
+        }
+        request->offset += bytes;
+        if (request->offset >= request->size) {
+            complete(request, true);
+        } else if (stop || !readChunk(*request)) {
+            complete(request, false);
+        }
+    }
+
+    // Only reachable with reads in flight if the port failed: wait for each
+    // cancelled read to let go of its buffer before releasing it
+    while (!active.empty()) {
+        Request* request = active.back().get();
+        DWORD bytes;
+        CancelIoEx(request->file, nullptr);
+        GetOverlappedResult(request->file, &request->overlapped, &bytes, TRUE);
+        complete(request, false);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        readerDone = true; // next() hands out what finished, then stops
+    }
+    finishedAvailable.notify_all();
+}
+
+bool AsyncFileReader::issueNext() {
+    if (nextFile >= files.size()) {
+        return false;
+    }
+    size_t index = nextFile++;
+
+    DWORD flags = FILE_FLAG_OVERLAPPED | (unbuffered ? FILE_FLAG_NO_BUFFERING : FILE_FLAG_SEQUENTIAL_SCAN);
+    HANDLE file = CreateFileW(files[index].wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, flags, nullptr);
+    LARGE_INTEGER size;
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || size.QuadPart <= 0 ||
+        !CreateIoCompletionPort(file, port, 1, 0)) {
+        // Reported as an empty file; the decoder logs the failure
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back({ index, PixelBuffer() });
+        }
+        finishedAvailable.notify_one();
+        return true;
+    }
+
+    std::unique_ptr<Request> request(new Request());
+    request->overlapped = OVERLAPPED();
+    request->file = file;
+    request->index = index;
+    request->size = static_cast<uint64_t>(size.QuadPart);
+    request->capacity = unbuffered ? (request->size + kSectorAlignment - 1) / kSectorAlignment * kSectorAlignment
+                                   : request->size;
+    request->offset = 0;
+    request->buffer = allocateBuffer(request->capacity);
+    Request* raw = request.get();
+    active.push_back(std::move(request));
+    if (raw->buffer.empty() || !readChunk(*raw)) {
+        complete(raw, false);
+    }
+    return true;
+}
+
+bool AsyncFileReader::readChunk(Request& request) {
+    DWORD length = static_cast<DWORD>(std::min(request.capacity - request.offset, kChunkBytes));
+    request.overlapped = OVERLAPPED();
+    request.overlapped.Offset = static_cast<DWORD>(request.offset);
+    request.overlapped.OffsetHigh = static_cast<DWORD>(request.offset >> 32);
+    // The completion is queued on the port even if the read finishes at once
+    return ReadFile(request.file, request.buffer.data() + request.offset, length, nullptr, &request.overlapped) ||
+           GetLastError() == ERROR_IO_PENDING;
+}
+
+void AsyncFileReader::complete(Request* request, bool ok) {
+    CloseHandle(request->file);
+    Finished result = { request->index, PixelBuffer() };
+    if (ok) {
+        if (unbuffered) {
+            // Handed on with the file's size; the whole allocation is freed with it
+            unsigned char* data = request->buffer.data();
+            request->buffer = PixelBuffer(); // Does not free: the aligned buffer has no release here
+            result.contents = PixelBuffer(data, static_cast<size_t>(request->size), &releaseAligned);
+        } else {
+            result.contents = std::move(request->buffer);
+        }
+    } else if (unbuffered && !request->buffer.empty()) {
+        VirtualFree(request->buffer.data(), 0, MEM_RELEASE);
+    }
+
+    active.erase(std::find_if(active.begin(), active.end(),
+                              [request](const std::unique_ptr<Request>& entry) { return entry.get() == request; }));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back(std::move(result));
+    }
+    finishedAvailable.notify_one();
+}
+
+PixelBuffer AsyncFileReader::allocateBuffer(uint64_t capacity) const {
+    if (!unbuffered) {
+        return PixelBuffer::allocate(static_cast<size_t>(capacity));
+    }
+    // Page-aligned, owned by the request until the read completes (no release callback)
+    void* data = VirtualAlloc(nullptr, static_cast<size_t>(capacity), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    return PixelBuffer(static_cast<unsigned char*>(data), static_cast<size_t>(capacity), nullptr);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Windows.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "PixelBuffer.h"
+
+// Reads whole files with overlapped I/O, many at a time, for decoders that
+// work from memory. A reader thread keeps up to queueDepth files in flight on
+// an I/O completion port, issued in the order given, and decode threads take
+// finished files with next() in the order they complete. Files read but not
+// yet taken count against the depth, so memory stays bounded to queueDepth
+// files however far the reads run ahead of the decoders.
+//
+// Unbuffered reads (FILE_FLAG_NO_BUFFERING) go from the device straight into
+// page-aligned buffers, bypassing the system file cache; sequences read once
+// then do not evict everything else from it.
+class AsyncFileReader {
+public:
+    explicit AsyncFileReader(int queueDepth = 8, bool unbuffered = false);
+    ~AsyncFileReader();
+
+    AsyncFileReader(const AsyncFileReader&) = delete;
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+    // Start reading the files. Returns false if the completion port or the
+    // reader thread cannot be created.
+    bool start(const std::vector<std::filesystem::path>& files);
+
+    // Take the next finished file: its position in the list given to start()
+    // and its bytes (empty if it could not be read). Blocks until one is done;
+    // returns false once every file has been handed out. Any thread.
+    bool next(size_t& index, PixelBuffer& contents);
+
+    // Cancel the reads in flight and join the reader thread
+    void stop();
+
+    int getQueueDepth() const { return queueDepth; }
+
+private:
+    // A file being read; overlapped must stay first so completions map back to it
+    struct Request {
+        OVERLAPPED overlapped;
+        HANDLE file;
+        size_t index;
+        PixelBuffer buffer;
+        uint64_t size;      // File size; buffer may be larger (whole sectors) when unbuffered
+        uint64_t capacity;  // Bytes the reads may fill
+        uint64_t offset;    // Bytes read so far
+    };
+
+    struct Finished {
+        size_t index;
+        PixelBuffer contents;
+    };
+
+    int queueDepth;
+    bool unbuffered;
+    std::vector<std::filesystem::path> files;
+    HANDLE port;
+    std::thread worker;
+
+    // Reader thread only
+    size_t nextFile;
+    std::vector<std::unique_ptr<Request>> active;
+
+    // Shared with next()
+    std::mutex mutex;
+    std::condition_variable finishedAvailable;
+    std::deque<Finished> finished;
+    size_t handedOut;  // Files taken by next()
+    bool stopping;
+    bool readerDone;   // The reader thread has exited
+
+    void readLoop();
+    // Open the next file and issue its first read; false when there is none left
+    bool issueNext();
+    bool readChunk(Request& request);
+    void complete(Request* request, bool ok);
+    PixelBuffer allocateBuffer(uint64_t capacity) const;
+};
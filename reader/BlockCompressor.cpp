@@ -0,0 +1,337 @@
+#include "BlockCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// 4x4 block of RGBA8 texels in row-major order
+struct Block {
+    uint8_t rgba[16][4];
+};
+
+static uint16_t packColor565(const float color[3]) {
+    int r = static_cast<int>(std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f));
+    int g = static_cast<int>(std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f));
+    int b = static_cast<int>(std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f));
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void unpackColor565(uint16_t packed, int color[3]) {
+    int r = (packed >> 11) & 0x1f;
+    int g = (packed >> 5) & 0x3f;
+    int b = packed & 0x1f;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+static void writeLE16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value & 0xff);
+    out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static uint16_t readLE16(const uint8_t* in) {
+    return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+// Gather a 4x4 block at (bx, by), clamping to the frame edge
+static void fetchBlock(const ImageData& image, int bx, int by, Block& block) {
+    const uint8_t* pixels = image.data.data();
+    for (int y = 0; y < 4; ++y) {
+        int sy = std::min(by * 4 + y, image.height - 1);
+        for (int x = 0; x < 4; ++x) {
+            int sx = std::min(bx * 4 + x, image.width - 1);
+            const uint8_t* src = pixels + (static_cast<size_t>(sy) * image.width + sx) * image.channels;
+            uint8_t* dst = block.rgba[y * 4 + x];
+            if (image.channels == 1) {
+                dst[0] = dst[1] = dst[2] = src[0];
+                dst[3] = 255;
+            } else {
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+                dst[3] = image.channels == 4 ? src[3] : 255;
+            }
+        }
+    }
+}
+
+// Encode the colour part of a block (BC1 layout, always 4-colour mode)
+static void encodeColorBlock(const Block& block, uint8_t* out) {
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            mean[c] += block.rgba[i][c];
+        }
+    }
+    for (int c = 0; c < 3; ++c) {
+        mean[c] /= 16.0f;
+    }
+
+    // Covariance of the block's colours
+    float cov[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; ++i) {
+        float r = block.rgba[i][0] - mean[0];
+        float g = block.rgba[i][1] - mean[1];
+        float b = block.rgba[i][2] - mean[2];
+        cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+        cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+    }
+
+    // Principal axis by power iteration
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 4; ++iteration) {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+        if (length <= 0.0f) {
+            break; // Flat block: any axis works
+        }
+        axis[0] = x / length;
+        axis[1] = y / length;
+        axis[2] = z / length;
+    }
+    float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+    // Endpoints at the extremes of the projections onto the axis
+    float minProjection = 0.0f;
+    float maxProjection = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        float projection = (block.rgba[i][0] - mean[0]) * axis[0] +
+                           (block.rgba[i][1] - mean[1]) * axis[1] +
+                           (block.rgba[i][2] - mean[2]) * axis[2];
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+    float endMax[3], endMin[3];
+    for (int c = 0; c < 3; ++c) {
+        endMax[c] = mean[c] + axis[c] * maxProjection / axisLength;
+        endMin[c] = mean[c] + axis[c] * minProjection / axisLength;
+    }
+
+    uint16_t color0 = packColor565(endMax);
+    uint16_t color1 = packColor565(endMin);
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        // 4-colour palette: c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1
+        int palette[4][3];
+        unpackColor565(color0, palette[0]);
+        unpackColor565(color1, palette[1]);
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (int i = 0; i < 16; ++i) {
+            int best = 0;
+            int bestError = 0x7fffffff;
+            for (int p = 0; p < 4; ++p) {
+                int dr = block.rgba[i][0] - palette[p][0];
+                int dg = block.rgba[i][1] - palette[p][1];
+                int db = block.rgba[i][2] - palette[p][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (i * 2);
+        }
+    }
+
+    writeLE16(out, color0);
+    writeLE16(out + 2, color1);
+    for (int i = 0; i < 4; ++i) {
+        out[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+    }
+}
+
+// Encode the alpha part of a BC3 block (8-value interpolated mode)
+static void encodeAlphaBlock(const Block& block, uint8_t* out) {
+    int alpha0 = 0;
+    int alpha1 = 255;
+    for (int i = 0; i < 16; ++i) {
+        alpha0 = std::max(alpha0, static_cast<int>(block.rgba[i][3]));
+        alpha1 = std::min(alpha1, static_cast<int>(block.rgba[i][3]));
+    }
+
+    uint64_t indices = 0;
+    if (alpha0 != alpha1) {
+        int palette[8];
+        palette[0] = alpha0;
+        palette[1] = alpha1;
+        for (int p = 1; p < 7; ++p) {
+            palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+        }
+
+        for (int i = 0; i < 16; ++i) {
+            int best = 0;
+            int bestError = 256;
+            for (int p = 0; p < 8; ++p) {
+                int error = std::abs(block.rgba[i][3] - palette[p]);
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= static_cast<uint64_t>(best) << (i * 3);
+        }
+    }
+
+    out[0] = static_cast<uint8_t>(alpha0);
+    out[1] = static_cast<uint8_t>(alpha1);
+    for (int i = 0; i < 6; ++i) {
+        out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+    }
+}
+
+static void decodeColorBlock(const uint8_t* in, bool allowTransparent, Block& block) {
+    uint16_t color0 = readLE16(in);
+    uint16_t color1 = readLE16(in + 2);
+    int palette[4][4];
+    unpackColor565(color0, palette[0]);
+    unpackColor565(color1, palette[1]);
+    palette[0][3] = palette[1][3] = 255;
+    if (color0 > color1 || !allowTransparent) {
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        palette[2][3] = palette[3][3] = 255;
+    } else {
+        // 3-colour mode with transparent black
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+        palette[2][3] = 255;
+        palette[3][3] = 0;
+    }
+
+    uint32_t indices = in[4] | (in[5] << 8) | (in[6] << 16) | (static_cast<uint32_t>(in[7]) << 24);
+    for (int i = 0; i < 16; ++i) {
+        const int* color = palette[(indices >> (i * 2)) & 3];
+        for (int c = 0; c < 4; ++c) {
+            block.rgba[i][c] = static_cast<uint8_t>(color[c]);
+        }
+    }
+}
+
+static void decodeAlphaBlock(const uint8_t* in, Block& block) {
+    int palette[8];
+    palette[0] = in[0];
+    palette[1] = in[1];
+    if (palette[0] > palette[1]) {
+        for (int p = 1; p < 7; ++p) {
+            palette[p + 1] = ((7 - p) * palette[0] + p * palette[1]) / 7;
+        }
+    } else {
+        for (int p = 1; p < 5; ++p) {
+            palette[p + 1] = ((5 - p) * palette[0] + p * palette[1]) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; ++i) {
+        indices |= static_cast<uint64_t>(in[2 + i]) << (i * 8);
+    }
+    for (int i = 0; i < 16; ++i) {
+        block.rgba[i][3] = static_cast<uint8_t>(palette[(indices >> (i * 3)) & 7]);
+    }
+}
+
+BlockFormat BlockCompressor::formatForChannels(int channels) {
+    return channels == 4 ? BlockFormat::BC3 : BlockFormat::BC1;
+}
+
+size_t BlockCompressor::compressedSize(BlockFormat format, int width, int height) {
+    size_t blocks = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+    switch (format) {
+        case BlockFormat::BC1: return blocks * 8;
+        case BlockFormat::BC3: return blocks * 16;
+        default:               return 0;
+    }
+}
+
+bool BlockCompressor::compress(const ImageData& source, BlockFormat format, ImageData& out) {
+    if (!source.isValid() || source.compression != BlockFormat::None || source.isPlanar() ||
+        source.sampleFormat != SampleFormat::UNorm8 ||
+        (source.channels != 1 && source.channels != 3 && source.channels != 4)) {
+        return false;
+    }
+    size_t size = compressedSize(format, source.width, source.height);
+    if (size == 0) {
+        return false;
+    }
+
+    PixelBuffer payload = PixelBuffer::allocate(size);
+    if (payload.empty()) {
+        return false;
+    }
+    uint8_t* dst = payload.data();
+    int blocksX = (source.width + 3) / 4;
+    int blocksY = (source.height + 3) / 4;
+    Block block;
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            fetchBlock(source, bx, by, block);
+            if (format == BlockFormat::BC3) {
+                encodeAlphaBlock(block, dst);
+                dst += 8;
+            }
+            encodeColorBlock(block, dst);
+            dst += 8;
+        }
+    }
+
+    int channels = format == BlockFormat::BC3 ? 4 : 3;
+    out = ImageData(source.width, source.height, channels, std::move(payload), format);
+    return true;
+}
+
+bool BlockCompressor::decompress(const ImageData& source, ImageData& out) {
+    if (!source.isValid() || source.compression == BlockFormat::None ||
+        source.data.size() < compressedSize(source.compression, source.width, source.height)) {
+        return false;
+    }
+
+    PixelBuffer pixels = PixelBuffer::allocate(static_cast<size_t>(source.width) * source.height * 4);
+    if (pixels.empty()) {
+        return false;
+    }
+    const uint8_t* src = source.data.data();
+    int blocksX = (source.width + 3) / 4;
+    int blocksY = (source.height + 3) / 4;
+    Block block;
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            if (source.compression == BlockFormat::BC3) {
+                decodeColorBlock(src + 8, false, block);
+                decodeAlphaBlock(src, block);
+                src += 16;
+            } else {
+                decodeColorBlock(src, true, block);
+                src += 8;
+            }
+
+            // Scatter the block, dropping texels past the frame edge
+            for (int y = 0; y < 4 && by * 4 + y < source.height; ++y) {
+                for (int x = 0; x < 4 && bx * 4 + x < source.width; ++x) {
+                    size_t offset = (static_cast<size_t>(by * 4 + y) * source.width + bx * 4 + x) * 4;
+                    memcpy(pixels.data() + offset, block.rgba[y * 4 + x], 4);
+                }
+            }
+        }
+    }
+
+    out = ImageData(source.width, source.height, 4, std::move(pixels));
+    return true;
+}
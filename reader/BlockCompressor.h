@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include "ImageLoader.h"
+
+// CPU encoder/decoder for the S3TC block formats used by the texture cache.
+// BC1 (DXT1) stores opaque frames in 8 bytes per 4x4 block and BC3 (DXT5)
+// frames with alpha in 16 bytes per block, a 6:1 / 4:1 reduction over RGB8 /
+// RGBA8. The encoder fits each block's endpoints along its principal colour
+// axis, which is fast enough to transcode a sequence on first run.
+class BlockCompressor {
+public:
+    // Format to use for a frame with the given channel count
+    static BlockFormat formatForChannels(int channels);
+
+    // Compressed payload size of a width x height frame
+    static size_t compressedSize(BlockFormat format, int width, int height);
+
+    // Compress an uncompressed 1/3/4-channel frame. Partial edge blocks are
+    // padded by repeating the last row/column.
+    static bool compress(const ImageData& source, BlockFormat format, ImageData& out);
+
+    // Decompress a BC1/BC3 frame to RGBA8 (channels == 4), for GPUs without S3TC support
+    static bool decompress(const ImageData& source, ImageData& out);
+};
@@ -0,0 +1,191 @@
+#include "BufferPool.h"
+
+#include <Windows.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+BufferPool& BufferPool::shared() {
+    // Never destroyed: buffers held by static objects (e.g. a global loader)
+    // may be released during static destruction
+    static BufferPool* pool = new BufferPool();
+    return *pool;
+}
+
+PixelBuffer PixelBuffer::allocate(size_t size) {
+    return BufferPool::shared().acquire(size);
+}
+
+BufferPool::BufferPool() : cachedBytes(0), cacheLimit(2048ull * 1024 * 1024), largePageSize(0) {
+}
+
+BufferPool::~BufferPool() {
+    trim();
+}
+
+size_t BufferPool::sizeClass(size_t size) const {
+    // Round up to 1/8 of the next power of two (at most 12.5% slack), so
+    // frames of one resolution always share a class
+    size_t top = 1;
+    while (top < size) {
+        top <<= 1;
+    }
+    size_t step = top / 8 > 4096 ? top / 8 : 4096;
+    size_t capacity = (size + step - 1) / step * step;
+    if (largePageSize) {
+        // Large-page allocations are whole pages; hand the remainder to the caller too
+        size_t total = (sizeof(Header) + capacity + largePageSize - 1) / largePageSize * largePageSize;
+        capacity = total - sizeof(Header);
+    }
+    return capacity;
+}
+
+bool BufferPool::enableLargePages() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (largePageSize) {
+        return true;
+    }
+    size_t pageSize = GetLargePageMinimum();
+    if (pageSize == 0) {
+        return false;
+    }
+
+    // The privilege has to be granted to the account and then enabled for this process
+    HANDLE token;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+        return false;
+    }
+    TOKEN_PRIVILEGES privileges = {};
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    bool enabled = LookupPrivilegeValueA(nullptr, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid) &&
+                   AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) &&
+                   GetLastError() == ERROR_SUCCESS; // ERROR_NOT_ALL_ASSIGNED without the privilege
+    CloseHandle(token);
+    if (!enabled) {
+        return false;
+    }
+    largePageSize = pageSize;
+    return true;
+}
+
+PixelBuffer BufferPool::acquire(size_t size) {
+    unsigned char* ptr = static_cast<unsigned char*>(allocate(size));
+    if (!ptr) {
+        std::cerr << "Cannot allocate " << size << " bytes for pixels" << std::endl;
+        return PixelBuffer();
+    }
+    return PixelBuffer(ptr, size, &releaseBuffer, this);
+}
+
+void BufferPool::releaseBuffer(unsigned char* ptr, size_t, void* context) {
+    static_cast<BufferPool*>(context)->release(ptr);
+}
+
+void* BufferPool::allocate(size_t size) {
+    if (size < kMinPooledSize) {
+        Header* header = static_cast<Header*>(malloc(sizeof(Header) + size));
+        if (!header) {
+            return nullptr;
+        }
+        header->capacity = size;
+        header->pooled = false;
+        return header + 1;
+    }
+
+    size_t capacity;
+    bool largePages;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        capacity = sizeClass(size);
+        largePages = largePageSize != 0;
+        auto list = freeLists.find(capacity);
+        if (list != freeLists.end() && !list->second.empty()) {
+            Header* header = list->second.back();
+            list->second.pop_back();
+            cachedBytes -= capacity;
+            return header + 1;
+        }
+    }
+
+    Header* header = nullptr;
+    if (largePages) {
+        // Physically contiguous pages may run out; fall back to normal pages then
+        header = static_cast<Header*>(VirtualAlloc(nullptr, sizeof(Header) + capacity,
+                                                   MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+    }
+    if (!header) {
+        header = static_cast<Header*>(VirtualAlloc(nullptr, sizeof(Header) + capacity,
+                                                   MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    }
+    if (!header) {
+        return nullptr;
+    }
+    header->capacity = capacity;
+    header->pooled = true;
+    return header + 1;
+}
+
+void* BufferPool::reallocate(void* ptr, size_t size) {
+    if (!ptr) {
+        return allocate(size);
+    }
+    Header* header = static_cast<Header*>(ptr) - 1;
+    if (size <= header->capacity && (header->pooled || size < kMinPooledSize)) {
+        return ptr; // Fits in the block it already has
+    }
+
+    void* grown = allocate(size);
+    if (grown) {
+        memcpy(grown, ptr, header->capacity < size ? header->capacity : size);
+        release(ptr);
+    }
+    return grown;
+}
+
+void BufferPool::release(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    Header* header = static_cast<Header*>(ptr) - 1;
+    if (!header->pooled) {
+        free(header);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cachedBytes + header->capacity <= cacheLimit) {
+            freeLists[header->capacity].push_back(header);
+            cachedBytes += header->capacity;
+            return;
+        }
+    }
+    VirtualFree(header, 0, MEM_RELEASE);
+}
+
+void BufferPool::setCacheLimit(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    cacheLimit = bytes;
+}
+
+void BufferPool::trim() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& list : freeLists) {
+        for (Header* header : list.second) {
+            VirtualFree(header, 0, MEM_RELEASE);
+        }
+    }
+    freeLists.clear();
+    cachedBytes = 0;
+}
+
+bool BufferPool::usesLargePages() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return largePageSize != 0;
+}
+
+size_t BufferPool::getCachedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cachedBytes;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "PixelBuffer.h"
+
+// Recycles large pixel allocations by size class.
+// Frame-sized blocks come straight from the OS (VirtualAlloc) and go back onto
+// a free list when released instead of being unmapped, so reloading a
+// sequence of the same resolution reuses the previous load's memory: no heap
+// fragmentation from multi-megabyte blocks and no page-zeroing on reuse.
+// Small requests fall through to malloc. Thread-safe.
+//
+// With large pages enabled, pooled blocks are backed by 2 MB pages, so the
+// copies of a 4K frame into upload staging memory touch a handful of TLB
+// entries instead of thousands.
+class BufferPool {
+public:
+    // Pool shared by the loader, the decoder and the pixel conversions
+    static BufferPool& shared();
+
+    BufferPool();
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Uninitialized buffer of size bytes that returns to the pool when released;
+    // empty if the memory cannot be allocated
+    PixelBuffer acquire(size_t size);
+
+    // Raw allocation interface (used by the stb_image allocator hooks)
+    void* allocate(size_t size);
+    void* reallocate(void* ptr, size_t size);
+    void release(void* ptr);
+
+    // Back new pooled blocks with large pages. Needs the "Lock pages in memory"
+    // privilege (SeLockMemoryPrivilege) and returns false without it; blocks
+    // then keep using normal pages.
+    bool enableLargePages();
+    bool usesLargePages() const;
+
+    // Bytes kept on the free lists before further blocks are returned to the OS
+    void setCacheLimit(size_t bytes);
+    // Return every cached block to the OS
+    void trim();
+
+    size_t getCachedBytes() const;
+
+private:
+    // Placed in front of every block; 64 bytes keeps the pixels cache-line aligned
+    struct alignas(64) Header {
+        size_t capacity;  // Usable bytes after the header
+        bool pooled;      // Came from the OS and returns to a free list
+    };
+
+    static const size_t kMinPooledSize = 256 * 1024;
+
+    mutable std::mutex mutex;
+    std::unordered_map<size_t, std::vector<Header*>> freeLists;  // By capacity
+    size_t cachedBytes;
+    size_t cacheLimit;
+    size_t largePageSize;  // 0 while large pages are off
+
+    size_t sizeClass(size_t size) const;
+    static void releaseBuffer(unsigned char* ptr, size_t size, void* context);
+};
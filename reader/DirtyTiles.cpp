@@ -0,0 +1,72 @@
+#include "DirtyTiles.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DIRTYTILES_X86 1
+#include <emmintrin.h>
+#endif
+
+// Whether two byte ranges are equal; stops at the first differing 16-byte block
+static bool spansEqual(const unsigned char* a, const unsigned char* b, size_t bytes) {
+    size_t i = 0;
+#ifdef DIRTYTILES_X86
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF) {
+            return false;
+        }
+    }
+#endif
+    return memcmp(a + i, b + i, bytes - i) == 0;
+}
+
+bool DirtyTiles::merge(const DirtyTiles& other) {
+    if (other.tileSize != tileSize || other.tilesX != tilesX || other.tilesY != tilesY) {
+        return false;
+    }
+    dirtyCount = 0;
+    for (size_t i = 0; i < dirty.size(); ++i) {
+        dirty[i] |= other.dirty[i];
+        dirtyCount += dirty[i];
+    }
+    return true;
+}
+
+bool DirtyTiles::compute(const ImageData& previous, const ImageData& current, int tileSize, DirtyTiles& out) {
+    if (tileSize <= 0 || !previous.isValid() || !current.isValid() ||
+        previous.compression != BlockFormat::None || current.compression != BlockFormat::None ||
+        previous.isPlanar() || current.isPlanar() ||
+        previous.sampleFormat != SampleFormat::UNorm8 || current.sampleFormat != SampleFormat::UNorm8 ||
+        previous.width != current.width || previous.height != current.height ||
+        previous.channels != current.channels) {
+        return false;
+    }
+
+    out.tileSize = tileSize;
+    out.tilesX = (current.width + tileSize - 1) / tileSize;
+    out.tilesY = (current.height + tileSize - 1) / tileSize;
+    out.dirty.assign(static_cast<size_t>(out.tilesX) * out.tilesY, 0);
+    out.dirtyCount = 0;
+
+    size_t stride = static_cast<size_t>(current.width) * current.channels;
+    size_t tileBytes = static_cast<size_t>(tileSize) * current.channels;
+    for (int y = 0; y < current.height; ++y) {
+        const unsigned char* rowA = previous.data.data() + stride * y;
+        const unsigned char* rowB = current.data.data() + stride * y;
+        uint8_t* flags = out.dirty.data() + static_cast<size_t>(y / tileSize) * out.tilesX;
+        for (int tx = 0; tx < out.tilesX; ++tx) {
+            if (flags[tx]) {
+                continue; // Already known to differ; skip the rest of its rows
+            }
+            size_t offset = tileBytes * tx;
+            if (!spansEqual(rowA + offset, rowB + offset, std::min(tileBytes, stride - offset))) {
+                flags[tx] = 1;
+                out.dirtyCount++;
+            }
+        }
+    }
+    return true;
+}
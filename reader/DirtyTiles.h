@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ImageLoader.h"
+
+// Which square tiles of a frame differ from the frame before it.
+// Computed once at load time for sequences where only small regions change
+// (e.g. UI captures), so playback can re-upload just the changed tiles.
+struct DirtyTiles {
+    int tileSize;
+    int tilesX;
+    int tilesY;
+    std::vector<uint8_t> dirty;  // tilesX * tilesY flags, row-major
+    size_t dirtyCount;
+
+    DirtyTiles() : tileSize(0), tilesX(0), tilesY(0), dirtyCount(0) {}
+
+    bool isValid() const { return tileSize > 0 && !dirty.empty(); }
+    bool isDirty(int tx, int ty) const { return dirty[static_cast<size_t>(ty) * tilesX + tx] != 0; }
+    double dirtyFraction() const { return dirty.empty() ? 1.0 : static_cast<double>(dirtyCount) / dirty.size(); }
+
+    // Add the tiles changed in other (same grid), e.g. to span several frames
+    bool merge(const DirtyTiles& other);
+
+    // Compare two uncompressed frames of the same size and layout tile by tile
+    // (SSE2 16-byte compares). Returns false if they cannot be compared.
+    static bool compute(const ImageData& previous, const ImageData& current, int tileSize, DirtyTiles& out);
+};
@@ -0,0 +1,364 @@
+#include "FrameCache.h"
+
+#include <algorithm>
+
+PrefetchScheduler::PrefetchScheduler(size_t memoryBudget, int threadCount)
+    : memoryBudget(memoryBudget), nextCache(0), residentBytes(0), stopping(false) {
+    threadCount = std::max(threadCount, 1);
+    for (int i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&PrefetchScheduler::workerLoop, this);
+    }
+}
+
+PrefetchScheduler::~PrefetchScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    frameReady.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+size_t PrefetchScheduler::getResidentBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return residentBytes;
+}
+
+void PrefetchScheduler::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        // The most urgent missing frame of any cache; equal ranks go round the caches
+        FrameCache* cache = nullptr;
+        size_t index = 0;
+        size_t bestRank = 0;
+        size_t cacheCount = caches.size();
+        for (size_t k = 0; k < cacheCount; ++k) {
+            size_t position = (nextCache + k) % cacheCount;
+            size_t candidate, candidateRank;
+            if (caches[position]->findPrefetchCandidate(candidate, candidateRank) &&
+                (!cache || candidateRank < bestRank)) {
+                cache = caches[position];
+                index = candidate;
+                bestRank = candidateRank;
+                nextCache = position + 1;
+            }
+        }
+        if (!cache) {
+            workAvailable.wait(lock);
+            continue;
+        }
+
+        cache->slots[index].loading = true;
+        cache->decodesInFlight++;
+        uint64_t generation = cache->seekGeneration;
+        lock.unlock();
+
+        auto frame = std::make_shared<ImageData>();
+        bool ok = cache->decode(index, *frame);
+
+        lock.lock();
+        cache->slots[index].loading = false;
+        cache->decodesInFlight--;
+        // A decode that a seek made stale must not push out frames around the new target
+        bool stale = generation != cache->seekGeneration && !cache->inWindow(index);
+        if (ok && frame->isValid() && !stale) {
+            cache->lastFrameBytes = frame->data.size();
+            // The playhead may have moved while decoding; only keep the frame if it still fits
+            cache->store(index, frame, false);
+        }
+        frameReady.notify_all();
+    }
+}
+
+bool PrefetchScheduler::canFit(const FrameCache& cache, size_t index, size_t bytes) const {
+    if (memoryBudget == 0 || residentBytes + bytes <= memoryBudget) {
+        return true;
+    }
+
+    // Count the bytes that could be reclaimed from frames less important than this one
+    size_t candidateRank = cache.rank(index);
+    size_t reclaimable = 0;
+    for (const FrameCache* other : caches) {
+        for (size_t i = 0; i < other->frameCount; ++i) {
+            if (other->slots[i].frame && other->rank(i) > candidateRank) {
+                reclaimable += other->slots[i].frame->data.size();
+            }
+        }
+    }
+    return residentBytes - reclaimable + bytes <= memoryBudget;
+}
+
+bool PrefetchScheduler::makeRoom(const FrameCache& cache, size_t index, size_t bytes, bool force) {
+    size_t candidateRank = cache.rank(index);
+    while (residentBytes + bytes > memoryBudget) {
+        FrameCache* victimCache = nullptr;
+        size_t victim = 0;
+        size_t victimRank = 0;
+        for (FrameCache* other : caches) {
+            for (size_t i = 0; i < other->frameCount; ++i) {
+                if ((other != &cache || i != index) && other->slots[i].frame && other->rank(i) >= victimRank) {
+                    victimCache = other;
+                    victim = i;
+                    victimRank = other->rank(i);
+                }
+            }
+        }
+        if (!victimCache || (!force && victimRank <= candidateRank)) {
+            return false;
+        }
+        victimCache->dropSlot(victim);
+    }
+    return true;
+}
+
+FrameCache::FrameCache(size_t frameCount, DecodeFn decode, const FrameCacheOptions& options)
+    : FrameCache(frameCount, std::move(decode), options,
+                 std::make_shared<PrefetchScheduler>(options.memoryBudget, options.threadCount)) {
+}
+
+FrameCache::FrameCache(size_t frameCount, DecodeFn decode, const FrameCacheOptions& options,
+                       std::shared_ptr<PrefetchScheduler> scheduler)
+    : frameCount(frameCount), decode(std::move(decode)), options(options), scheduler(std::move(scheduler)),
+      slots(frameCount), playhead(0), direction(1), residentBytes(0), residentCount(0),
+      lastFrameBytes(0), seekGeneration(0), decodesInFlight(0) {
+    attach();
+}
+
+void FrameCache::attach() {
+    {
+        std::lock_guard<std::mutex> lock(scheduler->mutex);
+        scheduler->caches.push_back(this);
+    }
+    scheduler->workAvailable.notify_all();
+}
+
+FrameCache::~FrameCache() {
+    // Workers may be decoding for this cache; they finish before it goes away
+    std::unique_lock<std::mutex> lock(scheduler->mutex);
+    auto& caches = scheduler->caches;
+    caches.erase(std::remove(caches.begin(), caches.end(), this), caches.end());
+    scheduler->nextCache = 0;
+    scheduler->frameReady.wait(lock, [this] { return decodesInFlight == 0; });
+    for (size_t i = 0; i < frameCount; ++i) {
+        dropSlot(i);
+    }
+    lock.unlock();
+    // The freed budget may let the other caches prefetch further
+    scheduler->workAvailable.notify_all();
+}
+
+std::shared_ptr<const ImageData> FrameCache::acquire(size_t index) {
+    if (index >= frameCount) {
+        return nullptr;
+    }
+
+    std::unique_lock<std::mutex> lock(scheduler->mutex);
+    for (;;) {
+        Slot& slot = slots[index];
+        if (slot.frame) {
+            return slot.frame;
+        }
+        if (!slot.loading) {
+            break;
+        }
+        // A worker is already decoding this frame; wait for it instead of decoding twice
+        scheduler->frameReady.wait(lock);
+        if (scheduler->stopping) {
+            return nullptr;
+        }
+    }
+
+    // Cache miss: decode on the calling thread
+    slots[index].loading = true;
+    lock.unlock();
+
+    auto frame = std::make_shared<ImageData>();
+    bool ok = decode(index, *frame);
+
+    lock.lock();
+    slots[index].loading = false;
+    std::shared_ptr<const ImageData> result;
+    if (ok && frame->isValid()) {
+        result = frame;
+        store(index, result, true);
+    }
+    lock.unlock();
+
+    scheduler->frameReady.notify_all();
+    scheduler->workAvailable.notify_all();
+    return result;
+}
+
+std::shared_ptr<const ImageData> FrameCache::tryAcquire(size_t index) const {
+    if (index >= frameCount) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(scheduler->mutex);
+    return slots[index].frame;
+}
+
+std::shared_ptr<const ImageData> FrameCache::acquireNearest(size_t index, size_t& found) const {
+    if (index >= frameCount) {
+        return nullptr;
+    }
+
+    // Search outwards from index, preferring the earlier frame on ties
+    std::lock_guard<std::mutex> lock(scheduler->mutex);
+    for (size_t distance = 0; distance <= frameCount / 2; ++distance) {
+        size_t before = (index + frameCount - distance) % frameCount;
+        size_t after = (index + distance) % frameCount;
+        if (slots[before].frame) {
+            found = before;
+            return slots[before].frame;
+        }
+        if (slots[after].frame) {
+            found = after;
+            return slots[after].frame;
+        }
+    }
+    return nullptr;
+}
+
+void FrameCache::seek(size_t index, int dir) {
+    if (index >= frameCount) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(scheduler->mutex);
+        seekGeneration++;
+    }
+    setPlayhead(index, dir);
+}
+
+void FrameCache::setPlayhead(size_t index, int dir) {
+    if (index >= frameCount) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(scheduler->mutex);
+        playhead = index;
+        direction = dir < 0 ? -1 : 1;
+        if (scheduler->memoryBudget == 0) {
+            evictOutsideWindow();
+        }
+    }
+    scheduler->workAvailable.notify_all();
+}
+
+size_t FrameCache::getResidentBytes() const {
+    std::lock_guard<std::mutex> lock(scheduler->mutex);
+    return residentBytes;
+}
+
+size_t FrameCache::getResidentCount() const {
+    std::lock_guard<std::mutex> lock(scheduler->mutex);
+    return residentCount;
+}
+
+size_t FrameCache::rank(size_t index) const {
+    // Lower rank = more important to keep. Frames in the playback direction come
+    // first, then the trailing frames, then everything else by distance.
+    size_t forward = (index + frameCount - playhead) % frameCount;
+    size_t backward = (playhead + frameCount - index) % frameCount;
+    size_t lead = direction >= 0 ? forward : backward;
+    size_t trail = direction >= 0 ? backward : forward;
+    size_t ahead = static_cast<size_t>(std::max(options.prefetchAhead, 0));
+    size_t behind = static_cast<size_t>(std::max(options.prefetchBehind, 0));
+
+    if (lead <= ahead) {
+        return lead;
+    }
+    if (trail <= behind) {
+        return ahead + trail;
+    }
+    return ahead + behind + std::min(lead, trail);
+}
+
+bool FrameCache::inWindow(size_t index) const {
+    size_t ahead = static_cast<size_t>(std::max(options.prefetchAhead, 0));
+    size_t behind = static_cast<size_t>(std::max(options.prefetchBehind, 0));
+    return rank(index) <= ahead + behind;
+}
+
+bool FrameCache::findPrefetchCandidate(size_t& index, size_t& candidateRank) const {
+    if (frameCount == 0) {
+        return false;
+    }
+
+    // Walk the window in priority order: ahead of the playhead first, then behind it
+    size_t ahead = static_cast<size_t>(std::max(options.prefetchAhead, 0));
+    size_t behind = static_cast<size_t>(std::max(options.prefetchBehind, 0));
+    size_t window = std::min(ahead + behind + 1, frameCount);
+    for (size_t k = 0; k < window; ++k) {
+        size_t offset;
+        bool leading = k <= ahead;
+        if (leading) {
+            offset = k;
+        } else {
+            offset = k - ahead;
+        }
+        int step = (leading ? direction : -direction);
+        size_t candidate = step > 0 ? (playhead + offset) % frameCount
+                                    : (playhead + frameCount - offset % frameCount) % frameCount;
+
+        const Slot& slot = slots[candidate];
+        if (slot.frame || slot.loading) {
+            continue;
+        }
+        if (!scheduler->canFit(*this, candidate, lastFrameBytes)) {
+            // Everything further out ranks lower, so it would not fit either
+            return false;
+        }
+        index = candidate;
+        candidateRank = rank(candidate);
+        return true;
+    }
+    return false;
+}
+
+void FrameCache::store(size_t index, std::shared_ptr<const ImageData> frame, bool force) {
+    size_t bytes = frame->data.size();
+    if (!force && !scheduler->canFit(*this, index, bytes)) {
+        return;
+    }
+    if (scheduler->memoryBudget == 0 && !force && !inWindow(index)) {
+        return;
+    }
+
+    // Evict the least important frames (of any cache sharing the budget) until the new one fits
+    if (scheduler->memoryBudget > 0) {
+        scheduler->makeRoom(*this, index, bytes, force);
+    }
+
+    if (slots[index].frame) {
+        dropSlot(index);
+    }
+    slots[index].frame = std::move(frame);
+    residentBytes += bytes;
+    residentCount++;
+    scheduler->residentBytes += bytes;
+}
+
+void FrameCache::evictOutsideWindow() {
+    for (size_t i = 0; i < frameCount; ++i) {
+        if (slots[i].frame && !inWindow(i)) {
+            dropSlot(i);
+        }
+    }
+}
+
+void FrameCache::dropSlot(size_t index) {
+    Slot& slot = slots[index];
+    if (slot.frame) {
+        size_t bytes = slot.frame->data.size();
+        residentBytes -= bytes;
+        scheduler->residentBytes -= bytes;
+        residentCount--;
+        slot.frame.reset();
+    }
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ImageLoader.h"
+
+// Options for the streaming frame cache
+struct FrameCacheOptions {
+    size_t memoryBudget;  // Maximum bytes of decoded pixels kept resident (0 = keep only the prefetch window)
+    int prefetchAhead;    // Frames to decode ahead of the playhead in the playback direction
+    int prefetchBehind;   // Frames to keep behind the playhead (ahead of it when stepping backward)
+    int threadCount;      // Number of background decode threads
+
+    FrameCacheOptions() : memoryBudget(0), prefetchAhead(8), prefetchBehind(2), threadCount(2) {}
+};
+
+class FrameCache;
+
+// Decode threads and memory budget shared by several frame caches, e.g. the
+// layers of a composite. Workers always decode the most urgent missing frame
+// of any cache (ranked by distance from each cache's own playhead) and
+// eviction picks the least important frame across all of them, so adding a
+// sequence neither adds threads nor splits the budget into fixed shares.
+class PrefetchScheduler {
+public:
+    // memoryBudget = 0 keeps only each cache's prefetch window
+    PrefetchScheduler(size_t memoryBudget, int threadCount);
+    ~PrefetchScheduler();
+
+    PrefetchScheduler(const PrefetchScheduler&) = delete;
+    PrefetchScheduler& operator=(const PrefetchScheduler&) = delete;
+
+    size_t getMemoryBudget() const { return memoryBudget; }
+    int getThreadCount() const { return static_cast<int>(workers.size()); }
+    // Decoded bytes resident in all caches
+    size_t getResidentBytes() const;
+
+private:
+    friend class FrameCache;
+
+    const size_t memoryBudget;
+    std::vector<FrameCache*> caches;  // Registered caches, guarded by mutex
+    size_t nextCache;                 // Where the next candidate search starts, so ties rotate
+    size_t residentBytes;
+    bool stopping;
+
+    mutable std::mutex mutex;
+    std::condition_variable workAvailable;  // Wakes prefetch workers
+    std::condition_variable frameReady;     // Wakes acquire() calls waiting on an in-flight decode
+    std::vector<std::thread> workers;
+
+    void workerLoop();
+
+    // The following helpers must be called with mutex held
+    bool canFit(const FrameCache& cache, size_t index, size_t bytes) const;
+    // Evict less important frames of any cache until bytes more fit; force
+    // evicts regardless of rank. Returns false if they still do not fit.
+    bool makeRoom(const FrameCache& cache, size_t index, size_t bytes, bool force);
+};
+
+// Sliding window of decoded frames around a playhead.
+// Background workers decode frames ahead of the playhead and evict the farthest
+// frames once the memory budget is exceeded. Frames are handed out as shared
+// pointers, so an evicted frame stays valid until its last user releases it.
+class FrameCache {
+public:
+    // Decodes the frame at index into out; returns false on failure
+    using DecodeFn = std::function<bool(size_t index, ImageData& out)>;
+
+    // A cache with its own scheduler of options.threadCount threads and options.memoryBudget
+    FrameCache(size_t frameCount, DecodeFn decode, const FrameCacheOptions& options = FrameCacheOptions());
+    // A cache prefetched by a shared scheduler; its budget and threads replace
+    // options.memoryBudget and options.threadCount
+    FrameCache(size_t frameCount, DecodeFn decode, const FrameCacheOptions& options,
+               std::shared_ptr<PrefetchScheduler> scheduler);
+    ~FrameCache();
+
+    FrameCache(const FrameCache&) = delete;
+    FrameCache& operator=(const FrameCache&) = delete;
+
+    // Get a frame, decoding it on the calling thread if it is not resident yet
+    std::shared_ptr<const ImageData> acquire(size_t index);
+
+    // Get a frame only if it is already resident (never decodes or waits)
+    std::shared_ptr<const ImageData> tryAcquire(size_t index) const;
+
+    // Get the resident frame closest to index (either direction). found is set
+    // to its index; returns nullptr if nothing is resident.
+    std::shared_ptr<const ImageData> acquireNearest(size_t index, size_t& found) const;
+
+    // Move the playhead; direction is +1 for forward playback and -1 for backward
+    void setPlayhead(size_t index, int direction);
+
+    // Jump the playhead (e.g. a seek across the sequence). Prefetching restarts
+    // at index, and decodes already in flight for frames outside the new window
+    // are discarded when they finish instead of evicting frames near the target.
+    void seek(size_t index, int direction);
+
+    size_t getFrameCount() const { return frameCount; }
+    size_t getResidentBytes() const;
+    size_t getResidentCount() const;
+    const PrefetchScheduler& getScheduler() const { return *scheduler; }
+
+private:
+    friend class PrefetchScheduler;
+
+    struct Slot {
+        std::shared_ptr<const ImageData> frame;
+        bool loading = false;  // A decode for this slot is in flight
+    };
+
+    const size_t frameCount;
+    DecodeFn decode;
+    FrameCacheOptions options;
+    std::shared_ptr<PrefetchScheduler> scheduler;  // Owns the lock, the workers and the budget
+
+    std::vector<Slot> slots;
+    size_t playhead;
+    int direction;
+    size_t residentBytes;
+    size_t residentCount;
+    size_t lastFrameBytes;  // Size of the most recent decode, used to estimate the next one
+    uint64_t seekGeneration;  // Incremented by seek()
+    int decodesInFlight;      // Worker decodes of this cache's frames
+
+    void attach();
+
+    // The following helpers must be called with the scheduler's mutex held
+    size_t rank(size_t index) const;
+    bool inWindow(size_t index) const;
+    // Most urgent frame to prefetch and its rank
+    bool findPrefetchCandidate(size_t& index, size_t& candidateRank) const;
+    void store(size_t index, std::shared_ptr<const ImageData> frame, bool force);
+    void evictOutsideWindow();
+    void dropSlot(size_t index);
+};
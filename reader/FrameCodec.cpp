@@ -0,0 +1,176 @@
+#include "FrameCodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FRAMECODEC_X86 1
+#include <emmintrin.h>
+#endif
+
+// Token types; each token is a type byte followed by a LEB128 length
+static const unsigned char kZeroRun = 0;
+static const unsigned char kLiteralRun = 1;
+
+// Shortest zero run worth a token of its own inside a literal run
+static const size_t kMinZeroRun = 8;
+
+static void writeLength(std::vector<unsigned char>& out, size_t length) {
+    while (length >= 0x80) {
+        out.push_back(static_cast<unsigned char>(length | 0x80));
+        length >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(length));
+}
+
+static bool readLength(const unsigned char*& data, const unsigned char* end, size_t& length) {
+    length = 0;
+    for (int shift = 0; data < end && shift < 64; shift += 7) {
+        unsigned char byte = *data++;
+        length |= static_cast<size_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Number of zero bytes starting at data (at most count)
+static size_t zeroRunLength(const unsigned char* data, size_t count) {
+    size_t i = 0;
+#ifdef FRAMECODEC_X86
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, zero));
+        if (mask != 0xFFFF) {
+            // Count the zero bytes before the first non-zero one
+            while (mask & 1) {
+                mask >>= 1;
+                ++i;
+            }
+            return i;
+        }
+    }
+#endif
+    while (i < count && data[i] == 0) {
+        ++i;
+    }
+    return i;
+}
+
+bool FrameCodec::encode(const ImageData& frame, const ImageData* keyframe, std::vector<unsigned char>& out) {
+    if (!frame.isValid() || frame.compression != BlockFormat::None || frame.isPlanar() ||
+        frame.sampleFormat != SampleFormat::UNorm8) {
+        return false;
+    }
+    bool delta = keyframe && keyframe->isValid() && keyframe->compression == BlockFormat::None &&
+                 keyframe->width == frame.width && keyframe->height == frame.height &&
+                 keyframe->channels == frame.channels;
+
+    // Residuals: difference from the keyframe, or from the previous pixel
+    size_t size = frame.data.size();
+    const unsigned char* pixels = frame.data.data();
+    PixelBuffer residualBuffer = PixelBuffer::allocate(size);
+    if (residualBuffer.empty()) {
+        return false;
+    }
+    unsigned char* residual = residualBuffer.data();
+    if (delta) {
+        const unsigned char* reference = keyframe->data.data();
+        for (size_t i = 0; i < size; ++i) {
+            residual[i] = static_cast<unsigned char>(pixels[i] - reference[i]);
+        }
+    } else {
+        size_t stride = static_cast<size_t>(frame.channels);
+        memcpy(residual, pixels, std::min(stride, size));
+        for (size_t i = stride; i < size; ++i) {
+            residual[i] = static_cast<unsigned char>(pixels[i] - pixels[i - stride]);
+        }
+    }
+
+    out.clear();
+    out.reserve(size / 4);
+    size_t i = 0;
+    while (i < size) {
+        size_t zeros = zeroRunLength(residual + i, size - i);
+        if (zeros > 0) {
+            out.push_back(kZeroRun);
+            writeLength(out, zeros);
+            i += zeros;
+            continue;
+        }
+        // Literal run up to the next zero run long enough to pay for its token
+        size_t start = i;
+        while (i < size) {
+            if (residual[i] == 0 && zeroRunLength(residual + i, std::min(kMinZeroRun, size - i)) >= kMinZeroRun) {
+                break;
+            }
+            ++i;
+        }
+        out.push_back(kLiteralRun);
+        writeLength(out, i - start);
+        out.insert(out.end(), residual + start, residual + i);
+    }
+    out.shrink_to_fit();
+    return true;
+}
+
+bool FrameCodec::decode(const unsigned char* data, size_t size, int width, int height, int channels,
+                        const ImageData* keyframe, ImageData& out) {
+    size_t bytes = static_cast<size_t>(width) * height * channels;
+    if (width <= 0 || height <= 0 || channels <= 0 ||
+        (keyframe && (!keyframe->isValid() || keyframe->data.size() != bytes))) {
+        return false;
+    }
+
+    PixelBuffer pixels = PixelBuffer::allocate(bytes);
+    if (pixels.empty()) {
+        return false;
+    }
+    unsigned char* dst = pixels.data();
+    const unsigned char* end = data + size;
+    size_t written = 0;
+    while (data < end) {
+        unsigned char type = *data++;
+        size_t length;
+        if (!readLength(data, end, length) || length > bytes - written) {
+            return false;
+        }
+        if (type == kZeroRun) {
+            memset(dst + written, 0, length);
+        } else if (type == kLiteralRun && length <= static_cast<size_t>(end - data)) {
+            memcpy(dst + written, data, length);
+            data += length;
+        } else {
+            return false;
+        }
+        written += length;
+    }
+    if (written != bytes) {
+        return false;
+    }
+
+    // Undo the prediction
+    if (keyframe) {
+        const unsigned char* reference = keyframe->data.data();
+        size_t i = 0;
+#ifdef FRAMECODEC_X86
+        for (; i + 16 <= bytes; i += 16) {
+            __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(reference + i));
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_add_epi8(r, d));
+        }
+#endif
+        for (; i < bytes; ++i) {
+            dst[i] = static_cast<unsigned char>(dst[i] + reference[i]);
+        }
+    } else {
+        for (size_t i = static_cast<size_t>(channels); i < bytes; ++i) {
+            dst[i] = static_cast<unsigned char>(dst[i] + dst[i - channels]);
+        }
+    }
+
+    out = ImageData(width, height, channels, std::move(pixels));
+    return true;
+}
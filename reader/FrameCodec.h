@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "ImageLoader.h"
+
+// Lossless in-memory encoding for decoded frames, so more of a sequence fits
+// in RAM than as raw pixels. Keyframes store each byte's difference from the
+// same channel of the previous pixel; delta frames store their difference
+// from a keyframe. The residuals are then run-length coded with zero runs
+// and literal runs, which is cheap to expand and collapses the flat areas and
+// unchanged regions that dominate screen captures and renders. Natural photos
+// compress less; see ImageLoadOptions::packInMemory.
+class FrameCodec {
+public:
+    // Encode an uncompressed frame. With a keyframe of the same layout the
+    // difference to it is stored, otherwise the frame is a keyframe itself.
+    static bool encode(const ImageData& frame, const ImageData* keyframe, std::vector<unsigned char>& out);
+
+    // Expand an encoded frame with the given layout. keyframe must be the
+    // decoded keyframe it was encoded against (nullptr for keyframes).
+    static bool decode(const unsigned char* data, size_t size, int width, int height, int channels,
+                       const ImageData* keyframe, ImageData& out);
+};
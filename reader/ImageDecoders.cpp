@@ -0,0 +1,467 @@
+#include "ImageDecoders.h"
+#include "BlockCompressor.h"
+#include "BufferPool.h"
+#include "PixelConvert.h"
+
+// Define STB_IMAGE_IMPLEMENTATION before including stb_image.h to create the implementation
+#define STB_IMAGE_IMPLEMENTATION
+// Decoded pixels and stb's working buffers come from the pool, so reloads reuse frame memory
+#define STBI_MALLOC(size) BufferPool::shared().allocate(size)
+#define STBI_REALLOC(ptr, size) BufferPool::shared().reallocate(ptr, size)
+#define STBI_FREE(ptr) BufferPool::shared().release(ptr)
+#include "../thirdparty/stb/stb_image.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+static uint32_t readBigEndian32(const unsigned char* bytes) {
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+           (static_cast<uint32_t>(bytes[2]) << 8) | bytes[3];
+}
+
+static uint32_t readLittleEndian32(const unsigned char* bytes) {
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static uint64_t readLittleEndian64(const unsigned char* bytes) {
+    uint64_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+// Frames larger than this are rejected before anything is allocated for them
+static const uint64_t kMaxPixels = 400000000;
+
+static bool validSize(uint64_t width, uint64_t height) {
+    return width > 0 && height > 0 && width * height <= kMaxPixels;
+}
+
+// --- PNG (stb_image) ---
+
+// Release callback for pixel buffers allocated by stb_image
+static void releaseStbPixels(unsigned char* ptr, size_t, void*) {
+    stbi_image_free(ptr);
+}
+
+static bool matchesPng(const unsigned char* bytes, size_t size) {
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    return size >= sizeof(signature) && memcmp(bytes, signature, sizeof(signature)) == 0;
+}
+
+static bool infoPng(const unsigned char* header, size_t headerSize, uint64_t, const DecodeSettings& settings,
+                    FrameLayout& layout) {
+    // The signature and IHDR chunk come first; stb only needs those
+    int size = static_cast<int>(headerSize);
+    if (!stbi_info_from_memory(header, size, &layout.width, &layout.height, &layout.channels)) {
+        return false;
+    }
+    layout.compression = BlockFormat::None;
+    layout.sampleFormat = SampleFormat::UNorm8;
+    if (settings.highBitDepth && stbi_is_16_bit_from_memory(header, size)) {
+        layout.channels = 4;
+        layout.sampleFormat = SampleFormat::Float16;
+    }
+    return true;
+}
+
+// desiredChannels 4 has stb expand to RGBA while decoding. With highBitDepth,
+// 16-bit files become RGBA half floats.
+static bool decodePng(const PixelBuffer& file, const DecodeSettings& settings, ImageData& out, int& sourceChannels) {
+    // Rows are kept in file order (top row first): the fullscreen quad's
+    // texture coordinates account for GL's bottom-up convention, so no CPU
+    // flip pass is needed. The flag is per thread because
+    // stbi_set_flip_vertically_on_load is process-global.
+    stbi_set_flip_vertically_on_load_thread(false);
+
+    int width, height, channels;
+    unsigned char* data;
+    bool halfFloat = false;
+    int fileSize = static_cast<int>(file.size());
+    if (settings.highBitDepth && stbi_is_16_bit_from_memory(file.data(), fileSize)) {
+        // Always RGBA, the half-float layout the GPU can render to and bind
+        // as an image; the samples are converted in stb's buffer
+        stbi_us* samples = stbi_load_16_from_memory(file.data(), fileSize, &width, &height, &channels, 4);
+        if (samples) {
+            PixelConvert::unorm16ToHalf(samples, static_cast<size_t>(width) * height * 4, samples);
+            halfFloat = true;
+        }
+        data = reinterpret_cast<unsigned char*>(samples);
+    } else {
+        data = stbi_load_from_memory(file.data(), fileSize, &width, &height, &channels, settings.desiredChannels);
+    }
+    if (!data) {
+        return false;
+    }
+    sourceChannels = channels;
+
+    int storedChannels = halfFloat ? 4 : settings.desiredChannels > 0 ? settings.desiredChannels : channels;
+    size_t dataSize = static_cast<size_t>(width) * height * storedChannels * (halfFloat ? 2 : 1);
+    out = ImageData(width, height, storedChannels, PixelBuffer(data, dataSize, &releaseStbPixels), BlockFormat::None,
+                    halfFloat ? SampleFormat::Float16 : SampleFormat::UNorm8);
+    return true;
+}
+
+// --- QOI ---
+
+static const size_t kQoiHeaderSize = 14;
+static const size_t kQoiPaddingSize = 8;  // End marker: seven 0x00 bytes and a 0x01
+
+static bool matchesQoi(const unsigned char* bytes, size_t size) {
+    return size >= kQoiHeaderSize && memcmp(bytes, "qoif", 4) == 0;
+}
+
+static bool infoQoi(const unsigned char* header, size_t headerSize, uint64_t, const DecodeSettings&,
+                    FrameLayout& layout) {
+    if (headerSize < kQoiHeaderSize) {
+        return false;
+    }
+    uint32_t w = readBigEndian32(header + 4);
+    uint32_t h = readBigEndian32(header + 8);
+    int channels = header[12];
+    if (!validSize(w, h) || (channels != 3 && channels != 4)) {
+        return false;
+    }
+    layout = FrameLayout();
+    layout.width = static_cast<int>(w);
+    layout.height = static_cast<int>(h);
+    layout.channels = channels;
+    return true;
+}
+
+// Decode the chunk stream into Channels-byte pixels. Every chunk is at most
+// 5 bytes and the stream ends in the 8-byte padding, so reads that start
+// before the padding stay inside the file.
+template <int Channels>
+static void decodeQoiPixels(const unsigned char* chunks, size_t chunksSize, size_t pixelCount, unsigned char* out) {
+    unsigned char index[64][4] = {};
+    unsigned char px[4] = {0, 0, 0, 255};
+    size_t p = 0;
+    int run = 0;
+    for (size_t i = 0; i < pixelCount; ++i, out += Channels) {
+        if (run > 0) {
+            --run;
+        } else if (p < chunksSize) {
+            unsigned char b1 = chunks[p++];
+            if (b1 == 0xFE) {         // QOI_OP_RGB
+                px[0] = chunks[p];
+                px[1] = chunks[p + 1];
+                px[2] = chunks[p + 2];
+                p += 3;
+            } else if (b1 == 0xFF) {  // QOI_OP_RGBA
+                memcpy(px, chunks + p, 4);
+                p += 4;
+            } else if ((b1 & 0xC0) == 0x00) {  // QOI_OP_INDEX
+                memcpy(px, index[b1], 4);
+            } else if ((b1 & 0xC0) == 0x40) {  // QOI_OP_DIFF
+                px[0] = static_cast<unsigned char>(px[0] + ((b1 >> 4) & 3) - 2);
+                px[1] = static_cast<unsigned char>(px[1] + ((b1 >> 2) & 3) - 2);
+                px[2] = static_cast<unsigned char>(px[2] + (b1 & 3) - 2);
+            } else if ((b1 & 0xC0) == 0x80) {  // QOI_OP_LUMA
+                unsigned char b2 = chunks[p++];
+                int dg = (b1 & 0x3F) - 32;
+                px[0] = static_cast<unsigned char>(px[0] + dg - 8 + ((b2 >> 4) & 0x0F));
+                px[1] = static_cast<unsigned char>(px[1] + dg);
+                px[2] = static_cast<unsigned char>(px[2] + dg - 8 + (b2 & 0x0F));
+            } else {                           // QOI_OP_RUN
+                run = b1 & 0x3F;
+            }
+            memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+        }
+        memcpy(out, px, Channels);
+    }
+}
+
+static bool decodeQoi(const PixelBuffer& file, const DecodeSettings& settings, ImageData& out, int& sourceChannels) {
+    FrameLayout layout;
+    if (file.size() < kQoiHeaderSize + kQoiPaddingSize ||
+        !infoQoi(file.data(), file.size(), file.size(), settings, layout)) {
+        return false;
+    }
+    int width = layout.width;
+    int height = layout.height;
+    int channels = layout.channels;
+    sourceChannels = channels;
+
+    // Decoded straight into the stored layout, RGBA when expanding; other
+    // channel counts are left to the loader's conversion
+    int storedChannels = settings.desiredChannels == 3 || settings.desiredChannels == 4 ? settings.desiredChannels : channels;
+    size_t pixelCount = static_cast<size_t>(width) * height;
+    PixelBuffer pixels = PixelBuffer::allocate(pixelCount * storedChannels);
+    if (pixels.empty()) {
+        return false;
+    }
+    const unsigned char* chunks = file.data() + kQoiHeaderSize;
+    size_t chunksSize = file.size() - kQoiHeaderSize - kQoiPaddingSize;
+    if (storedChannels == 4) {
+        decodeQoiPixels<4>(chunks, chunksSize, pixelCount, pixels.data());
+    } else {
+        decodeQoiPixels<3>(chunks, chunksSize, pixelCount, pixels.data());
+    }
+    out = ImageData(width, height, storedChannels, std::move(pixels));
+    return true;
+}
+
+// --- KTX2 ---
+
+static const unsigned char kKtx2Identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+static const size_t kKtx2LevelIndexOffset = 80;  // Header (48 bytes) and the index of the data blocks (32 bytes)
+
+// The Vulkan formats the frames can be stored in; sRGB variants are taken as
+// the UNORM data the rest of the pipeline treats frames as
+struct Ktx2Format {
+    uint32_t vkFormat;
+    BlockFormat compression;
+    SampleFormat sampleFormat;
+    int channels;
+};
+
+static const Ktx2Format kKtx2Formats[] = {
+    { 23, BlockFormat::None, SampleFormat::UNorm8, 3 },    // VK_FORMAT_R8G8B8_UNORM
+    { 29, BlockFormat::None, SampleFormat::UNorm8, 3 },    // VK_FORMAT_R8G8B8_SRGB
+    { 37, BlockFormat::None, SampleFormat::UNorm8, 4 },    // VK_FORMAT_R8G8B8A8_UNORM
+    { 43, BlockFormat::None, SampleFormat::UNorm8, 4 },    // VK_FORMAT_R8G8B8A8_SRGB
+    { 97, BlockFormat::None, SampleFormat::Float16, 4 },   // VK_FORMAT_R16G16B16A16_SFLOAT
+    { 131, BlockFormat::BC1, SampleFormat::UNorm8, 3 },    // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+    { 132, BlockFormat::BC1, SampleFormat::UNorm8, 3 },    // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+    { 137, BlockFormat::BC3, SampleFormat::UNorm8, 4 },    // VK_FORMAT_BC3_UNORM_BLOCK
+    { 138, BlockFormat::BC3, SampleFormat::UNorm8, 4 },    // VK_FORMAT_BC3_SRGB_BLOCK
+};
+
+static bool matchesKtx2(const unsigned char* bytes, size_t size) {
+    return size >= sizeof(kKtx2Identifier) && memcmp(bytes, kKtx2Identifier, sizeof(kKtx2Identifier)) == 0;
+}
+
+static const Ktx2Format* findKtx2Format(uint32_t vkFormat) {
+    for (const Ktx2Format& format : kKtx2Formats) {
+        if (format.vkFormat == vkFormat) {
+            return &format;
+        }
+    }
+    return nullptr;
+}
+
+static bool infoKtx2(const unsigned char* header, size_t headerSize, uint64_t, const DecodeSettings&,
+                     FrameLayout& layout) {
+    if (headerSize < 28) {
+        return false;
+    }
+    uint32_t w = readLittleEndian32(header + 20);
+    uint32_t h = readLittleEndian32(header + 24);
+    const Ktx2Format* format = findKtx2Format(readLittleEndian32(header + 12));
+    if (!validSize(w, h) || !format) {
+        return false;
+    }
+    layout.width = static_cast<int>(w);
+    layout.height = static_cast<int>(h);
+    layout.channels = format->channels;
+    layout.compression = format->compression;
+    layout.sampleFormat = format->sampleFormat;
+    return true;
+}
+
+// Level 0 of a single 2D image, copied out as the frame's pixels or blocks
+static bool decodeKtx2(const PixelBuffer& file, const DecodeSettings& settings, ImageData& out, int& sourceChannels) {
+    const unsigned char* bytes = file.data();
+    if (file.size() < kKtx2LevelIndexOffset + 24) {
+        return false;
+    }
+    uint32_t vkFormat = readLittleEndian32(bytes + 12);
+    const Ktx2Format* format = findKtx2Format(vkFormat);
+    if (!format) {
+        std::cerr << "Unsupported KTX2 format (VkFormat " << vkFormat << ")" << std::endl;
+        return false;
+    }
+    FrameLayout layout;
+    if (!infoKtx2(bytes, file.size(), file.size(), settings, layout)) {
+        return false;
+    }
+    int width = layout.width;
+    int height = layout.height;
+    uint32_t depth = readLittleEndian32(bytes + 28);
+    uint32_t layers = readLittleEndian32(bytes + 32);
+    uint32_t faces = readLittleEndian32(bytes + 36);
+    uint32_t supercompression = readLittleEndian32(bytes + 44);
+    if (depth > 1 || layers > 1 || faces != 1 || supercompression != 0) {
+        std::cerr << "KTX2 frames must be a single 2D image (no array layers, cube faces or supercompression)" << std::endl;
+        return false;
+    }
+    // Partial blocks cannot be uploaded as a sub-image on every GPU, and half
+    // floats are only handled in high bit depth mode (see ImageLoadOptions)
+    if ((format->compression != BlockFormat::None && (width % 4 != 0 || height % 4 != 0)) ||
+        (format->sampleFormat == SampleFormat::Float16 && !settings.highBitDepth)) {
+        std::cerr << "KTX2 format (VkFormat " << vkFormat << ") not usable for a " << width << "x" << height
+                  << " frame in this mode" << std::endl;
+        return false;
+    }
+
+    size_t expected = format->compression != BlockFormat::None
+                          ? BlockCompressor::compressedSize(format->compression, width, height)
+                          : static_cast<size_t>(width) * height * format->channels *
+                                (format->sampleFormat == SampleFormat::Float16 ? 2 : 1);
+    uint64_t offset = readLittleEndian64(bytes + kKtx2LevelIndexOffset);
+    uint64_t length = readLittleEndian64(bytes + kKtx2LevelIndexOffset + 8);
+    if (length != expected || offset > file.size() || file.size() - offset < length) {
+        return false;
+    }
+    sourceChannels = format->channels;
+
+    const unsigned char* level = bytes + offset;
+    if (format->compression == BlockFormat::None && format->sampleFormat == SampleFormat::UNorm8 &&
+        settings.desiredChannels == 4 && format->channels != 4) {
+        size_t pixelCount = static_cast<size_t>(width) * height;
+        PixelBuffer pixels = PixelBuffer::allocate(pixelCount * 4);
+        if (pixels.empty()) {
+            return false;
+        }
+        PixelConvert::expandToRGBA(level, format->channels, pixelCount, pixels.data());
+        out = ImageData(width, height, 4, std::move(pixels));
+        return true;
+    }
+    PixelBuffer payload = PixelBuffer::allocate(expected);
+    if (payload.empty()) {
+        return false;
+    }
+    memcpy(payload.data(), level, expected);
+    out = ImageData(width, height, format->channels, std::move(payload), format->compression, format->sampleFormat);
+    return true;
+}
+
+// --- Headerless RGBA8 ---
+
+static bool infoRaw(const unsigned char*, size_t, uint64_t fileSize, const DecodeSettings& settings,
+                    FrameLayout& layout) {
+    if (!validSize(static_cast<uint64_t>(std::max(settings.rawWidth, 0)), static_cast<uint64_t>(std::max(settings.rawHeight, 0))) ||
+        fileSize != static_cast<uint64_t>(settings.rawWidth) * settings.rawHeight * 4) {
+        return false;
+    }
+    layout = FrameLayout();
+    layout.width = settings.rawWidth;
+    layout.height = settings.rawHeight;
+    layout.channels = 4;
+    return true;
+}
+
+static bool decodeRaw(const PixelBuffer& file, const DecodeSettings& settings, ImageData& out, int& sourceChannels) {
+    FrameLayout layout;
+    if (!infoRaw(nullptr, 0, file.size(), settings, layout)) {
+        std::cerr << "Raw frame of " << file.size() << " bytes does not match the raw frame size "
+                  << settings.rawWidth << "x" << settings.rawHeight << " (RGBA8)" << std::endl;
+        return false;
+    }
+    sourceChannels = 4;
+    PixelBuffer pixels = PixelBuffer::allocate(file.size());
+    if (pixels.empty()) {
+        return false;
+    }
+    memcpy(pixels.data(), file.data(), file.size());
+    out = ImageData(layout.width, layout.height, 4, std::move(pixels));
+    return true;
+}
+
+// --- Headerless 4:2:0 YUV (NV12, I420) ---
+
+// Both layouts hold a full-size Y plane and two quarter-size chroma planes,
+// so only the extension tells them apart. Sizes must be even, so every 2x2
+// block of luma has its own chroma sample.
+template <PlaneFormat Planes>
+static bool infoYuv(const unsigned char*, size_t, uint64_t fileSize, const DecodeSettings& settings,
+                    FrameLayout& layout) {
+    if (!validSize(static_cast<uint64_t>(std::max(settings.rawWidth, 0)), static_cast<uint64_t>(std::max(settings.rawHeight, 0))) ||
+        settings.rawWidth % 2 != 0 || settings.rawHeight % 2 != 0 ||
+        fileSize != PixelConvert::yuvSize(settings.rawWidth, settings.rawHeight)) {
+        return false;
+    }
+    layout = FrameLayout();
+    layout.width = settings.rawWidth;
+    layout.height = settings.rawHeight;
+    layout.channels = 3;
+    layout.planes = Planes;
+    return true;
+}
+
+// The planes are kept as they are (desiredChannels does not apply): they are
+// converted to RGB where they are drawn
+template <PlaneFormat Planes>
+static bool decodeYuv(const PixelBuffer& file, const DecodeSettings& settings, ImageData& out, int& sourceChannels) {
+    FrameLayout layout;
+    if (!infoYuv<Planes>(nullptr, 0, file.size(), settings, layout)) {
+        std::cerr << "YUV frame of " << file.size() << " bytes does not match the raw frame size "
+                  << settings.rawWidth << "x" << settings.rawHeight << " (" << (Planes == PlaneFormat::NV12 ? "NV12" : "I420")
+                  << ", even sizes only)" << std::endl;
+        return false;
+    }
+    sourceChannels = 3;
+    PixelBuffer pixels = PixelBuffer::allocate(file.size());
+    if (pixels.empty()) {
+        return false;
+    }
+    memcpy(pixels.data(), file.data(), file.size());
+    out = ImageData(layout.width, layout.height, 3, std::move(pixels), BlockFormat::None, SampleFormat::UNorm8, Planes);
+    return true;
+}
+
+// --- Registry ---
+
+static std::mutex registryMutex;
+
+static std::vector<ImageDecoder>& registry() {
+    static std::vector<ImageDecoder> decoders = {
+        { "png", ".png", &matchesPng, &infoPng, &decodePng, true },
+        { "qoi", ".qoi", &matchesQoi, &infoQoi, &decodeQoi, true },
+        { "ktx2", ".ktx2", &matchesKtx2, &infoKtx2, &decodeKtx2, false },
+        { "raw", ".rgba .raw", nullptr, &infoRaw, &decodeRaw, false },
+        { "nv12", ".nv12", nullptr, &infoYuv<PlaneFormat::NV12>, &decodeYuv<PlaneFormat::NV12>, false },
+        { "i420", ".i420 .yuv", nullptr, &infoYuv<PlaneFormat::I420>, &decodeYuv<PlaneFormat::I420>, false },
+    };
+    return decoders;
+}
+
+static bool hasExtension(const ImageDecoder& decoder, const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    if (extension.empty()) {
+        return false;
+    }
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    // Whole words of the space-separated list only
+    std::string list = std::string(" ") + decoder.extensions + " ";
+    return list.find(" " + extension + " ") != std::string::npos;
+}
+
+void ImageDecoders::add(const ImageDecoder& decoder) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry().push_back(decoder);
+}
+
+const ImageDecoder* ImageDecoders::find(const unsigned char* bytes, size_t size, const std::filesystem::path& path) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const ImageDecoder& decoder : registry()) {
+        if (decoder.matches && decoder.matches(bytes, size)) {
+            return &decoder;
+        }
+    }
+    for (const ImageDecoder& decoder : registry()) {
+        if (!decoder.matches && hasExtension(decoder, path)) {
+            return &decoder;
+        }
+    }
+    return nullptr;
+}
+
+bool ImageDecoders::handlesExtension(const std::filesystem::path& path) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const ImageDecoder& decoder : registry()) {
+        if (hasExtension(decoder, path)) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include "ImageLoader.h"
+
+// One image file format the loader can read
+struct ImageDecoder {
+    const char* name;
+    // Lower-case extensions the directory scan picks up, space-separated (e.g. ".rgba .raw")
+    const char* extensions;
+    // Whether the file starts with the format's signature; null for formats without one
+    bool (*matches)(const unsigned char* bytes, size_t size);
+    // Layout of the frame as the decoder produces it without desiredChannels
+    // (size, the file's own channels, block and sample format), from the first
+    // ImageDecoders::kHeaderBytes of the file (or the whole file, if shorter)
+    // and the file's size, without decoding it
+    bool (*info)(const unsigned char* header, size_t headerSize, uint64_t fileSize, const DecodeSettings& settings,
+                 FrameLayout& layout);
+    // Decode a whole file; sourceChannels receives the file's own channel count
+    bool (*decode)(const PixelBuffer& file, const DecodeSettings& settings, ImageData& out, int& sourceChannels);
+    // Whether frames are worth keeping in the frame cache: false for formats
+    // that load as cheaply as a cache entry would
+    bool cacheable;
+};
+
+// Registry of the formats image sequences can be stored in, so a sequence can
+// be kept in whichever format its workload decodes fastest:
+//   png   PNG through stb_image (zlib inflate dominates the load)
+//   qoi   QOI, a byte-oriented lossless format decoding several times faster
+//   ktx2  KTX2 holding BC1/BC3 blocks or 8-bit/half-float pixels, level 0,
+//         taken as they are stored (no supercompression)
+//   raw   Headerless top-down RGBA8 (shaderDemoExport --format raw), sized by
+//         DecodeSettings::rawWidth/rawHeight
+//   nv12  Headerless 4:2:0 YUV (.nv12 NV12, .i420/.yuv I420), e.g. straight
+//   i420  from a camera, sized like raw frames; kept as planes (see PlaneFormat)
+// A file goes to the decoder whose signature its first bytes carry, whatever its
+// extension; formats without a signature are only chosen by extension.
+class ImageDecoders {
+public:
+    // Bytes of a file needed to identify it and read its size
+    static const size_t kHeaderBytes = 64;
+
+    // Register another format (before loading starts). Signatures of added
+    // decoders are checked after those of the built-in ones.
+    static void add(const ImageDecoder& decoder);
+
+    // Decoder for a file from its first bytes, or by extension for formats
+    // without a signature; null if no registered format takes it
+    static const ImageDecoder* find(const unsigned char* bytes, size_t size, const std::filesystem::path& path);
+
+    // Whether the directory scan should pick up the file
+    static bool handlesExtension(const std::filesystem::path& path);
+};
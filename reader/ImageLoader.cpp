@@ -1,16 +1,504 @@
 #include "ImageLoader.h"
-
-// Define STB_IMAGE_IMPLEMENTATION before including stb_image.h to create the implementation
-#define STB_IMAGE_IMPLEMENTATION
-#include "../thirdparty/stb/stb_image.h"
+#include "AsyncFileReader.h"
+#include "BlockCompressor.h"
+#include "BufferPool.h"
+#include "DirtyTiles.h"
+#include "FrameCache.h"
+#include "FrameCodec.h"
+#include "ImageDecoders.h"
+#include "PixelConvert.h"
+#include "SequenceFile.h"
+#include "../render/Trace.h"
 
 #include <filesystem>
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cwctype>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
 
 namespace fs = std::filesystem;
 
-ImageLoader::ImageLoader() {
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Read a whole file into a pooled buffer
+static bool readWholeFile(const fs::path& path, PixelBuffer& out) {
+    TRACE_ZONE("Read file");
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    std::streamsize size = file.tellg();
+    if (size <= 0) {
+        return false;
+    }
+    file.seekg(0);
+    out = PixelBuffer::allocate(static_cast<size_t>(size));
+    return !out.empty() && static_cast<bool>(file.read(reinterpret_cast<char*>(out.data()), size));
+}
+
+// Layout of a file's frame from its header, see ImageDecoder::info
+static bool probeFrame(const fs::path& path, const DecodeSettings& settings, FrameLayout& layout) {
+    unsigned char header[ImageDecoders::kHeaderBytes];
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    size_t headerSize = static_cast<size_t>(file.gcount());
+    std::error_code ec;
+    uint64_t fileSize = static_cast<uint64_t>(fs::file_size(path, ec));
+    const ImageDecoder* decoder = ImageDecoders::find(header, headerSize, path);
+    return !ec && decoder && decoder->info(header, headerSize, fileSize, settings, layout);
+}
+
+// Bytes a frame of the layout takes once decoded, before proxy reduction and block compression
+static size_t decodedBytes(const FrameLayout& layout, const DecodeSettings& settings) {
+    size_t pixelCount = static_cast<size_t>(layout.width) * layout.height;
+    if (layout.compression != BlockFormat::None) {
+        return BlockCompressor::compressedSize(layout.compression, layout.width, layout.height);
+    }
+    if (layout.planes != PlaneFormat::Interleaved) {
+        return PixelConvert::yuvSize(layout.width, layout.height);
+    }
+    if (layout.sampleFormat == SampleFormat::Float16) {
+        return pixelCount * layout.channels * 2;
+    }
+    return pixelCount * (settings.desiredChannels > 0 ? settings.desiredChannels : layout.channels);
+}
+
+// Convert a decoded frame to the sequence's uniform layout: block-compressed
+// and YUV outliers are expanded, then sizes are resampled and channels and
+// sample formats converted. Nothing is block-compressed or turned into YUV to
+// match; such targets are only chosen when every file already has them.
+static bool conformFrame(ImageData& frame, const FrameLayout& target, const fs::path& path) {
+    ImageData converted;
+    bool ok = true;
+    if (frame.planes != target.planes || frame.compression != target.compression) {
+        ok = frame.isPlanar() ? PixelConvert::yuvToRGBA(frame, converted)
+                              : frame.compression != BlockFormat::None && BlockCompressor::decompress(frame, converted);
+        if (ok) {
+            frame = std::move(converted);
+        }
+    }
+    if (ok && (frame.isPlanar() || frame.compression != BlockFormat::None)) {
+        // Served as stored, so only the size has to match
+        ok = frame.width == target.width && frame.height == target.height;
+    } else if (ok) {
+        if (frame.width != target.width || frame.height != target.height) {
+            ok = frame.sampleFormat == SampleFormat::UNorm8 &&
+                 PixelConvert::resize(frame, target.width, target.height, converted);
+            if (ok) {
+                frame = std::move(converted);
+            }
+        }
+        if (ok && frame.sampleFormat != target.sampleFormat) {
+            ok = target.sampleFormat == SampleFormat::Float16 && PixelConvert::toHalfRGBA(frame, converted);
+            if (ok) {
+                frame = std::move(converted);
+            }
+        } else if (ok && frame.channels != target.channels) {
+            ok = PixelConvert::convertChannels(frame, target.channels, converted);
+            if (ok) {
+                frame = std::move(converted);
+            }
+        }
+    }
+    if (!ok) {
+        std::cerr << "Cannot convert " << path.string() << " (" << frame.width << "x" << frame.height << ", "
+                  << frame.channels << " channels) to the sequence format" << std::endl;
+    }
+    return ok;
+}
+
+// Decode one file with the decoder its first bytes (or its extension) call
+// for, see ImageDecoders. sourceChannels receives the file's own channel
+// count and cacheable whether the frame is worth keeping in the frame cache.
+// contents, if given, holds the file's bytes, already read.
+static bool decodeImageFile(const fs::path& path, const DecodeSettings& settings, ImageData& out,
+                            int* sourceChannels = nullptr, bool* cacheable = nullptr, FileLoadTiming* timing = nullptr,
+                            const PixelBuffer* contents = nullptr) {
+    // Read the file in one go and decode from memory, so that I/O and decode
+    // time can be told apart
+    auto start = std::chrono::steady_clock::now();
+    PixelBuffer read;
+    if (!contents) {
+        if (!readWholeFile(path, read)) {
+            return false;
+        }
+        if (timing) {
+            timing->readMs += millisecondsSince(start);
+            timing->fileBytes += read.size();
+            start = std::chrono::steady_clock::now();
+        }
+    }
+    const PixelBuffer& file = contents ? *contents : read;
+    if (file.empty()) {
+        return false;
+    }
+    const ImageDecoder* decoder = ImageDecoders::find(file.data(), file.size(), path);
+    if (!decoder) {
+        std::cerr << "Unrecognized image format: " << path.string() << std::endl;
+        return false;
+    }
+    
+    int channels = 0;
+    bool ok;
+    {
+        TRACE_ZONE("Decode image");
+        ok = decoder->decode(file, settings, out, channels);
+    }
+    if (timing) {
+        timing->decodeMs += millisecondsSince(start);
+    }
+    if (!ok) {
+        return false;
+    }
+    if (settings.uniform.width > 0 && FrameLayout{ out.width, out.height, out.channels, out.compression, out.sampleFormat, out.planes } != settings.uniform) {
+        start = std::chrono::steady_clock::now();
+        ok = conformFrame(out, settings.uniform, path);
+        if (timing) {
+            timing->convertMs += millisecondsSince(start);
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    if (sourceChannels) {
+        *sourceChannels = channels;
+    }
+    if (cacheable) {
+        *cacheable = decoder->cacheable;
+    }
+    return true;
+}
+
+FrameSortKey FrameSortKey::parse(const std::string& name) {
+    FrameSortKey key;
+    key.number = 0;
+    key.name = name;
+    
+    size_t end = name.find_last_of("0123456789");
+    if (end == std::string::npos) {
+        key.prefix = name;
+        return key;
+    }
+    size_t begin = name.find_last_not_of("0123456789", end);
+    begin = (begin == std::string::npos) ? 0 : begin + 1;
+    
+    key.prefix = name.substr(0, begin);
+    key.suffix = name.substr(end + 1);
+    for (size_t i = begin; i <= end; ++i) {
+        // Saturate rather than wrap on absurdly long digit runs
+        unsigned long long digit = static_cast<unsigned long long>(name[i] - '0');
+        if (key.number > (~0ULL - digit) / 10) {
+            key.number = ~0ULL;
+            break;
+        }
+        key.number = key.number * 10 + digit;
+    }
+    return key;
+}
+
+FileLoadTiming LoadProfile::total() const {
+    FileLoadTiming sum;
+    for (const FileLoadTiming& file : files) {
+        sum.readMs += file.readMs;
+        sum.decodeMs += file.decodeMs;
+        sum.convertMs += file.convertMs;
+        sum.insertMs += file.insertMs;
+        sum.fileBytes += file.fileBytes;
+        sum.pixelBytes += file.pixelBytes;
+    }
+    return sum;
+}
+
+double LoadProfile::imagesPerSecond() const {
+    return wallMs > 0.0 ? files.size() / (wallMs / 1000.0) : 0.0;
+}
+
+double LoadProfile::megabytesPerSecond() const {
+    return wallMs > 0.0 ? total().fileBytes / (1024.0 * 1024.0) / (wallMs / 1000.0) : 0.0;
+}
+
+void LoadProfile::print(std::ostream& out, bool perFile) const {
+    FileLoadTiming sum = total();
+    out << std::fixed << std::setprecision(2);
+    if (perFile) {
+        for (size_t i = 0; i < files.size(); ++i) {
+            const FileLoadTiming& file = files[i];
+            out << "  " << names[i] << ": read " << file.readMs << " ms, decode " << file.decodeMs
+                << " ms, convert " << file.convertMs << " ms, insert " << file.insertMs << " ms, "
+                << file.fileBytes / 1024 << " KB -> " << file.pixelBytes / 1024 << " KB" << std::endl;
+        }
+    }
+    
+    double work = sum.readMs + sum.decodeMs + sum.convertMs + sum.insertMs;
+    double percent = work > 0.0 ? 100.0 / work : 0.0;
+    out << "Load profile: " << files.size() << " files, " << sum.fileBytes / (1024.0 * 1024.0) << " MB read on "
+        << threadCount << " thread(s) in " << wallMs << " ms: " << imagesPerSecond() << " images/s, "
+        << megabytesPerSecond() << " MB/s" << std::endl;
+    out << "  read " << sum.readMs << " ms (" << sum.readMs * percent << "%), decode " << sum.decodeMs << " ms ("
+        << sum.decodeMs * percent << "%), convert " << sum.convertMs << " ms (" << sum.convertMs * percent
+        << "%), insert " << sum.insertMs << " ms (" << sum.insertMs * percent << "%), sort " << sortMs << " ms"
+        << std::endl;
+    out << "  " << (sum.readMs > sum.decodeMs + sum.convertMs ? "I/O-bound" : "decode-bound")
+        << " (thread-summed times)" << std::endl;
+    out << std::defaultfloat;
+}
+
+size_t LoaderMemoryUsage::getAverageFrameBytes() const {
+    if (cacheFrames > 0) {
+        return cacheBytes / cacheFrames;
+    }
+    return frameCount > 0 ? frameBytes / frameCount : 0;
+}
+
+void LoaderMemoryUsage::print(std::ostream& out) const {
+    const double MB = 1024.0 * 1024.0;
+    out << std::fixed << std::setprecision(1);
+    out << "CPU memory: " << getHeldBytes() / MB << " MB held for " << frameCount << " frames, "
+        << getAverageFrameBytes() / MB << " MB per frame (largest " << largestFrameBytes / MB << " MB)";
+    if (memoryLimit > 0) {
+        out << ", limit " << memoryLimit / MB << " MB";
+    }
+    if (refusedFrames > 0) {
+        out << ", " << refusedFrames << " frames refused";
+    }
+    out << std::endl;
+    out << "  frames " << frameBytes / MB << " MB (" << mappedBytes / MB << " MB mapped), packed "
+        << packedBytes / MB << " MB, cache " << cacheBytes / MB << " MB in " << cacheFrames << " frames (budget "
+        << cacheBudget / MB << " MB, " << schedulerBytes / MB << " MB in the scheduler), buffer pool "
+        << pooledBytes / MB << " MB" << std::endl;
+    out << std::defaultfloat;
+}
+
+// Header of a frame cache file, followed by payloadSize bytes of BC1/BC3
+// blocks or, for BlockFormat::None, of tightly packed pixels. 64 bytes, so the
+// payload of a mapped entry keeps the alignment of the page it starts on.
+struct CachedFrameHeader {
+    char magic[4];         // "SDBC"
+    uint32_t version;
+    uint32_t format;       // BlockFormat
+    int32_t width;
+    int32_t height;
+    int32_t channels;
+    uint64_t sourceSize;   // Size and modification time of the PNG the frame was made from
+    int64_t sourceTime;
+    uint64_t sourceHash;   // Hash of the PNG's absolute path
+    uint64_t payloadSize;
+    uint32_t sampleFormat; // SampleFormat of uncompressed frames
+    uint32_t reserved;
+};
+static_assert(sizeof(CachedFrameHeader) == 64, "cache entries start with a 64-byte header");
+
+static const char kCachedFrameMagic[4] = {'S', 'D', 'B', 'C'};
+static const uint32_t kCachedFrameVersion = 3; // 2: rows stored top-down; 3: uncompressed frames, path hash
+
+// Identifies the source file, so that stale cache entries are rebuilt when the
+// PNG changes and files of the same name in other directories never share one
+struct SourceStamp {
+    uint64_t size = 0;
+    int64_t time = 0;
+    uint64_t pathHash = 0;
+};
+
+static bool sourceStamp(const fs::path& path, SourceStamp& stamp) {
+    std::error_code ec;
+    stamp.size = static_cast<uint64_t>(fs::file_size(path, ec));
+    if (ec) {
+        return false;
+    }
+    stamp.time = static_cast<int64_t>(fs::last_write_time(path, ec).time_since_epoch().count());
+    if (ec) {
+        return false;
+    }
+    // FNV-1a of the lower-cased absolute path (Windows paths are case-insensitive)
+    fs::path absolute = fs::absolute(path, ec);
+    stamp.pathHash = 14695981039346656037ull;
+    for (wchar_t c : (ec ? path : absolute).wstring()) {
+        stamp.pathHash = (stamp.pathHash ^ static_cast<uint64_t>(towlower(c))) * 1099511628211ull;
+    }
+    return true;
+}
+
+// Whether a header belongs to a current cache entry of the source file
+static bool validCachedHeader(const CachedFrameHeader& header, const SourceStamp& stamp) {
+    if (memcmp(header.magic, kCachedFrameMagic, sizeof(header.magic)) != 0 ||
+        header.version != kCachedFrameVersion ||
+        header.sourceSize != stamp.size || header.sourceTime != stamp.time || header.sourceHash != stamp.pathHash ||
+        header.width <= 0 || header.height <= 0 || header.channels <= 0 || header.channels > 4) {
+        return false;
+    }
+    BlockFormat format = static_cast<BlockFormat>(header.format);
+    if (format == BlockFormat::None) {
+        SampleFormat samples = static_cast<SampleFormat>(header.sampleFormat);
+        if (samples != SampleFormat::UNorm8 && samples != SampleFormat::Float16) {
+            return false;
+        }
+        uint64_t sampleBytes = samples == SampleFormat::Float16 ? 2 : 1;
+        return header.payloadSize == static_cast<uint64_t>(header.width) * header.height * header.channels * sampleBytes;
+    }
+    return (format == BlockFormat::BC1 || format == BlockFormat::BC3) &&
+           header.payloadSize == BlockCompressor::compressedSize(format, header.width, header.height);
+}
+
+static ImageData cachedFrame(const CachedFrameHeader& header, PixelBuffer&& payload) {
+    return ImageData(header.width, header.height, header.channels, std::move(payload),
+                     static_cast<BlockFormat>(header.format), static_cast<SampleFormat>(header.sampleFormat));
+}
+
+// Whether bytes read for a frame are a cache entry rather than a PNG
+static bool isCachedFrame(const PixelBuffer& bytes) {
+    return bytes.size() >= sizeof(CachedFrameHeader) &&
+           memcmp(bytes.data(), kCachedFrameMagic, sizeof(kCachedFrameMagic)) == 0;
+}
+
+// A cache entry read into memory
+static bool parseCachedFrame(const PixelBuffer& bytes, const SourceStamp& stamp, ImageData& out) {
+    CachedFrameHeader header;
+    memcpy(&header, bytes.data(), sizeof(header));
+    if (!validCachedHeader(header, stamp) || bytes.size() - sizeof(header) < header.payloadSize) {
+        return false;
+    }
+    PixelBuffer payload = PixelBuffer::allocate(static_cast<size_t>(header.payloadSize));
+    if (payload.empty()) {
+        return false;
+    }
+    memcpy(payload.data(), bytes.data() + sizeof(header), static_cast<size_t>(header.payloadSize));
+    out = cachedFrame(header, std::move(payload));
+    return true;
+}
+
+// Release callback of mapped cache entries; the context is the view
+static void releaseMappedFrame(unsigned char*, size_t, void* view) {
+    UnmapViewOfFile(view);
+}
+
+// Map a cache entry: the frame's pixels are the payload in the file mapping,
+// paged in from the file (or the system cache) as the upload reads them, and
+// unmapped when the frame is released
+static bool mapCachedFrame(const fs::path& cachePath, const SourceStamp& stamp, ImageData& out) {
+    // Delete sharing lets the cache be trimmed while frames are still mapped
+    HANDLE file = CreateFileW(cachePath.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart >= static_cast<LONGLONG>(sizeof(CachedFrameHeader))) {
+        mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    // The view keeps the mapping and the file open
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    if (!view) {
+        return false;
+    }
+
+    CachedFrameHeader header;
+    memcpy(&header, view, sizeof(header));
+    if (!validCachedHeader(header, stamp) ||
+        static_cast<uint64_t>(fileSize.QuadPart) - sizeof(header) < header.payloadSize) {
+        UnmapViewOfFile(view);
+        return false;
+    }
+    unsigned char* payload = static_cast<unsigned char*>(view) + sizeof(header);
+    out = cachedFrame(header, PixelBuffer(payload, static_cast<size_t>(header.payloadSize), &releaseMappedFrame, view));
+    return true;
+}
+
+static void writeCachedFrame(const fs::path& cachePath, const SourceStamp& stamp, const ImageData& image) {
+    CachedFrameHeader header = {};
+    memcpy(header.magic, kCachedFrameMagic, sizeof(header.magic));
+    header.version = kCachedFrameVersion;
+    header.format = static_cast<uint32_t>(image.compression);
+    header.width = image.width;
+    header.height = image.height;
+    header.channels = image.channels;
+    header.sourceSize = stamp.size;
+    header.sourceTime = stamp.time;
+    header.sourceHash = stamp.pathHash;
+    header.payloadSize = image.data.size();
+    header.sampleFormat = static_cast<uint32_t>(image.sampleFormat);
+
+    // Write to a temporary name first so an interrupted run never leaves a truncated entry
+    fs::path tempPath = cachePath;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file ||
+            !file.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+            !file.write(reinterpret_cast<const char*>(image.data.data()), static_cast<std::streamsize>(image.data.size()))) {
+            std::cerr << "Failed to write cached frame: " << cachePath.string() << std::endl;
+            return;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tempPath, cachePath, ec);
+    if (ec) {
+        fs::remove(tempPath, ec);
+    }
+}
+
+// Delete the least recently used entries until the cache directory holds at
+// most limit bytes. Entries are aged by modification time, which hits refresh.
+static void trimFrameCache(const fs::path& cacheDir, uint64_t limit) {
+    struct Entry {
+        fs::file_time_type time;
+        uint64_t size;
+        fs::path path;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    std::error_code ec;
+    for (fs::directory_iterator it(cacheDir, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code entryError;
+        if (!it->is_regular_file(entryError)) {
+            continue;
+        }
+        Entry entry = { it->last_write_time(entryError), static_cast<uint64_t>(it->file_size(entryError)), it->path() };
+        if (!entryError) {
+            total += entry.size;
+            entries.push_back(std::move(entry));
+        }
+    }
+    if (total <= limit) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+    size_t removed = 0;
+    uint64_t removedBytes = 0;
+    for (const Entry& entry : entries) {
+        if (total <= limit) {
+            break;
+        }
+        if (fs::remove(entry.path, ec)) {
+            total -= entry.size;
+            removedBytes += entry.size;
+            ++removed;
+        }
+    }
+    std::cout << "Frame cache: evicted " << removed << " entries (" << removedBytes / (1024 * 1024)
+              << " MB) to stay within " << limit / (1024 * 1024) << " MB" << std::endl;
+}
+
+ImageLoader::ImageLoader() : sequenceChannels(0), proxyWidth(0), proxyHeight(0), memoryLimit(0), refusedFrames(0),
+                             decodeTimeCallback(nullptr), decodeTimeContext(nullptr),
+                             blockCompression(false), cacheDecodedFrames(false) {
 }
 
 ImageLoader::~ImageLoader() {
@@ -19,18 +507,40 @@ ImageLoader::~ImageLoader() {
 }
 
 void ImageLoader::clearImages() {
-    images.clear();
+    // Stop the prefetch workers before dropping the file list they read from
+    frameCache.reset();
+    streamPaths.clear();
+    packedFrames.clear();
+    frames.clear();
+    frameNames.clear();
+    frameIndex.clear();
+    dirtyTiles.clear();
+    // Frames may be views into the mapping, so unmap only after dropping them
+    sequenceFile.reset();
 }
 
 bool ImageLoader::loadImagesFromDirectory(const std::string& directory, const ImageLoadOptions& options) {
+    if (isStreaming() || sequenceFile) {
+        // A streamed or mapped sequence cannot be mixed with another load
+        clearImages();
+    }
+    
     if (!fs::exists(directory) || !fs::is_directory(directory)) {
         std::cerr << "Error: Directory '" << directory << "' does not exist or is not a directory." << std::endl;
         return false;
     }
     
+    if (options.largePages && !BufferPool::shared().usesLargePages()) {
+        if (BufferPool::shared().enableLargePages()) {
+            std::cout << "Decoding into large-page buffers" << std::endl;
+        } else {
+            std::cerr << "Warning: Large pages unavailable (needs the 'Lock pages in memory' privilege), using normal pages" << std::endl;
+        }
+    }
+    
     size_t loadedCount = 0;
     
-    // Collect all PNG files first
+    // Collect all image files first (any format ImageDecoders handles)
     std::vector<fs::path> pngFiles;
     
     for (const auto& entry : fs::directory_iterator(directory)) {
@@ -38,79 +548,1014 @@ bool ImageLoader::loadImagesFromDirectory(const std::string& directory, const Im
             continue;
         }
         
+        // Extensions are compared case-insensitively
         const fs::path& path = entry.path();
-        std::string extension = path.extension().string();
-        
-        // Convert extension to lowercase for case-insensitive comparison
-        std::transform(extension.begin(), extension.end(), extension.begin(), 
-                      [](unsigned char c) { return std::tolower(c); });
-        
-        // Collect PNG files
-        if (extension == ".png") {
+        if (ImageDecoders::handlesExtension(path)) {
             pngFiles.push_back(path);
         }
     }
     
-    // Apply max images limit if specified
-    if (options.maxImages > 0 && pngFiles.size() > static_cast<size_t>(options.maxImages)) {
-        pngFiles.resize(options.maxImages);
+    // Order the sequence before choosing the range: directory_iterator order is
+    // unspecified, so truncating first would load an arbitrary subset
+    std::vector<std::pair<FrameSortKey, fs::path>> sorted;
+    sorted.reserve(pngFiles.size());
+    for (auto& path : pngFiles) {
+        sorted.emplace_back(FrameSortKey::parse(extractBaseName(path)), std::move(path));
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    
+    // Apply the start frame and max images limit
+    size_t first = std::min(static_cast<size_t>(std::max(options.startFrame, 0)), sorted.size());
+    size_t last = sorted.size();
+    if (options.maxImages > 0) {
+        last = std::min(last, first + static_cast<size_t>(options.maxImages));
+    }
+    pngFiles.clear();
+    for (size_t i = first; i < last; ++i) {
+        pngFiles.push_back(std::move(sorted[i].second));
+    }
+    
+    decodeSettings.desiredChannels = options.expandToRGBA ? 4 : 0;
+    decodeSettings.highBitDepth = options.highBitDepth;
+    decodeSettings.rawWidth = options.rawWidth;
+    decodeSettings.rawHeight = options.rawHeight;
+    decodeSettings.uniform = FrameLayout();
+    sequenceLayout = FrameLayout();
+    proxyWidth = std::max(options.proxyWidth, 0);
+    proxyHeight = std::max(options.proxyHeight, 0);
+    frameCacheDir.clear();
+    blockCompression = options.blockCompression;
+    cacheDecodedFrames = options.cacheDecodedFrames;
+    if (options.blockCompression || options.cacheDecodedFrames) {
+        fs::path cacheDir = options.cacheDirectory.empty() ? fs::path(directory) / ".bccache"
+                                                           : fs::path(options.cacheDirectory);
+        std::error_code ec;
+        fs::create_directories(cacheDir, ec);
+        if (ec) {
+            std::cerr << "Cannot create frame cache directory " << cacheDir.string()
+                      << ", decoding every frame" << std::endl;
+        } else {
+            frameCacheDir = cacheDir;
+            if (options.cacheDirectoryLimit > 0) {
+                trimFrameCache(frameCacheDir, options.cacheDirectoryLimit);
+            }
+        }
+    }
+    
+    memoryLimit = options.memoryLimitBytes;
+    refusedFrames = 0;
+    
+    if (options.uniformFrames && !validateSequence(pngFiles, options)) {
+        std::cerr << "No readable images in " << directory << std::endl;
+        return false;
     }
     
-    // Load the PNG files
-    for (const auto& path : pngFiles) {
-        std::string filePath = path.string();
+    if (options.streaming) {
+        return startStreaming(pngFiles, options);
+    }
+    
+    // Decoded result for each file, filled in by whichever worker picks it up
+    std::vector<ImageData> decoded(pngFiles.size());
+    
+    // Stage times per file in profiling mode, written by the worker that loads the file
+    auto loadStart = std::chrono::steady_clock::now();
+    std::vector<FileLoadTiming> timings(options.profile ? pngFiles.size() : 0);
+    
+    // With overlapped I/O the reads run ahead of the decoders; a file's read
+    // time is then how long its decoder waited for it
+    std::unique_ptr<AsyncFileReader> reader;
+    if (options.ioQueueDepth > 0) {
+        std::vector<fs::path> readPaths;
+        readPaths.reserve(pngFiles.size());
+        for (const fs::path& path : pngFiles) {
+            readPaths.push_back(readPath(path));
+        }
+        reader.reset(new AsyncFileReader(options.ioQueueDepth, options.unbufferedIO));
+        if (!reader->start(readPaths)) {
+            reader.reset();
+        }
+    }
+    
+    // With a memory limit, each frame reserves its decoded size (from its
+    // header) before it is decoded, so frames in flight on every thread count
+    // too, and keeps its stored size once done. Once the next frame would
+    // exceed the limit the workers stop taking files. Which frames get in
+    // depends on which thread gets there first, so the table below keeps only
+    // the run up to the first one left out.
+    enum FileState : unsigned char { NotLoaded, Admitted, Refused };
+    std::vector<unsigned char> states(pngFiles.size(), NotLoaded);
+    std::atomic<size_t> admittedBytes(0);
+    std::atomic<bool> limitReached(false);
+    if (memoryLimit > 0) {
+        admittedBytes = getMemoryUsage().frameBytes;
+    }
+    auto claim = [&](size_t i, size_t bytes) {
+        if (admittedBytes.fetch_add(bytes) + bytes > memoryLimit) {
+            admittedBytes -= bytes;
+            states[i] = Refused;
+            limitReached = true;
+            return false;
+        }
+        return true;
+    };
+    auto reserve = [&](size_t i, size_t& reserved) {
+        reserved = 0;
+        FrameLayout layout = decodeSettings.uniform; // Every frame is converted to it, if set
+        if (memoryLimit == 0 || (layout.width <= 0 && !probeFrame(pngFiles[i], decodeSettings, layout))) {
+            return true; // An unreadable header is left to the decode to report
+        }
+        reserved = decodedBytes(layout, decodeSettings);
+        return claim(i, reserved);
+    };
+    auto admit = [&](size_t i, size_t reserved) {
+        size_t bytes = memoryLimit > 0 && decoded[i].isValid() ? decoded[i].data.size() : 0;
+        if (bytes <= reserved) {
+            admittedBytes -= reserved - bytes; // Block-compressed, reduced to a proxy or failed
+        } else if (!claim(i, bytes - reserved)) {
+            admittedBytes -= reserved;
+            decoded[i] = ImageData();
+            return;
+        }
+        states[i] = Admitted;
+    };
+    
+    // Workers pull file indices from a shared counter (or take whichever read
+    // finished first) so that large and small files balance out across threads
+    std::atomic<size_t> nextFile(0);
+    auto decodeWorker = [&]() {
+        if (reader) {
+            size_t i;
+            PixelBuffer contents;
+            for (auto waitStart = std::chrono::steady_clock::now(); !limitReached && reader->next(i, contents);
+                 waitStart = std::chrono::steady_clock::now()) {
+                FileLoadTiming* timing = options.profile ? &timings[i] : nullptr;
+                if (timing) {
+                    timing->readMs += millisecondsSince(waitStart);
+                    timing->fileBytes += contents.size();
+                }
+                size_t reserved;
+                if (!reserve(i, reserved)) {
+                    break;
+                }
+                loadFrame(pngFiles[i], decoded[i], timing, &contents);
+                contents.reset();
+                admit(i, reserved);
+            }
+            return;
+        }
+        for (size_t i = nextFile++; i < pngFiles.size() && !limitReached; i = nextFile++) {
+            size_t reserved;
+            if (!reserve(i, reserved)) {
+                break;
+            }
+            loadFrame(pngFiles[i], decoded[i], options.profile ? &timings[i] : nullptr);
+            admit(i, reserved);
+        }
+    };
+    
+    size_t threadCount = resolveThreadCount(options, pngFiles.size());
+    if (threadCount <= 1) {
+        decodeWorker();
+    } else {
+        std::vector<std::thread> workers;
+        workers.reserve(threadCount);
+        for (size_t t = 0; t < threadCount; ++t) {
+            workers.emplace_back(decodeWorker);
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    
+    // Store the decoded images in file order so the output is deterministic
+    // regardless of which thread finished first
+    bool appended = false;
+    for (size_t i = 0; i < pngFiles.size(); ++i) {
+        const fs::path& path = pngFiles[i];
         std::string baseName = extractBaseName(path);
+        ImageData& result = decoded[i];
+        auto insertStart = std::chrono::steady_clock::now();
         
-        // Load the image
-        int width, height, channels;
-        stbi_set_flip_vertically_on_load(true); // Don't flip the image vertically
-
-        // Load at original size
-        unsigned char* data = stbi_load(filePath.c_str(), &width, &height, &channels, 0);
-
-        if (data) {
-            // Calculate the size of the image data
-            size_t dataSize = width * height * channels;
-
-            // Store the image data
-            images[baseName] = ImageData(width, height, channels, data, dataSize);
-
-            // Free the image data loaded by stb_image
-            stbi_image_free(data);
-
+        if (limitReached && (refusedFrames > 0 || states[i] != Admitted)) {
+            // At or past the first frame the memory limit left out
+            result = ImageData();
+            ++refusedFrames;
+            continue;
+        }
+        if (result.isValid()) {
+            int width = result.width;
+            int height = result.height;
+            int channels = result.channels;
+            BlockFormat compression = result.compression;
+            
+            // Move the decoded image into the frame table; its pixel buffer is never copied
+            auto existing = frameIndex.find(baseName);
+            if (existing != frameIndex.end()) {
+                // Reloading over an existing entry: replace it
+                frames[existing->second] = std::move(result);
+            } else {
+                frameIndex.emplace(baseName, frames.size());
+                frameNames.push_back(baseName);
+                frames.push_back(std::move(result));
+                appended = true;
+            }
+            if (options.profile) {
+                timings[i].insertMs = millisecondsSince(insertStart);
+            }
+            
             loadedCount++;
             if (options.verbose) {
                 std::cout << "Loaded image: " << baseName << " (" << width << "x" << height << ", "
-                          << channels << " channels)" << std::endl;
+                          << channels << " channels"
+                          << (compression == BlockFormat::BC1 ? ", BC1" : compression == BlockFormat::BC3 ? ", BC3" : "")
+                          << ")" << std::endl;
             }
         } else {
-            std::cerr << "Failed to load image: " << filePath << std::endl;
+            std::cerr << "Failed to load image: " << path.string() << std::endl;
+        }
+    }
+    
+    if (refusedFrames > 0) {
+        std::cerr << "Memory limit of " << memoryLimit / (1024 * 1024) << " MB reached: refused " << refusedFrames
+                  << " of " << pngFiles.size() << " images (stream the sequence to play all of them)" << std::endl;
+    }
+    
+    auto sortStart = std::chrono::steady_clock::now();
+    if (appended) {
+        sortFrames();
+    }
+    if (options.profile) {
+        loadProfile.threadCount = threadCount;
+        loadProfile.sortMs = millisecondsSince(sortStart);
+        loadProfile.wallMs = millisecondsSince(loadStart);
+        loadProfile.names.clear();
+        for (const fs::path& path : pngFiles) {
+            loadProfile.names.push_back(extractBaseName(path));
         }
+        loadProfile.files = std::move(timings);
+        loadProfile.print(std::cout, options.verbose);
+    }
+    if (!frameCacheDir.empty() && options.cacheDirectoryLimit > 0) {
+        // Entries written by this load are the newest, so older ones go first
+        trimFrameCache(frameCacheDir, options.cacheDirectoryLimit);
+    }
+    if (options.dirtyTileSize > 0) {
+        computeDirtyTiles(options.dirtyTileSize, threadCount);
+    }
+    if (options.packInMemory && loadedCount > 0) {
+        packFrames(options, threadCount);
     }
     
-    std::cout << "Loaded " << loadedCount << " PNG images from " << directory << std::endl;
+    std::cout << "Loaded " << loadedCount << " images from " << directory
+              << " using " << threadCount << " decode thread(s)" << std::endl;
     return loadedCount > 0;
 }
 
+bool ImageLoader::loadSequenceFile(const std::string& path, const ImageLoadOptions& options) {
+    clearImages();
+    sequenceLayout = FrameLayout();
+    // Mapped frames are backed by the file rather than held in memory the limit covers
+    memoryLimit = 0;
+    refusedFrames = 0;
+    
+    auto file = std::make_unique<SequenceFile>();
+    if (!file->open(path)) {
+        return false;
+    }
+    
+    // The packer wrote the frames in sequence order already
+    size_t first = std::min(static_cast<size_t>(std::max(options.startFrame, 0)), file->getFrameCount());
+    size_t last = file->getFrameCount();
+    if (options.maxImages > 0) {
+        last = std::min(last, first + static_cast<size_t>(options.maxImages));
+    }
+    
+    frames.reserve(last - first);
+    frameNames.reserve(last - first);
+    for (size_t i = first; i < last; ++i) {
+        ImageData view;
+        if (!file->getFrame(i, view)) {
+            continue;
+        }
+        const std::string& name = file->getFrameName(i);
+        if (!frameIndex.emplace(name, frames.size()).second) {
+            continue;
+        }
+        if (options.verbose) {
+            std::cout << "Mapped image: " << name << " (" << view.width << "x" << view.height << ", "
+                      << view.channels << " channels)" << std::endl;
+        }
+        frameNames.push_back(name);
+        frames.push_back(std::move(view));
+    }
+    sequenceFile = std::move(file);
+    if (options.dirtyTileSize > 0) {
+        computeDirtyTiles(options.dirtyTileSize, resolveThreadCount(options, frames.size()));
+    }
+    
+    std::cout << "Mapped " << frames.size() << " frames from " << path << std::endl;
+    return !frames.empty();
+}
+
+void ImageLoader::sortFrames() {
+    // Sort once at load time so that playback can address frames by index
+    std::vector<std::pair<FrameSortKey, size_t>> order;
+    order.reserve(frames.size());
+    for (size_t i = 0; i < frames.size(); ++i) {
+        order.emplace_back(FrameSortKey::parse(frameNames[i]), i);
+    }
+    std::sort(order.begin(), order.end());
+    
+    std::vector<ImageData> sortedFrames;
+    std::vector<std::string> sortedNames;
+    sortedFrames.reserve(frames.size());
+    sortedNames.reserve(frameNames.size());
+    for (const auto& entry : order) {
+        sortedFrames.push_back(std::move(frames[entry.second]));
+        sortedNames.push_back(std::move(frameNames[entry.second]));
+    }
+    frames = std::move(sortedFrames);
+    frameNames = std::move(sortedNames);
+    
+    frameIndex.clear();
+    frameIndex.reserve(frameNames.size());
+    for (size_t i = 0; i < frameNames.size(); ++i) {
+        frameIndex.emplace(frameNames[i], i);
+    }
+}
+
+bool ImageLoader::findFrame(const std::string& name, size_t& index) const {
+    auto it = frameIndex.find(name);
+    if (it == frameIndex.end()) {
+        return false;
+    }
+    index = it->second;
+    return true;
+}
+
+bool ImageLoader::getFrameSize(size_t index, int& width, int& height) const {
+    if (index < packedFrames.size()) {
+        width = packedFrames[index].width;
+        height = packedFrames[index].height;
+        return true;
+    }
+    if (index < frames.size() && frames[index].isValid()) {
+        width = frames[index].width;
+        height = frames[index].height;
+        return true;
+    }
+    if (index >= streamPaths.size()) {
+        return false;
+    }
+    if (decodeSettings.uniform.width > 0) {
+        width = decodeSettings.uniform.width; // Every frame is converted to it
+        height = decodeSettings.uniform.height;
+        return true;
+    }
+    
+    // Every format's size is in its first bytes (or, for raw frames, the file size)
+    FrameLayout layout;
+    if (!probeFrame(streamPaths[index], decodeSettings, layout)) {
+        return false;
+    }
+    width = layout.width;
+    height = layout.height;
+    return true;
+}
+
+bool ImageLoader::getSequenceLayout(FrameLayout& layout) const {
+    if (sequenceLayout.width <= 0) {
+        return false;
+    }
+    layout = sequenceLayout;
+    return true;
+}
+
+bool ImageLoader::validateSequence(std::vector<fs::path>& files, const ImageLoadOptions& options) {
+    // Read every file's header, spread over the decode threads
+    std::vector<FrameLayout> layouts(files.size());
+    std::vector<char> readable(files.size(), 0);
+    std::atomic<size_t> nextFile(0);
+    auto probeWorker = [&]() {
+        for (size_t i = nextFile++; i < files.size(); i = nextFile++) {
+            readable[i] = probeFrame(files[i], decodeSettings, layouts[i]);
+        }
+    };
+    size_t threadCount = resolveThreadCount(options, files.size());
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threadCount; ++t) {
+        workers.emplace_back(probeWorker);
+    }
+    probeWorker();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    
+    // Unreadable files are dropped now instead of failing during playback
+    size_t kept = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!readable[i]) {
+            std::cerr << "Skipping unreadable image: " << files[i].string() << std::endl;
+            continue;
+        }
+        files[kept] = std::move(files[i]);
+        layouts[kept] = layouts[i];
+        ++kept;
+    }
+    size_t skipped = files.size() - kept;
+    files.resize(kept);
+    layouts.resize(kept);
+    if (layouts.empty()) {
+        return false;
+    }
+    
+    // The most common size, the earliest in sequence order among equally common ones
+    std::map<std::pair<int, int>, size_t> sizeCounts;
+    for (const FrameLayout& layout : layouts) {
+        ++sizeCounts[std::make_pair(layout.width, layout.height)];
+    }
+    FrameLayout target;
+    size_t bestCount = 0;
+    for (const FrameLayout& layout : layouts) {
+        size_t count = sizeCounts[std::make_pair(layout.width, layout.height)];
+        if (count > bestCount) {
+            bestCount = count;
+            target.width = layout.width;
+            target.height = layout.height;
+        }
+    }
+    
+    // Enough channels for every file: colour if any has colour, alpha if any
+    // has alpha (grey with alpha becomes RGBA, which uploads have a format for)
+    bool color = false;
+    bool alpha = false;
+    bool halfFloat = false;
+    bool sameBlocks = layouts[0].compression != BlockFormat::None;
+    bool samePlanes = layouts[0].planes != PlaneFormat::Interleaved;
+    for (const FrameLayout& layout : layouts) {
+        int channels = layout.compression == BlockFormat::BC3 ? 4 : layout.compression == BlockFormat::BC1 ? 3 : layout.channels;
+        color = color || channels >= 3;
+        alpha = alpha || channels == 2 || channels == 4;
+        halfFloat = halfFloat || layout.sampleFormat == SampleFormat::Float16;
+        sameBlocks = sameBlocks && layout.compression == layouts[0].compression &&
+                     layout.width == target.width && layout.height == target.height;
+        samePlanes = samePlanes && layout.planes == layouts[0].planes &&
+                     layout.width == target.width && layout.height == target.height;
+    }
+    sequenceChannels = alpha ? 4 : color ? 3 : 1;
+    if (sameBlocks) {
+        // Already GPU-ready and alike: served as stored
+        target.compression = layouts[0].compression;
+        target.channels = layouts[0].channels;
+    } else if (samePlanes) {
+        // YUV throughout: uploaded as planes and converted on the GPU
+        target.planes = layouts[0].planes;
+        target.channels = 3;
+    } else if (halfFloat) {
+        target.channels = 4;
+        target.sampleFormat = SampleFormat::Float16;
+    } else {
+        target.channels = decodeSettings.desiredChannels == 4 ? 4 : sequenceChannels;
+        decodeSettings.desiredChannels = target.channels; // stb decodes straight to it
+    }
+    decodeSettings.uniform = target;
+    
+    size_t converted = 0;
+    size_t resized = 0;
+    for (const FrameLayout& layout : layouts) {
+        if (layout.width != target.width || layout.height != target.height) {
+            ++resized;
+        } else if (layout.channels != target.channels || layout.compression != target.compression ||
+                   layout.sampleFormat != target.sampleFormat || layout.planes != target.planes) {
+            ++converted;
+        }
+    }
+    
+    // As frames are served: reduced to the proxy tier, then block-compressed by loadFrame
+    sequenceLayout = target;
+    if (target.compression == BlockFormat::None && target.sampleFormat == SampleFormat::UNorm8 &&
+        target.planes == PlaneFormat::Interleaved) {
+        while (proxyWidth > 0 && proxyHeight > 0 && sequenceLayout.width / 2 >= proxyWidth &&
+               sequenceLayout.height / 2 >= proxyHeight) {
+            sequenceLayout.width /= 2;
+            sequenceLayout.height /= 2;
+        }
+        if (blockCompression && !frameCacheDir.empty() && sequenceLayout.width % 4 == 0 && sequenceLayout.height % 4 == 0) {
+            sequenceLayout.compression = BlockCompressor::formatForChannels(sequenceChannels);
+            sequenceLayout.channels = sequenceLayout.compression == BlockFormat::BC3 ? 4 : 3;
+        }
+    }
+    
+    std::cout << "Sequence format: " << layouts.size() << " frames of " << target.width << "x" << target.height << ", "
+              << target.channels << " channels"
+              << (target.compression == BlockFormat::BC1 ? ", BC1" : target.compression == BlockFormat::BC3 ? ", BC3" : "")
+              << (target.sampleFormat == SampleFormat::Float16 ? ", half float" : "")
+              << (target.planes == PlaneFormat::NV12 ? ", NV12" : target.planes == PlaneFormat::I420 ? ", I420" : "")
+              << "; " << resized
+              << " resized, " << converted << " converted, " << skipped << " skipped" << std::endl;
+    return true;
+}
+
+const ImageData* ImageLoader::getImage(size_t index) const {
+    if (isStreaming() || index >= frames.size()) {
+        return nullptr;
+    }
+    return &frames[index];
+}
+
 const ImageData* ImageLoader::getImage(const std::string& name) const {
-    auto it = images.find(name);
-    if (it != images.end()) {
-        return &(it->second);
+    size_t index;
+    if (!findFrame(name, index)) {
+        return nullptr;
+    }
+    return getImage(index);
+}
+
+std::shared_ptr<const ImageData> ImageLoader::acquireImage(size_t index) const {
+    if (isStreaming()) {
+        if (index >= frameNames.size()) {
+            return nullptr;
+        }
+        return frameCache->acquire(index);
+    }
+    
+    // Fully loaded images are owned by the frame table: hand out a non-owning pointer
+    const ImageData* image = getImage(index);
+    if (!image) {
+        return nullptr;
+    }
+    return std::shared_ptr<const ImageData>(std::shared_ptr<const ImageData>(), image);
+}
+
+std::shared_ptr<const ImageData> ImageLoader::tryAcquireImage(size_t index) const {
+    if (isStreaming()) {
+        return frameCache->tryAcquire(index);
+    }
+    return acquireImage(index);
+}
+
+std::shared_ptr<const ImageData> ImageLoader::acquireNearestImage(size_t index, size_t& found) const {
+    if (isStreaming()) {
+        return frameCache->acquireNearest(index, found);
+    }
+    found = index;
+    return acquireImage(index);
+}
+
+std::shared_ptr<const ImageData> ImageLoader::acquireImage(const std::string& name) const {
+    size_t index;
+    if (!findFrame(name, index)) {
+        return nullptr;
     }
-    return nullptr;
+    return acquireImage(index);
 }
 
-std::vector<std::string> ImageLoader::getImageNames() const {
-    std::vector<std::string> names;
-    names.reserve(images.size());
+void ImageLoader::setPlaybackPosition(size_t index, int direction) {
+    if (isStreaming()) {
+        frameCache->setPlayhead(index, direction);
+    }
+}
+
+// Partial updates only pay off for a few frames; beyond that most tiles have changed anyway
+static const size_t kMaxTileSpan = 8;
+
+bool ImageLoader::getChangedTiles(size_t from, size_t to, DirtyTiles& out) const {
+    size_t count = dirtyTiles.size();
+    if (count == 0 || from >= count || to >= count || from == to) {
+        return false;
+    }
+    size_t span = (to + count - from) % count;
+    if (span > kMaxTileSpan) {
+        return false;
+    }
+
+    for (size_t k = 1; k <= span; ++k) {
+        const DirtyTiles& step = dirtyTiles[(from + k) % count];
+        if (!step.isValid()) {
+            return false;
+        }
+        if (k == 1) {
+            out = step;
+        } else if (!out.merge(step)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ImageLoader::computeDirtyTiles(int tileSize, size_t threadCount) {
+    dirtyTiles.clear();
+    if (frames.size() < 2) {
+        return;
+    }
+    dirtyTiles.resize(frames.size());
     
-    for (const auto& pair : images) {
-        names.push_back(pair.first);
+    // Each comparison reads two frames once; spread them over the decode threads
+    std::atomic<size_t> nextFrame(0);
+    auto compareWorker = [&]() {
+        for (size_t i = nextFrame++; i < frames.size(); i = nextFrame++) {
+            const ImageData& previous = frames[(i + frames.size() - 1) % frames.size()];
+            DirtyTiles::compute(previous, frames[i], tileSize, dirtyTiles[i]);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threadCount; ++t) {
+        workers.emplace_back(compareWorker);
+    }
+    compareWorker();
+    for (auto& worker : workers) {
+        worker.join();
     }
     
-    return names;
+    size_t dirty = 0, total = 0, compared = 0;
+    for (const DirtyTiles& tiles : dirtyTiles) {
+        if (tiles.isValid()) {
+            dirty += tiles.dirtyCount;
+            total += tiles.dirty.size();
+            compared++;
+        }
+    }
+    if (compared > 0) {
+        std::cout << "Tile diff: " << dirty << " of " << total << " " << tileSize << "x" << tileSize
+                  << " tiles change across " << compared << " frames" << std::endl;
+    }
+}
+
+bool ImageLoader::packFrames(const ImageLoadOptions& options, size_t threadCount) {
+    for (const ImageData& frame : frames) {
+        if (frame.compression != BlockFormat::None) {
+            std::cout << "Block-compressed frames are kept as they are, not packed in memory" << std::endl;
+            return false;
+        }
+        if (frame.sampleFormat != SampleFormat::UNorm8) {
+            std::cout << "Half-float frames are kept as they are, not packed in memory" << std::endl;
+            return false;
+        }
+        if (frame.isPlanar()) {
+            std::cout << "YUV frames are kept as they are, not packed in memory" << std::endl;
+            return false;
+        }
+    }
+    
+    size_t interval = static_cast<size_t>(std::max(options.keyframeInterval, 1));
+    std::vector<PackedFrame> packed(frames.size());
+    std::atomic<size_t> nextFrame(0);
+    auto packWorker = [&]() {
+        for (size_t i = nextFrame++; i < frames.size(); i = nextFrame++) {
+            size_t key = i - i % interval;
+            const ImageData& frame = frames[i];
+            packed[i].width = frame.width;
+            packed[i].height = frame.height;
+            packed[i].channels = frame.channels;
+            packed[i].keyframe = key;
+            // A frame whose layout differs from its keyframe is stored as a keyframe itself
+            const ImageData& keyframe = frames[key];
+            bool delta = key != i && keyframe.width == frame.width && keyframe.height == frame.height &&
+                         keyframe.channels == frame.channels;
+            if (!delta) {
+                packed[i].keyframe = i;
+            }
+            FrameCodec::encode(frame, delta ? &keyframe : nullptr, packed[i].bytes);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threadCount; ++t) {
+        workers.emplace_back(packWorker);
+    }
+    packWorker();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    
+    size_t rawBytes = 0, packedBytes = 0;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        rawBytes += frames[i].data.size();
+        packedBytes += packed[i].bytes.size();
+    }
+    
+    // The raw frames are no longer needed; playback expands them on demand
+    packedFrames = std::move(packed);
+    frames.clear();
+    dirtyTiles.clear(); // Tile updates need both frames resident at once
+    
+    FrameCacheOptions cacheOptions;
+    cacheOptions.memoryBudget = resolveCacheBudget(options);
+    cacheOptions.prefetchAhead = options.prefetchAhead;
+    cacheOptions.prefetchBehind = options.prefetchBehind;
+    cacheOptions.threadCount = static_cast<int>(std::max<size_t>(threadCount, 1));
+    frameCache = std::make_unique<FrameCache>(packedFrames.size(),
+        [this](size_t index, ImageData& out) {
+            auto start = std::chrono::steady_clock::now();
+            bool ok = unpackFrame(index, out);
+            reportDecodeTime(start);
+            return ok;
+        },
+        cacheOptions, resolveScheduler(options, cacheOptions));
+    
+    std::cout << "Packed " << packedFrames.size() << " frames in memory: " << (rawBytes / (1024 * 1024)) << " MB -> "
+              << (packedBytes / (1024 * 1024)) << " MB" << std::endl;
+    return true;
+}
+
+bool ImageLoader::unpackFrame(size_t index, ImageData& out) const {
+    if (index >= packedFrames.size()) {
+        return false;
+    }
+    const PackedFrame& frame = packedFrames[index];
+    if (frame.keyframe == index) {
+        return FrameCodec::decode(frame.bytes.data(), frame.bytes.size(), frame.width, frame.height, frame.channels,
+                                  nullptr, out);
+    }
+    
+    const PackedFrame& key = packedFrames[frame.keyframe];
+    ImageData keyframe;
+    return FrameCodec::decode(key.bytes.data(), key.bytes.size(), key.width, key.height, key.channels, nullptr, keyframe) &&
+           FrameCodec::decode(frame.bytes.data(), frame.bytes.size(), frame.width, frame.height, frame.channels,
+                              &keyframe, out);
+}
+
+LoaderMemoryUsage ImageLoader::getMemoryUsage() const {
+    LoaderMemoryUsage usage;
+    usage.frameCount = frameNames.size();
+    for (const ImageData& frame : frames) {
+        usage.frameBytes += frame.data.size();
+        usage.largestFrameBytes = std::max(usage.largestFrameBytes, frame.data.size());
+    }
+    if (sequenceFile) {
+        usage.mappedBytes = usage.frameBytes; // Every frame is a view into the mapping
+    }
+    for (const PackedFrame& frame : packedFrames) {
+        usage.packedBytes += frame.bytes.size();
+        usage.largestFrameBytes = std::max(usage.largestFrameBytes, frame.bytes.size());
+    }
+    if (frameCache) {
+        usage.cacheBytes = frameCache->getResidentBytes();
+        usage.cacheFrames = frameCache->getResidentCount();
+        usage.cacheBudget = frameCache->getScheduler().getMemoryBudget();
+        usage.schedulerBytes = frameCache->getScheduler().getResidentBytes();
+    }
+    usage.pooledBytes = BufferPool::shared().getCachedBytes();
+    usage.memoryLimit = memoryLimit;
+    usage.refusedFrames = refusedFrames;
+    return usage;
+}
+
+size_t ImageLoader::getFrameBytes(size_t index) const {
+    size_t bytes = 0;
+    if (index < frames.size()) {
+        bytes += frames[index].data.size();
+    }
+    if (index < packedFrames.size()) {
+        bytes += packedFrames[index].bytes.size();
+    }
+    if (frameCache) {
+        std::shared_ptr<const ImageData> frame = frameCache->tryAcquire(index);
+        if (frame) {
+            bytes += frame->data.size();
+        }
+    }
+    return bytes;
+}
+
+void ImageLoader::setDecodeTimeCallback(DecodeTimeCallback callback, void* context) {
+    // Taking the lock waits for a call in flight to finish with the old context
+    std::lock_guard<std::mutex> lock(decodeTimeMutex);
+    decodeTimeCallback = callback;
+    decodeTimeContext = callback ? context : nullptr;
+}
+
+void ImageLoader::reportDecodeTime(std::chrono::steady_clock::time_point start) const {
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(decodeTimeMutex);
+    if (decodeTimeCallback) {
+        decodeTimeCallback(decodeTimeContext, milliseconds);
+    }
+}
+
+void ImageLoader::seekPlaybackPosition(size_t index, int direction) {
+    if (isStreaming()) {
+        frameCache->seek(index, direction);
+    }
+}
+
+bool ImageLoader::decodeFrame(const fs::path& path, ImageData& out, int* sourceChannels, bool* cacheable,
+                              FileLoadTiming* timing, const PixelBuffer* contents) const {
+    if (!decodeImageFile(path, decodeSettings, out, sourceChannels, cacheable, timing, contents)) {
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    ImageData proxy;
+    if (PixelConvert::reduceToProxy(out, proxyWidth, proxyHeight, proxy)) {
+        out = std::move(proxy);
+    }
+    if (timing) {
+        timing->convertMs += millisecondsSince(start);
+    }
+    return true;
+}
+
+fs::path ImageLoader::frameCachePath(const fs::path& path) const {
+    // Proxy tiers are cached separately from full-resolution frames
+    // Named with the extension: a.png and a.qoi of one directory are two frames
+    std::string cacheName = path.filename().string();
+    // Frames decoded to other channels or samples are different frames
+    if (decodeSettings.desiredChannels > 0) {
+        cacheName += ".c" + std::to_string(decodeSettings.desiredChannels);
+    }
+    if (decodeSettings.highBitDepth) {
+        cacheName += ".hbd";
+    }
+    if (proxyWidth > 0 && proxyHeight > 0) {
+        cacheName += ".proxy" + std::to_string(proxyWidth) + "x" + std::to_string(proxyHeight);
+    }
+    // So are frames converted to a sequence format, which depends on the other files
+    const FrameLayout& uniform = decodeSettings.uniform;
+    if (uniform.width > 0) {
+        cacheName += ".as" + std::to_string(uniform.width) + "x" + std::to_string(uniform.height) + "c" +
+                     std::to_string(uniform.channels) + (uniform.sampleFormat == SampleFormat::Float16 ? "h" : "");
+    }
+    return frameCacheDir / (cacheName + ".frame");
+}
+
+fs::path ImageLoader::readPath(const fs::path& path) const {
+    if (frameCacheDir.empty()) {
+        return path;
+    }
+    fs::path cachePath = frameCachePath(path);
+    std::error_code ec;
+    return fs::exists(cachePath, ec) ? cachePath : path;
+}
+
+bool ImageLoader::loadFrame(const fs::path& path, ImageData& out, FileLoadTiming* timing, const PixelBuffer* contents) const {
+    TRACE_ZONE("Load frame");
+    if (frameCacheDir.empty()) {
+        bool ok = decodeFrame(path, out, nullptr, nullptr, timing, contents);
+        if (ok && timing) {
+            timing->pixelBytes = out.data.size();
+        }
+        return ok;
+    }
+    
+    SourceStamp stamp;
+    bool stamped = sourceStamp(path, stamp);
+    fs::path cachePath = frameCachePath(path);
+    auto start = std::chrono::steady_clock::now();
+    
+    // Bytes read ahead are either the cache entry or, without one, the PNG
+    bool readEntry = contents && isCachedFrame(*contents);
+    const PixelBuffer* png = contents && !readEntry ? contents : nullptr;
+    bool hit = readEntry ? stamped && parseCachedFrame(*contents, stamp, out)
+                         : !png && stamped && mapCachedFrame(cachePath, stamp, out);
+    if (hit) {
+        // A hit makes the entry the most recently used one for trimFrameCache
+        std::error_code ec;
+        fs::last_write_time(cachePath, fs::file_time_type::clock::now(), ec);
+        if (timing) {
+            if (!contents) {
+                timing->readMs += millisecondsSince(start);
+                timing->fileBytes += out.data.size();
+            }
+            timing->pixelBytes = out.data.size();
+        }
+        return true;
+    }
+    
+    // Cache miss (or a stale entry, after which the file is read here): decode
+    // it, then store it for the next run unless its format loads as fast
+    int sourceChannels = 0;
+    bool cacheable = true;
+    if (!decodeFrame(path, out, &sourceChannels, &cacheable, timing, png)) {
+        return false;
+    }
+    stamped = stamped && cacheable;
+    
+    // Partial blocks cannot be uploaded as a sub-image on every GPU, so frames
+    // whose size is not a multiple of 4 stay uncompressed, as do half-float
+    // frames, whose precision BC1/BC3 would throw away, and YUV frames, already
+    // half the size of RGB. With cacheDecodedFrames those are stored as they are.
+    start = std::chrono::steady_clock::now();
+    ImageData compressed;
+    if (blockCompression && out.compression == BlockFormat::None && out.sampleFormat == SampleFormat::UNorm8 &&
+        !out.isPlanar() && out.width % 4 == 0 && out.height % 4 == 0 &&
+        BlockCompressor::compress(out, BlockCompressor::formatForChannels(sequenceLayout.width > 0 ? sequenceChannels : sourceChannels),
+                                  compressed)) {
+        if (stamped) {
+            writeCachedFrame(cachePath, stamp, compressed);
+        }
+        out = std::move(compressed);
+    } else if (cacheDecodedFrames && stamped) {
+        writeCachedFrame(cachePath, stamp, out);
+    }
+    if (timing) {
+        timing->convertMs += millisecondsSince(start);
+        timing->pixelBytes = out.data.size();
+    }
+    return true;
 }
 
 std::string ImageLoader::extractBaseName(const fs::path& path) const {
     return path.stem().string();
 }
+
+bool ImageLoader::profileThreadCounts(const std::string& directory, ImageLoadOptions options,
+                                      const std::vector<int>& threadCounts, std::ostream& out) {
+    options.profile = true;
+    options.verbose = false;
+    options.streaming = false;
+    options.packInMemory = false;
+    options.dirtyTileSize = 0;
+    
+    bool loadedAny = false;
+    out << std::fixed << std::setprecision(2);
+    out << "threads    wall ms   images/s       MB/s    read ms  decode ms convert ms" << std::endl;
+    for (int threads : threadCounts) {
+        // A fresh loader per run, so every run decodes every file
+        options.threadCount = threads;
+        ImageLoader loader;
+        std::ostringstream log;
+        std::streambuf* saved = std::cout.rdbuf(log.rdbuf()); // Keep the per-load report out of the table
+        bool loaded = loader.loadImagesFromDirectory(directory, options);
+        std::cout.rdbuf(saved);
+        if (!loaded) {
+            continue;
+        }
+        loadedAny = true;
+        const LoadProfile& profile = loader.getLoadProfile();
+        FileLoadTiming sum = profile.total();
+        out << std::setw(7) << profile.threadCount << std::setw(11) << profile.wallMs
+            << std::setw(11) << profile.imagesPerSecond() << std::setw(11) << profile.megabytesPerSecond()
+            << std::setw(11) << sum.readMs << std::setw(11) << sum.decodeMs << std::setw(11) << sum.convertMs << std::endl;
+    }
+    out << std::defaultfloat;
+    return loadedAny;
+}
+
+size_t ImageLoader::resolveCacheBudget(const ImageLoadOptions& options) {
+    if (options.memoryLimitBytes == 0) {
+        return options.cacheBudgetBytes;
+    }
+    // A window-only cache (budget 0) would not be bounded by bytes
+    return options.cacheBudgetBytes > 0 ? std::min(options.cacheBudgetBytes, options.memoryLimitBytes)
+                                        : options.memoryLimitBytes;
+}
+
+std::shared_ptr<PrefetchScheduler> ImageLoader::resolveScheduler(const ImageLoadOptions& options,
+                                                                 const FrameCacheOptions& cacheOptions) {
+    if (options.prefetchScheduler) {
+        return options.prefetchScheduler;
+    }
+    return std::make_shared<PrefetchScheduler>(cacheOptions.memoryBudget, cacheOptions.threadCount);
+}
+
+size_t ImageLoader::resolveThreadCount(const ImageLoadOptions& options, size_t fileCount) {
+    size_t threadCount = options.threadCount > 0 ? static_cast<size_t>(options.threadCount)
+                                                 : std::thread::hardware_concurrency();
+    if (threadCount == 0) {
+        threadCount = 1; // hardware_concurrency may be unknown
+    }
+    return std::min(threadCount, std::max<size_t>(fileCount, 1));
+}
+
+bool ImageLoader::startStreaming(const std::vector<fs::path>& files, const ImageLoadOptions& options) {
+    clearImages();
+    
+    // The files arrive in sequence order; a name seen twice (e.g. "1.png" and
+    // "1.PNG") keeps its first file
+    for (const auto& path : files) {
+        std::string baseName = extractBaseName(path);
+        if (frameIndex.emplace(baseName, frameNames.size()).second) {
+            frameNames.push_back(baseName);
+            streamPaths.push_back(path);
+        }
+    }
+    
+    if (frameNames.empty()) {
+        std::cerr << "No images to stream" << std::endl;
+        return false;
+    }
+    
+    FrameCacheOptions cacheOptions;
+    cacheOptions.memoryBudget = resolveCacheBudget(options);
+    cacheOptions.prefetchAhead = options.prefetchAhead;
+    cacheOptions.prefetchBehind = options.prefetchBehind;
+    cacheOptions.threadCount = static_cast<int>(resolveThreadCount(options, frameNames.size()));
+    
+    std::shared_ptr<PrefetchScheduler> scheduler = resolveScheduler(options, cacheOptions);
+    frameCache = std::make_unique<FrameCache>(frameNames.size(),
+        [this](size_t index, ImageData& out) {
+            auto start = std::chrono::steady_clock::now();
+            bool ok = loadFrame(streamPaths[index], out);
+            reportDecodeTime(start);
+            if (!ok) {
+                std::cerr << "Failed to load image: " << streamPaths[index].string() << std::endl;
+            }
+            return ok;
+        },
+        cacheOptions, scheduler);
+    
+    std::cout << "Streaming " << frameNames.size() << " images with " << scheduler->getThreadCount()
+              << " prefetch thread(s), budget " << (scheduler->getMemoryBudget() / (1024 * 1024)) << " MB"
+              << (options.prefetchScheduler ? " (shared)" : "") << std::endl;
+    return true;
+}
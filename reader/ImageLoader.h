@@ -1,46 +1,284 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <string>
-#include <map>
+#include <unordered_map>
 #include <vector>
 #include <filesystem>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include "PixelBuffer.h"
+
+class FrameCache;
+struct FrameCacheOptions;
+class PrefetchScheduler;
+class SequenceFile;
+struct DirtyTiles;
+
+// GPU block compression of a frame's pixel data
+enum class BlockFormat {
+    None,  // Tightly packed 8-bit pixels
+    BC1,   // S3TC DXT1, 8 bytes per 4x4 block, opaque
+    BC3    // S3TC DXT5, 16 bytes per 4x4 block, with alpha
+};
+
+// Storage of each channel of an uncompressed frame
+enum class SampleFormat {
+    UNorm8,  // One byte per channel
+    Float16  // IEEE half float per channel (16-bit PNGs with ImageLoadOptions::highBitDepth)
+};
+
+// How a frame's pixels are laid out in its buffer
+enum class PlaneFormat {
+    Interleaved,  // One plane of interleaved channels (grey, RGB, RGBA)
+    NV12,         // 4:2:0 YUV: a Y plane, then one half-size plane of interleaved U,V pairs
+    I420          // 4:2:0 YUV: a Y plane, then half-size U and V planes
+};
 
 // Structure to hold image data
+// Pixels are owned through a PixelBuffer, so ImageData is move-only.
 struct ImageData {
     int width;
     int height;
-    int channels;  // 3 for RGB, 4 for RGBA
-    std::vector<unsigned char> data;
+    int channels;  // 3 for RGB, 4 for RGBA (channels after decompression for block-compressed frames, 3 for YUV)
+    PixelBuffer data;
+    BlockFormat compression;
+    SampleFormat sampleFormat;
+    // YUV frames are 8-bit, uncompressed and of even size; their video-range
+    // BT.709 samples are converted to RGB on the GPU (or, where planes cannot
+    // be uploaded, on the CPU, see PixelConvert::yuvToRGBA)
+    PlaneFormat planes;
+    
+    ImageData() : width(0), height(0), channels(0), compression(BlockFormat::None), sampleFormat(SampleFormat::UNorm8),
+                  planes(PlaneFormat::Interleaved) {}
     
-    ImageData() : width(0), height(0), channels(0) {}
+    ImageData(int w, int h, int c, PixelBuffer&& pixels, BlockFormat blockFormat = BlockFormat::None,
+              SampleFormat samples = SampleFormat::UNorm8, PlaneFormat planeFormat = PlaneFormat::Interleaved) 
+        : width(w), height(h), channels(c), data(std::move(pixels)), compression(blockFormat), sampleFormat(samples),
+          planes(planeFormat) {}
     
-    ImageData(int w, int h, int c, const unsigned char* ptr, size_t size) 
-        : width(w), height(h), channels(c), data(ptr, ptr + size) {}
+    ImageData(ImageData&&) = default;
+    ImageData& operator=(ImageData&&) = default;
     
     bool isValid() const { return !data.empty() && width > 0 && height > 0; }
+    bool isPlanar() const { return planes != PlaneFormat::Interleaved; }
+};
+
+// Size and storage of a frame, without its pixels
+struct FrameLayout {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    BlockFormat compression = BlockFormat::None;
+    SampleFormat sampleFormat = SampleFormat::UNorm8;
+    PlaneFormat planes = PlaneFormat::Interleaved;
+    
+    bool operator==(const FrameLayout& other) const {
+        return width == other.width && height == other.height && channels == other.channels &&
+               compression == other.compression && sampleFormat == other.sampleFormat && planes == other.planes;
+    }
+    bool operator!=(const FrameLayout& other) const { return !(*this == other); }
+};
+
+// How decoders store the frames they decode (see ImageDecoders)
+struct DecodeSettings {
+    int desiredChannels = 0;   // Channels to decode to (4 expands to RGBA), 0 keeps the file's channels
+    bool highBitDepth = false; // 16-bit sources become RGBA half floats
+    int rawWidth = 0;          // Size of headerless raw frames (RGBA8, NV12 and I420)
+    int rawHeight = 0;
+    // Layout every decoded frame is converted to, before proxy reduction
+    // (width 0 = frames keep their own, see ImageLoadOptions::uniformFrames)
+    FrameLayout uniform;
 };
 
 // Options for loading images
 struct ImageLoadOptions {
-    int maxImages;       // Maximum number of images to load (0 = no limit)
+    int startFrame;      // First frame to load, as a position in sorted sequence order
+    int maxImages;       // Maximum number of images to load from startFrame (0 = no limit)
     bool verbose;        // Print detailed loading information
+    int threadCount;     // Number of decode threads (0 = one per hardware thread, 1 = sequential)
+    
+    // Decode every frame as 4-channel RGBA. Rows are then 4-byte aligned and
+    // uploads take the driver's direct path; ANGLE's D3D11 backend would
+    // otherwise expand RGB to RGBA on the CPU during every upload.
+    bool expandToRGBA;
+    
+    // Streaming mode: only enumerate the files up front and decode a sliding
+    // window of frames around the playhead in the background
+    bool streaming;
+    size_t cacheBudgetBytes; // Memory budget for decoded frames in streaming mode (0 = prefetch window only)
+    int prefetchAhead;       // Frames decoded ahead of the playhead in streaming mode
+    int prefetchBehind;      // Frames kept behind the playhead in streaming mode
+    
+    // Transcode frames to BC1/BC3 on first load and keep them in a cache
+    // directory, so later runs read the compressed frames instead of decoding PNGs
+    bool blockCompression;
+    // Keep the frames block compression leaves alone (or all of them, without
+    // it) in the cache directory as decoded pixels. Entries are keyed by the
+    // PNG's path, size and modification time, and hits of either kind are
+    // memory-mapped rather than read, so a warm run costs no decode and no copy.
+    bool cacheDecodedFrames;
+    std::string cacheDirectory; // Where cached frames are kept (empty = "<directory>/.bccache")
+    // Delete the least recently used entries once the cache directory is larger
+    // than this, when loading starts and after a full load (0 = no limit)
+    uint64_t cacheDirectoryLimit;
+    
+    // Proxy tier: frames at least twice as large as proxyWidth x proxyHeight
+    // (e.g. the window size) are box-filtered down by powers of two while
+    // decoding, stopping at the last size that still covers it. Uploads,
+    // cache memory and the compressed cache then match the display instead of
+    // the source resolution. 0 keeps full resolution.
+    int proxyWidth;
+    int proxyHeight;
+    
+    // Compare consecutive frames of fully loaded, uncompressed sequences in
+    // tiles of this size after loading, so playback can upload only changed
+    // tiles (0 = off). Time and memory are negligible next to the decode.
+    int dirtyTileSize;
+    
+    // Keep fully loaded, uncompressed frames encoded in RAM (see FrameCodec)
+    // instead of as raw pixels. Frames are then served like a streamed
+    // sequence: the prefetch threads expand a window around the playhead
+    // within cacheBudgetBytes. Every keyframeInterval-th frame is a keyframe,
+    // the others are stored as their difference from it.
+    bool packInMemory;
+    int keyframeInterval;
     
-    ImageLoadOptions() : maxImages(0), verbose(true) {}
+    // Decode into large-page buffers (see BufferPool::enableLargePages). Cuts
+    // TLB misses on the per-frame copies into upload staging memory; needs the
+    // "Lock pages in memory" privilege and falls back to normal pages without it.
+    bool largePages;
+    
+    // Time every stage of each file's load (see LoadProfile). Full loads only;
+    // streamed frames are decoded later, on the prefetch threads.
+    bool profile;
+    
+    // Decode 16-bit PNGs with stbi_load_16 into RGBA half floats instead of
+    // truncating them to 8 bits, for effect chains that would otherwise band.
+    // Such frames are 4x the size of RGB8 ones and skip block compression,
+    // proxy reduction, dirty tiles and in-memory packing. 8-bit files load as usual.
+    bool highBitDepth;
+    
+    // Size of headerless RGBA8 frames (.rgba/.raw files, e.g. written by
+    // shaderDemoExport --format raw); such files fail to load while it is 0.
+    // PNG, QOI and KTX2 files carry their size.
+    int rawWidth;
+    int rawHeight;
+    
+    // Validate the sequence while loading and give every frame the same
+    // layout: every file's header is read up front, files that cannot be read
+    // are dropped with a message, and the most common size with enough
+    // channels for every file (RGBA if any has alpha, half floats if any is
+    // half-float) becomes the sequence format. stb decodes straight to that
+    // channel count; outliers are converted and resized (bilinear) after
+    // decoding. Playback then never re-specifies texture storage, and
+    // getSequenceLayout() reports the layout so it can be allocated up front.
+    bool uniformFrames;
+    
+    // Prefetch threads and cache budget shared with other sequences (see
+    // PrefetchScheduler), e.g. the layers of a composite: the streamed or packed
+    // frames then count against the scheduler's budget, and cacheBudgetBytes and
+    // threadCount only apply to the initial load. Null = the sequence's own.
+    std::shared_ptr<PrefetchScheduler> prefetchScheduler;
+    
+    // Read the files of a full load with overlapped I/O, up to ioQueueDepth at
+    // a time ahead of the decode threads (see AsyncFileReader), instead of each
+    // decode thread reading its next file itself. Pays off where I/O latency
+    // rather than decoding is the limit (network shares, spinning disks). 0 = off.
+    // unbufferedIO bypasses the system file cache for the reads.
+    int ioQueueDepth;
+    bool unbufferedIO;
+    
+    // Hard limit on the RAM the loader holds for frames (0 = none). A full
+    // load admits frames in sequence order until their pixels would exceed it,
+    // counting each frame from when its decode starts, and refuses the rest
+    // with a message (stream the sequence to play all of them); a streamed or
+    // packed sequence's cache budget is capped at it, so frames beyond it are
+    // evicted. A shared prefetchScheduler keeps its own budget.
+    size_t memoryLimitBytes;
+    
+    ImageLoadOptions() : startFrame(0), maxImages(0), verbose(true), threadCount(1), expandToRGBA(false),
+                         streaming(false), cacheBudgetBytes(0), prefetchAhead(8), prefetchBehind(2),
+                         blockCompression(false), cacheDecodedFrames(false), cacheDirectoryLimit(0),
+                         proxyWidth(0), proxyHeight(0),
+                         dirtyTileSize(0), packInMemory(false), keyframeInterval(16),
+                         largePages(false), profile(false), highBitDepth(false), rawWidth(0), rawHeight(0),
+                         uniformFrames(false),
+                         ioQueueDepth(0), unbufferedIO(false), memoryLimitBytes(0) {}
+};
+
+// RAM an ImageLoader holds for its frames, see ImageLoader::getMemoryUsage
+struct LoaderMemoryUsage {
+    size_t frameCount = 0;         // Frames in the table (enumerated ones when streaming)
+    size_t frameBytes = 0;         // Pixels of fully loaded frames, mapped views included
+    size_t mappedBytes = 0;        // Of those, views into a memory-mapped sequence file
+    size_t largestFrameBytes = 0;  // Largest fully loaded or packed frame
+    size_t packedBytes = 0;        // Encoded frames of a sequence packed in memory
+    size_t cacheBytes = 0;         // Decoded frames resident in the streaming cache
+    size_t cacheFrames = 0;
+    size_t cacheBudget = 0;        // Of the prefetch scheduler (0 = prefetch window only)
+    size_t schedulerBytes = 0;     // Resident in every cache of the scheduler, e.g. shared with layers
+    size_t pooledBytes = 0;        // Freed blocks BufferPool::shared() keeps for reuse
+    size_t memoryLimit = 0;        // ImageLoadOptions::memoryLimitBytes of the last load
+    size_t refusedFrames = 0;      // Frames the last full load refused to stay within it
+    
+    // Heap memory of frames (mapped views are backed by the file, not counted)
+    size_t getHeldBytes() const { return frameBytes - mappedBytes + packedBytes + cacheBytes; }
+    // Mean bytes of a fully loaded frame, or of a frame in the streaming cache
+    size_t getAverageFrameBytes() const;
+    
+    void print(std::ostream& out) const;
+};
+
+// Where one file's load time went
+struct FileLoadTiming {
+    double readMs = 0.0;     // Reading the image file, or the frame cache entry
+    double decodeMs = 0.0;   // Image decode, including the decoder's RGBA expansion
+    double convertMs = 0.0;  // Proxy reduction and block compression
+    double insertMs = 0.0;   // Moving the frame into the frame table and name index
+    uint64_t fileBytes = 0;
+    uint64_t pixelBytes = 0; // Size of the stored frame
+};
+
+// Timing of the last profiled loadImagesFromDirectory call. Per-file stage
+// times are summed over all decode threads; wallMs is the elapsed time of the
+// whole load, so the sums exceed it when several threads run.
+struct LoadProfile {
+    size_t threadCount = 0;
+    double wallMs = 0.0;
+    double sortMs = 0.0;  // Restoring sequence order once all frames are in
+    std::vector<std::string> names;
+    std::vector<FileLoadTiming> files;
+    
+    FileLoadTiming total() const;
+    double imagesPerSecond() const;
+    double megabytesPerSecond() const;  // File bytes read per wall second
+    
+    // Aggregate figures and whether the load was I/O- or decode-bound, plus
+    // one line per file if perFile is set
+    void print(std::ostream& out, bool perFile) const;
 };
 
-// Custom comparator for numeric string sorting
-struct NumericStringCompare {
-    bool operator()(const std::string& a, const std::string& b) const {
-        // Try to convert strings to integers for numeric comparison
-        try {
-            int numA = std::stoi(a);
-            int numB = std::stoi(b);
-            return numA < numB;
-        } catch (const std::exception&) {
-            // Fall back to lexicographical comparison if conversion fails
-            return a < b;
-        }
+// Sort key for a frame name, parsed once per file.
+// The last run of digits is the frame number, so "10" sorts after "9" and
+// "shot_0010" after "shot_0002"; the text around it groups sequences with
+// different prefixes or suffixes. Names without digits sort by text alone.
+struct FrameSortKey {
+    std::string prefix;      // Text before the frame number (the whole name if there is none)
+    unsigned long long number;
+    std::string suffix;      // Text after the frame number
+    std::string name;        // Full name, to order equal numbers such as "01" and "1"
+    
+    static FrameSortKey parse(const std::string& name);
+    
+    bool operator<(const FrameSortKey& other) const {
+        if (prefix != other.prefix) return prefix < other.prefix;
+        if (number != other.number) return number < other.number;
+        if (suffix != other.suffix) return suffix < other.suffix;
+        return name < other.name;
     }
 };
 
@@ -49,25 +287,209 @@ public:
     ImageLoader();
     ~ImageLoader();
     
-    // Load all PNG images from a directory with options
+    // Load all images (PNG, QOI, KTX2 or raw, see ImageDecoders) from a directory with options
     bool loadImagesFromDirectory(const std::string& directory, const ImageLoadOptions& options = ImageLoadOptions());
     
+    // Open a packed sequence file (see SequenceFile) instead of a PNG directory.
+    // Frames are served straight from the memory-mapped file without decoding;
+    // startFrame and maxImages select the range, the other options do not apply.
+    bool loadSequenceFile(const std::string& path, const ImageLoadOptions& options = ImageLoadOptions());
+    
+    // Get image data by frame index (position in getImageNames()). O(1); this is
+    // what playback uses. Only available for fully loaded sequences; returns
+    // nullptr in streaming mode or for an out-of-range index.
+    const ImageData* getImage(size_t index) const;
+    
     // Get image data by filename (without path and extension)
+    // Only available for fully loaded sequences; returns nullptr in streaming mode
     const ImageData* getImage(const std::string& name) const;
     
-    // Get all loaded image names
-    std::vector<std::string> getImageNames() const;
+    // Get image data by frame index in either mode. In streaming mode this decodes
+    // the frame on the calling thread if the prefetcher has not produced it yet.
+    std::shared_ptr<const ImageData> acquireImage(size_t index) const;
+    
+    // Get a frame only if it can be had without decoding (always true for fully
+    // loaded sequences). Never blocks on the prefetcher.
+    std::shared_ptr<const ImageData> tryAcquireImage(size_t index) const;
+    
+    // Get the frame closest to index that is available without decoding, e.g.
+    // as a stand-in right after a seek. found is set to its index.
+    std::shared_ptr<const ImageData> acquireNearestImage(size_t index, size_t& found) const;
+    
+    // Name-keyed variant of acquireImage(size_t)
+    std::shared_ptr<const ImageData> acquireImage(const std::string& name) const;
+    
+    // Look up the frame index for a name. Returns false if there is no such frame.
+    bool findFrame(const std::string& name, size_t& index) const;
+    
+    // Tell the streaming prefetcher where playback is and which way it is going
+    // (index into getImageNames(), direction +1 forward / -1 backward)
+    void setPlaybackPosition(size_t index, int direction);
+    
+    // Jump the playback position: the prefetcher restarts at index and stale
+    // in-flight decodes are dropped (see FrameCache::seek)
+    void seekPlaybackPosition(size_t index, int direction);
+    
+    // Tiles that change when playback moves forward from frame from to frame to
+    // (wrapping at the end), up to a few frames apart. Returns false when that
+    // is unknown: no tile pass ran, the frames differ in layout, or they are
+    // too far apart for a partial update to pay off.
+    bool getChangedTiles(size_t from, size_t to, DirtyTiles& out) const;
+    
+    // Whether frames are streamed instead of fully loaded (also true for sequences packed in memory)
+    bool isStreaming() const { return frameCache != nullptr; }
     
-    // Get number of loaded images
-    size_t getImageCount() const { return images.size(); }
+    // Get all loaded image names, in playback order
+    const std::vector<std::string>& getImageNames() const { return frameNames; }
+    
+    // Name of the frame at an index
+    const std::string& getImageName(size_t index) const { return frameNames[index]; }
+    
+    // Get number of loaded images (or enumerated frames in streaming mode)
+    size_t getImageCount() const { return frameNames.size(); }
+    
+    // Size of a frame without decoding it: from the frame table, or from the
+    // file header of a streamed file, i.e. before proxy reduction.
+    // Reads a few bytes, so it can lay out a placeholder while the frame decodes.
+    bool getFrameSize(size_t index, int& width, int& height) const;
+    
+    // Layout every frame is served in (after proxy reduction and block
+    // compression) when the load gave the sequence one, see
+    // ImageLoadOptions::uniformFrames; false otherwise
+    bool getSequenceLayout(FrameLayout& layout) const;
     
     // Clear all loaded images
     void clearImages();
     
+    // Called on the decoding thread with the time each streamed frame took to
+    // decode or unpack, e.g. to feed frame timing statistics. Pass nullptr to
+    // remove it; that waits for calls in flight, so the old context may be
+    // destroyed once it returns.
+    typedef void (*DecodeTimeCallback)(void* context, double milliseconds);
+    void setDecodeTimeCallback(DecodeTimeCallback callback, void* context);
+    
+    // RAM held for the frames right now (any thread while no load runs)
+    LoaderMemoryUsage getMemoryUsage() const;
+    
+    // RAM held for one frame: its pixels when fully loaded, its encoded bytes
+    // when packed in memory, plus its decoded pixels while the streaming cache
+    // holds it
+    size_t getFrameBytes(size_t index) const;
+    
+    // Profile of the last load with ImageLoadOptions::profile set
+    const LoadProfile& getLoadProfile() const { return loadProfile; }
+    
+    // Load the directory once per thread count with profiling on and print a
+    // summary line for each, to see how far decoding scales. Returns false if
+    // nothing could be loaded.
+    static bool profileThreadCounts(const std::string& directory, ImageLoadOptions options,
+                                    const std::vector<int>& threadCounts, std::ostream& out);
+
+    // Cache budget of a streamed or packed sequence: cacheBudgetBytes within
+    // memoryLimitBytes. A shared PrefetchScheduler replaces the budget of the
+    // caches it serves, so it should be built with this one.
+    static size_t resolveCacheBudget(const ImageLoadOptions& options);
+    
 private:
-    // Map of image name to image data, using ordered map with numeric string comparison
-    std::map<std::string, ImageData, NumericStringCompare> images;
+    // Frame table in playback order: frameNames[i] names frames[i] (fully loaded)
+    // or streamPaths[i] (streaming). frameIndex maps names back to indices and is
+    // rebuilt once per load, so playback never parses or compares names.
+    std::vector<ImageData> frames;
+    std::vector<std::string> frameNames;
+    std::unordered_map<std::string, size_t> frameIndex;
+    
+    // Streaming mode state: source file per frame and the decode cache over them
+    std::vector<std::filesystem::path> streamPaths;
+    std::unique_ptr<FrameCache> frameCache;
+    
+    // Encoded frames of a sequence packed in memory (see ImageLoadOptions::packInMemory)
+    struct PackedFrame {
+        int width;
+        int height;
+        int channels;
+        size_t keyframe;  // Index of the keyframe it is a delta to (itself for keyframes)
+        std::vector<unsigned char> bytes;
+    };
+    std::vector<PackedFrame> packedFrames;
+    
+    // Mapped sequence file whose view backs frames (null unless loaded from one)
+    std::unique_ptr<SequenceFile> sequenceFile;
+    
+    // Channel count, bit depth and raw frame size of decoded frames (from ImageLoadOptions)
+    DecodeSettings decodeSettings;
+    
+    // Uniform frames: the layout they are served in (width 0 = not uniform) and
+    // the channels their content needs, which picks the block format
+    FrameLayout sequenceLayout;
+    int sequenceChannels;
+    
+    // dirtyTiles[i] holds the tiles of frame i that differ from frame i - 1
+    // (frame 0 is compared with the last frame, for looping); empty when off
+    std::vector<DirtyTiles> dirtyTiles;
+    
+    // Proxy tier size (0 = full resolution), see ImageLoadOptions
+    int proxyWidth;
+    int proxyHeight;
+    
+    LoadProfile loadProfile;
+    
+    // ImageLoadOptions::memoryLimitBytes of the last load, and the frames it refused
+    size_t memoryLimit;
+    size_t refusedFrames;
+    
+    // Decode timing hook, called by the frame cache's threads under decodeTimeMutex
+    mutable std::mutex decodeTimeMutex;
+    DecodeTimeCallback decodeTimeCallback;
+    void* decodeTimeContext;
+    void reportDecodeTime(std::chrono::steady_clock::time_point start) const;
+    
+    // Directory of cached frames (empty when neither block compression nor
+    // cacheDecodedFrames is on), and which frames are stored in it
+    std::filesystem::path frameCacheDir;
+    bool blockCompression;
+    bool cacheDecodedFrames;
+    
+    // Load one frame: from the frame cache if enabled, otherwise by decoding
+    // the file (and filling the cache). Safe to call from several threads.
+    // timing, if given, receives the time spent in each stage. contents, if
+    // given, holds the bytes of readPath(path), already read.
+    bool loadFrame(const std::filesystem::path& path, ImageData& out, FileLoadTiming* timing = nullptr,
+                   const PixelBuffer* contents = nullptr) const;
+    
+    // Decode a file (from contents, if already read) and reduce it to the proxy
+    // tier if one is configured. cacheable receives whether its format is worth
+    // keeping in the frame cache.
+    bool decodeFrame(const std::filesystem::path& path, ImageData& out, int* sourceChannels = nullptr,
+                     bool* cacheable = nullptr, FileLoadTiming* timing = nullptr,
+                     const PixelBuffer* contents = nullptr) const;
+    
+    // The file loadFrame reads for a PNG: its frame cache entry if there is one
+    std::filesystem::path frameCachePath(const std::filesystem::path& path) const;
+    std::filesystem::path readPath(const std::filesystem::path& path) const;
+    
+    // Fill dirtyTiles for the fully loaded frame table
+    void computeDirtyTiles(int tileSize, size_t threadCount);
+    
+    // Restore sequence order after new frames were appended, and rebuild frameIndex
+    void sortFrames();
+    
+    // Encode the fully loaded frame table and serve it through the frame cache
+    bool packFrames(const ImageLoadOptions& options, size_t threadCount);
+    bool unpackFrame(size_t index, ImageData& out) const;
+    
+    // Read the header of every file, drop unreadable ones and settle the
+    // sequence format (see ImageLoadOptions::uniformFrames); false if none is left
+    bool validateSequence(std::vector<std::filesystem::path>& files, const ImageLoadOptions& options);
+    
+    // Start streaming over the collected files instead of decoding them all
+    bool startStreaming(const std::vector<std::filesystem::path>& files, const ImageLoadOptions& options);
     
     // Extract filename without extension
     std::string extractBaseName(const std::filesystem::path& path) const;
+    
+    // Resolve the number of decode threads to use for a given number of files
+    static size_t resolveThreadCount(const ImageLoadOptions& options, size_t fileCount);
+    // The shared prefetch scheduler, or one of the sequence's own for cacheOptions
+    static std::shared_ptr<PrefetchScheduler> resolveScheduler(const ImageLoadOptions& options,
+                                                               const FrameCacheOptions& cacheOptions);
 };
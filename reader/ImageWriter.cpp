@@ -0,0 +1,156 @@
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// CRC-32 of PNG chunks (polynomial 0xEDB88320), one table lookup per byte
+static uint32_t crc32(uint32_t crc, const unsigned char* data, size_t size) {
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> values(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            values[i] = c;
+        }
+        return values;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Adler-32 of the zlib stream; sums are reduced every 5552 bytes, the most that cannot overflow
+static uint32_t adler32(uint32_t adler, const unsigned char* data, size_t size) {
+    uint32_t a = adler & 0xffff;
+    uint32_t b = adler >> 16;
+    while (size > 0) {
+        size_t block = size < 5552 ? size : 5552;
+        size -= block;
+        for (size_t i = 0; i < block; ++i) {
+            a += data[i];
+            b += a;
+        }
+        data += block;
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+static void putBigEndian(std::vector<unsigned char>& out, uint32_t value) {
+    out.push_back(static_cast<unsigned char>(value >> 24));
+    out.push_back(static_cast<unsigned char>(value >> 16));
+    out.push_back(static_cast<unsigned char>(value >> 8));
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+// Length, type, data and the CRC of type and data
+static void writeChunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data) {
+    std::vector<unsigned char> header;
+    putBigEndian(header, static_cast<uint32_t>(data.size()));
+    header.insert(header.end(), type, type + 4);
+    uint32_t crc = crc32(0, header.data() + 4, 4);
+    crc = crc32(crc, data.data(), data.size());
+    std::vector<unsigned char> trailer;
+    putBigEndian(trailer, crc);
+
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    file.write(reinterpret_cast<const char*>(trailer.data()), trailer.size());
+}
+
+static const unsigned char* rowAt(const unsigned char* pixels, int width, int height, int y, bool bottomUp) {
+    size_t stride = static_cast<size_t>(width) * 4;
+    return pixels + stride * static_cast<size_t>(bottomUp ? height - 1 - y : y);
+}
+
+bool ImageWriter::writePng(const std::string& path, int width, int height, const unsigned char* pixels, bool bottomUp) {
+    if (width <= 0 || height <= 0 || !pixels) {
+        return false;
+    }
+
+    // Scanlines with filter type 0 (none), top row first
+    size_t stride = static_cast<size_t>(width) * 4;
+    size_t scanlineBytes = (stride + 1) * height;
+    std::vector<unsigned char> scanlines(scanlineBytes);
+    for (int y = 0; y < height; ++y) {
+        unsigned char* line = scanlines.data() + (stride + 1) * y;
+        line[0] = 0;
+        memcpy(line + 1, rowAt(pixels, width, height, y, bottomUp), stride);
+    }
+
+    // zlib stream of stored blocks of at most 65535 bytes
+    const size_t kMaxStoredBlock = 65535;
+    std::vector<unsigned char> idat;
+    idat.reserve(scanlineBytes + scanlineBytes / kMaxStoredBlock * 5 + 16);
+    idat.push_back(0x78); // Deflate, 32K window
+    idat.push_back(0x01); // Fastest level; header checksum makes it a multiple of 31
+    for (size_t offset = 0; offset < scanlineBytes; offset += kMaxStoredBlock) {
+        size_t length = std::min(kMaxStoredBlock, scanlineBytes - offset);
+        bool last = offset + length == scanlineBytes;
+        idat.push_back(last ? 1 : 0); // BFINAL, BTYPE 00
+        idat.push_back(static_cast<unsigned char>(length));
+        idat.push_back(static_cast<unsigned char>(length >> 8));
+        idat.push_back(static_cast<unsigned char>(~length));
+        idat.push_back(static_cast<unsigned char>(~length >> 8));
+        idat.insert(idat.end(), scanlines.begin() + offset, scanlines.begin() + offset + length);
+    }
+    putBigEndian(idat, adler32(1, scanlines.data(), scanlineBytes));
+
+    std::vector<unsigned char> ihdr;
+    putBigEndian(ihdr, static_cast<uint32_t>(width));
+    putBigEndian(ihdr, static_cast<uint32_t>(height));
+    ihdr.push_back(8); // Bits per channel
+    ihdr.push_back(6); // RGBA
+    ihdr.push_back(0); // Deflate
+    ihdr.push_back(0); // Adaptive filtering
+    ihdr.push_back(0); // Not interlaced
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Cannot create " << path << std::endl;
+        return false;
+    }
+    static const unsigned char kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    file.write(reinterpret_cast<const char*>(kSignature), sizeof(kSignature));
+    writeChunk(file, "IHDR", ihdr);
+    writeChunk(file, "IDAT", idat);
+    writeChunk(file, "IEND", {});
+    if (!file) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ImageWriter::writeRaw(const std::string& path, int width, int height, const unsigned char* pixels, bool bottomUp) {
+    if (width <= 0 || height <= 0 || !pixels) {
+        return false;
+    }
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Cannot create " << path << std::endl;
+        return false;
+    }
+    std::streamsize stride = static_cast<std::streamsize>(width) * 4;
+    if (bottomUp) {
+        for (int y = 0; y < height; ++y) {
+            file.write(reinterpret_cast<const char*>(rowAt(pixels, width, height, y, true)), stride);
+        }
+    } else {
+        file.write(reinterpret_cast<const char*>(pixels), stride * height);
+    }
+    if (!file) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
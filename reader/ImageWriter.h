@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+// Writes processed RGBA8 frames to disk (the batch exporter's encoders).
+// Rows are given bottom row first, as glReadPixels returns them, or top row
+// first; files always hold the top row first.
+//
+// PNG image data is written as deflate "stored" blocks: the tree carries no
+// zlib, and skipping compression keeps encoding at memory speed, so export
+// throughput stays bound by the GPU. The files are about the size of the raw
+// pixels; recompress them offline if size matters.
+class ImageWriter {
+public:
+    static bool writePng(const std::string& path, int width, int height, const unsigned char* pixels, bool bottomUp);
+
+    // The bare pixels, width * height * 4 bytes
+    static bool writeRaw(const std::string& path, int width, int height, const unsigned char* pixels, bool bottomUp);
+};
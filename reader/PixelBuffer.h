@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+// Move-only owner of a block of decoded pixels.
+// The buffer keeps whichever allocation the decoder produced (e.g. the malloc'd
+// block returned by stb_image) and hands it back through a release callback,
+// so decoded frames never have to be copied into a separate container.
+class PixelBuffer {
+public:
+    // Called with the pointer, its size and the context passed at construction
+    using ReleaseFn = void (*)(unsigned char* ptr, size_t size, void* context);
+
+    PixelBuffer() : ptr(nullptr), bytes(0), release(nullptr), context(nullptr) {}
+
+    // Take ownership of ptr; release (if any) is invoked when the buffer is destroyed
+    PixelBuffer(unsigned char* ptr, size_t size, ReleaseFn release, void* context = nullptr)
+        : ptr(ptr), bytes(size), release(release), context(context) {}
+
+    // Allocate an uninitialized buffer from the shared BufferPool (empty on failure)
+    static PixelBuffer allocate(size_t size);
+
+    ~PixelBuffer() { reset(); }
+
+    PixelBuffer(PixelBuffer&& other) noexcept
+        : ptr(other.ptr), bytes(other.bytes), release(other.release), context(other.context) {
+        other.detach();
+    }
+
+    PixelBuffer& operator=(PixelBuffer&& other) noexcept {
+        if (this != &other) {
+            reset();
+            ptr = other.ptr;
+            bytes = other.bytes;
+            release = other.release;
+            context = other.context;
+            other.detach();
+        }
+        return *this;
+    }
+
+    PixelBuffer(const PixelBuffer&) = delete;
+    PixelBuffer& operator=(const PixelBuffer&) = delete;
+
+    unsigned char* data() { return ptr; }
+    const unsigned char* data() const { return ptr; }
+    size_t size() const { return bytes; }
+    bool empty() const { return ptr == nullptr || bytes == 0; }
+
+    // Free the pixels now
+    void reset() {
+        if (ptr && release) {
+            release(ptr, bytes, context);
+        }
+        detach();
+    }
+
+private:
+    unsigned char* ptr;
+    size_t bytes;
+    ReleaseFn release;
+    void* context;
+
+    void detach() {
+        ptr = nullptr;
+        bytes = 0;
+        release = nullptr;
+        context = nullptr;
+    }
+};
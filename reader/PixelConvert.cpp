@@ -0,0 +1,483 @@
+#include "PixelConvert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PIXELCONVERT_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit SSSE3/AVX2 instructions in functions that ask for them;
+// MSVC accepts the intrinsics anywhere
+#if defined(PIXELCONVERT_X86) && !defined(_MSC_VER)
+#define PIXELCONVERT_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PIXELCONVERT_TARGET(isa)
+#endif
+
+using ExpandFn = void (*)(const unsigned char* src, size_t pixelCount, unsigned char* dst);
+
+static void expandGreyScalar(const unsigned char* src, size_t pixelCount, unsigned char* dst) {
+    for (size_t i = 0; i < pixelCount; ++i) {
+        dst[0] = dst[1] = dst[2] = src[i];
+        dst[3] = 255;
+        dst += 4;
+    }
+}
+
+static void expandRGBScalar(const unsigned char* src, size_t pixelCount, unsigned char* dst) {
+    for (size_t i = 0; i < pixelCount; ++i) {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = 255;
+        src += 3;
+        dst += 4;
+    }
+}
+
+#ifdef PIXELCONVERT_X86
+
+// 16 grey pixels per iteration: interleave each byte with itself twice, then set alpha
+static void expandGreySSE2(const unsigned char* src, size_t pixelCount, unsigned char* dst) {
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000u));
+    size_t i = 0;
+    for (; i + 16 <= pixelCount; i += 16) {
+        __m128i grey = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i pairsLo = _mm_unpacklo_epi8(grey, grey);
+        __m128i pairsHi = _mm_unpackhi_epi8(grey, grey);
+        __m128i* out = reinterpret_cast<__m128i*>(dst + i * 4);
+        _mm_storeu_si128(out + 0, _mm_or_si128(_mm_unpacklo_epi16(pairsLo, pairsLo), alpha));
+        _mm_storeu_si128(out + 1, _mm_or_si128(_mm_unpackhi_epi16(pairsLo, pairsLo), alpha));
+        _mm_storeu_si128(out + 2, _mm_or_si128(_mm_unpacklo_epi16(pairsHi, pairsHi), alpha));
+        _mm_storeu_si128(out + 3, _mm_or_si128(_mm_unpackhi_epi16(pairsHi, pairsHi), alpha));
+    }
+    expandGreyScalar(src + i, pixelCount - i, dst + i * 4);
+}
+
+// 4 pixels per shuffle: spread 12 RGB bytes into 16 RGBA bytes, then set alpha
+PIXELCONVERT_TARGET("ssse3")
+static void expandRGBSSSE3(const unsigned char* src, size_t pixelCount, unsigned char* dst) {
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000u));
+    size_t i = 0;
+    // Each load reads 16 bytes but consumes 12, so stop while 16 are still in bounds
+    for (; i + 6 <= pixelCount; i += 4) {
+        __m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+        __m128i rgba = _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), rgba);
+    }
+    expandRGBScalar(src + i * 3, pixelCount - i, dst + i * 4);
+}
+
+// 8 pixels per iteration: move each 12-byte group into its own 128-bit lane,
+// then shuffle both lanes at once
+PIXELCONVERT_TARGET("avx2")
+static void expandRGBAVX2(const unsigned char* src, size_t pixelCount, unsigned char* dst) {
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0);
+    const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                             0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xff000000u));
+    size_t i = 0;
+    // Each load reads 32 bytes but consumes 24
+    for (; i + 11 <= pixelCount; i += 8) {
+        __m256i rgb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 3));
+        __m256i grouped = _mm256_permutevar8x32_epi32(rgb, lanes);
+        __m256i rgba = _mm256_or_si256(_mm256_shuffle_epi8(grouped, shuffle), alpha);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), rgba);
+    }
+    expandRGBSSSE3(src + i * 3, pixelCount - i, dst + i * 4);
+}
+
+// CPUID feature checks (AVX2 also needs the OS to save YMM state)
+static bool cpuSupports(bool avx2) {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool ssse3 = (info[2] & (1 << 9)) != 0;
+    if (!avx2) {
+        return ssse3;
+    }
+    bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    if (!osSavesYmm || maxLeaf < 7) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return avx2 ? __builtin_cpu_supports("avx2") : __builtin_cpu_supports("ssse3");
+#endif
+}
+
+#endif // PIXELCONVERT_X86
+
+// Pick the widest kernel the CPU supports, once
+static ExpandFn selectRGBKernel() {
+#ifdef PIXELCONVERT_X86
+    if (cpuSupports(true)) {
+        return &expandRGBAVX2;
+    }
+    if (cpuSupports(false)) {
+        return &expandRGBSSSE3;
+    }
+#endif
+    return &expandRGBScalar;
+}
+
+static ExpandFn selectGreyKernel() {
+#ifdef PIXELCONVERT_X86
+    return &expandGreySSE2; // SSE2 is baseline on x64
+#else
+    return &expandGreyScalar;
+#endif
+}
+
+void PixelConvert::expandToRGBA(const unsigned char* src, int channels, size_t pixelCount, unsigned char* dst) {
+    static const ExpandFn expandGrey = selectGreyKernel();
+    static const ExpandFn expandRGB = selectRGBKernel();
+
+    switch (channels) {
+        case 1:
+            expandGrey(src, pixelCount, dst);
+            break;
+        case 3:
+            expandRGB(src, pixelCount, dst);
+            break;
+        case 4:
+            memcpy(dst, src, pixelCount * 4);
+            break;
+        default:
+            break;
+    }
+}
+
+const char* PixelConvert::getKernelName() {
+    ExpandFn kernel = selectRGBKernel();
+#ifdef PIXELCONVERT_X86
+    if (kernel == &expandRGBAVX2) {
+        return "AVX2";
+    }
+    if (kernel == &expandRGBSSSE3) {
+        return "SSSE3";
+    }
+#endif
+    return kernel == &expandRGBScalar ? "scalar" : "unknown";
+}
+
+// Average 2x2 blocks of two source rows into one row of outWidth pixels
+static void halveRowScalar(const unsigned char* row0, const unsigned char* row1, int channels,
+                           size_t outWidth, unsigned char* dst) {
+    for (size_t x = 0; x < outWidth; ++x) {
+        for (int c = 0; c < channels; ++c) {
+            unsigned sum = row0[c] + row0[c + channels] + row1[c] + row1[c + channels];
+            dst[c] = static_cast<unsigned char>((sum + 2) >> 2);
+        }
+        row0 += channels * 2;
+        row1 += channels * 2;
+        dst += channels;
+    }
+}
+
+static void halveRowRGBA(const unsigned char* row0, const unsigned char* row1, size_t outWidth, unsigned char* dst) {
+    size_t x = 0;
+#ifdef PIXELCONVERT_X86
+    // 4 output pixels per iteration: average the rows, then the even and odd pixels
+    for (; x + 4 <= outWidth; x += 4) {
+        const __m128i* top = reinterpret_cast<const __m128i*>(row0 + x * 8);
+        const __m128i* bottom = reinterpret_cast<const __m128i*>(row1 + x * 8);
+        __m128 lo = _mm_castsi128_ps(_mm_avg_epu8(_mm_loadu_si128(top), _mm_loadu_si128(bottom)));
+        __m128 hi = _mm_castsi128_ps(_mm_avg_epu8(_mm_loadu_si128(top + 1), _mm_loadu_si128(bottom + 1)));
+        __m128i even = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i odd = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_avg_epu8(even, odd));
+    }
+#endif
+    halveRowScalar(row0 + x * 8, row1 + x * 8, 4, outWidth - x, dst + x * 4);
+}
+
+bool PixelConvert::halve(const ImageData& source, ImageData& out) {
+    if (!source.isValid() || source.compression != BlockFormat::None || source.isPlanar() ||
+        source.sampleFormat != SampleFormat::UNorm8 ||
+        source.channels < 1 || source.channels > 4 ||
+        source.width < 2 || source.height < 2) {
+        return false;
+    }
+
+    int width = source.width / 2;
+    int height = source.height / 2;
+    int channels = source.channels;
+    size_t srcStride = static_cast<size_t>(source.width) * channels;
+    size_t dstStride = static_cast<size_t>(width) * channels;
+    PixelBuffer pixels = PixelBuffer::allocate(dstStride * height);
+    if (pixels.empty()) {
+        return false;
+    }
+    for (int y = 0; y < height; ++y) {
+        const unsigned char* row0 = source.data.data() + srcStride * (y * 2);
+        const unsigned char* row1 = row0 + srcStride;
+        unsigned char* dst = pixels.data() + dstStride * y;
+        if (channels == 4) {
+            halveRowRGBA(row0, row1, width, dst);
+        } else {
+            halveRowScalar(row0, row1, channels, width, dst);
+        }
+    }
+    out = ImageData(width, height, channels, std::move(pixels));
+    return true;
+}
+
+bool PixelConvert::reduceToProxy(const ImageData& source, int targetWidth, int targetHeight, ImageData& out) {
+    if (targetWidth <= 0 || targetHeight <= 0 ||
+        source.width / 2 < targetWidth || source.height / 2 < targetHeight) {
+        return false;
+    }
+
+    if (!halve(source, out)) {
+        return false;
+    }
+    while (out.width / 2 >= targetWidth && out.height / 2 >= targetHeight) {
+        ImageData smaller;
+        if (!halve(out, smaller)) {
+            break;
+        }
+        out = std::move(smaller);
+    }
+    return true;
+}
+
+bool PixelConvert::toRGBA(const ImageData& source, ImageData& out) {
+    if (!source.isValid() || source.compression != BlockFormat::None || source.isPlanar() ||
+        source.sampleFormat != SampleFormat::UNorm8 ||
+        (source.channels != 1 && source.channels != 3 && source.channels != 4)) {
+        return false;
+    }
+
+    size_t pixelCount = static_cast<size_t>(source.width) * source.height;
+    PixelBuffer pixels = PixelBuffer::allocate(pixelCount * 4);
+    if (pixels.empty()) {
+        return false;
+    }
+    expandToRGBA(source.data.data(), source.channels, pixelCount, pixels.data());
+    out = ImageData(source.width, source.height, 4, std::move(pixels));
+    return true;
+}
+
+// Half float nearest to a non-negative float below 65504
+static uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int exponent = static_cast<int>((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = (bits & 0x7fffff) | 0x800000;
+    if (exponent <= 0) {
+        // Subnormal half: shift the full mantissa down to units of 2^-24
+        int shift = 14 - exponent;
+        if (shift > 24) {
+            return 0;
+        }
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1))) {
+            ++half;
+        }
+        return static_cast<uint16_t>(half);
+    }
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | ((mantissa & 0x7fffff) >> 13);
+    uint32_t remainder = mantissa & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+        ++half; // A carry into the exponent is still the correctly rounded value
+    }
+    return static_cast<uint16_t>(half);
+}
+
+void PixelConvert::unorm16ToHalf(const uint16_t* src, size_t count, uint16_t* dst) {
+    // Every 16-bit sample has one answer, so build the table once instead of
+    // converting through float per sample
+    static const std::vector<uint16_t> table = [] {
+        std::vector<uint16_t> values(65536);
+        for (uint32_t i = 0; i < values.size(); ++i) {
+            values[i] = floatToHalf(static_cast<float>(i) / 65535.0f);
+        }
+        return values;
+    }();
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = table[src[i]];
+    }
+}
+
+bool PixelConvert::convertChannels(const ImageData& source, int channels, ImageData& out) {
+    if (!source.isValid() || source.compression != BlockFormat::None || source.isPlanar() ||
+        source.sampleFormat != SampleFormat::UNorm8 ||
+        source.channels < 1 || source.channels > 4 || (channels != 1 && channels != 3 && channels != 4)) {
+        return false;
+    }
+    if ((source.channels == 1 || source.channels == 3) && channels == 4) {
+        return toRGBA(source, out); // The vectorized expansion
+    }
+
+    size_t pixelCount = static_cast<size_t>(source.width) * source.height;
+    PixelBuffer pixels = PixelBuffer::allocate(pixelCount * channels);
+    if (pixels.empty()) {
+        return false;
+    }
+    const unsigned char* src = source.data.data();
+    unsigned char* dst = pixels.data();
+    int sourceChannels = source.channels;
+    for (size_t i = 0; i < pixelCount; ++i, src += sourceChannels, dst += channels) {
+        // Grey sources (1 or 2 channels) replicate their one colour sample
+        unsigned char r = src[0];
+        unsigned char g = sourceChannels >= 3 ? src[1] : src[0];
+        unsigned char b = sourceChannels >= 3 ? src[2] : src[0];
+        unsigned char a = sourceChannels == 2 ? src[1] : sourceChannels == 4 ? src[3] : 255;
+        if (channels == 1) {
+            dst[0] = static_cast<unsigned char>((r * 77 + g * 150 + b * 29 + 128) >> 8);
+        } else {
+            dst[0] = r;
+            dst[1] = g;
+            dst[2] = b;
+            if (channels == 4) {
+                dst[3] = a;
+            }
+        }
+    }
+    out = ImageData(source.width, source.height, channels, std::move(pixels));
+    return true;
+}
+
+bool PixelConvert::toHalfRGBA(const ImageData& source, ImageData& out) {
+    ImageData rgba;
+    const ImageData* frame = &source;
+    if (source.channels != 4) {
+        if (!convertChannels(source, 4, rgba)) {
+            return false;
+        }
+        frame = &rgba;
+    } else if (!source.isValid() || source.compression != BlockFormat::None || source.isPlanar() ||
+               source.sampleFormat != SampleFormat::UNorm8) {
+        return false;
+    }
+
+    // Widen to 16 bits (v * 257 maps 255 to 65535), then through the half table in place
+    size_t count = static_cast<size_t>(frame->width) * frame->height * 4;
+    PixelBuffer samples = PixelBuffer::allocate(count * sizeof(uint16_t));
+    if (samples.empty()) {
+        return false;
+    }
+    uint16_t* dst = reinterpret_cast<uint16_t*>(samples.data());
+    const unsigned char* src = frame->data.data();
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = static_cast<uint16_t>(src[i] * 257);
+    }
+    unorm16ToHalf(dst, count, dst);
+    out = ImageData(frame->width, frame->height, 4, std::move(samples), BlockFormat::None, SampleFormat::Float16);
+    return true;
+}
+
+bool PixelConvert::resize(const ImageData& source, int width, int height, ImageData& out) {
+    if (!source.isValid() || source.compression != BlockFormat::None || source.isPlanar() ||
+        source.sampleFormat != SampleFormat::UNorm8 ||
+        source.channels < 1 || source.channels > 4 || width <= 0 || height <= 0) {
+        return false;
+    }
+
+    // Bilinear, sampling at pixel centres, in 8-bit fixed point weights.
+    // Horizontal taps are computed once for all rows.
+    int channels = source.channels;
+    struct Tap {
+        size_t offset;  // Byte offset of the left sample in a row
+        unsigned weight; // Of the right sample, 0-256
+    };
+    std::vector<Tap> taps(width);
+    for (int x = 0; x < width; ++x) {
+        float position = (x + 0.5f) * source.width / width - 0.5f;
+        int left = std::min(std::max(static_cast<int>(std::floor(position)), 0), source.width - 1);
+        float fraction = std::min(std::max(position - left, 0.0f), 1.0f);
+        taps[x].offset = static_cast<size_t>(left) * channels;
+        taps[x].weight = left + 1 < source.width ? static_cast<unsigned>(fraction * 256.0f + 0.5f) : 0;
+    }
+
+    size_t srcStride = static_cast<size_t>(source.width) * channels;
+    PixelBuffer pixels = PixelBuffer::allocate(static_cast<size_t>(width) * height * channels);
+    if (pixels.empty()) {
+        return false;
+    }
+    unsigned char* dst = pixels.data();
+    for (int y = 0; y < height; ++y) {
+        float position = (y + 0.5f) * source.height / height - 0.5f;
+        int top = std::min(std::max(static_cast<int>(std::floor(position)), 0), source.height - 1);
+        float fraction = std::min(std::max(position - top, 0.0f), 1.0f);
+        unsigned wy = top + 1 < source.height ? static_cast<unsigned>(fraction * 256.0f + 0.5f) : 0;
+        const unsigned char* row0 = source.data.data() + srcStride * top;
+        const unsigned char* row1 = wy ? row0 + srcStride : row0;
+        for (int x = 0; x < width; ++x) {
+            const unsigned char* a = row0 + taps[x].offset;
+            const unsigned char* b = row1 + taps[x].offset;
+            unsigned wx = taps[x].weight;
+            size_t next = wx ? channels : 0;
+            for (int c = 0; c < channels; ++c) {
+                unsigned upper = a[c] * (256 - wx) + a[c + next] * wx;
+                unsigned lower = b[c] * (256 - wx) + b[c + next] * wx;
+                *dst++ = static_cast<unsigned char>((upper * (256 - wy) + lower * wy + 32768) >> 16);
+            }
+        }
+    }
+    out = ImageData(width, height, channels, std::move(pixels));
+    return true;
+}
+
+size_t PixelConvert::yuvSize(int width, int height) {
+    size_t lumaSize = static_cast<size_t>(width) * height;
+    return lumaSize + lumaSize / 2;
+}
+
+static unsigned char clampByte(int value) {
+    return static_cast<unsigned char>(std::min(std::max(value, 0), 255));
+}
+
+bool PixelConvert::yuvToRGBA(const ImageData& source, ImageData& out) {
+    if (!source.isValid() || !source.isPlanar() || source.width % 2 != 0 || source.height % 2 != 0 ||
+        source.data.size() != yuvSize(source.width, source.height)) {
+        return false;
+    }
+
+    // Chroma sample of pixel (x, y): interleaved U,V pairs for NV12, separate planes for I420
+    size_t lumaSize = static_cast<size_t>(source.width) * source.height;
+    const unsigned char* luma = source.data.data();
+    const unsigned char* chromaU = luma + lumaSize;
+    const unsigned char* chromaV = source.planes == PlaneFormat::NV12 ? chromaU + 1 : chromaU + lumaSize / 4;
+    size_t chromaStride = source.planes == PlaneFormat::NV12 ? source.width : source.width / 2;
+    size_t chromaStep = source.planes == PlaneFormat::NV12 ? 2 : 1;
+
+    // Video-range BT.709 in 8.8 fixed point, the matrix shaders/yuv.frag applies
+    PixelBuffer pixels = PixelBuffer::allocate(lumaSize * 4);
+    if (pixels.empty()) {
+        return false;
+    }
+    unsigned char* dst = pixels.data();
+    for (int y = 0; y < source.height; ++y) {
+        const unsigned char* row = luma + static_cast<size_t>(y) * source.width;
+        size_t chromaRow = static_cast<size_t>(y / 2) * chromaStride;
+        for (int x = 0; x < source.width; ++x) {
+            size_t chroma = chromaRow + static_cast<size_t>(x / 2) * chromaStep;
+            int c = 298 * (row[x] - 16) + 128;
+            int u = chromaU[chroma] - 128;
+            int v = chromaV[chroma] - 128;
+            *dst++ = clampByte((c + 459 * v) >> 8);
+            *dst++ = clampByte((c - 55 * u - 136 * v) >> 8);
+            *dst++ = clampByte((c + 541 * u) >> 8);
+            *dst++ = 255;
+        }
+    }
+    out = ImageData(source.width, source.height, 4, std::move(pixels));
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "ImageLoader.h"
+
+// Pixel layout conversions applied before upload.
+// The expansion kernels are picked once at runtime from the CPU's features
+// (AVX2 / SSSE3 shuffles for RGB, SSE2 unpacks for grey, scalar otherwise).
+class PixelConvert {
+public:
+    // Expand tightly packed 1- or 3-channel pixels to RGBA with opaque alpha
+    // (grey is replicated to RGB). 4-channel input is copied unchanged.
+    static void expandToRGBA(const unsigned char* src, int channels, size_t pixelCount, unsigned char* dst);
+
+    // Convert 16-bit unsigned normalized samples to IEEE half floats
+    // (round to nearest, through a table). src and dst may be the same buffer.
+    static void unorm16ToHalf(const uint16_t* src, size_t count, uint16_t* dst);
+
+    // Convert an uncompressed 8-bit frame to 4-channel RGBA
+    static bool toRGBA(const ImageData& source, ImageData& out);
+
+    // Convert an uncompressed 8-bit frame to 1, 3 or 4 channels. Grey is
+    // replicated to RGB and missing alpha is opaque; fewer channels drop
+    // alpha (and colour, to the Rec. 601 luma, for 1 channel).
+    static bool convertChannels(const ImageData& source, int channels, ImageData& out);
+
+    // Convert an uncompressed 8-bit frame to RGBA half floats
+    static bool toHalfRGBA(const ImageData& source, ImageData& out);
+
+    // Resample an uncompressed 8-bit frame to width x height (bilinear)
+    static bool resize(const ImageData& source, int width, int height, ImageData& out);
+
+    // Halve an uncompressed 8-bit frame in both dimensions with a 2x2 box filter
+    // (an odd last row or column is dropped). RGBA uses SSE2 averages.
+    static bool halve(const ImageData& source, ImageData& out);
+
+    // Proxy tier for display at targetWidth x targetHeight: halve the frame for
+    // as long as the result still covers the target, so the GPU never has to
+    // minify by more than 2x. Returns false if the frame is already small enough.
+    static bool reduceToProxy(const ImageData& source, int targetWidth, int targetHeight, ImageData& out);
+
+    // Bytes of a 4:2:0 YUV frame of even size (a full-size Y plane, quarter-size U and V)
+    static size_t yuvSize(int width, int height);
+
+    // Convert an NV12 or I420 frame to RGBA8 with video-range BT.709, for
+    // uploads that cannot take planes (each 2x2 block shares its chroma sample)
+    static bool yuvToRGBA(const ImageData& source, ImageData& out);
+
+    // Name of the RGB expansion kernel selected for this CPU
+    static const char* getKernelName();
+};
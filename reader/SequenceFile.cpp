@@ -0,0 +1,271 @@
+#include "SequenceFile.h"
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+
+#include <cstring>
+#include "BlockCompressor.h"
+#include <filesystem>
+#include <iostream>
+
+// On-disk structures (little-endian, naturally aligned)
+struct SequenceHeader {
+    char magic[4];           // "SDSQ"
+    uint32_t version;
+    uint32_t frameCount;
+    uint32_t payloadAlignment;
+    uint64_t tableOffset;    // SequenceFrameRecord[frameCount]
+    uint64_t namesOffset;    // Concatenated frame names
+    uint64_t namesSize;
+};
+
+struct SequenceFrameRecord {
+    int32_t width;
+    int32_t height;
+    int32_t channels;
+    uint32_t format;         // BlockFormat
+    uint64_t offset;         // Payload position from the start of the file
+    uint64_t size;
+    uint32_t nameOffset;     // Position in the names block
+    uint32_t nameLength;
+};
+
+static const char kSequenceMagic[4] = {'S', 'D', 'S', 'Q'};
+static const uint32_t kSequenceVersion = 2; // 2: rows stored top-down
+
+// Payload bytes a record's size must equal, so no upload reads past its frame
+static bool hasExpectedSize(const SequenceFrameRecord& record, BlockFormat format) {
+    // Far beyond any texture size, and the block count cannot overflow
+    const int32_t maxSide = 1 << 16;
+    if (record.width > maxSide || record.height > maxSide ||
+        (record.channels != 1 && record.channels != 3 && record.channels != 4)) {
+        return false;
+    }
+    uint64_t expected = format == BlockFormat::None
+        ? static_cast<uint64_t>(record.width) * static_cast<uint64_t>(record.height) * record.channels
+        : BlockCompressor::compressedSize(format, record.width, record.height);
+    return record.size == expected;
+}
+
+SequenceFile::SequenceFile()
+    : file(INVALID_HANDLE_VALUE), mapping(nullptr), view(nullptr), viewSize(0) {
+}
+
+SequenceFile::~SequenceFile() {
+    close();
+}
+
+bool SequenceFile::open(const std::string& path) {
+    close();
+
+    file = CreateFileW(std::filesystem::path(path).wstring().c_str(), GENERIC_READ, FILE_SHARE_READ,
+                       NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to open sequence file: " << path << std::endl;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(SequenceHeader))) {
+        std::cerr << "Sequence file is too small: " << path << std::endl;
+        close();
+        return false;
+    }
+    viewSize = static_cast<uint64_t>(fileSize.QuadPart);
+
+    mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) {
+        std::cerr << "Failed to map sequence file: " << path << " (error " << GetLastError() << ")" << std::endl;
+        close();
+        return false;
+    }
+    view = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!view) {
+        std::cerr << "Failed to map sequence file: " << path << " (error " << GetLastError() << ")" << std::endl;
+        close();
+        return false;
+    }
+
+    SequenceHeader header;
+    memcpy(&header, view, sizeof(header));
+    uint64_t tableSize = static_cast<uint64_t>(header.frameCount) * sizeof(SequenceFrameRecord);
+    if (memcmp(header.magic, kSequenceMagic, sizeof(header.magic)) != 0 || header.version != kSequenceVersion ||
+        header.tableOffset > viewSize || tableSize > viewSize - header.tableOffset ||
+        header.namesOffset > viewSize || header.namesSize > viewSize - header.namesOffset) {
+        std::cerr << "Not a valid sequence file: " << path << std::endl;
+        close();
+        return false;
+    }
+
+    const char* nameData = reinterpret_cast<const char*>(view + header.namesOffset);
+    entries.reserve(header.frameCount);
+    names.reserve(header.frameCount);
+    for (uint32_t i = 0; i < header.frameCount; ++i) {
+        SequenceFrameRecord record;
+        memcpy(&record, view + header.tableOffset + i * sizeof(SequenceFrameRecord), sizeof(record));
+
+        BlockFormat format = static_cast<BlockFormat>(record.format);
+        bool validFormat = format == BlockFormat::None || format == BlockFormat::BC1 || format == BlockFormat::BC3;
+        if (!validFormat || record.width <= 0 || record.height <= 0 || !hasExpectedSize(record, format) ||
+            record.offset > viewSize || record.size > viewSize - record.offset ||
+            static_cast<uint64_t>(record.nameOffset) + record.nameLength > header.namesSize) {
+            std::cerr << "Corrupt frame table entry " << i << " in " << path << std::endl;
+            close();
+            return false;
+        }
+
+        Entry entry;
+        entry.width = record.width;
+        entry.height = record.height;
+        entry.channels = record.channels;
+        entry.compression = format;
+        entry.offset = record.offset;
+        entry.size = record.size;
+        entries.push_back(entry);
+        names.emplace_back(nameData + record.nameOffset, record.nameLength);
+    }
+    return true;
+}
+
+void SequenceFile::close() {
+    if (view) {
+        UnmapViewOfFile(view);
+        view = nullptr;
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+        mapping = nullptr;
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+    }
+    viewSize = 0;
+    entries.clear();
+    names.clear();
+}
+
+bool SequenceFile::getFrame(size_t index, ImageData& image) const {
+    if (!view || index >= entries.size()) {
+        return false;
+    }
+
+    // No release callback: the pixels belong to the mapping
+    const Entry& entry = entries[index];
+    unsigned char* pixels = const_cast<unsigned char*>(view + entry.offset);
+    image = ImageData(entry.width, entry.height, entry.channels,
+                      PixelBuffer(pixels, static_cast<size_t>(entry.size), nullptr), entry.compression);
+    return true;
+}
+
+SequenceWriter::SequenceWriter() {
+}
+
+SequenceWriter::~SequenceWriter() {
+    if (out.is_open()) {
+        // finish() was never called: do not leave a file without a frame table behind
+        out.close();
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+}
+
+bool SequenceWriter::create(const std::string& outputPath) {
+    path = outputPath;
+    entries.clear();
+    out.open(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to create sequence file: " << path << std::endl;
+        return false;
+    }
+
+    // Placeholder header; rewritten by finish()
+    SequenceHeader header = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    return padToAlignment();
+}
+
+bool SequenceWriter::padToAlignment() {
+    static const char zeros[SequenceFile::kPayloadAlignment] = {};
+    uint64_t position = static_cast<uint64_t>(out.tellp());
+    uint64_t padding = (SequenceFile::kPayloadAlignment - position % SequenceFile::kPayloadAlignment) %
+                       SequenceFile::kPayloadAlignment;
+    out.write(zeros, static_cast<std::streamsize>(padding));
+    return static_cast<bool>(out);
+}
+
+bool SequenceWriter::writeFrame(const std::string& name, const ImageData& image) {
+    if (!out.is_open() || !image.isValid()) {
+        return false;
+    }
+    if (image.sampleFormat != SampleFormat::UNorm8) {
+        std::cerr << "Sequence files hold 8-bit frames only, skipping " << name << std::endl;
+        return false;
+    }
+    if (image.planes != PlaneFormat::Interleaved) {
+        std::cerr << "Sequence files hold interleaved frames only, skipping " << name << std::endl;
+        return false;
+    }
+
+    Entry entry;
+    entry.width = image.width;
+    entry.height = image.height;
+    entry.channels = image.channels;
+    entry.compression = image.compression;
+    entry.offset = static_cast<uint64_t>(out.tellp());
+    entry.size = image.data.size();
+    entry.name = name;
+
+    out.write(reinterpret_cast<const char*>(image.data.data()), static_cast<std::streamsize>(image.data.size()));
+    if (!padToAlignment()) {
+        std::cerr << "Failed to write frame " << name << " to " << path << std::endl;
+        return false;
+    }
+    entries.push_back(std::move(entry));
+    return true;
+}
+
+bool SequenceWriter::finish() {
+    if (!out.is_open()) {
+        return false;
+    }
+
+    SequenceHeader header;
+    memcpy(header.magic, kSequenceMagic, sizeof(header.magic));
+    header.version = kSequenceVersion;
+    header.frameCount = static_cast<uint32_t>(entries.size());
+    header.payloadAlignment = SequenceFile::kPayloadAlignment;
+    header.tableOffset = static_cast<uint64_t>(out.tellp());
+
+    uint32_t nameOffset = 0;
+    for (const auto& entry : entries) {
+        SequenceFrameRecord record;
+        record.width = entry.width;
+        record.height = entry.height;
+        record.channels = entry.channels;
+        record.format = static_cast<uint32_t>(entry.compression);
+        record.offset = entry.offset;
+        record.size = entry.size;
+        record.nameOffset = nameOffset;
+        record.nameLength = static_cast<uint32_t>(entry.name.size());
+        out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        nameOffset += record.nameLength;
+    }
+
+    header.namesOffset = static_cast<uint64_t>(out.tellp());
+    header.namesSize = nameOffset;
+    for (const auto& entry : entries) {
+        out.write(entry.name.data(), static_cast<std::streamsize>(entry.name.size()));
+    }
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+    if (out.fail()) {
+        std::cerr << "Failed to finish sequence file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "ImageLoader.h"
+
+// Packed, pre-decoded image sequence (.sdseq).
+//
+// Layout: a fixed header, then each frame's pixel payload (raw 8-bit pixels or
+// BC1/BC3 blocks) starting on a kPayloadAlignment boundary, then the frame table
+// and the frame names. The table sits at the end so the writer can stream
+// frames without knowing their sizes up front.
+//
+// SequenceFile maps the whole file read-only; frames are handed out as
+// ImageData views into the mapping, so opening a sequence costs no decode and
+// no heap copy, and pages are read in only when a frame is first touched.
+class SequenceFile {
+public:
+    static const uint32_t kPayloadAlignment = 4096;
+
+    SequenceFile();
+    ~SequenceFile();
+
+    SequenceFile(const SequenceFile&) = delete;
+    SequenceFile& operator=(const SequenceFile&) = delete;
+
+    // Map a sequence file and validate its frame table
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return view != nullptr; }
+
+    size_t getFrameCount() const { return entries.size(); }
+    const std::string& getFrameName(size_t index) const { return names[index]; }
+
+    // Fill image with a non-owning view of frame index. The view stays valid
+    // until the file is closed and must not be written to.
+    bool getFrame(size_t index, ImageData& image) const;
+
+private:
+    struct Entry {
+        int width;
+        int height;
+        int channels;
+        BlockFormat compression;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    void* file;     // HANDLE of the open file
+    void* mapping;  // HANDLE of the file mapping
+    const unsigned char* view;
+    uint64_t viewSize;
+    std::vector<Entry> entries;
+    std::vector<std::string> names;
+};
+
+// Writes a .sdseq file one frame at a time
+class SequenceWriter {
+public:
+    SequenceWriter();
+    ~SequenceWriter();
+
+    bool create(const std::string& path);
+
+    // Append a decoded (or block-compressed) frame
+    bool writeFrame(const std::string& name, const ImageData& image);
+
+    // Write the frame table and header. The file is incomplete until this succeeds.
+    bool finish();
+
+    size_t getFrameCount() const { return entries.size(); }
+
+private:
+    struct Entry {
+        int width;
+        int height;
+        int channels;
+        BlockFormat compression;
+        uint64_t offset;
+        uint64_t size;
+        std::string name;
+    };
+
+    std::ofstream out;
+    std::string path;
+    std::vector<Entry> entries;
+
+    bool padToAlignment();
+};
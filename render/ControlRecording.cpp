@@ -0,0 +1,161 @@
+#include "ControlRecording.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include "Renderer.h"
+#include "../computeRenderer/ComputePipeline.h"
+
+static const char* const kActionNames[] = { "pause", "step-forward", "step-back", "seek", "scrub", "features", "lut", "quit" };
+
+static bool takesValue(ControlAction action) {
+    return action == ControlAction::Seek || action == ControlAction::Scrub || action == ControlAction::ToggleFeatures;
+}
+
+void ControlRecording::start() {
+    startTime = std::chrono::steady_clock::now();
+    events.clear();
+}
+
+void ControlRecording::record(int window, ControlAction action, long long value) {
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    events.push_back({ seconds, window, action, value });
+}
+
+bool ControlRecording::save(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Cannot write control recording " << path << std::endl;
+        return false;
+    }
+    file << "# seconds window action [value]" << std::endl;
+    file << std::fixed << std::setprecision(4);
+    for (const ControlEvent& event : events) {
+        file << event.seconds << " " << event.window << " " << getActionName(event.action);
+        if (takesValue(event.action)) {
+            file << " " << event.value;
+        }
+        file << std::endl;
+    }
+    if (!file) {
+        std::cerr << "Failed to write control recording " << path << std::endl;
+        return false;
+    }
+    std::cout << "Recorded " << events.size() << " control events to " << path << std::endl;
+    return true;
+}
+
+bool ControlRecording::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot read control recording " << path << std::endl;
+        return false;
+    }
+    events.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        std::istringstream fields(line.substr(0, line.find('#')));
+        ControlEvent event = { 0.0, 0, ControlAction::Quit, 0 };
+        std::string action;
+        if (!(fields >> event.seconds)) {
+            continue; // Blank or comment
+        }
+        bool ok = (fields >> event.window >> action) && parseAction(action, event.action);
+        ok = ok && (!takesValue(event.action) || (fields >> event.value));
+        std::string extra;
+        if (!ok || (fields >> extra) || !std::isfinite(event.seconds) || event.seconds < 0.0 || event.window < 0) {
+            std::cerr << path << ":" << lineNumber << ": expected <seconds> <window> <action> [value]" << std::endl;
+            events.clear();
+            return false;
+        }
+        events.push_back(event);
+    }
+    // Events of several windows may have been written out of order by hand
+    std::stable_sort(events.begin(), events.end(),
+                     [](const ControlEvent& a, const ControlEvent& b) { return a.seconds < b.seconds; });
+    // Replays end at a quit; one written without it gets one after the last
+    // event, so that event's effect is drawn and measured as well
+    if (!events.empty() && events.back().action != ControlAction::Quit) {
+        events.push_back({ events.back().seconds + kTrailingSeconds, 0, ControlAction::Quit, 0 });
+    }
+    return true;
+}
+
+void ControlRecording::apply(const ControlEvent& event, Renderer& renderer, ComputePipeline* computePipeline) {
+    switch (event.action) {
+    case ControlAction::TogglePause:
+        renderer.togglePause();
+        break;
+    case ControlAction::StepForward:
+        renderer.stepForward();
+        break;
+    case ControlAction::StepBackward:
+        renderer.stepBackward();
+        break;
+    case ControlAction::Seek:
+        renderer.seek(static_cast<size_t>(std::max(event.value, 0LL))); // Clamped to the sequence by the renderer
+        break;
+    case ControlAction::Scrub:
+        renderer.scrub(event.value);
+        break;
+    case ControlAction::ToggleFeatures:
+        if (computePipeline) {
+            computePipeline->setTintFeatures(computePipeline->getTintFeatures() ^
+                                             static_cast<ShaderVariants::Key>(event.value));
+            renderer.invalidate(); // Show the change while paused too
+        }
+        break;
+    case ControlAction::CycleLut:
+        renderer.cycleLut();
+        break;
+    case ControlAction::Quit:
+        break;
+    }
+}
+
+const char* ControlRecording::getActionName(ControlAction action) {
+    return kActionNames[static_cast<int>(action)];
+}
+
+bool ControlRecording::parseAction(const std::string& name, ControlAction& action) {
+    for (int i = 0; i < static_cast<int>(sizeof(kActionNames) / sizeof(kActionNames[0])); ++i) {
+        if (name == kActionNames[i]) {
+            action = static_cast<ControlAction>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+ControlReplay::ControlReplay(const ControlRecording& recording)
+    : events(recording.getEvents()), next(0), startTime(std::chrono::steady_clock::now()) {
+}
+
+void ControlReplay::start() {
+    next = 0;
+    startTime = std::chrono::steady_clock::now();
+}
+
+const ControlEvent* ControlReplay::takeDue() {
+    if (next >= events.size() || events[next].seconds > elapsedSeconds()) {
+        return nullptr;
+    }
+    return &events[next++];
+}
+
+DWORD ControlReplay::getWaitMilliseconds() const {
+    if (next >= events.size()) {
+        return INFINITE;
+    }
+    double remaining = events[next].seconds - elapsedSeconds();
+    return remaining > 0.0 ? static_cast<DWORD>(std::ceil(remaining * 1000.0)) : 0;
+}
+
+double ControlReplay::elapsedSeconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <Windows.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+class Renderer;
+class ComputePipeline;
+
+// A playback control as the window procedure gives it to a renderer
+enum class ControlAction {
+    TogglePause,
+    StepForward,
+    StepBackward,
+    Seek,           // value = target frame
+    Scrub,          // value = frames to move (negative = back)
+    ToggleFeatures, // value = compute tint feature bits to flip (see ComputePipeline::setTintFeatures)
+    CycleLut,       // Grade with the next configured LUT (see Renderer::cycleLut)
+    Quit            // The session ended here
+};
+
+struct ControlEvent {
+    double seconds;        // Since the recording started
+    int window;            // Output the control went to (its position in the window list)
+    ControlAction action;
+    long long value;
+};
+
+// Controls given during a session, timestamped, so the session can be played
+// back exactly (see ControlReplay), e.g. to reproduce a latency problem that
+// only shows with a particular pattern of steps and seeks. Files hold one
+// event per line, "<seconds> <window> <action> [value]", with '#' comments.
+class ControlRecording {
+public:
+    // Start the clock the events are timed by (drops earlier events)
+    void start();
+    // Record a control given now
+    void record(int window, ControlAction action, long long value = 0);
+
+    bool save(const std::string& path) const;
+    // Read a file written by save(); false, naming the line, on malformed
+    // input. A recording that does not end with quit gets one kTrailingSeconds
+    // after its last event.
+    bool load(const std::string& path);
+    static constexpr double kTrailingSeconds = 1.0;
+
+    const std::vector<ControlEvent>& getEvents() const { return events; }
+    bool isEmpty() const { return events.empty(); }
+
+    // Give a control to a renderer (and its compute pipeline, if any, for
+    // feature toggles); Quit is left to the caller
+    static void apply(const ControlEvent& event, Renderer& renderer, ComputePipeline* computePipeline);
+
+    // "pause", "step-forward", "step-back", "seek", "scrub", "features", "lut" or "quit"
+    static const char* getActionName(ControlAction action);
+    static bool parseAction(const std::string& name, ControlAction& action);
+
+private:
+    std::chrono::steady_clock::time_point startTime;
+    std::vector<ControlEvent> events;
+};
+
+// Plays a recording back in real time: each event is due at its timestamp
+// after start(), so the controls reach the renderers at the same points of
+// the session as when they were recorded.
+class ControlReplay {
+public:
+    explicit ControlReplay(const ControlRecording& recording);
+
+    void start();
+
+    // The next event once it is due (null before then, or when all were taken)
+    const ControlEvent* takeDue();
+    // Milliseconds until the next event is due (INFINITE once all were taken)
+    DWORD getWaitMilliseconds() const;
+    bool isFinished() const { return next >= events.size(); }
+
+private:
+    std::vector<ControlEvent> events;
+    size_t next;
+    std::chrono::steady_clock::time_point startTime;
+
+    double elapsedSeconds() const;
+};
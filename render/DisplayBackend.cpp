@@ -0,0 +1,243 @@
+#include "DisplayBackend.h"
+
+#include <Windows.h>
+#include <dxgi.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+const struct {
+    const char* name;
+    DisplayBackend::Api api;
+    DisplayBackend::Device device;
+} backendNames[] = {
+    { "default", DisplayBackend::Api::Default, DisplayBackend::Device::Hardware },
+    { "d3d11", DisplayBackend::Api::D3D11, DisplayBackend::Device::Hardware },
+    { "d3d11-warp", DisplayBackend::Api::D3D11, DisplayBackend::Device::Warp },
+    { "d3d9", DisplayBackend::Api::D3D9, DisplayBackend::Device::Hardware },
+    { "vulkan", DisplayBackend::Api::Vulkan, DisplayBackend::Device::Hardware },
+    { "vulkan-swiftshader", DisplayBackend::Api::Vulkan, DisplayBackend::Device::SwiftShader },
+    { "gl", DisplayBackend::Api::OpenGL, DisplayBackend::Device::Hardware },
+};
+
+// LUID of the index-th DXGI adapter, logged with its description
+bool findAdapter(int index, LUID& luid) {
+    IDXGIFactory1* factory = nullptr;
+    if (FAILED(CreateDXGIFactory1(__uuidof(IDXGIFactory1), reinterpret_cast<void**>(&factory)))) {
+        return false;
+    }
+    IDXGIAdapter1* adapter = nullptr;
+    bool found = SUCCEEDED(factory->EnumAdapters1(static_cast<UINT>(index), &adapter));
+    if (found) {
+        DXGI_ADAPTER_DESC1 desc;
+        found = SUCCEEDED(adapter->GetDesc1(&desc));
+        if (found) {
+            luid = desc.AdapterLuid;
+            std::wcout << L"Adapter " << index << L": " << desc.Description << std::endl;
+        }
+        adapter->Release();
+    }
+    factory->Release();
+    return found;
+}
+
+// ANGLE matches feature names ignoring case and underscores, so the
+// snake_case names of the json files and the camelCase ones it reports are equal
+std::string normalizeFeatureName(const std::string& name) {
+    std::string normalized;
+    for (char c : name) {
+        if (c != '_') {
+            normalized += static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        }
+    }
+    return normalized;
+}
+
+// Null-terminated name list for an EGL_FEATURE_OVERRIDES_*_ANGLE attribute
+std::vector<const char*> featureList(const std::vector<std::string>& names) {
+    std::vector<const char*> list;
+    for (const std::string& name : names) {
+        list.push_back(name.c_str());
+    }
+    list.push_back(nullptr);
+    return list;
+}
+
+} // namespace
+
+bool DisplayBackend::parse(const std::string& name, DisplayBackend& backend) {
+    for (const auto& entry : backendNames) {
+        if (name == entry.name) {
+            backend.api = entry.api;
+            backend.device = entry.device;
+            return true;
+        }
+    }
+    std::cerr << "Unknown backend: " << name << " (use default, d3d11, d3d11-warp, d3d9, vulkan, vulkan-swiftshader or gl)" << std::endl;
+    return false;
+}
+
+std::vector<int> DisplayBackend::findHardwareAdapters() {
+    std::vector<int> adapters;
+    IDXGIFactory1* factory = nullptr;
+    if (FAILED(CreateDXGIFactory1(__uuidof(IDXGIFactory1), reinterpret_cast<void**>(&factory)))) {
+        return adapters;
+    }
+    IDXGIAdapter1* adapter = nullptr;
+    for (UINT i = 0; SUCCEEDED(factory->EnumAdapters1(i, &adapter)); ++i) {
+        DXGI_ADAPTER_DESC1 desc;
+        if (SUCCEEDED(adapter->GetDesc1(&desc)) && !(desc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE)) {
+            adapters.push_back(static_cast<int>(i));
+        }
+        adapter->Release();
+    }
+    factory->Release();
+    return adapters;
+}
+
+std::string DisplayBackend::getName() const {
+    std::string name = "default";
+    for (const auto& entry : backendNames) {
+        if (entry.api == api && entry.device == device) {
+            name = entry.name;
+            break;
+        }
+    }
+    return adapterIndex >= 0 ? name + ":" + std::to_string(adapterIndex) : name;
+}
+
+bool DisplayBackend::loadFeatureOverrides(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot read feature overrides from " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string action, feature, extra;
+        if (!(words >> action)) {
+            continue; // Blank or comment
+        }
+        if (!(words >> feature) || (words >> extra) || (action != "enable" && action != "disable")) {
+            std::cerr << path << ":" << lineNumber << ": expected \"enable <feature>\" or \"disable <feature>\"" << std::endl;
+            return false;
+        }
+        (action == "enable" ? enabledFeatures : disabledFeatures).push_back(feature);
+    }
+    std::cout << "Feature overrides from " << path << ": " << enabledFeatures.size() << " enabled, "
+              << disabledFeatures.size() << " disabled" << std::endl;
+    return true;
+}
+
+EGLDisplay DisplayBackend::open(EGLNativeDisplayType nativeDisplay) const {
+    bool overrides = !enabledFeatures.empty() || !disabledFeatures.empty();
+    if (api == Api::Default && adapterIndex < 0 && !overrides) {
+        return eglGetDisplay(nativeDisplay);
+    }
+
+    // Resolved at run time like the other extension entry points; the client
+    // extension string says whether ANGLE's platform is there at all. The
+    // EGL 1.5 entry point takes EGLAttrib, wide enough for the feature lists' pointers.
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYPROC>(eglGetProcAddress("eglGetPlatformDisplay"));
+    if (!getPlatformDisplay || !clientExtensions || !strstr(clientExtensions, "EGL_ANGLE_platform_angle")) {
+        std::cerr << "EGL_ANGLE_platform_angle not available, cannot select the " << getName() << " backend" << std::endl;
+        return EGL_NO_DISPLAY;
+    }
+    if (overrides && !strstr(clientExtensions, "EGL_ANGLE_feature_control")) {
+        std::cout << "EGL_ANGLE_feature_control not available, feature overrides ignored" << std::endl;
+        overrides = false;
+    }
+
+    std::vector<EGLAttrib> attribs;
+    switch (api) {
+    case Api::Default:
+        // An adapter needs a D3D renderer, and ANGLE's default one is D3D11
+        attribs.insert(attribs.end(), { EGL_PLATFORM_ANGLE_TYPE_ANGLE, adapterIndex >= 0 ? EGL_PLATFORM_ANGLE_TYPE_D3D11_ANGLE
+                                                                                        : EGL_PLATFORM_ANGLE_TYPE_DEFAULT_ANGLE });
+        break;
+    case Api::D3D11: attribs.insert(attribs.end(), { EGL_PLATFORM_ANGLE_TYPE_ANGLE, EGL_PLATFORM_ANGLE_TYPE_D3D11_ANGLE }); break;
+    case Api::D3D9: attribs.insert(attribs.end(), { EGL_PLATFORM_ANGLE_TYPE_ANGLE, EGL_PLATFORM_ANGLE_TYPE_D3D9_ANGLE }); break;
+    case Api::Vulkan: attribs.insert(attribs.end(), { EGL_PLATFORM_ANGLE_TYPE_ANGLE, EGL_PLATFORM_ANGLE_TYPE_VULKAN_ANGLE }); break;
+    case Api::OpenGL: attribs.insert(attribs.end(), { EGL_PLATFORM_ANGLE_TYPE_ANGLE, EGL_PLATFORM_ANGLE_TYPE_OPENGL_ANGLE }); break;
+    }
+    if (device == Device::Warp) {
+        attribs.insert(attribs.end(), { EGL_PLATFORM_ANGLE_DEVICE_TYPE_ANGLE, EGL_PLATFORM_ANGLE_DEVICE_TYPE_D3D_WARP_ANGLE });
+    } else if (device == Device::SwiftShader) {
+        attribs.insert(attribs.end(), { EGL_PLATFORM_ANGLE_DEVICE_TYPE_ANGLE, EGL_PLATFORM_ANGLE_DEVICE_TYPE_SWIFTSHADER_ANGLE });
+    }
+
+    // ANGLE's D3D renderers take the adapter as a LUID; the other backends pick their own device
+    if (adapterIndex >= 0) {
+        LUID luid;
+        if (api != Api::Default && api != Api::D3D11 && api != Api::D3D9) {
+            std::cout << "Adapter selection applies to the D3D backends only, ignored for " << getName() << std::endl;
+        } else if (!findAdapter(adapterIndex, luid)) {
+            std::cerr << "No DXGI adapter " << adapterIndex << std::endl;
+            return EGL_NO_DISPLAY;
+        } else {
+            attribs.insert(attribs.end(), { EGL_PLATFORM_ANGLE_D3D_LUID_HIGH_ANGLE, static_cast<EGLAttrib>(luid.HighPart),
+                                            EGL_PLATFORM_ANGLE_D3D_LUID_LOW_ANGLE, static_cast<EGLAttrib>(luid.LowPart) });
+        }
+    }
+
+    // The lists only have to live until the display is created
+    std::vector<const char*> enabled = featureList(enabledFeatures);
+    std::vector<const char*> disabled = featureList(disabledFeatures);
+    if (overrides) {
+        attribs.insert(attribs.end(), { EGL_FEATURE_OVERRIDES_ENABLED_ANGLE, reinterpret_cast<EGLAttrib>(enabled.data()),
+                                        EGL_FEATURE_OVERRIDES_DISABLED_ANGLE, reinterpret_cast<EGLAttrib>(disabled.data()) });
+    }
+    attribs.push_back(EGL_NONE);
+
+    EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_ANGLE_ANGLE, reinterpret_cast<void*>(nativeDisplay), attribs.data());
+    if (display == EGL_NO_DISPLAY) {
+        std::cerr << "Failed to get the " << getName() << " EGL display" << std::endl;
+    }
+    return display;
+}
+
+void DisplayBackend::logFeatures(EGLDisplay display, std::ostream& out) const {
+    auto queryDisplayAttrib = reinterpret_cast<PFNEGLQUERYDISPLAYATTRIBANGLEPROC>(eglGetProcAddress("eglQueryDisplayAttribANGLE"));
+    auto queryStringi = reinterpret_cast<PFNEGLQUERYSTRINGIANGLEPROC>(eglGetProcAddress("eglQueryStringiANGLE"));
+    EGLAttrib count = 0;
+    if (!queryDisplayAttrib || !queryStringi || !queryDisplayAttrib(display, EGL_FEATURE_COUNT_ANGLE, &count)) {
+        out << "ANGLE features: not queryable (no EGL_ANGLE_feature_control)" << std::endl;
+        return;
+    }
+
+    std::vector<std::string> known;
+    out << "ANGLE features enabled:";
+    for (EGLint i = 0; i < static_cast<EGLint>(count); ++i) {
+        const char* name = queryStringi(display, EGL_FEATURE_NAME_ANGLE, i);
+        const char* status = queryStringi(display, EGL_FEATURE_STATUS_ANGLE, i);
+        if (!name) {
+            continue;
+        }
+        known.push_back(normalizeFeatureName(name));
+        if (status && strcmp(status, "enabled") == 0) {
+            const char* category = queryStringi(display, EGL_FEATURE_CATEGORY_ANGLE, i);
+            out << " " << name << (category ? std::string(" (") + category + ")" : "");
+        }
+    }
+    out << std::endl;
+
+    // A misspelled override is silently ignored by ANGLE
+    for (const auto* names : { &enabledFeatures, &disabledFeatures }) {
+        for (const std::string& name : *names) {
+            if (std::find(known.begin(), known.end(), normalizeFeatureName(name)) == known.end()) {
+                out << "Feature override " << name << " does not match any feature of this backend" << std::endl;
+            }
+        }
+    }
+}
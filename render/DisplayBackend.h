@@ -0,0 +1,49 @@
+#pragma once
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Which ANGLE backend and device the renderer's EGL display runs on. The
+// default lets ANGLE pick (D3D11 on the hardware adapter); the others go
+// through eglGetPlatformDisplayEXT so each GPU can use its fastest backend.
+struct DisplayBackend {
+    enum class Api { Default, D3D11, D3D9, Vulkan, OpenGL };
+    enum class Device { Hardware, Warp, SwiftShader };
+
+    Api api = Api::Default;
+    Device device = Device::Hardware;  // Warp: D3D11 only, SwiftShader: Vulkan only
+    int adapterIndex = -1;              // DXGI adapter for the D3D backends; -1 = ANGLE's choice
+
+    // ANGLE features (workarounds and optimizations, see
+    // thirdparty/angle/include/platform/*_features.json) forced on or off
+    // with EGL_FEATURE_OVERRIDES_ENABLED/DISABLED_ANGLE
+    std::vector<std::string> enabledFeatures;
+    std::vector<std::string> disabledFeatures;
+
+    // Read overrides from a text file with one "enable <feature>" or
+    // "disable <feature>" per line; '#' starts a comment. Returns false if the
+    // file cannot be read or has a malformed line.
+    bool loadFeatureOverrides(const std::string& path);
+
+    // "default", "d3d11", "d3d11-warp", "d3d9", "vulkan", "vulkan-swiftshader"
+    // or "gl". Returns false for other names.
+    static bool parse(const std::string& name, DisplayBackend& backend);
+
+    // DXGI indices of the hardware adapters (software ones such as the Basic
+    // Render Driver left out), e.g. to spread work over every GPU of a machine
+    static std::vector<int> findHardwareAdapters();
+
+    // The name parse() accepts, plus ":<adapter>" when one was chosen
+    std::string getName() const;
+
+    // Display for nativeDisplay (a window DC or EGL_DEFAULT_DISPLAY).
+    // Returns EGL_NO_DISPLAY if the backend or adapter is unavailable.
+    EGLDisplay open(EGLNativeDisplayType nativeDisplay) const;
+
+    // Print the features the initialized display has enabled, warning about
+    // overrides that name no feature of the backend (needs EGL_ANGLE_feature_control)
+    void logFeatures(EGLDisplay display, std::ostream& out) const;
+};
@@ -0,0 +1,286 @@
+#include "FragmentPipeline.h"
+#include "GpuTrace.h"
+#include "ShaderProgram.h"
+
+#include <iostream>
+
+FragmentPipeline::FragmentPipeline()
+    : shaderReloader(nullptr), frameStats(nullptr), quad(nullptr), gles3(false),
+      shaderProgram(0), uTextureLocation(-1), displayShaderId(-1),
+      arrayShaderProgram(0), uFramesLocation(-1), uLayerLocation(-1), arrayShaderId(-1),
+      yuvShaderProgram(0), uChromaSelectLocation(-1), yuvShaderId(-1),
+      lutShaderProgram(0), uLutScaleLocation(-1), uLutOffsetLocation(-1), lutShaderId(-1),
+      timingMode(TimingMode::Off) {
+}
+
+void FragmentPipeline::addShaders(ShaderReloader& reloader) {
+    // Each program is rebuilt from its (vertex, fragment) files when either changes
+    auto build = [](const std::vector<std::string>& sources) {
+        return ShaderProgram::create(sources[0].c_str(), sources[1].c_str());
+    };
+    displayShaderId = reloader.addProgram({"display.vert", "display.frag"}, build);
+    arrayShaderId = reloader.addProgram({"array.vert", "array.frag"}, build);
+    yuvShaderId = reloader.addProgram({"display.vert", "yuv.frag"}, build);
+    lutShaderId = reloader.addProgram({"array.vert", "lut.frag"}, build);
+}
+
+bool FragmentPipeline::initialize(PipelineSetup& setup) {
+    shaderReloader = setup.shaderReloader;
+    frameStats = setup.frameStats;
+    quad = setup.quad;
+    gles3 = setup.gles3;
+
+    // Create shader program from the shader files
+    GLuint program = loadShaderProgram(displayShaderId, vertexShaderSource, fragmentShaderSource);
+    if (!program) {
+        std::cerr << "Failed to create shader program" << std::endl;
+        return false;
+    }
+    setDisplayProgram(program);
+
+    // YUV planes are R8/RG8 textures, which only ES3 uploads (see TextureUploader::enablePlanarUploads)
+    if (gles3) {
+        program = loadShaderProgram(yuvShaderId, vertexShaderSource, yuvFragmentShaderSource);
+        if (!program) {
+            std::cerr << "Failed to create the YUV shader program" << std::endl;
+            return false;
+        }
+        setYuvProgram(program);
+
+        // Built up front, so selecting a LUT later never compiles anything;
+        // without it frames are drawn ungraded
+        program = loadShaderProgram(lutShaderId, arrayVertexShaderSource, lutFragmentShaderSource);
+        if (program) {
+            setLutProgram(program);
+        } else {
+            std::cerr << "Failed to create the LUT shader program, LUTs are not applied" << std::endl;
+        }
+    }
+
+    // GPU timer queries for non-blocking frame timing
+    timingMode = setup.timingMode;
+    if (timingMode == TimingMode::GpuTimer && !gpuTimer.initialize()) {
+        std::cout << "GL_EXT_disjoint_timer_query not available, frame timing disabled" << std::endl;
+        timingMode = TimingMode::Off;
+    }
+    setup.timingMode = timingMode;
+
+    checkGLError("FragmentPipeline::initialize");
+    return true;
+}
+
+void FragmentPipeline::destroy() {
+    gpuTimer.destroy();
+    luts.destroy();
+    if (lutShaderProgram) {
+        glDeleteProgram(lutShaderProgram);
+        lutShaderProgram = 0;
+    }
+    if (yuvShaderProgram) {
+        glDeleteProgram(yuvShaderProgram);
+        yuvShaderProgram = 0;
+    }
+    if (arrayShaderProgram) {
+        glDeleteProgram(arrayShaderProgram);
+        arrayShaderProgram = 0;
+    }
+    if (shaderProgram) {
+        glDeleteProgram(shaderProgram);
+        shaderProgram = 0;
+    }
+}
+
+bool FragmentPipeline::enableTextureArrays() {
+    // Texture arrays need ES3; without them every frame gets its own texture
+    if (gles3 && !arrayShaderProgram) {
+        GLuint program = loadShaderProgram(arrayShaderId, arrayVertexShaderSource, arrayFragmentShaderSource);
+        if (program) {
+            setArrayProgram(program);
+        }
+    }
+    return arrayShaderProgram != 0;
+}
+
+GLuint FragmentPipeline::loadShaderProgram(int shaderId, const char* builtInVertex, const char* builtInFragment) {
+    std::vector<std::string> sources;
+    if (shaderReloader->readSources(shaderId, sources)) {
+        GLuint program = ShaderProgram::create(sources[0].c_str(), sources[1].c_str());
+        if (program) {
+            return program;
+        }
+        std::cerr << "Shader files in " << shaderReloader->getDirectory() << " failed to build, using built-in shaders" << std::endl;
+    }
+    return ShaderProgram::create(builtInVertex, builtInFragment);
+}
+
+void FragmentPipeline::setDisplayProgram(GLuint program) {
+    if (shaderProgram && shaderProgram != program) {
+        glDeleteProgram(shaderProgram);
+    }
+    shaderProgram = program;
+    uTextureLocation = glGetUniformLocation(shaderProgram, "uTexture");
+    glUseProgram(shaderProgram);
+    glUniform1i(uTextureLocation, 0);
+    glUseProgram(0);
+}
+
+void FragmentPipeline::setArrayProgram(GLuint program) {
+    if (arrayShaderProgram && arrayShaderProgram != program) {
+        glDeleteProgram(arrayShaderProgram);
+    }
+    arrayShaderProgram = program;
+    uFramesLocation = glGetUniformLocation(arrayShaderProgram, "uFrames");
+    uLayerLocation = glGetUniformLocation(arrayShaderProgram, "uLayer");
+    glUseProgram(arrayShaderProgram);
+    glUniform1i(uFramesLocation, 0);
+    glUseProgram(0);
+}
+
+void FragmentPipeline::setYuvProgram(GLuint program) {
+    if (yuvShaderProgram && yuvShaderProgram != program) {
+        glDeleteProgram(yuvShaderProgram);
+    }
+    yuvShaderProgram = program;
+    uChromaSelectLocation = glGetUniformLocation(yuvShaderProgram, "uChromaSelect");
+    glUseProgram(yuvShaderProgram);
+    glUniform1i(glGetUniformLocation(yuvShaderProgram, "uTexture"), 0);
+    glUniform1i(glGetUniformLocation(yuvShaderProgram, "uChromaU"), 1);
+    glUniform1i(glGetUniformLocation(yuvShaderProgram, "uChromaV"), 2);
+    glUseProgram(0);
+}
+
+void FragmentPipeline::setLutProgram(GLuint program) {
+    if (lutShaderProgram && lutShaderProgram != program) {
+        glDeleteProgram(lutShaderProgram);
+    }
+    lutShaderProgram = program;
+    uLutScaleLocation = glGetUniformLocation(lutShaderProgram, "uLutScale");
+    uLutOffsetLocation = glGetUniformLocation(lutShaderProgram, "uLutOffset");
+    glUseProgram(lutShaderProgram);
+    glUniform1i(glGetUniformLocation(lutShaderProgram, "uTexture"), 0);
+    glUniform1i(glGetUniformLocation(lutShaderProgram, "uLut"), 1);
+    glUseProgram(0);
+}
+
+bool FragmentPipeline::applyReloadedShaders() {
+    bool reloaded = false;
+    GLuint program = 0;
+    if (shaderReloader->takeProgram(displayShaderId, program)) {
+        setDisplayProgram(program);
+        reloaded = true;
+    }
+    if (shaderReloader->takeProgram(arrayShaderId, program)) {
+        // The array program only exists while the sequence is resident as a texture array
+        if (arrayShaderProgram) {
+            setArrayProgram(program);
+            reloaded = true;
+        } else {
+            glDeleteProgram(program);
+        }
+    }
+    if (shaderReloader->takeProgram(yuvShaderId, program)) {
+        // Only built on ES3
+        if (yuvShaderProgram) {
+            setYuvProgram(program);
+            reloaded = true;
+        } else {
+            glDeleteProgram(program);
+        }
+    }
+    if (shaderReloader->takeProgram(lutShaderId, program)) {
+        // Only built on ES3 as well
+        if (lutShaderProgram) {
+            setLutProgram(program);
+            reloaded = luts.hasSelection() || reloaded;
+        } else {
+            glDeleteProgram(program);
+        }
+    }
+    return reloaded;
+}
+
+void FragmentPipeline::render(const PipelineFrame& frame, const PipelineOutput& output) {
+    bool fromArray = frame.target == GL_TEXTURE_2D_ARRAY;
+    bool planar = frame.planes != PlaneFormat::Interleaved;
+    // The LUT is taken up (and uploaded, the first time) with the frame it grades
+    const LutTexture* lut = !fromArray && !planar && lutShaderProgram ? luts.getSelected() : nullptr;
+    GLuint program = fromArray ? arrayShaderProgram : planar ? yuvShaderProgram : lut ? lutShaderProgram : shaderProgram;
+    if (!program || !frame.texture) {
+        return;
+    }
+    TRACE_GPU_ZONE("Draw frame");
+
+    // The frame is drawn straight at the output size; the sampler filters it
+    glViewport(output.x, output.y, output.width, output.height);
+
+    // Use the shader program
+    glUseProgram(program);
+
+    // Bind the frame texture; the sampler uniforms were set to unit 0 (and 1
+    // and 2 for chroma) when the programs were linked
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(frame.target, frame.texture);
+    if (fromArray) {
+        glUniform1f(uLayerLocation, static_cast<float>(frame.layer));
+    }
+    if (planar) {
+        // NV12 has one chroma texture, read for both U (red) and V (green)
+        bool nv12 = frame.planes == PlaneFormat::NV12;
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, frame.chromaTextures[0]);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, frame.chromaTextures[nv12 ? 0 : 1]);
+        glActiveTexture(GL_TEXTURE0);
+        glUniform2f(uChromaSelectLocation, nv12 ? 0.0f : 1.0f, nv12 ? 1.0f : 0.0f);
+    }
+    if (lut) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_3D, lut->texture);
+        glActiveTexture(GL_TEXTURE0);
+        glUniform3fv(uLutScaleLocation, 1, lut->scale);
+        glUniform3fv(uLutOffsetLocation, 1, lut->offset);
+    }
+
+    // Precise profiling forces a GPU sync around the draw; the default timer
+    // query mode measures on the GPU without draining the pipeline
+    if (timingMode == TimingMode::Precise) {
+        glFinish();
+    }
+    auto drawStartTime = std::chrono::high_resolution_clock::now();
+    if (timingMode == TimingMode::GpuTimer) {
+        gpuTimer.begin();
+    }
+
+    quad->draw();
+
+    if (timingMode == TimingMode::GpuTimer) {
+        gpuTimer.end();
+    } else if (timingMode == TimingMode::Precise) {
+        // 确保所有渲染完成
+        glFinish();
+    }
+
+    // Unbind shader program
+    glUseProgram(0);
+
+    if (timingMode == TimingMode::Precise) {
+        recordRenderTime(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - drawStartTime).count());
+    } else if (timingMode == TimingMode::GpuTimer) {
+        // Results arrive a few frames late; drain whatever the GPU has finished
+        double gpuTime;
+        while (gpuTimer.collect(gpuTime)) {
+            recordRenderTime(gpuTime);
+        }
+    }
+
+    checkGLError("FragmentPipeline::render");
+}
+
+void FragmentPipeline::addGpuAllocations(std::vector<GpuAllocation>& allocations) const {
+    allocations.push_back({ "LUTs", luts.getMemoryBytes() });
+}
+
+void FragmentPipeline::recordRenderTime(double renderTime) {
+    frameStats->record(FrameStage::Draw, renderTime);
+    TRACE_GPU_TIME("Draw frame", renderTime);
+}
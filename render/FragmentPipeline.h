@@ -0,0 +1,158 @@
+#pragma once
+
+#include <chrono>
+#include "LutCache.h"
+#include "RenderPipeline.h"
+
+// Draws the frame straight to the back buffer with the display program
+// (shaders/display.vert/.frag), or with shaders/array.vert/.frag for a layer
+// of a resident texture array. Runs on ES 2.0 and 3.x. YUV frames are
+// converted to RGB by shaders/display.vert + yuv.frag as they are drawn
+// (ES3). RGBA frames can be graded with a 3D LUT as they are drawn
+// (shaders/array.vert + lut.frag, ES3); YUV frames and layers of a resident
+// array are drawn ungraded. The compute pipeline uses it for its final draw as well.
+class FragmentPipeline : public RenderPipeline {
+public:
+    FragmentPipeline();
+
+    const char* getName() const override { return "fragment"; }
+    int getMinimumClientVersion() const override { return 2; }
+    bool supportsPlanarFrames() const override { return true; }
+    bool supportsResidentFrames() const override { return true; }
+    bool enableTextureArrays() override;
+
+    void addShaders(ShaderReloader& reloader) override;
+    bool initialize(PipelineSetup& setup) override;
+    void destroy() override;
+    bool applyReloadedShaders() override;
+    void render(const PipelineFrame& frame, const PipelineOutput& output) override;
+    void setLut(const std::string& path) override { luts.select(path); }
+    void addGpuAllocations(std::vector<GpuAllocation>& allocations) const override;
+
+    // Vertex shader of the display program, for fragment effects that draw the same quad
+    const char* getVertexShaderSource() const { return vertexShaderSource; }
+
+private:
+    ShaderReloader* shaderReloader;
+    FrameStats* frameStats;
+    FullscreenQuad* quad;
+    bool gles3;
+
+    // Display program and its sampler location, cached after linking
+    GLuint shaderProgram;
+    GLint uTextureLocation;
+    int displayShaderId;
+
+    // Program that samples a layer of a resident array texture (ES3)
+    GLuint arrayShaderProgram;
+    GLint uFramesLocation;
+    GLint uLayerLocation;
+    int arrayShaderId;
+
+    // Program that converts the planes of a YUV frame (ES3)
+    GLuint yuvShaderProgram;
+    GLint uChromaSelectLocation;
+    int yuvShaderId;
+
+    // Program that draws the frame through the selected LUT (ES3), and the LUTs it samples
+    GLuint lutShaderProgram;
+    GLint uLutScaleLocation;
+    GLint uLutOffsetLocation;
+    int lutShaderId;
+    LutCache luts;
+
+    // Performance measurement
+    TimingMode timingMode;
+    GpuTimer gpuTimer;
+
+    // Built-in shader sources, used when shaders/ has no file for a program
+    const char* vertexShaderSource = R"(
+        attribute vec4 aPosition;
+        attribute vec2 aTexCoord;
+        varying vec2 vTexCoord;
+        void main() {
+            gl_Position = aPosition;
+            vTexCoord = aTexCoord;
+        }
+    )";
+
+    const char* fragmentShaderSource = R"(
+        precision mediump float;
+        varying vec2 vTexCoord;
+        uniform sampler2D uTexture;
+        void main() {
+            gl_FragColor = texture2D(uTexture, vTexCoord);
+        }
+    )";
+
+    const char* yuvFragmentShaderSource = R"(
+        precision mediump float;
+        varying vec2 vTexCoord;
+        uniform sampler2D uTexture;   // Y plane
+        uniform sampler2D uChromaU;   // U plane (I420), or the interleaved U,V pairs (NV12)
+        uniform sampler2D uChromaV;   // V plane (I420), or the U,V pairs again (NV12)
+        uniform vec2 uChromaSelect;   // Picks V from uChromaV: (1, 0) for I420, (0, 1) for NV12
+
+        // 4:2:0 YUV frames converted to RGB while drawing: video-range BT.709
+        // (Y 16-235, chroma 16-240). The half-size chroma planes are filtered up to
+        // the luma resolution by the samplers.
+        void main() {
+            vec3 yuv = vec3(texture2D(uTexture, vTexCoord).r,
+                            texture2D(uChromaU, vTexCoord).r,
+                            dot(texture2D(uChromaV, vTexCoord).rg, uChromaSelect));
+            yuv -= vec3(0.0627451, 0.5019608, 0.5019608);
+            vec3 rgb = mat3(1.1643836, 1.1643836, 1.1643836,
+                            0.0, -0.2132486, 2.1124018,
+                            1.7927411, -0.5329093, 0.0) * yuv;
+            gl_FragColor = vec4(clamp(rgb, 0.0, 1.0), 1.0);
+        }
+    )";
+
+    // ES3 shaders for resident sequences: the frame is a layer of a 2D array texture
+    const char* arrayVertexShaderSource = R"(#version 300 es
+        in vec4 aPosition;
+        in vec2 aTexCoord;
+        out vec2 vTexCoord;
+        void main() {
+            gl_Position = aPosition;
+            vTexCoord = aTexCoord;
+        }
+    )";
+
+    const char* arrayFragmentShaderSource = R"(#version 300 es
+        precision mediump float;
+        precision mediump sampler2DArray;
+        in vec2 vTexCoord;
+        uniform sampler2DArray uFrames;
+        uniform float uLayer;
+        out vec4 fragColor;
+        void main() {
+            fragColor = texture(uFrames, vec3(vTexCoord, uLayer));
+        }
+    )";
+
+    // ES3 grading with a 3D LUT; drawn with arrayVertexShaderSource
+    const char* lutFragmentShaderSource = R"(#version 300 es
+        precision mediump float;
+        precision mediump sampler3D;
+        in vec2 vTexCoord;
+        uniform sampler2D uTexture;
+        uniform sampler3D uLut;
+        uniform vec3 uLutScale;   // Maps a color in the LUT's domain to texel centers
+        uniform vec3 uLutOffset;
+        out vec4 fragColor;
+        // One trilinear lookup replaces the whole grade; alpha is kept
+        void main() {
+            vec4 color = texture(uTexture, vTexCoord);
+            fragColor = vec4(texture(uLut, color.rgb * uLutScale + uLutOffset).rgb, color.a);
+        }
+    )";
+
+    GLuint loadShaderProgram(int shaderId, const char* builtInVertex, const char* builtInFragment);
+    void setDisplayProgram(GLuint program);
+    void setArrayProgram(GLuint program);
+    void setYuvProgram(GLuint program);
+    void setLutProgram(GLuint program);
+    // Add one draw time sample
+    void recordRenderTime(double renderTime);
+};
@@ -0,0 +1,100 @@
+#include "FrameBatch.h"
+
+#include <algorithm>
+#include <iostream>
+#include "../reader/BlockCompressor.h"
+#include "../reader/PixelConvert.h"
+#include "TextureUploader.h"
+
+FrameBatch::FrameBatch() : texture(0), width(0), height(0), layers(0), capacity(0), count(0) {
+}
+
+void FrameBatch::begin(int frames) {
+    capacity = std::max(frames, 1);
+    count = 0;
+}
+
+bool FrameBatch::add(const ImageData& image) {
+    if (isFull() || !image.isValid() || image.sampleFormat != SampleFormat::UNorm8) {
+        return false;
+    }
+    if (count > 0 && (image.width != width || image.height != height)) {
+        return false; // Starts the next batch instead
+    }
+
+    // The layers are RGBA8 whatever the frame is stored as
+    ImageData converted;
+    const ImageData* pixels = &image;
+    if (image.compression != BlockFormat::None) {
+        if (!BlockCompressor::decompress(image, converted)) {
+            std::cerr << "Failed to decompress block-compressed frame" << std::endl;
+            return false;
+        }
+        pixels = &converted;
+    } else if (image.isPlanar()) {
+        if (!PixelConvert::yuvToRGBA(image, converted)) {
+            std::cerr << "Failed to convert YUV frame" << std::endl;
+            return false;
+        }
+        pixels = &converted;
+    }
+    const unsigned char* data = pixels->data.data();
+    if (pixels->channels != 4) {
+        size_t pixelCount = static_cast<size_t>(pixels->width) * pixels->height;
+        expandBuffer.resize(pixelCount * 4);
+        PixelConvert::expandToRGBA(data, pixels->channels, pixelCount, expandBuffer.data());
+        data = expandBuffer.data();
+    }
+
+    if (count == 0 && !ensureStorage(image.width, image.height)) {
+        return false;
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, count, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    ++count;
+    return true;
+}
+
+PipelineFrame FrameBatch::getFrame() const {
+    return { texture, GL_TEXTURE_2D_ARRAY, 0, width, height, GL_RGBA8 };
+}
+
+size_t FrameBatch::getMemoryBytes() const {
+    return TextureUploader::estimateBytes(GL_RGBA8, width, height, layers);
+}
+
+bool FrameBatch::ensureStorage(int frameWidth, int frameHeight) {
+    if (texture && frameWidth == width && frameHeight == height && capacity <= layers) {
+        return true;
+    }
+    destroy();
+
+    // Immutable storage, so the array can be bound as an image
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, frameWidth, frameHeight, capacity);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    if (glGetError() != GL_NO_ERROR) {
+        std::cerr << "Failed to allocate a batch of " << capacity << " frames (" << frameWidth << "x"
+                  << frameHeight << ")" << std::endl;
+        destroy();
+        return false;
+    }
+    width = frameWidth;
+    height = frameHeight;
+    layers = capacity;
+    return true;
+}
+
+void FrameBatch::destroy() {
+    if (texture) {
+        glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+    width = height = layers = 0;
+}
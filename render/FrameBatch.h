@@ -0,0 +1,50 @@
+#pragma once
+
+#include <angle_gl.h>
+#include <vector>
+#include "../reader/ImageLoader.h"
+#include "RenderPipeline.h"
+
+// Frames gathered for one batched dispatch (RenderPipeline::processBatch):
+// the layers of a GL_TEXTURE_2D_ARRAY of RGBA8, which compute passes can bind
+// as a single image2DArray. Every frame of a batch must have the first one's
+// size; block-compressed, YUV and RGB frames are expanded to RGBA8 on the CPU,
+// half-float frames are not taken. The array is reused while batches keep
+// their size and capacity.
+class FrameBatch {
+public:
+    FrameBatch();
+
+    FrameBatch(const FrameBatch&) = delete;
+    FrameBatch& operator=(const FrameBatch&) = delete;
+
+    // Start a batch of up to capacity frames (drops the frames of the last one)
+    void begin(int capacity);
+
+    // Upload the frame as the next layer. Returns false, adding nothing, when
+    // the batch is full or the frame cannot join it (size or sample format).
+    // Needs a current context.
+    bool add(const ImageData& image);
+
+    int getCount() const { return count; }
+    bool isFull() const { return count >= capacity; }
+
+    // The array holding the batch, as processBatch() takes it
+    PipelineFrame getFrame() const;
+
+    // Estimated texture memory of the array
+    size_t getMemoryBytes() const;
+
+    void destroy();
+
+private:
+    GLuint texture;
+    int width;
+    int height;
+    int layers;    // Layers allocated
+    int capacity;  // Frames the current batch takes
+    int count;     // Frames added to it
+    std::vector<unsigned char> expandBuffer;
+
+    bool ensureStorage(int frameWidth, int frameHeight);
+};
@@ -0,0 +1,222 @@
+#include "FrameExporter.h"
+#include "Trace.h"
+#include "../reader/ImageWriter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+bool FrameExporter::parseFormat(const std::string& name, Format& format) {
+    if (name == "png") {
+        format = Format::PNG;
+    } else if (name == "raw") {
+        format = Format::Raw;
+    } else {
+        std::cerr << "Unknown export format: " << name << " (use png or raw)" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+FrameExporter::FrameExporter()
+    : format(Format::PNG), nextSlot(0), maxQueuedJobs(0), stopping(false), written(0), failed(0) {
+}
+
+FrameExporter::~FrameExporter() {
+    // finish() releases the buffers with the context current; here only the threads are left to stop
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        stopping = true;
+    }
+    jobAdded.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+bool FrameExporter::start(const std::string& outputDirectory, Format outputFormat, bool pixelBuffers,
+                          int ringSize, int threadCount) {
+    std::error_code ec;
+    fs::create_directories(outputDirectory, ec);
+    if (ec) {
+        std::cerr << "Cannot create export directory " << outputDirectory << std::endl;
+        return false;
+    }
+    directory = outputDirectory;
+    format = outputFormat;
+    written = 0;
+    failed = 0;
+
+    slots.clear();
+    if (pixelBuffers) {
+        slots.resize(std::max(ringSize, 1));
+        for (Slot& slot : slots) {
+            glGenBuffers(1, &slot.buffer);
+        }
+    }
+    nextSlot = 0;
+
+    if (threadCount <= 0) {
+        unsigned hardware = std::thread::hardware_concurrency();
+        threadCount = hardware > 1 ? static_cast<int>(hardware) - 1 : 1;
+    }
+    // Two frames waiting per thread keeps every thread busy without buffering the whole sequence
+    maxQueuedJobs = static_cast<size_t>(threadCount) * 2;
+    stopping = false;
+    for (int i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&FrameExporter::encodeLoop, this);
+    }
+    std::cout << "Exporting to " << directory << " with " << threadCount << " encode thread(s), "
+              << (slots.empty() ? "synchronous readback" : std::to_string(slots.size()) + " pixel pack buffers") << std::endl;
+    return true;
+}
+
+bool FrameExporter::capture(int x, int y, int width, int height, const std::string& name) {
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+    size_t size = static_cast<size_t>(width) * height * 4;
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    if (slots.empty()) {
+        // ES2: the copy waits for the frame, but encoding still overlaps the next one
+        PixelBuffer pixels = PixelBuffer::allocate(size);
+        if (pixels.empty()) {
+            return false;
+        }
+        glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        enqueue(name, width, height, std::move(pixels));
+        return true;
+    }
+
+    // The oldest readback in the ring has had a whole ring of frames to complete
+    Slot& slot = slots[nextSlot];
+    if (slot.pending) {
+        retire(slot);
+    }
+
+    TRACE_ZONE("Read back frame");
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (slot.capacity < static_cast<GLsizeiptr>(size)) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_READ);
+        slot.capacity = static_cast<GLsizeiptr>(size);
+    }
+    glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.pending = true;
+    slot.width = width;
+    slot.height = height;
+    slot.name = name;
+    nextSlot = (nextSlot + 1) % slots.size();
+    return glGetError() == GL_NO_ERROR;
+}
+
+void FrameExporter::retire(Slot& slot) {
+    TRACE_ZONE("Map readback");
+    if (slot.fence) {
+        glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+    }
+    slot.pending = false;
+
+    size_t size = static_cast<size_t>(slot.width) * slot.height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_READ_BIT);
+    if (!mapped) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        std::cerr << "Failed to map the readback of " << slot.name << std::endl;
+        ++failed;
+        return;
+    }
+    // The mapping belongs to the GL thread, so the encoders get their own copy
+    PixelBuffer pixels = PixelBuffer::allocate(size);
+    if (!pixels.empty()) {
+        memcpy(pixels.data(), mapped, size);
+    }
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (pixels.empty()) {
+        ++failed;
+        return;
+    }
+    enqueue(slot.name, slot.width, slot.height, std::move(pixels));
+}
+
+void FrameExporter::enqueue(const std::string& name, int width, int height, PixelBuffer&& pixels) {
+    std::string extension = format == Format::PNG ? ".png" : ".rgba";
+    EncodeJob job = { (fs::path(directory) / (name + extension)).string(), width, height, std::move(pixels) };
+    std::unique_lock<std::mutex> lock(jobMutex);
+    jobTaken.wait(lock, [this] { return jobs.size() < maxQueuedJobs; });
+    jobs.push_back(std::move(job));
+    lock.unlock();
+    jobAdded.notify_one();
+}
+
+void FrameExporter::encodeLoop() {
+    for (;;) {
+        EncodeJob job;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobAdded.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                return; // Stopping, and every queued frame is written
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        jobTaken.notify_one();
+
+        TRACE_ZONE("Encode frame");
+        bool ok = format == Format::PNG
+            ? ImageWriter::writePng(job.path, job.width, job.height, job.pixels.data(), true)
+            : ImageWriter::writeRaw(job.path, job.width, job.height, job.pixels.data(), true);
+        ++(ok ? written : failed);
+    }
+}
+
+size_t FrameExporter::getBufferBytes() const {
+    size_t bytes = 0;
+    for (const Slot& slot : slots) {
+        bytes += static_cast<size_t>(slot.capacity);
+    }
+    return bytes;
+}
+
+size_t FrameExporter::getQueuedBytes() {
+    std::lock_guard<std::mutex> lock(jobMutex);
+    size_t bytes = 0;
+    for (const EncodeJob& job : jobs) {
+        bytes += job.pixels.size();
+    }
+    return bytes;
+}
+
+bool FrameExporter::finish() {
+    // Drain the ring oldest first, so frames are queued in capture order
+    for (size_t i = 0; i < slots.size(); ++i) {
+        Slot& slot = slots[(nextSlot + i) % slots.size()];
+        if (slot.pending) {
+            retire(slot);
+        }
+    }
+    for (Slot& slot : slots) {
+        glDeleteBuffers(1, &slot.buffer);
+    }
+    slots.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        stopping = true;
+    }
+    jobAdded.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    return failed == 0;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <angle_gl.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../reader/PixelBuffer.h"
+
+// Writes rendered frames to disk without stalling the GPU (batch export).
+//
+// capture() starts an asynchronous glReadPixels into the next pixel pack
+// buffer of a ring (ES3) and fences it. The buffer is only mapped when the
+// ring comes round to it again, by which time the GPU has normally finished
+// the copy long ago; its pixels are then handed to a pool of encode threads.
+// Rendering, readback and encoding of consecutive frames therefore overlap,
+// and throughput is set by the slowest of them rather than their sum. A
+// bounded encode queue keeps memory in check when the disk is the bottleneck.
+// On ES2 the readback is synchronous; encoding still runs on the pool.
+class FrameExporter {
+public:
+    enum class Format {
+        PNG,  // <name>.png (see ImageWriter)
+        Raw   // <name>.rgba: width * height RGBA8 pixels, top row first
+    };
+
+    // "png" or "raw"; returns false for other names
+    static bool parseFormat(const std::string& name, Format& format);
+
+    FrameExporter();
+    ~FrameExporter();
+
+    FrameExporter(const FrameExporter&) = delete;
+    FrameExporter& operator=(const FrameExporter&) = delete;
+
+    // Create the output directory and start threadCount encode threads (0 =
+    // one per hardware thread, leaving one for rendering). pixelBuffers selects
+    // the asynchronous readback ring of ringSize buffers (needs ES3).
+    bool start(const std::string& directory, Format format, bool pixelBuffers, int ringSize = 3, int threadCount = 0);
+
+    // Read back a region of the current read framebuffer and write it as name
+    // once it arrives. Needs the context start() ran on; blocks only while the
+    // oldest buffer in the ring or the encode queue is still busy.
+    bool capture(int x, int y, int width, int height, const std::string& name);
+
+    // Wait for every readback and encode, then release the buffers and threads.
+    // Returns false if any frame could not be written.
+    bool finish();
+
+    size_t getWrittenCount() const { return written; }
+    size_t getFailedCount() const { return failed; }
+
+    // GPU memory of the readback ring, and CPU memory of the frames waiting to be encoded
+    size_t getBufferBytes() const;
+    size_t getQueuedBytes();
+
+private:
+    struct Slot {
+        GLuint buffer = 0;
+        GLsizeiptr capacity = 0;
+        GLsync fence = nullptr;  // Signalled once the readback into the buffer is complete
+        bool pending = false;
+        int width = 0;
+        int height = 0;
+        std::string name;
+    };
+
+    struct EncodeJob {
+        std::string path;
+        int width;
+        int height;
+        PixelBuffer pixels;  // Bottom row first, as read back
+    };
+
+    std::string directory;
+    Format format;
+
+    // Readback ring (empty for synchronous readback)
+    std::vector<Slot> slots;
+    size_t nextSlot;
+
+    // Encode pool
+    std::vector<std::thread> workers;
+    std::deque<EncodeJob> jobs;
+    size_t maxQueuedJobs;
+    bool stopping;
+    std::mutex jobMutex;
+    std::condition_variable jobAdded;
+    std::condition_variable jobTaken;
+    std::atomic<size_t> written;
+    std::atomic<size_t> failed;
+
+    // Map a finished buffer and queue its pixels for encoding
+    void retire(Slot& slot);
+    void enqueue(const std::string& name, int width, int height, PixelBuffer&& pixels);
+    void encodeLoop();
+};
@@ -0,0 +1,113 @@
+#include "FramePacer.h"
+
+#include <thread>
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// If presentation falls this many seconds behind (e.g. after a debugger break),
+// resynchronize the clock instead of dropping a long run of frames
+static const double kMaxCatchUpSeconds = 0.5;
+
+// Slack left for yielding when only the default (coarse) sleep is available
+static const std::chrono::milliseconds kCoarseSleepMargin(2);
+
+FramePacer::FramePacer()
+    : frameRate(30.0), startTime(Clock::now()), framesConsumed(0), droppedFrames(0), timer(nullptr), wakeEvent(nullptr) {
+    // High-resolution timers need Windows 10 1803+; without one sleepUntil falls
+    // back to a coarse sleep followed by yielding
+    timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    wakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+}
+
+FramePacer::~FramePacer() {
+    if (timer) {
+        CloseHandle(timer);
+    }
+    if (wakeEvent) {
+        CloseHandle(wakeEvent);
+    }
+}
+
+void FramePacer::setFrameRate(double fps) {
+    if (fps > 0.0) {
+        frameRate = fps;
+        reset();
+    }
+}
+
+void FramePacer::reset() {
+    startTime = Clock::now();
+    framesConsumed = 0;
+    droppedFrames = 0;
+}
+
+FramePacer::Clock::time_point FramePacer::deadline(int64_t frame) const {
+    return startTime + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(static_cast<double>(frame) / frameRate));
+}
+
+int FramePacer::advance() {
+    double elapsed = std::chrono::duration<double>(Clock::now() - startTime).count();
+    int64_t due = static_cast<int64_t>(elapsed * frameRate);
+    int64_t frames = due - framesConsumed;
+
+    if (frames <= 0) {
+        return 0; // Still within the current frame's interval: repeat it
+    }
+
+    if (frames > static_cast<int64_t>(kMaxCatchUpSeconds * frameRate) + 1) {
+        // Far behind: show the next frame and restart the clock from here
+        reset();
+        return 1;
+    }
+
+    framesConsumed = due;
+    droppedFrames += frames - 1;
+    return static_cast<int>(frames);
+}
+
+void FramePacer::waitForNextFrame() {
+    sleepUntil(deadline(framesConsumed + 1));
+}
+
+void FramePacer::waitForWake() {
+    WaitForSingleObject(wakeEvent, INFINITE);
+}
+
+void FramePacer::interrupt() {
+    SetEvent(wakeEvent);
+}
+
+void FramePacer::sleepUntil(Clock::time_point target) {
+    auto remaining = target - Clock::now();
+    if (remaining <= Clock::duration::zero()) {
+        return;
+    }
+
+    if (timer) {
+        // Relative due time in 100 ns units (negative = relative)
+        LARGE_INTEGER dueTime;
+        dueTime.QuadPart = -static_cast<LONGLONG>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count() / 100);
+        if (SetWaitableTimer(timer, &dueTime, 0, NULL, NULL, FALSE)) {
+            HANDLE handles[2] = { timer, wakeEvent };
+            if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) == WAIT_OBJECT_0 + 1) {
+                CancelWaitableTimer(timer);
+                return;
+            }
+        }
+    } else if (remaining > kCoarseSleepMargin) {
+        DWORD milliseconds = static_cast<DWORD>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(remaining - kCoarseSleepMargin).count());
+        if (WaitForSingleObject(wakeEvent, milliseconds) == WAIT_OBJECT_0) {
+            return;
+        }
+    }
+
+    // Timer resolution can leave a fraction of a millisecond; yield out the rest
+    while (Clock::now() < target) {
+        std::this_thread::yield();
+    }
+}
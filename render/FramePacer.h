@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Windows.h>
+#include <chrono>
+#include <cstdint>
+
+// Playback clock that maps wall time to source frames.
+// advance() reports how many source frames are due since the last call (0 when
+// the display runs faster than the source and the current frame is repeated,
+// more than 1 when presentation fell behind and frames must be dropped), and
+// waitForNextFrame() sleeps precisely until the next frame deadline using a
+// high-resolution waitable timer.
+class FramePacer {
+public:
+    FramePacer();
+    ~FramePacer();
+
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    // Source frame rate in frames per second
+    void setFrameRate(double fps);
+    double getFrameRate() const { return frameRate; }
+
+    // Restart the clock so the current frame is frame 0 (e.g. on resume)
+    void reset();
+
+    // Number of source frames due since the previous call
+    int advance();
+
+    // Sleep until the next source frame is due
+    void waitForNextFrame();
+
+    // Sleep until interrupt(), however long that takes (e.g. paused with
+    // nothing to redraw, so an idle renderer does not wake every frame interval)
+    void waitForWake();
+
+    // Wake a thread sleeping in waitForNextFrame() early (e.g. on shutdown).
+    // An interrupt with no sleeper pending cuts the next sleep short instead.
+    void interrupt();
+
+    // Frames dropped since the last reset because presentation fell behind
+    int64_t getDroppedFrames() const { return droppedFrames; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    double frameRate;
+    Clock::time_point startTime;
+    int64_t framesConsumed;  // Source frames handed out since reset
+    int64_t droppedFrames;
+    HANDLE timer;            // High-resolution waitable timer (null on older Windows)
+    HANDLE wakeEvent;        // Auto-reset event set by interrupt()
+
+    Clock::time_point deadline(int64_t frame) const;
+    void sleepUntil(Clock::time_point target);
+};
@@ -0,0 +1,246 @@
+#include "FrameProducer.h"
+#include "GpuTrace.h"
+
+#include <iostream>
+
+FrameProducer::FrameProducer()
+    : loader(nullptr), frameCount(0), requireRGBA(false), stats(nullptr), running(false), textureBytes(0), wakeEvent(nullptr), generation(0), seekIndex(0),
+      current{ -1, 0, 0, 0, GL_NONE, 0, 0, 0, nullptr }, hasCurrent(false), targetSequence(0) {
+}
+
+FrameProducer::~FrameProducer() {
+    // stop() needs the render context current; only the thread is torn down here
+    if (worker.joinable()) {
+        running = false;
+        SetEvent(wakeEvent);
+        worker.join();
+    }
+    if (wakeEvent) {
+        CloseHandle(wakeEvent);
+    }
+}
+
+bool FrameProducer::start(ImageLoader& imageLoader, EGLDisplay display, EGLConfig config, EGLContext shareContext,
+                          const EGLint* contextAttribs, size_t firstIndex, int slotCount) {
+    if (isRunning() || imageLoader.getImageCount() == 0 || slotCount < 2) {
+        return false;
+    }
+    if (!context.create(display, config, shareContext, contextAttribs)) {
+        return false;
+    }
+
+    loader = &imageLoader;
+    frameCount = imageLoader.getImageCount();
+    slots.assign(slotCount, TextureUploader());
+    slotFrames.assign(slotCount, frameCount);
+    readyFrames.reset(new SpscQueue<ReadyFrame>(slotCount));
+    freeSlots.reset(new SpscQueue<FreeSlot>(slotCount));
+    for (int i = 0; i < slotCount; ++i) {
+        freeSlots->push({ i, nullptr });
+    }
+
+    hasCurrent = false;
+    targetSequence = 0;
+    seekIndex = firstIndex % frameCount;
+    generation = 0;
+    if (!wakeEvent) {
+        wakeEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    }
+
+    running = true;
+    worker = std::thread(&FrameProducer::produceLoop, this);
+    return true;
+}
+
+void FrameProducer::stop() {
+    if (!worker.joinable()) {
+        return;
+    }
+    running = false;
+    SetEvent(wakeEvent);
+    worker.join();
+
+    // Fences are shared objects; the ones still queued are deleted here
+    ReadyFrame frame;
+    while (readyFrames->pop(frame)) {
+        if (frame.fence) {
+            glDeleteSync(frame.fence);
+        }
+    }
+    FreeSlot slot;
+    while (freeSlots->pop(slot)) {
+        if (slot.fence) {
+            glDeleteSync(slot.fence);
+        }
+    }
+    if (hasCurrent && current.fence) {
+        glDeleteSync(current.fence);
+    }
+    hasCurrent = false;
+    context.destroy();
+}
+
+void FrameProducer::seek(size_t index) {
+    if (!isRunning()) {
+        return;
+    }
+
+    // Frames already produced belong to the old position
+    ReadyFrame frame;
+    while (readyFrames->pop(frame)) {
+        recycle(frame);
+    }
+    targetSequence = 0;
+    seekIndex = index % frameCount;
+    generation.fetch_add(1, std::memory_order_release);
+    SetEvent(wakeEvent);
+}
+
+void FrameProducer::advance(size_t count) {
+    targetSequence += count;
+}
+
+void FrameProducer::recycle(ReadyFrame& frame) {
+    FreeSlot slot = { frame.slot, nullptr };
+    if (frame.fence) {
+        // Never drawn: the producer may overwrite it right away
+        glDeleteSync(frame.fence);
+    } else {
+        // Drawn: the producer waits for those draws before uploading into it
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+    }
+    freeSlots->push(slot);
+    SetEvent(wakeEvent);
+}
+
+bool FrameProducer::update() {
+    if (!isRunning()) {
+        return false;
+    }
+
+    uint32_t currentGeneration = generation.load(std::memory_order_relaxed);
+    bool changed = false;
+    ReadyFrame frame;
+    while (readyFrames->peek(frame)) {
+        if (frame.generation == currentGeneration && frame.sequence > targetSequence) {
+            break; // Not due yet
+        }
+        readyFrames->pop(frame);
+        if (frame.generation != currentGeneration) {
+            recycle(frame); // Produced before a seek the producer had not seen yet
+            continue;
+        }
+        // Frames that were due but superseded before being drawn are dropped
+        if (hasCurrent) {
+            recycle(current);
+        }
+        current = frame;
+        hasCurrent = true;
+        changed = true;
+    }
+
+    if (changed) {
+        // Make this context's draws wait for the upload, without blocking the CPU
+        glWaitSync(current.fence, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(current.fence);
+        current.fence = nullptr;
+    } else if (hasCurrent && current.sequence + readyFrames->capacity() * 2 < targetSequence) {
+        // The producer fell far behind the playhead; restart it at the frame due now
+        seek((seekIndex + static_cast<size_t>(targetSequence % frameCount)) % frameCount);
+    }
+    return changed;
+}
+
+void FrameProducer::produceLoop() {
+    if (!context.makeCurrent()) {
+        std::cerr << "Failed to bind frame producer context" << std::endl;
+        return;
+    }
+    for (TextureUploader& slot : slots) {
+        slot.create(true);
+        if (requireRGBA) {
+            slot.setRequireRGBA(true);
+        } else {
+            slot.enableCompressedUploads();
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Rows are tightly packed
+
+    uint32_t producedGeneration = generation.load(std::memory_order_acquire) - 1;
+    size_t nextIndex = 0;
+    uint64_t sequence = 0;
+    FreeSlot slot = { -1, nullptr };
+
+    while (running) {
+        uint32_t requested = generation.load(std::memory_order_acquire);
+        if (requested != producedGeneration) {
+            producedGeneration = requested;
+            nextIndex = seekIndex.load();
+            sequence = 0;
+        }
+
+        // Wait for the render thread to hand back a slot
+        if (slot.slot < 0 && !freeSlots->pop(slot)) {
+            WaitForSingleObject(wakeEvent, INFINITE);
+            continue;
+        }
+        if (slot.fence) {
+            glWaitSync(slot.fence, 0, GL_TIMEOUT_IGNORED);
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+
+        // Streaming loaders prefetch around the frame being produced
+        TRACE_ZONE("Produce frame");
+        loader->setPlaybackPosition(nextIndex, 1);
+        std::shared_ptr<const ImageData> image = loader->acquireImage(nextIndex);
+        if (generation.load(std::memory_order_acquire) != producedGeneration) {
+            continue; // Seek while decoding; keep the slot for the new position
+        }
+
+        // A slot that held a recent frame of mostly static content only needs the changed tiles
+        TextureUploader& texture = slots[slot.slot];
+        DirtyTiles tiles;
+        bool uploaded = false;
+        if (image && image->isValid()) {
+            TRACE_GPU_ZONE("Upload frame");
+            FrameStats::Scope timing(stats, FrameStage::Upload);
+            if (loader->getChangedTiles(slotFrames[slot.slot], nextIndex, tiles) && texture.uploadTiles(*image, tiles)) {
+                timing.addBytes(static_cast<uint64_t>(image->data.size() * tiles.dirtyFraction()));
+                uploaded = true;
+            } else if (texture.upload(*image)) {
+                timing.addBytes(image->data.size());
+                uploaded = true;
+            }
+        }
+        slotFrames[slot.slot] = uploaded ? nextIndex : frameCount;
+        if (uploaded) {
+            size_t bytes = 0;
+            for (const TextureUploader& slotTexture : slots) {
+                bytes += slotTexture.getMemoryBytes();
+            }
+            textureBytes.store(bytes, std::memory_order_relaxed);
+            ReadyFrame frame = { slot.slot, texture.getTexture(), texture.getWidth(), texture.getHeight(),
+                                 texture.getInternalFormat(), nextIndex, sequence, producedGeneration,
+                                 glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) };
+            glFlush(); // The fence must reach the GPU before another context waits on it
+            readyFrames->push(frame);
+            slot.slot = -1;
+        } else {
+            std::cerr << "Frame producer skipped " << loader->getImageName(nextIndex) << std::endl;
+        }
+        nextIndex = (nextIndex + 1) % frameCount;
+        ++sequence;
+    }
+
+    if (slot.fence) {
+        glDeleteSync(slot.fence);
+    }
+    for (TextureUploader& texture : slots) {
+        texture.destroy();
+    }
+    textureBytes.store(0, std::memory_order_relaxed);
+    glFinish();
+    context.release();
+}
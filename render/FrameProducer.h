@@ -0,0 +1,111 @@
+#pragma once
+
+#include <angle_gl.h>
+#include <EGL/egl.h>
+#include <Windows.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../reader/ImageLoader.h"
+#include "FrameStats.h"
+#include "SharedContext.h"
+#include "SpscQueue.h"
+#include "TextureUploader.h"
+
+// Producer stage that prepares frames off the render thread (ES3).
+// A worker thread with its own shared EGL context fetches frames from the
+// loader (decoding or waiting on the streaming cache as needed), uploads each
+// into one of a few slot textures and hands the slot to the render thread
+// through a lock-free single-producer/single-consumer queue, together with a
+// fence the render thread waits on inside the GPU. Slots come back through a
+// second queue once the render thread has moved on, fenced after its last
+// draw. The render thread therefore only binds and draws, and decode or I/O
+// stalls delay the producer rather than presentation.
+//
+// Frames are produced in order from the last seek. Each frame carries its
+// distance from that seek (its sequence number), so the render thread can
+// skip frames the pacer dropped and always shows the newest frame due.
+class FrameProducer {
+public:
+    FrameProducer();
+    ~FrameProducer();
+
+    // Start producing from firstIndex with slotCount textures in flight.
+    // shareContext must be the render thread's context.
+    bool start(ImageLoader& loader, EGLDisplay display, EGLConfig config, EGLContext shareContext,
+               const EGLint* contextAttribs, size_t firstIndex, int slotCount = 4);
+    // Stop the producer. Call from the render thread with its context current.
+    void stop();
+    bool isRunning() const { return worker.joinable(); }
+
+    // Store every frame as RGBA8 with compressed uploads off, for consumers
+    // that bind the frame as an rgba8 image unit (call before start)
+    void setRequireRGBA(bool enabled) { requireRGBA = enabled; }
+
+    // Record upload times of produced frames (call before start; null = off)
+    void setStats(FrameStats* frameStats) { stats = frameStats; }
+
+    // Render thread: restart production at index (step back, jump)
+    void seek(size_t index);
+    // Render thread: the playhead moved forward by count frames
+    void advance(size_t count);
+    // Render thread: switch to the newest produced frame that is due. Returns
+    // true if the displayed frame changed.
+    bool update();
+
+    // Texture and index of the frame to draw (0 until the first frame arrives)
+    GLuint getTexture() const { return hasCurrent ? current.texture : 0; }
+    size_t getFrameIndex() const { return current.index; }
+    int getWidth() const { return current.width; }
+    int getHeight() const { return current.height; }
+    GLenum getInternalFormat() const { return current.internalFormat; }
+
+    // Estimated texture memory of the slots, as of the last upload (any thread)
+    size_t getMemoryBytes() const { return textureBytes.load(std::memory_order_relaxed); }
+
+private:
+    struct ReadyFrame {
+        int slot;
+        GLuint texture;
+        int width;
+        int height;
+        GLenum internalFormat;
+        size_t index;
+        uint64_t sequence;     // Frames since the seek it was produced for
+        uint32_t generation;   // Seek it was produced for
+        GLsync fence;          // Upload complete; 0 once the render thread has waited
+    };
+
+    struct FreeSlot {
+        int slot;
+        GLsync fence;  // Last draw from the slot; 0 if it was never drawn
+    };
+
+    ImageLoader* loader;
+    size_t frameCount;
+    bool requireRGBA;
+    FrameStats* stats;
+    SharedContext context;
+    std::vector<TextureUploader> slots;  // Used only on the producer thread
+    std::vector<size_t> slotFrames;      // Frame each slot texture holds, for tile updates
+    std::unique_ptr<SpscQueue<ReadyFrame>> readyFrames;
+    std::unique_ptr<SpscQueue<FreeSlot>> freeSlots;
+    std::thread worker;
+    std::atomic<bool> running;
+    std::atomic<size_t> textureBytes;  // Sum of the slots' getMemoryBytes(), written by the producer thread
+    HANDLE wakeEvent;  // Signaled when a slot is returned or a seek is requested
+
+    // Seek requests, written by the render thread
+    std::atomic<uint32_t> generation;
+    std::atomic<size_t> seekIndex;
+
+    // Render thread state
+    ReadyFrame current;
+    bool hasCurrent;
+    uint64_t targetSequence;
+
+    void produceLoop();
+    void recycle(ReadyFrame& frame);
+};
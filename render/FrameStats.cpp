@@ -0,0 +1,180 @@
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+const size_t StageCount = static_cast<size_t>(FrameStage::Count);
+
+// Nearest-rank percentile of sorted samples
+double percentile(const std::vector<float>& sorted, double fraction) {
+    size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+} // namespace
+
+FrameStats::FrameStats(size_t capacity) : capacity(std::max<size_t>(capacity, 1)), lastFrameMark(0) {
+    for (Ring& ring : rings) {
+        ring.samples.reset(new std::atomic<float>[this->capacity]);
+        for (size_t i = 0; i < this->capacity; ++i) {
+            ring.samples[i].store(0.0f, std::memory_order_relaxed);
+        }
+    }
+    scratch.reserve(this->capacity);
+}
+
+void FrameStats::record(FrameStage stage, double milliseconds, uint64_t bytes) {
+    if (stage >= FrameStage::Count) {
+        return;
+    }
+    Ring& ring = rings[static_cast<size_t>(stage)];
+    size_t slot = ring.written.fetch_add(1, std::memory_order_relaxed) % capacity;
+    ring.samples[slot].store(static_cast<float>(milliseconds), std::memory_order_relaxed);
+    ring.totalNanoseconds.fetch_add(static_cast<uint64_t>(milliseconds * 1e6), std::memory_order_relaxed);
+    if (bytes) {
+        ring.totalBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+}
+
+StageSummary FrameStats::summarize(FrameStage stage) const {
+    StageSummary summary;
+    if (stage >= FrameStage::Count) {
+        return summary;
+    }
+    const Ring& ring = rings[static_cast<size_t>(stage)];
+    size_t count = std::min(ring.written.load(std::memory_order_relaxed), capacity);
+    if (count == 0) {
+        return summary;
+    }
+
+    scratch.clear();
+    for (size_t i = 0; i < count; ++i) {
+        scratch.push_back(ring.samples[i].load(std::memory_order_relaxed));
+    }
+    std::sort(scratch.begin(), scratch.end());
+    summary.samples = count;
+    summary.p50 = percentile(scratch, 0.50);
+    summary.p95 = percentile(scratch, 0.95);
+    summary.p99 = percentile(scratch, 0.99);
+    summary.max = scratch.back();
+    return summary;
+}
+
+void FrameStats::markFrame() {
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t previous = lastFrameMark.exchange(now, std::memory_order_relaxed);
+    if (previous != 0) {
+        record(FrameStage::Frame, (now - previous) / 1e6);
+    }
+}
+
+StageTotals FrameStats::getTotals(FrameStage stage) const {
+    StageTotals totals;
+    if (stage >= FrameStage::Count) {
+        return totals;
+    }
+    const Ring& ring = rings[static_cast<size_t>(stage)];
+    totals.samples = ring.written.load(std::memory_order_relaxed);
+    totals.milliseconds = ring.totalNanoseconds.load(std::memory_order_relaxed) / 1e6;
+    totals.bytes = ring.totalBytes.load(std::memory_order_relaxed);
+    return totals;
+}
+
+void FrameStats::report(std::ostream& out) const {
+    out << std::fixed << std::setprecision(3);
+    out << "Stage        samples      p50      p95      p99      max (ms)" << std::endl;
+    for (size_t i = 0; i < StageCount; ++i) {
+        FrameStage stage = static_cast<FrameStage>(i);
+        StageSummary summary = summarize(stage);
+        if (summary.samples == 0) {
+            continue; // Stage not used by this renderer
+        }
+        out << std::left << std::setw(10) << stageName(stage) << std::right
+            << std::setw(10) << summary.samples
+            << std::setw(9) << summary.p50 << std::setw(9) << summary.p95
+            << std::setw(9) << summary.p99 << std::setw(9) << summary.max << std::endl;
+    }
+    out << std::defaultfloat;
+}
+
+bool FrameStats::appendCsv(const std::string& path, const std::string& label) const {
+    bool exists = std::filesystem::exists(path);
+    std::ofstream file(path, std::ios::app);
+    if (!file) {
+        std::cerr << "Failed to open " << path << " for frame statistics" << std::endl;
+        return false;
+    }
+    if (!exists) {
+        file << "label,stage,samples,p50_ms,p95_ms,p99_ms,max_ms\n";
+    }
+    file << std::fixed << std::setprecision(4);
+    for (size_t i = 0; i < StageCount; ++i) {
+        FrameStage stage = static_cast<FrameStage>(i);
+        StageSummary summary = summarize(stage);
+        file << label << ',' << stageName(stage) << ',' << summary.samples << ',' << summary.p50 << ','
+             << summary.p95 << ',' << summary.p99 << ',' << summary.max << '\n';
+    }
+    return static_cast<bool>(file);
+}
+
+bool FrameStats::writeJson(const std::string& path, const std::string& label) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        std::cerr << "Failed to open " << path << " for frame statistics" << std::endl;
+        return false;
+    }
+    // Labels are build/renderer names; only quotes and backslashes need escaping
+    std::string escaped;
+    for (char c : label) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    file << std::fixed << std::setprecision(4);
+    file << "{\n  \"label\": \"" << escaped << "\",\n  \"stages\": {\n";
+    for (size_t i = 0; i < StageCount; ++i) {
+        FrameStage stage = static_cast<FrameStage>(i);
+        StageSummary summary = summarize(stage);
+        file << "    \"" << stageName(stage) << "\": { \"samples\": " << summary.samples
+             << ", \"p50_ms\": " << summary.p50 << ", \"p95_ms\": " << summary.p95
+             << ", \"p99_ms\": " << summary.p99 << ", \"max_ms\": " << summary.max << " }"
+             << (i + 1 < StageCount ? "," : "") << "\n";
+    }
+    file << "  }\n}\n";
+    return static_cast<bool>(file);
+}
+
+void FrameStats::clear() {
+    lastFrameMark.store(0, std::memory_order_relaxed);
+    for (Ring& ring : rings) {
+        ring.written.store(0, std::memory_order_relaxed);
+        ring.totalNanoseconds.store(0, std::memory_order_relaxed);
+        ring.totalBytes.store(0, std::memory_order_relaxed);
+    }
+}
+
+void FrameStats::recordDecodeTime(void* context, double milliseconds) {
+    if (context) {
+        static_cast<FrameStats*>(context)->record(FrameStage::Decode, milliseconds);
+    }
+}
+
+const char* FrameStats::stageName(FrameStage stage) {
+    switch (stage) {
+    case FrameStage::Decode: return "decode";
+    case FrameStage::Upload: return "upload";
+    case FrameStage::Compute: return "compute";
+    case FrameStage::Draw: return "draw";
+    case FrameStage::Present: return "present";
+    case FrameStage::Frame: return "frame";
+    default: return "unknown";
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Pipeline stages timed per frame
+enum class FrameStage {
+    Decode,   // Decoding or unpacking a frame on a loader thread
+    Upload,   // Copying a frame into a texture or pixel buffer (CPU side)
+    Compute,  // Compute passes (GPU time)
+    Draw,     // Drawing the frame to the back buffer (GPU time)
+    Present,  // eglSwapBuffers, including any vsync wait inside it
+    Frame,    // Present to present: the frame time the viewer sees
+    Count
+};
+
+// Percentiles of one stage over the samples currently in its ring
+struct StageSummary {
+    size_t samples = 0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+// Everything recorded for one stage since construction or clear(), not
+// limited to the ring
+struct StageTotals {
+    uint64_t samples = 0;
+    double milliseconds = 0.0;
+    uint64_t bytes = 0;  // Data moved by the stage, where it reports any (uploads)
+
+    double megabytesPerSecond() const { return milliseconds > 0.0 ? bytes / (1024.0 * 1024.0) / (milliseconds / 1000.0) : 0.0; }
+};
+
+// Per-stage timing samples kept in fixed-size rings.
+// record() may be called from any thread and never allocates or locks, so it
+// can sit on the hot path of decode, upload and render threads. Summaries and
+// exports cover the most recent `capacity` samples of each stage.
+class FrameStats {
+public:
+    explicit FrameStats(size_t capacity = 1024);
+
+    FrameStats(const FrameStats&) = delete;
+    FrameStats& operator=(const FrameStats&) = delete;
+
+    void record(FrameStage stage, double milliseconds, uint64_t bytes = 0);
+
+    // Call once per presented frame; records the time since the previous call as FrameStage::Frame
+    void markFrame();
+
+    // Times a block of CPU work and records it on destruction (stats may be null)
+    class Scope {
+    public:
+        Scope(FrameStats* stats, FrameStage stage)
+            : stats(stats), stage(stage), start(std::chrono::steady_clock::now()) {}
+        ~Scope() {
+            if (stats) {
+                stats->record(stage, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), bytes);
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        // Data moved inside the block, for throughput
+        void addBytes(uint64_t count) { bytes += count; }
+
+    private:
+        FrameStats* stats;
+        FrameStage stage;
+        std::chrono::steady_clock::time_point start;
+        uint64_t bytes = 0;
+    };
+
+    // Summaries use a scratch buffer, so only one thread should call these at a time
+    StageSummary summarize(FrameStage stage) const;
+    StageTotals getTotals(FrameStage stage) const;
+    void report(std::ostream& out) const;
+
+    // Machine-readable results for comparing builds. The CSV gets one row per
+    // stage and is appended to (with a header when new), so successive runs
+    // build up a history; the JSON file is rewritten with the latest results.
+    bool appendCsv(const std::string& path, const std::string& label) const;
+    bool writeJson(const std::string& path, const std::string& label) const;
+
+    // Drop all samples, e.g. after a seek or a resolution change
+    void clear();
+
+    static const char* stageName(FrameStage stage);
+
+    // ImageLoader::DecodeTimeCallback with a FrameStats* context
+    static void recordDecodeTime(void* context, double milliseconds);
+
+private:
+    struct Ring {
+        std::unique_ptr<std::atomic<float>[]> samples;
+        std::atomic<size_t> written{0};
+        std::atomic<uint64_t> totalNanoseconds{0};
+        std::atomic<uint64_t> totalBytes{0};
+    };
+
+    size_t capacity;
+    std::atomic<int64_t> lastFrameMark;  // steady_clock nanoseconds, 0 = none yet
+    Ring rings[static_cast<size_t>(FrameStage::Count)];
+    mutable std::vector<float> scratch;
+};
@@ -0,0 +1,82 @@
+#include "FullscreenQuad.h"
+
+// Vertex data for a quad (x, y, z, u, v)
+// Frames are uploaded with their first (top) row at t = 0, unflipped; the
+// t coordinate runs bottom-up here so the picture is oriented exactly as when
+// the loader flipped every frame on the CPU.
+static const float kQuadVertices[] = {
+    // Positions    // Texture Coords
+    -1.0f,  1.0f, 0.0f,  0.0f, 1.0f,  // Top-left
+     1.0f,  1.0f, 0.0f,  1.0f, 1.0f,  // Top-right
+    -1.0f, -1.0f, 0.0f,  0.0f, 0.0f,  // Bottom-left
+     1.0f, -1.0f, 0.0f,  1.0f, 0.0f   // Bottom-right
+};
+
+static const GLsizei kQuadStride = 5 * sizeof(float);
+
+FullscreenQuad::FullscreenQuad()
+    : vertexBuffer(0), vertexArray(0), positionLocation(-1), texCoordLocation(-1) {
+}
+
+bool FullscreenQuad::create(bool useVertexArray, GLint position, GLint texCoord) {
+    if (position < 0 || texCoord < 0) {
+        return false;
+    }
+    positionLocation = position;
+    texCoordLocation = texCoord;
+
+    glGenBuffers(1, &vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(kQuadVertices), kQuadVertices, GL_STATIC_DRAW);
+
+    if (useVertexArray) {
+        glGenVertexArrays(1, &vertexArray);
+        glBindVertexArray(vertexArray);
+        bindAttributes();
+        glBindVertexArray(0);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+void FullscreenQuad::destroy() {
+    if (vertexArray) {
+        glDeleteVertexArrays(1, &vertexArray);
+        vertexArray = 0;
+    }
+    if (vertexBuffer) {
+        glDeleteBuffers(1, &vertexBuffer);
+        vertexBuffer = 0;
+    }
+}
+
+void FullscreenQuad::draw() {
+    if (!vertexBuffer) {
+        return;
+    }
+
+    if (vertexArray) {
+        glBindVertexArray(vertexArray);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glBindVertexArray(0);
+        return;
+    }
+
+    // ES2: point the attributes at the buffer; no client-side copy is involved
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    bindAttributes();
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glDisableVertexAttribArray(positionLocation);
+    glDisableVertexAttribArray(texCoordLocation);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void FullscreenQuad::bindAttributes() {
+    glEnableVertexAttribArray(positionLocation);
+    glEnableVertexAttribArray(texCoordLocation);
+    glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, kQuadStride,
+                          reinterpret_cast<const void*>(0));
+    glVertexAttribPointer(texCoordLocation, 2, GL_FLOAT, GL_FALSE, kQuadStride,
+                          reinterpret_cast<const void*>(3 * sizeof(float)));
+}
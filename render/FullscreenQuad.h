@@ -0,0 +1,26 @@
+#pragma once
+
+#include <angle_gl.h>
+
+// Static vertex buffer for the textured fullscreen quad.
+// The vertices are uploaded once; on ES3 a vertex array object also captures
+// the attribute setup, so drawing is a single bind plus glDrawArrays.
+class FullscreenQuad {
+public:
+    FullscreenQuad();
+
+    // Create the buffers for a program's attribute locations (needs a current context)
+    bool create(bool useVertexArray, GLint positionLocation, GLint texCoordLocation);
+    void destroy();
+
+    // Draw the quad with whatever program and textures are bound
+    void draw();
+
+private:
+    GLuint vertexBuffer;
+    GLuint vertexArray;  // 0 when vertex array objects are not used (ES2)
+    GLint positionLocation;
+    GLint texCoordLocation;
+
+    void bindAttributes();
+};
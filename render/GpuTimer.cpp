@@ -0,0 +1,140 @@
+#include "GpuTimer.h"
+
+#include <EGL/egl.h>
+#include <cstring>
+
+namespace {
+
+// GL_EXT_disjoint_timer_query entry points, resolved once through eglGetProcAddress
+struct TimerQueryFunctions {
+    PFNGLGENQUERIESEXTPROC genQueries = nullptr;
+    PFNGLDELETEQUERIESEXTPROC deleteQueries = nullptr;
+    PFNGLBEGINQUERYEXTPROC beginQuery = nullptr;
+    PFNGLENDQUERYEXTPROC endQuery = nullptr;
+    PFNGLGETQUERYOBJECTUIVEXTPROC getQueryObjectuiv = nullptr;
+    PFNGLGETQUERYOBJECTUI64VEXTPROC getQueryObjectui64v = nullptr;
+
+    bool load() {
+        if (genQueries) {
+            return true;
+        }
+        genQueries = reinterpret_cast<PFNGLGENQUERIESEXTPROC>(eglGetProcAddress("glGenQueriesEXT"));
+        deleteQueries = reinterpret_cast<PFNGLDELETEQUERIESEXTPROC>(eglGetProcAddress("glDeleteQueriesEXT"));
+        beginQuery = reinterpret_cast<PFNGLBEGINQUERYEXTPROC>(eglGetProcAddress("glBeginQueryEXT"));
+        endQuery = reinterpret_cast<PFNGLENDQUERYEXTPROC>(eglGetProcAddress("glEndQueryEXT"));
+        getQueryObjectuiv = reinterpret_cast<PFNGLGETQUERYOBJECTUIVEXTPROC>(eglGetProcAddress("glGetQueryObjectuivEXT"));
+        getQueryObjectui64v = reinterpret_cast<PFNGLGETQUERYOBJECTUI64VEXTPROC>(eglGetProcAddress("glGetQueryObjectui64vEXT"));
+        if (!genQueries || !deleteQueries || !beginQuery || !endQuery || !getQueryObjectuiv || !getQueryObjectui64v) {
+            genQueries = nullptr;
+            return false;
+        }
+        return true;
+    }
+};
+
+TimerQueryFunctions timerQuery;
+
+} // namespace
+
+GpuTimer::GpuTimer()
+    : available(false), active(false), skipped(false), writeIndex(0), readIndex(0) {
+}
+
+bool GpuTimer::isSupported() {
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    return extensions && strstr(extensions, "GL_EXT_disjoint_timer_query") != nullptr;
+}
+
+bool GpuTimer::initialize(int latencyFrames) {
+    destroy();
+    if (!isSupported() || !timerQuery.load()) {
+        return false;
+    }
+
+    queries.resize(latencyFrames > 1 ? latencyFrames : 2);
+    for (auto& query : queries) {
+        timerQuery.genQueries(1, &query.id);
+    }
+    writeIndex = 0;
+    readIndex = 0;
+    available = true;
+    return true;
+}
+
+void GpuTimer::destroy() {
+    if (available) {
+        for (auto& query : queries) {
+            timerQuery.deleteQueries(1, &query.id);
+        }
+    }
+    queries.clear();
+    available = false;
+    active = false;
+}
+
+void GpuTimer::begin() {
+    if (!available || active) {
+        return;
+    }
+
+    active = true;
+    Query& query = queries[writeIndex];
+    if (query.pending) {
+        // Every query is still in flight: skip this sample rather than wait for the GPU
+        skipped = true;
+        return;
+    }
+    skipped = false;
+    timerQuery.beginQuery(GL_TIME_ELAPSED_EXT, query.id);
+}
+
+void GpuTimer::end() {
+    if (!available || !active) {
+        return;
+    }
+
+    active = false;
+    if (skipped) {
+        return;
+    }
+    timerQuery.endQuery(GL_TIME_ELAPSED_EXT);
+    queries[writeIndex].pending = true;
+    writeIndex = (writeIndex + 1) % queries.size();
+}
+
+bool GpuTimer::collect(double& elapsedMs) {
+    if (!available) {
+        return false;
+    }
+
+    // A disjoint event invalidates every measurement in flight
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    if (disjoint) {
+        // Drop the results without reading them; the query objects can simply be reused
+        for (auto& query : queries) {
+            query.pending = false;
+        }
+        readIndex = writeIndex;
+        return false;
+    }
+
+    Query& query = queries[readIndex];
+    if (!query.pending) {
+        return false;
+    }
+
+    GLuint resultAvailable = GL_FALSE;
+    timerQuery.getQueryObjectuiv(query.id, GL_QUERY_RESULT_AVAILABLE_EXT, &resultAvailable);
+    if (!resultAvailable) {
+        return false;
+    }
+
+    GLuint64 elapsedNs = 0;
+    timerQuery.getQueryObjectui64v(query.id, GL_QUERY_RESULT_EXT, &elapsedNs);
+    query.pending = false;
+    readIndex = (readIndex + 1) % queries.size();
+
+    elapsedMs = static_cast<double>(elapsedNs) / 1.0e6;
+    return true;
+}
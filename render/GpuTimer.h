@@ -0,0 +1,51 @@
+#pragma once
+
+#include <angle_gl.h>
+#include <cstddef>
+#include <vector>
+
+// How the renderers measure GPU work
+enum class TimingMode {
+    Off,       // No timing
+    GpuTimer,  // GL_EXT_disjoint_timer_query, results read back a few frames later
+    Precise    // glFinish around the measured work; exact but drains the pipeline every frame
+};
+
+// Ring of GL_EXT_disjoint_timer_query elapsed-time queries.
+// begin()/end() bracket the work to measure; collect() returns results once the
+// GPU has produced them, typically a couple of frames later, so measuring never
+// stalls the CPU. Results spanning a disjoint event (e.g. a GPU clock change)
+// are discarded.
+class GpuTimer {
+public:
+    GpuTimer();
+
+    // Create the queries (needs a current context). Returns false if the
+    // extension is not available, in which case begin/end/collect do nothing.
+    bool initialize(int latencyFrames = 4);
+    void destroy();
+    bool isAvailable() const { return available; }
+
+    // Bracket the GPU work to time. Queries cannot nest.
+    void begin();
+    void end();
+
+    // Fetch the oldest finished measurement. Returns false if none is ready yet.
+    bool collect(double& elapsedMs);
+
+    // Whether the current context exposes the timer query extension
+    static bool isSupported();
+
+private:
+    struct Query {
+        GLuint id = 0;
+        bool pending = false;  // Ended but not yet read back
+    };
+
+    bool available;
+    bool active;      // Between begin() and end()
+    bool skipped;     // begin() found no free query, so end() must not end one
+    std::vector<Query> queries;
+    size_t writeIndex;
+    size_t readIndex;
+};
@@ -0,0 +1,51 @@
+#include "GpuTrace.h"
+
+#if SHADERDEMO_TRACING
+
+#include <angle_gl.h>
+#include <EGL/egl.h>
+#include <cstring>
+#include <mutex>
+
+namespace {
+
+// GL_KHR_debug entry points, resolved once through eglGetProcAddress
+struct DebugGroupFunctions {
+    PFNGLPUSHDEBUGGROUPKHRPROC pushDebugGroup = nullptr;
+    PFNGLPOPDEBUGGROUPKHRPROC popDebugGroup = nullptr;
+    std::once_flag loaded;
+
+    bool load() {
+        // The first caller has a context current, so the extension string can be checked
+        std::call_once(loaded, [this] {
+            const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+            if (!extensions || !strstr(extensions, "GL_KHR_debug")) {
+                return;
+            }
+            pushDebugGroup = reinterpret_cast<PFNGLPUSHDEBUGGROUPKHRPROC>(eglGetProcAddress("glPushDebugGroupKHR"));
+            popDebugGroup = reinterpret_cast<PFNGLPOPDEBUGGROUPKHRPROC>(eglGetProcAddress("glPopDebugGroupKHR"));
+            if (!pushDebugGroup || !popDebugGroup) {
+                pushDebugGroup = nullptr;
+            }
+        });
+        return pushDebugGroup != nullptr;
+    }
+};
+
+DebugGroupFunctions debugGroup;
+
+} // namespace
+
+GpuZone::GpuZone(const char* name) : zone(name), pushed(debugGroup.load()) {
+    if (pushed) {
+        debugGroup.pushDebugGroup(GL_DEBUG_SOURCE_APPLICATION_KHR, 0, -1, name);
+    }
+}
+
+GpuZone::~GpuZone() {
+    if (pushed) {
+        debugGroup.popDebugGroup();
+    }
+}
+
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Trace.h"
+
+// GPU zones: a GL_KHR_debug group around the GL calls of a block, so that the
+// work appears under that name in RenderDoc and PIX captures, plus a CPU zone
+// for the submission in ETW traces. GPU durations are reported separately
+// with TRACE_GPU_TIME once the timer queries resolve. Needs a current context;
+// compiles to nothing unless SHADERDEMO_TRACING is set.
+
+#if SHADERDEMO_TRACING
+
+class GpuZone {
+public:
+    explicit GpuZone(const char* name);
+    ~GpuZone();
+
+    GpuZone(const GpuZone&) = delete;
+    GpuZone& operator=(const GpuZone&) = delete;
+
+private:
+    Trace::Zone zone;
+    bool pushed;
+};
+
+#define TRACE_GPU_ZONE(name) GpuZone TRACE_CONCAT(gpuZone, __LINE__)(name)
+
+#else
+
+#define TRACE_GPU_ZONE(name) ((void)0)
+
+#endif
@@ -0,0 +1,283 @@
+#include "LayerCompositor.h"
+#include "GpuTrace.h"
+#include "ShaderProgram.h"
+
+#include <iostream>
+
+bool LayerCompositor::parseBlendMode(const std::string& name, BlendMode& mode) {
+    if (name == "normal") {
+        mode = BlendMode::Normal;
+    } else if (name == "add") {
+        mode = BlendMode::Add;
+    } else if (name == "multiply") {
+        mode = BlendMode::Multiply;
+    } else if (name == "screen") {
+        mode = BlendMode::Screen;
+    } else {
+        std::cerr << "Unknown blend mode: " << name << " (use normal, add, multiply or screen)" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+LayerCompositor::LayerCompositor()
+    : quad(nullptr), frameStats(nullptr), gles3(false),
+      targetTexture(0), targetFramebuffer(0), targetWidth(0), targetHeight(0) {
+}
+
+bool LayerCompositor::addLayer(ImageLoader& loader, float opacity, BlendMode mode) {
+    if (layers.size() >= static_cast<size_t>(MaxLayers)) {
+        std::cerr << "At most " << MaxLayers << " layers can be composited" << std::endl;
+        return false;
+    }
+    std::unique_ptr<Layer> layer(new Layer());
+    layer->loader = &loader;
+    layer->opacity = opacity < 0.0f ? 0.0f : (opacity > 1.0f ? 1.0f : opacity);
+    layer->mode = mode;
+    layer->uploadedFrame = TextureUploader::NoKey;
+    layers.push_back(std::move(layer));
+    return true;
+}
+
+bool LayerCompositor::initialize(FullscreenQuad* fullscreenQuad, FrameStats* stats, bool es3) {
+    quad = fullscreenQuad;
+    frameStats = stats;
+    gles3 = es3;
+
+    // Layers are only sampled, so compressed frames can stay compressed
+    for (auto& layer : layers) {
+        layer->uploader.create(gles3);
+        layer->uploader.enableCompressedUploads();
+    }
+
+    if (!buildProgram(false, frameProgram)) {
+        std::cerr << "Failed to build the layer composite program" << std::endl;
+        return false;
+    }
+    // Resident sequences hand over layers of a texture array
+    if (gles3 && !buildProgram(true, arrayProgram)) {
+        std::cout << "Layer composite program for texture arrays unavailable" << std::endl;
+    }
+
+    glGenFramebuffers(1, &targetFramebuffer);
+    std::cout << "Compositing " << layers.size() << " layer(s) over the frames" << std::endl;
+    return true;
+}
+
+void LayerCompositor::destroy() {
+    for (auto& layer : layers) {
+        layer->uploader.destroy();
+        layer->uploadedFrame = TextureUploader::NoKey;
+    }
+    for (Program* program : { &frameProgram, &arrayProgram }) {
+        if (program->program) {
+            glDeleteProgram(program->program);
+            program->program = 0;
+        }
+    }
+    if (targetFramebuffer) {
+        glDeleteFramebuffers(1, &targetFramebuffer);
+        targetFramebuffer = 0;
+    }
+    if (targetTexture) {
+        glDeleteTextures(1, &targetTexture);
+        targetTexture = 0;
+    }
+    targetWidth = targetHeight = 0;
+}
+
+std::string LayerCompositor::vertexSource(bool arrayFrame) const {
+    if (arrayFrame) {
+        return "#version 300 es\n"
+               "in vec4 aPosition;\n"
+               "in vec2 aTexCoord;\n"
+               "out vec2 vTexCoord;\n"
+               "void main() {\n"
+               "    gl_Position = aPosition;\n"
+               "    vTexCoord = aTexCoord;\n"
+               "}\n";
+    }
+    return "attribute vec4 aPosition;\n"
+           "attribute vec2 aTexCoord;\n"
+           "varying vec2 vTexCoord;\n"
+           "void main() {\n"
+           "    gl_Position = aPosition;\n"
+           "    vTexCoord = aTexCoord;\n"
+           "}\n";
+}
+
+std::string LayerCompositor::fragmentSource(bool arrayFrame) const {
+    // Each layer is its own sampler and line, so the blend modes are constant
+    // code rather than per-pixel branches
+    std::string sample = arrayFrame ? "texture" : "texture2D";
+    std::string source;
+    if (arrayFrame) {
+        source += "#version 300 es\n"
+                  "precision mediump float;\n"
+                  "precision mediump sampler2DArray;\n"
+                  "in vec2 vTexCoord;\n"
+                  "out vec4 fragColor;\n"
+                  "uniform sampler2DArray uFrame;\n"
+                  "uniform float uFrameLayer;\n";
+    } else {
+        source += "precision mediump float;\n"
+                  "varying vec2 vTexCoord;\n"
+                  "uniform sampler2D uFrame;\n";
+    }
+    for (size_t i = 0; i < layers.size(); ++i) {
+        source += "uniform sampler2D uLayer" + std::to_string(i) + ";\n";
+    }
+    source += "uniform float uOpacity[" + std::to_string(layers.size()) + "];\n"
+              "void main() {\n";
+    source += arrayFrame ? "    vec4 color = texture(uFrame, vec3(vTexCoord, uFrameLayer));\n"
+                         : "    vec4 color = texture2D(uFrame, vTexCoord);\n";
+    source += "    vec4 layer;\n";
+    for (size_t i = 0; i < layers.size(); ++i) {
+        const char* blended = "layer.rgb";
+        switch (layers[i]->mode) {
+            case BlendMode::Normal:   blended = "layer.rgb"; break;
+            case BlendMode::Add:      blended = "min(color.rgb + layer.rgb, vec3(1.0))"; break;
+            case BlendMode::Multiply: blended = "color.rgb * layer.rgb"; break;
+            case BlendMode::Screen:   blended = "vec3(1.0) - (vec3(1.0) - color.rgb) * (vec3(1.0) - layer.rgb)"; break;
+        }
+        std::string index = std::to_string(i);
+        source += "    layer = " + sample + "(uLayer" + index + ", vTexCoord);\n"
+                  "    color.rgb = mix(color.rgb, " + blended + ", layer.a * uOpacity[" + index + "]);\n";
+    }
+    source += arrayFrame ? "    fragColor = color;\n" : "    gl_FragColor = color;\n";
+    source += "}\n";
+    return source;
+}
+
+bool LayerCompositor::buildProgram(bool arrayFrame, Program& program) {
+    GLuint linked = ShaderProgram::create(vertexSource(arrayFrame).c_str(), fragmentSource(arrayFrame).c_str());
+    if (!linked) {
+        return false;
+    }
+    program.program = linked;
+    program.uFrameLayerLocation = glGetUniformLocation(linked, "uFrameLayer");
+
+    // Samplers and opacities are fixed for the compositor's lifetime
+    std::vector<GLfloat> opacities;
+    glUseProgram(linked);
+    glUniform1i(glGetUniformLocation(linked, "uFrame"), 0);
+    for (size_t i = 0; i < layers.size(); ++i) {
+        std::string name = "uLayer" + std::to_string(i);
+        glUniform1i(glGetUniformLocation(linked, name.c_str()), static_cast<GLint>(i + 1));
+        opacities.push_back(layers[i]->opacity);
+    }
+    glUniform1fv(glGetUniformLocation(linked, "uOpacity"), static_cast<GLsizei>(opacities.size()), opacities.data());
+    glUseProgram(0);
+    return true;
+}
+
+void LayerCompositor::addGpuAllocations(std::vector<GpuAllocation>& allocations) const {
+    for (size_t i = 0; i < layers.size(); ++i) {
+        allocations.push_back({ "Layer " + std::to_string(i + 1) + " upload", layers[i]->uploader.getMemoryBytes() });
+    }
+    if (targetTexture) {
+        allocations.push_back({ "Composite target", TextureUploader::estimateBytes(GL_RGBA8, targetWidth, targetHeight) });
+    }
+}
+
+bool LayerCompositor::ensureTarget(int width, int height) {
+    if (targetTexture && width == targetWidth && height == targetHeight) {
+        return true;
+    }
+
+    // RGBA8 on both versions; immutable on ES3 so the compute pipeline can bind it as an image
+    if (targetTexture) {
+        glDeleteTextures(1, &targetTexture);
+    }
+    glGenTextures(1, &targetTexture);
+    glBindTexture(GL_TEXTURE_2D, targetTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (gles3) {
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+    } else {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, targetTexture, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        std::cerr << "Layer composite target " << width << "x" << height << " is incomplete" << std::endl;
+        glDeleteTextures(1, &targetTexture);
+        targetTexture = 0;
+        return false;
+    }
+    targetWidth = width;
+    targetHeight = height;
+    return true;
+}
+
+void LayerCompositor::updateLayer(Layer& layer, size_t frameIndex, int direction) {
+    size_t count = layer.loader->getImageCount();
+    if (count == 0) {
+        return;
+    }
+    size_t index = frameIndex % count;
+    if (index == layer.uploadedFrame) {
+        return;
+    }
+
+    // The layer's prefetcher follows the playhead like the main sequence's
+    layer.loader->setPlaybackPosition(index, direction);
+    std::shared_ptr<const ImageData> imageData = layer.loader->acquireImage(index);
+    if (!imageData || !imageData->isValid()) {
+        std::cerr << "Invalid layer frame: " << layer.loader->getImageName(index) << std::endl;
+        return;
+    }
+    FrameStats::Scope timing(frameStats, FrameStage::Upload);
+    if (layer.uploader.upload(*imageData)) {
+        timing.addBytes(imageData->data.size());
+        layer.uploadedFrame = index;
+    }
+}
+
+bool LayerCompositor::composite(const PipelineFrame& frame, size_t frameIndex, int direction, PipelineFrame& composite) {
+    bool fromArray = frame.target == GL_TEXTURE_2D_ARRAY;
+    const Program& program = fromArray ? arrayProgram : frameProgram;
+    if (layers.empty() || !program.program || !frame.texture || !ensureTarget(frame.width, frame.height)) {
+        return false;
+    }
+
+    {
+        TRACE_ZONE("Upload layers");
+        for (auto& layer : layers) {
+            updateLayer(*layer, frameIndex, direction);
+        }
+    }
+
+    TRACE_GPU_ZONE("Composite layers");
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+    glViewport(0, 0, targetWidth, targetHeight);
+    glUseProgram(program.program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(frame.target, frame.texture);
+    if (fromArray) {
+        glUniform1f(program.uFrameLayerLocation, static_cast<float>(frame.layer));
+    }
+    for (size_t i = 0; i < layers.size(); ++i) {
+        glActiveTexture(GL_TEXTURE1 + static_cast<GLenum>(i));
+        glBindTexture(GL_TEXTURE_2D, layers[i]->uploader.getTexture());
+    }
+    quad->draw();
+    glActiveTexture(GL_TEXTURE0);
+    glUseProgram(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    composite.texture = targetTexture;
+    composite.target = GL_TEXTURE_2D;
+    composite.layer = 0;
+    composite.width = targetWidth;
+    composite.height = targetHeight;
+    composite.internalFormat = GL_RGBA8;
+    return true;
+}
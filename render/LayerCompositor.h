@@ -0,0 +1,94 @@
+#pragma once
+
+#include <angle_gl.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../reader/ImageLoader.h"
+#include "FrameStats.h"
+#include "FullscreenQuad.h"
+#include "RenderPipeline.h"
+#include "TextureUploader.h"
+
+// Blends further image sequences over the playback frame before the pipeline
+// draws it. Every layer has its own loader (usually sharing a
+// PrefetchScheduler with the main one) and upload texture; one fragment draw
+// samples the frame and all layers and writes the composite into an RGBA8
+// target of the frame's size, which the pipeline then receives as its frame.
+// So effects apply to the composite, and compositing costs one pass whatever
+// the layer count.
+//
+// Layer i shows frame (playback frame % its length), so shorter sequences
+// loop, and is stretched to the frame's size. The frame may be a layer of a
+// resident texture array. The program is generated for the layer count and
+// blend modes when the compositor is initialized.
+class LayerCompositor {
+public:
+    enum class BlendMode {
+        Normal,    // Layer over the frame by its alpha
+        Add,       // Frame + layer
+        Multiply,  // Frame * layer
+        Screen     // 1 - (1 - frame) * (1 - layer)
+    };
+
+    // Layers beyond the frame; with it, the texture units ES2 guarantees
+    static const int MaxLayers = 7;
+
+    // "normal", "add", "multiply" or "screen"; returns false for other names
+    static bool parseBlendMode(const std::string& name, BlendMode& mode);
+
+    LayerCompositor();
+
+    // Add a layer drawn with opacity (0 - 1) and mode over the ones before it
+    // (before initialize). Returns false once MaxLayers are set.
+    bool addLayer(ImageLoader& loader, float opacity, BlendMode mode);
+    bool hasLayers() const { return !layers.empty(); }
+
+    // Create textures, the target and the programs for the layers added
+    bool initialize(FullscreenQuad* quad, FrameStats* frameStats, bool gles3);
+    void destroy();
+
+    // Upload the layers' frames for playback frame frameIndex (waiting for
+    // their decode if needed) and draw the composite of frame and layers.
+    // direction (+1/-1) steers the layers' prefetching. Leaves the default
+    // framebuffer bound; returns false, leaving composite untouched, on failure.
+    bool composite(const PipelineFrame& frame, size_t frameIndex, int direction, PipelineFrame& composite);
+
+    // Append the layers' upload textures and the composite target, with their estimated size
+    void addGpuAllocations(std::vector<GpuAllocation>& allocations) const;
+
+private:
+    struct Layer {
+        ImageLoader* loader;
+        float opacity;
+        BlendMode mode;
+        TextureUploader uploader;
+        size_t uploadedFrame;  // Frame of the layer's own sequence in uploader
+    };
+    std::vector<std::unique_ptr<Layer>> layers;
+
+    FullscreenQuad* quad;
+    FrameStats* frameStats;
+    bool gles3;
+
+    // Composite program for 2D frames and, on ES3, for layers of a texture array
+    struct Program {
+        GLuint program = 0;
+        GLint uFrameLayerLocation = -1;
+    };
+    Program frameProgram;
+    Program arrayProgram;
+
+    // Render target the composite is drawn into
+    GLuint targetTexture;
+    GLuint targetFramebuffer;
+    int targetWidth;
+    int targetHeight;
+
+    // Shader sources for the current layers
+    std::string vertexSource(bool arrayFrame) const;
+    std::string fragmentSource(bool arrayFrame) const;
+    bool buildProgram(bool arrayFrame, Program& program);
+    bool ensureTarget(int width, int height);
+    void updateLayer(Layer& layer, size_t frameIndex, int direction);
+};
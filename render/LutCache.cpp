@@ -0,0 +1,193 @@
+#include "LutCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "TextureUploader.h"
+
+// GL_MAX_3D_TEXTURE_SIZE is at least 256 on ES3; production LUTs are 17-65
+static const int kMaxLutSize = 256;
+
+bool CubeLut::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot read LUT " << path << std::endl;
+        return false;
+    }
+    title.clear();
+    size = 0;
+    rgb.clear();
+    std::fill(domainMin, domainMin + 3, 0.0f);
+    std::fill(domainMax, domainMax + 3, 1.0f);
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::string keyword;
+        if (!(fields >> keyword)) {
+            continue; // Blank or comment
+        }
+        bool ok = true;
+        if (keyword == "TITLE") {
+            std::getline(fields >> std::ws, title);
+            title.erase(std::remove(title.begin(), title.end(), '"'), title.end());
+        } else if (keyword == "LUT_3D_SIZE") {
+            ok = (fields >> size) && size >= 2 && size <= kMaxLutSize && rgb.empty();
+        } else if (keyword == "DOMAIN_MIN") {
+            ok = static_cast<bool>(fields >> domainMin[0] >> domainMin[1] >> domainMin[2]);
+        } else if (keyword == "DOMAIN_MAX") {
+            ok = static_cast<bool>(fields >> domainMax[0] >> domainMax[1] >> domainMax[2]);
+        } else if (keyword == "LUT_3D_INPUT_RANGE") {
+            float low = 0.0f;
+            float high = 1.0f;
+            ok = static_cast<bool>(fields >> low >> high);
+            std::fill(domainMin, domainMin + 3, low);
+            std::fill(domainMax, domainMax + 3, high);
+        } else if (keyword == "LUT_1D_SIZE" || keyword == "LUT_1D_INPUT_RANGE") {
+            std::cerr << path << ":" << lineNumber << ": 1D LUTs are not supported" << std::endl;
+            return false;
+        } else {
+            // An entry, once the size is known: the keyword was its red value
+            fields.clear();
+            fields.seekg(0);
+            float entry[3];
+            ok = size > 0 && rgb.size() < static_cast<size_t>(size) * size * size * 3 &&
+                 (fields >> entry[0] >> entry[1] >> entry[2]);
+            if (ok) {
+                rgb.insert(rgb.end(), entry, entry + 3);
+            }
+        }
+        std::string extra;
+        if (!ok || (fields >> extra)) {
+            std::cerr << path << ":" << lineNumber << ": unexpected \"" << line << "\"" << std::endl;
+            return false;
+        }
+    }
+    size_t expected = static_cast<size_t>(size) * size * size;
+    if (size == 0 || rgb.size() != expected * 3) {
+        std::cerr << path << ": expected " << expected << " entries, found " << rgb.size() / 3 << std::endl;
+        return false;
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        if (!(domainMax[axis] > domainMin[axis])) {
+            std::cerr << path << ": empty domain" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+LutCache::LutCache() : format(GL_RGBA8) {
+}
+
+void LutCache::select(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    selected = path;
+}
+
+bool LutCache::hasSelection() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !selected.empty();
+}
+
+const LutTexture* LutCache::getSelected() {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        path = selected;
+    }
+    if (path.empty()) {
+        return nullptr;
+    }
+    auto found = textures.find(path);
+    if (found == textures.end()) {
+        // Failures are kept too, so a bad file is read and reported once
+        CubeLut lut;
+        LutTexture texture = {};
+        if (lut.load(path)) {
+            texture = upload(lut, format);
+            if (texture.texture) {
+                std::cout << "LUT " << path << (lut.title.empty() ? "" : " (" + lut.title + ")") << ": " << lut.size
+                          << "^3, " << (format == GL_RGBA16F ? "RGBA16F" : "RGBA8") << std::endl;
+            }
+        }
+        found = textures.emplace(path, texture).first;
+    }
+    return found->second.texture ? &found->second : nullptr;
+}
+
+LutTexture LutCache::upload(const CubeLut& lut, GLenum internalFormat) {
+    LutTexture result = {};
+    size_t count = static_cast<size_t>(lut.size) * lut.size * lut.size;
+    // Errors of earlier calls must not be taken for the upload's
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    // Rows of RGBA texels are 4-byte aligned, so any unpack alignment (the
+    // uploaders keep 1) reads them as written
+    glGenTextures(1, &result.texture);
+    glBindTexture(GL_TEXTURE_3D, result.texture);
+    if (internalFormat == GL_RGBA16F) {
+        // Taken as floats; GL converts them to half floats
+        std::vector<float> texels(count * 4, 1.0f);
+        for (size_t i = 0; i < count; ++i) {
+            std::copy(&lut.rgb[i * 3], &lut.rgb[i * 3] + 3, &texels[i * 4]);
+        }
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, lut.size, lut.size, lut.size, 0, GL_RGBA, GL_FLOAT, texels.data());
+    } else {
+        std::vector<uint8_t> texels(count * 4, 255);
+        for (size_t i = 0; i < count; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                float value = std::min(std::max(lut.rgb[i * 3 + c], 0.0f), 1.0f);
+                texels[i * 4 + c] = static_cast<uint8_t>(std::lround(value * 255.0f));
+            }
+        }
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8, lut.size, lut.size, lut.size, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+    }
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    if (glGetError() != GL_NO_ERROR) {
+        std::cerr << "Failed to upload a " << lut.size << "^3 LUT" << std::endl;
+        glDeleteTextures(1, &result.texture);
+        return LutTexture();
+    }
+
+    // The domain's ends land on the centers of the first and last texels, so
+    // the filter interpolates between entries and never past them
+    result.size = lut.size;
+    result.internalFormat = internalFormat;
+    for (int axis = 0; axis < 3; ++axis) {
+        float span = lut.domainMax[axis] - lut.domainMin[axis];
+        result.scale[axis] = (lut.size - 1) / (lut.size * span);
+        result.offset[axis] = 0.5f / lut.size - lut.domainMin[axis] * result.scale[axis];
+    }
+    return result;
+}
+
+void LutCache::destroy() {
+    for (auto& entry : textures) {
+        if (entry.second.texture) {
+            glDeleteTextures(1, &entry.second.texture);
+        }
+    }
+    textures.clear();
+}
+
+size_t LutCache::getMemoryBytes() const {
+    size_t bytes = 0;
+    for (const auto& entry : textures) {
+        if (entry.second.texture) {
+            const LutTexture& lut = entry.second;
+            bytes += TextureUploader::estimateBytes(lut.internalFormat, lut.size, lut.size, lut.size);
+        }
+    }
+    return bytes;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <angle_gl.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A 3D color lookup table as stored in an Adobe/Resolve .cube file
+struct CubeLut {
+    std::string title;
+    int size = 0;  // Entries per axis
+    float domainMin[3] = { 0.0f, 0.0f, 0.0f };
+    float domainMax[3] = { 1.0f, 1.0f, 1.0f };
+    // size^3 RGB entries, red changing fastest, then green, then blue (the
+    // order of the file, which is also the x, y, z order of a 3D texture)
+    std::vector<float> rgb;
+
+    // Read a .cube file: LUT_3D_SIZE, optional TITLE, DOMAIN_MIN/MAX (or
+    // LUT_3D_INPUT_RANGE) and the entries; '#' starts a comment. Returns
+    // false, naming the line, for 1D LUTs and malformed or incomplete files.
+    bool load(const std::string& path);
+};
+
+// A LUT resident on the GPU, sampled with its domain mapped to texel centers
+struct LutTexture {
+    GLuint texture;         // 0 if the file could not be used
+    int size;
+    GLenum internalFormat;  // GL_RGBA8 or GL_RGBA16F
+    // Texture coordinate of a color: color * scale + offset
+    float scale[3];
+    float offset[3];
+};
+
+// 3D LUT grading for the pipelines (ES3): every .cube file is uploaded once,
+// as a GL_TEXTURE_3D with trilinear filtering, and kept by path, so switching
+// between LUTs afterwards costs neither a parse, an upload nor a shader
+// compile: the grading program only samples another texture. The selection
+// may change from any thread; the render thread picks it up with the next frame.
+class LutCache {
+public:
+    LutCache();
+
+    // Storage of LUTs uploaded from now on (render thread): GL_RGBA8
+    // (default) or GL_RGBA16F, which keeps values outside 0-1 and the
+    // precision of half-float chains
+    void setFormat(GLenum internalFormat) { format = internalFormat; }
+
+    // The LUT to grade with, empty for none (any thread)
+    void select(const std::string& path);
+    bool hasSelection() const;
+
+    // The selected LUT, uploaded on its first use (render thread); null when
+    // none is selected or the file cannot be used (reported once per path)
+    const LutTexture* getSelected();
+
+    // Delete every texture (needs the owning context to be current)
+    void destroy();
+
+    // Estimated texture memory of the uploaded LUTs
+    size_t getMemoryBytes() const;
+
+private:
+    mutable std::mutex mutex;
+    std::string selected;  // Guarded by mutex
+    GLenum format;
+    std::unordered_map<std::string, LutTexture> textures;  // Render thread only
+
+    static LutTexture upload(const CubeLut& lut, GLenum internalFormat);
+};
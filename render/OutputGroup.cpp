@@ -0,0 +1,218 @@
+#include "OutputGroup.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <iostream>
+
+OutputGroup::OutputGroup(ImageLoader& loader, int textureCount)
+    : loader(loader), useClock(0), display(EGL_NO_DISPLAY), config(nullptr), gles3(false) {
+    for (int i = 0; i < std::max(textureCount, 2); ++i) {
+        slots.emplace_back(new Slot());
+    }
+}
+
+OutputGroup::~OutputGroup() {
+    close();
+}
+
+bool OutputGroup::open(const DisplayBackend& backend, int minimumClientVersion, bool requireRGBA) {
+    // Every output's window surface is created on this display; the default
+    // native display lets windows on any monitor share it
+    display = backend.open(EGL_DEFAULT_DISPLAY);
+    EGLint majorVersion, minorVersion;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &majorVersion, &minorVersion)) {
+        std::cerr << "Failed to initialize the shared EGL display (" << backend.getName() << " backend)" << std::endl;
+        display = EGL_NO_DISPLAY;
+        return false;
+    }
+    backend.logFeatures(display, std::cout);
+
+    // One config for the root context, the windows and the outputs' contexts
+    const EGLint clientVersions[] = { 3, 2 };
+    for (EGLint clientVersion : clientVersions) {
+        if (clientVersion < minimumClientVersion) {
+            break;
+        }
+        const EGLint configAttribs[] = {
+            EGL_SURFACE_TYPE, EGL_WINDOW_BIT | EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, clientVersion == 3 ? EGL_OPENGL_ES3_BIT_KHR : EGL_OPENGL_ES2_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_ALPHA_SIZE, 8,
+            EGL_NONE
+        };
+        EGLint numConfigs;
+        if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs <= 0) {
+            continue;
+        }
+        const EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, clientVersion, EGL_NONE };
+        if (rootContext.create(display, config, EGL_NO_CONTEXT, contextAttribs)) {
+            gles3 = clientVersion >= 3;
+            break;
+        }
+    }
+    if (!rootContext.isValid() || !rootContext.makeCurrent()) {
+        std::cerr << "Failed to create the shared EGL context" << std::endl;
+        close();
+        return false;
+    }
+
+    for (auto& slot : slots) {
+        slot->uploader.setRequireRGBA(requireRGBA);
+        slot->uploader.create(gles3);
+        if (!requireRGBA) {
+            slot->uploader.enableCompressedUploads();
+        }
+    }
+    rootContext.release();
+
+    std::cout << "Output group: ES " << (gles3 ? "3.0" : "2.0") << ", " << slots.size()
+              << " shared frame textures" << std::endl;
+    return true;
+}
+
+void OutputGroup::close() {
+    if (display == EGL_NO_DISPLAY) {
+        return;
+    }
+    if (rootContext.makeCurrent()) {
+        for (auto& slot : slots) {
+            waitForReleases(slot->released);
+            if (slot->ready) {
+                glDeleteSync(slot->ready);
+                slot->ready = nullptr;
+            }
+            slot->uploader.destroy();
+            slot->frame = NoFrame;
+        }
+        rootContext.release();
+    }
+    rootContext.destroy();
+    eglTerminate(display);
+    display = EGL_NO_DISPLAY;
+}
+
+void OutputGroup::waitForReleases(std::vector<GLsync>& fences) {
+    for (GLsync fence : fences) {
+        // A server-side wait: this context's upload is ordered after the draws, the CPU is not blocked
+        glWaitSync(fence, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fence);
+    }
+    fences.clear();
+}
+
+bool OutputGroup::acquire(size_t frameIndex, int direction, Frame& frame, FrameStats* stats) {
+    std::unique_lock<std::mutex> lock(mutex);
+    Slot* target = nullptr;
+    for (;;) {
+        Slot* victim = nullptr;
+        Slot* match = nullptr;
+        for (auto& slot : slots) {
+            if (slot->frame == frameIndex) {
+                match = slot.get();
+            } else if (slot->pins == 0 && !slot->uploading && (!victim || slot->lastUse < victim->lastUse)) {
+                victim = slot.get();
+            }
+        }
+        if (match && !match->uploading) {
+            // Uploaded by this or another output
+            match->pins++;
+            match->lastUse = ++useClock;
+            if (match->ready) {
+                glWaitSync(match->ready, 0, GL_TIMEOUT_IGNORED);
+            }
+            frame = { match->uploader.getTexture(), match->uploader.getWidth(), match->uploader.getHeight(),
+                      match->uploader.getInternalFormat() };
+            return true;
+        }
+        if (!match && victim) {
+            target = victim;
+            break;
+        }
+        // Another output is uploading the frame, or every texture is pinned
+        slotChanged.wait(lock);
+    }
+
+    target->frame = frameIndex;
+    target->uploading = true;
+    target->pins = 1;
+    std::vector<GLsync> released;
+    released.swap(target->released);
+    GLsync previousReady = target->ready;
+    target->ready = nullptr;
+    lock.unlock();
+
+    // The upload runs unlocked, so other outputs keep drawing frames that are already resident
+    TRACE_ZONE("Upload shared frame");
+    waitForReleases(released);
+    if (previousReady) {
+        glDeleteSync(previousReady);
+    }
+    loader.setPlaybackPosition(frameIndex, direction);
+    std::shared_ptr<const ImageData> imageData = loader.acquireImage(frameIndex);
+    bool ok = false;
+    if (imageData && imageData->isValid()) {
+        FrameStats::Scope timing(stats, FrameStage::Upload);
+        ok = target->uploader.upload(*imageData);
+        if (ok) {
+            timing.addBytes(imageData->data.size());
+        }
+    } else {
+        std::cerr << "Invalid image data for: " << loader.getImageName(frameIndex) << std::endl;
+    }
+    GLsync ready = nullptr;
+    if (ok) {
+        // Other contexts wait for the upload on the GPU (ES3); ES2 has no fences, so finish it here
+        if (gles3) {
+            ready = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+        } else {
+            glFinish();
+        }
+    }
+
+    lock.lock();
+    target->uploading = false;
+    target->ready = ready;
+    if (ok) {
+        target->lastUse = ++useClock;
+        frame = { target->uploader.getTexture(), target->uploader.getWidth(), target->uploader.getHeight(),
+                  target->uploader.getInternalFormat() };
+    } else {
+        target->frame = NoFrame;
+        target->pins = 0;
+    }
+    lock.unlock();
+    slotChanged.notify_all();
+    return ok;
+}
+
+void OutputGroup::release(size_t frameIndex) {
+    // Fence this output's last draw; the texture is not overwritten before it completes
+    GLsync fence = nullptr;
+    if (gles3) {
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+    } else {
+        glFinish();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& slot : slots) {
+            if (slot->frame == frameIndex && slot->pins > 0) {
+                slot->pins--;
+                if (fence) {
+                    slot->released.push_back(fence);
+                    fence = nullptr;
+                }
+                break;
+            }
+        }
+    }
+    if (fence) {
+        glDeleteSync(fence);
+    }
+    slotChanged.notify_all();
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <angle_gl.h>
+#include <EGL/egl.h>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "../reader/ImageLoader.h"
+#include "DisplayBackend.h"
+#include "FrameStats.h"
+#include "SharedContext.h"
+#include "TextureUploader.h"
+
+// Several renderers, one per window, showing the same sequence (e.g. one per
+// monitor, each with its own pipeline). They share one EGL display and share
+// group: a frame is decoded once by the shared loader and uploaded once into a
+// texture of the group's pool, and every output samples that texture. Each
+// renderer keeps its own render thread, pacing and playback controls, so
+// outputs on displays with different refresh rates never wait for each other.
+//
+// The output that first needs a frame uploads it and moves the loader's
+// playhead, so prefetching follows the leading output while the others mostly
+// find their frames already on the GPU. A frame an output draws is pinned
+// until it moves on; textures are only overwritten once every output's last
+// draw from them has completed.
+class OutputGroup {
+public:
+    // A pooled frame texture
+    struct Frame {
+        GLuint texture;
+        int width;
+        int height;
+        GLenum internalFormat;
+    };
+
+    // textureCount should leave a couple of textures per output for uploads
+    explicit OutputGroup(ImageLoader& loader, int textureCount = 8);
+    ~OutputGroup();
+
+    OutputGroup(const OutputGroup&) = delete;
+    OutputGroup& operator=(const OutputGroup&) = delete;
+
+    // Open the display and the share group's root context (before starting
+    // the renderers). ES3 is preferred; minimumClientVersion is the highest any
+    // output's pipeline needs. requireRGBA stores frames as RGBA8 for
+    // pipelines that bind them as images (see RenderPipeline::requiresRGBA).
+    bool open(const DisplayBackend& backend, int minimumClientVersion, bool requireRGBA);
+    // Release the textures and the display once every renderer has stopped
+    void close();
+
+    EGLDisplay getDisplay() const { return display; }
+    EGLConfig getConfig() const { return config; }
+    EGLContext getShareContext() const { return rootContext.getContext(); }
+    bool isGLES3() const { return gles3; }
+
+    // Render thread of an output, with its context current: the texture holding
+    // frameIndex, uploaded now if no output has done so. The frame is pinned
+    // until release(). direction (+1/-1) steers prefetching. Returns false if
+    // the frame cannot be loaded.
+    bool acquire(size_t frameIndex, int direction, Frame& frame, FrameStats* stats);
+    // Render thread: unpin a frame after the output's last draw from it was issued
+    void release(size_t frameIndex);
+
+private:
+    static const size_t NoFrame = static_cast<size_t>(-1);
+
+    struct Slot {
+        TextureUploader uploader;
+        size_t frame = NoFrame;
+        bool uploading = false;  // An output is uploading frame into the texture
+        int pins = 0;            // Outputs drawing the frame
+        uint64_t lastUse = 0;    // Least recently used unpinned slots are overwritten first
+        GLsync ready = nullptr;  // Signalled once the upload is complete, for the other contexts
+        std::vector<GLsync> released;  // After each output's last draw of the frame
+    };
+
+    ImageLoader& loader;
+    std::vector<std::unique_ptr<Slot>> slots;
+    uint64_t useClock;
+
+    EGLDisplay display;
+    EGLConfig config;
+    SharedContext rootContext;  // Keeps the share group and the pool alive
+    bool gles3;
+
+    std::mutex mutex;
+    std::condition_variable slotChanged;  // An upload finished or a frame was unpinned
+
+    // Make the previous uses of a slot's texture complete before it is rewritten
+    void waitForReleases(std::vector<GLsync>& fences);
+};
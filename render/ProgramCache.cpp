@@ -0,0 +1,178 @@
+#include "ProgramCache.h"
+
+#include <EGL/egl.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Header of a cached binary file
+struct ProgramBinaryHeader {
+    char magic[4];        // "SDPB"
+    uint32_t version;
+    uint64_t key;         // Hash of sources and context strings, checked on load
+    uint32_t binaryFormat;
+    uint32_t length;
+};
+
+const uint32_t kProgramBinaryVersion = 1;
+
+std::string cacheDirectory = "shadercache";
+
+// glGetProgramBinary/glProgramBinary, from core ES3 or GL_OES_get_program_binary
+struct ProgramBinaryFunctions {
+    PFNGLGETPROGRAMBINARYOESPROC getProgramBinary = nullptr;
+    PFNGLPROGRAMBINARYOESPROC programBinary = nullptr;
+    bool core = false;
+
+    bool load() {
+        getProgramBinary = nullptr;
+        programBinary = nullptr;
+        const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+        core = version && strstr(version, "OpenGL ES 3") != nullptr;
+        if (core) {
+            getProgramBinary = &glGetProgramBinary;
+            programBinary = &glProgramBinary;
+        } else {
+            const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+            if (!extensions || !strstr(extensions, "GL_OES_get_program_binary")) {
+                return false;
+            }
+            getProgramBinary = reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(eglGetProcAddress("glGetProgramBinaryOES"));
+            programBinary = reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(eglGetProcAddress("glProgramBinaryOES"));
+        }
+        if (!getProgramBinary || !programBinary) {
+            return false;
+        }
+
+        // Some drivers expose the entry points without any binary format
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formatCount);
+        return formatCount > 0;
+    }
+};
+
+// FNV-1a over every source and the strings identifying GPU and driver
+uint64_t programKey(std::initializer_list<const char*> sources) {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const char* text) {
+        for (const char* c = text ? text : ""; *c; ++c) {
+            hash = (hash ^ static_cast<unsigned char>(*c)) * 1099511628211ull;
+        }
+        hash = (hash ^ 0xffu) * 1099511628211ull; // Separator, so "ab"+"c" differs from "a"+"bc"
+    };
+    for (const char* source : sources) {
+        mix(source);
+    }
+    mix(reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    mix(reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    return hash;
+}
+
+fs::path binaryPath(uint64_t key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return fs::path(cacheDirectory) / name;
+}
+
+} // namespace
+
+void ProgramCache::setDirectory(const std::string& directory) {
+    cacheDirectory = directory;
+}
+
+void ProgramCache::prepare(GLuint program) {
+    // Only ES3 has the hint; OES_get_program_binary always allows retrieval
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    if (version && strstr(version, "OpenGL ES 3") != nullptr) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+}
+
+GLuint ProgramCache::load(std::initializer_list<const char*> sources) {
+    ProgramBinaryFunctions functions;
+    if (!functions.load()) {
+        return 0;
+    }
+
+    uint64_t key = programKey(sources);
+    fs::path path = binaryPath(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return 0;
+    }
+
+    ProgramBinaryHeader header;
+    std::vector<char> binary;
+    bool valid = file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+                 memcmp(header.magic, "SDPB", 4) == 0 && header.version == kProgramBinaryVersion &&
+                 header.key == key && header.length > 0;
+    if (valid) {
+        binary.resize(header.length);
+        valid = static_cast<bool>(file.read(binary.data(), binary.size()));
+    }
+    file.close();
+
+    GLuint program = 0;
+    if (valid) {
+        program = glCreateProgram();
+        functions.programBinary(program, header.binaryFormat, binary.data(), static_cast<GLint>(binary.size()));
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            // Usually a driver update; the caller relinks and stores a fresh binary
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    if (!program) {
+        std::error_code error;
+        fs::remove(path, error);
+    }
+    return program;
+}
+
+void ProgramCache::store(GLuint program, std::initializer_list<const char*> sources) {
+    ProgramBinaryFunctions functions;
+    if (!program || !functions.load()) {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<char> binary(length);
+    GLenum binaryFormat = 0;
+    GLsizei written = 0;
+    functions.getProgramBinary(program, length, &written, &binaryFormat, binary.data());
+    if (written <= 0) {
+        return;
+    }
+
+    std::error_code error;
+    fs::create_directories(cacheDirectory, error);
+
+    uint64_t key = programKey(sources);
+    ProgramBinaryHeader header;
+    memcpy(header.magic, "SDPB", 4);
+    header.version = kProgramBinaryVersion;
+    header.key = key;
+    header.binaryFormat = binaryFormat;
+    header.length = static_cast<uint32_t>(written);
+
+    std::ofstream file(binaryPath(key), std::ios::binary | std::ios::trunc);
+    if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+        !file.write(binary.data(), written)) {
+        std::cerr << "Failed to write program binary " << binaryPath(key).string() << std::endl;
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <angle_gl.h>
+#include <initializer_list>
+#include <string>
+
+// On-disk cache of linked program binaries.
+// Compiling GLSL on ANGLE means translating to HLSL and running the D3D
+// compiler, which can take hundreds of milliseconds per program. Linked
+// programs are saved with glGetProgramBinary (ES3, or GL_OES_get_program_binary
+// on ES2) under a hash of their sources, GL_RENDERER and GL_VERSION, and later
+// launches restore them with glProgramBinary. A binary the driver rejects is
+// deleted, and the caller compiles from source as before.
+class ProgramCache {
+public:
+    // Directory that holds the binaries; created on the first store
+    static void setDirectory(const std::string& directory);
+
+    // Ask the driver to keep the binary retrievable. Call before glLinkProgram.
+    static void prepare(GLuint program);
+
+    // Linked program restored from the cache for these sources, or 0
+    static GLuint load(std::initializer_list<const char*> sources);
+
+    // Save a successfully linked program under its sources
+    static void store(GLuint program, std::initializer_list<const char*> sources);
+};
@@ -0,0 +1,100 @@
+#include "QualityController.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Weight of the newest frame in the average GPU time
+static const double kAverageWeight = 0.2;
+
+// Lowered when the average is over the budget for a few frames, raised after
+// it has been under kLowWatermark of it for about two seconds at 30 fps.
+// One raise step costs 1.1^2 = 1.21 times the pixels, which lands at most at
+// 0.85 of the budget, so a raise never triggers the next cut by itself.
+static const double kLowWatermark = 0.7;
+static const int kFramesBeforeLowering = 3;
+static const int kFramesBeforeRaising = 60;
+static const float kRaiseStep = 1.1f;
+
+// A cut aims for this share of the budget, leaving room for scene variation
+static const double kTargetLoad = 0.85;
+
+// GPU timer results lag the frames they measure; ignore this many after a change
+static const int kSettleFrames = 6;
+
+static const FrameStage kGpuStages[] = { FrameStage::Compute, FrameStage::Draw };
+
+QualityController::QualityController()
+    : minScale(0.25f), maxScale(1.0f), scale(1.0f), frameBudget(0.0), stageTime(),
+      averageGpuTime(0.0), framesOver(0), framesUnder(0), settleFrames(0) {
+}
+
+void QualityController::setBounds(float minScale, float maxScale) {
+    this->maxScale = std::min(std::max(maxScale, 0.25f), 1.0f);
+    this->minScale = std::min(std::max(minScale, 0.25f), this->maxScale);
+    scale = std::min(std::max(scale, this->minScale), this->maxScale);
+}
+
+void QualityController::reset(const FrameStats& stats) {
+    for (int i = 0; i < GpuStageCount; ++i) {
+        lastTotals[i] = stats.getTotals(kGpuStages[i]);
+        stageTime[i] = 0.0;
+    }
+    setScale(maxScale);
+}
+
+bool QualityController::takeGpuTime(const FrameStats& stats, double& milliseconds) {
+    bool updated = false;
+    milliseconds = 0.0;
+    for (int i = 0; i < GpuStageCount; ++i) {
+        StageTotals totals = stats.getTotals(kGpuStages[i]);
+        if (totals.samples < lastTotals[i].samples) {
+            lastTotals[i] = StageTotals(); // The stats were cleared
+        }
+        if (totals.samples > lastTotals[i].samples) {
+            // Results of several frames can arrive together; take their mean
+            stageTime[i] = (totals.milliseconds - lastTotals[i].milliseconds) / (totals.samples - lastTotals[i].samples);
+            updated = true;
+        }
+        lastTotals[i] = totals;
+        milliseconds += stageTime[i];
+    }
+    return updated;
+}
+
+float QualityController::update(const FrameStats& stats) {
+    double gpuTime;
+    if (!takeGpuTime(stats, gpuTime) || frameBudget <= 0.0) {
+        return scale;
+    }
+    if (settleFrames > 0) {
+        --settleFrames; // Still measuring frames drawn at the previous scale
+        return scale;
+    }
+    averageGpuTime = averageGpuTime > 0.0 ? averageGpuTime + kAverageWeight * (gpuTime - averageGpuTime) : gpuTime;
+
+    if (averageGpuTime > frameBudget) {
+        framesUnder = 0;
+        if (++framesOver >= kFramesBeforeLowering && scale > minScale) {
+            float cut = scale * static_cast<float>(std::sqrt(frameBudget * kTargetLoad / averageGpuTime));
+            setScale(std::max(cut, minScale));
+        }
+    } else if (averageGpuTime < frameBudget * kLowWatermark) {
+        framesOver = 0;
+        if (++framesUnder >= kFramesBeforeRaising && scale < maxScale) {
+            setScale(std::min(scale * kRaiseStep, maxScale));
+        }
+    } else {
+        // Between the thresholds: hold
+        framesOver = 0;
+        framesUnder = 0;
+    }
+    return scale;
+}
+
+void QualityController::setScale(float newScale) {
+    scale = newScale;
+    averageGpuTime = 0.0;
+    framesOver = 0;
+    framesUnder = 0;
+    settleFrames = kSettleFrames;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "FrameStats.h"
+
+// Picks the render scale frame by frame so a frame's GPU work fits its budget.
+// The GPU times the pipelines record (compute passes and the final draw) are
+// averaged; once the average stays over the budget the scale is cut at once in
+// proportion to the overrun (cost follows the pixel count, so by its square
+// root), and only after a long run well under the budget is it raised again,
+// one small step at a time. The gap between the two thresholds, the longer
+// wait before raising and a settling period after every change (timer results
+// arrive a few frames late) keep the scale from oscillating around the budget.
+class QualityController {
+public:
+    QualityController();
+
+    // Range of the scale (clamped to 0.25 - 1); reset() starts at maxScale
+    void setBounds(float minScale, float maxScale);
+    float getMinScale() const { return minScale; }
+    float getMaxScale() const { return maxScale; }
+
+    // GPU milliseconds a frame may take
+    void setFrameBudget(double milliseconds) { frameBudget = milliseconds; }
+    double getFrameBudget() const { return frameBudget; }
+
+    // Start over at the maximum scale; times recorded so far are ignored
+    void reset(const FrameStats& stats);
+
+    // Once per presented frame: take in the GPU times recorded since the last
+    // call and return the scale to render the next frame at
+    float update(const FrameStats& stats);
+
+    float getScale() const { return scale; }
+    // Average GPU time per frame at the current scale (0 until it is known)
+    double getAverageGpuTime() const { return averageGpuTime; }
+
+private:
+    float minScale;
+    float maxScale;
+    float scale;
+    double frameBudget;
+
+    // Latest per-frame time of each GPU stage and the totals it was taken from
+    static const int GpuStageCount = 2;  // FrameStage::Compute and FrameStage::Draw
+    StageTotals lastTotals[GpuStageCount];
+    double stageTime[GpuStageCount];
+
+    double averageGpuTime;  // Exponential moving average, 0 = no sample since the last change
+    int framesOver;         // Consecutive frames over the budget
+    int framesUnder;        // Consecutive frames well under it
+    int settleFrames;       // Frames left before the times reflect the current scale
+
+    // GPU time of the newest frame; false if no stage recorded anything new
+    bool takeGpuTime(const FrameStats& stats, double& milliseconds);
+    void setScale(float newScale);
+};
@@ -0,0 +1,23 @@
+#include "RenderPipeline.h"
+#include "FragmentPipeline.h"
+#include "../computeRenderer/ComputePipeline.h"
+
+#include <iostream>
+
+std::unique_ptr<RenderPipeline> RenderPipeline::create(const std::string& name) {
+    if (name == "fragment") {
+        return std::unique_ptr<RenderPipeline>(new FragmentPipeline());
+    }
+    if (name == "compute") {
+        return std::unique_ptr<RenderPipeline>(new ComputePipeline());
+    }
+    std::cerr << "Unknown render pipeline: " << name << std::endl;
+    return nullptr;
+}
+
+void RenderPipeline::checkGLError(const char* msg) {
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        std::cerr << "GL Error at " << msg << ": 0x" << std::hex << error << std::dec << std::endl;
+    }
+}
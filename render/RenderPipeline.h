@@ -0,0 +1,130 @@
+#pragma once
+
+#include <angle_gl.h>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "../reader/ImageLoader.h"
+#include "FrameStats.h"
+#include "FullscreenQuad.h"
+#include "GpuTimer.h"
+#include "ShaderReloader.h"
+
+// The frame a pipeline draws, as the playback core has it on the GPU
+struct PipelineFrame {
+    GLuint texture;
+    GLenum target;          // GL_TEXTURE_2D, or GL_TEXTURE_2D_ARRAY for a resident sequence
+    int layer;              // Array layer of the frame (GL_TEXTURE_2D_ARRAY only)
+    int width;
+    int height;
+    GLenum internalFormat;  // Of the luma plane for YUV frames
+    // YUV frames (see RenderPipeline::supportsPlanarFrames): texture holds luma
+    // and chromaTextures the U,V pairs (NV12) or the U and V planes (I420)
+    PlaneFormat planes = PlaneFormat::Interleaved;
+    GLuint chromaTextures[2] = { 0, 0 };
+};
+
+// Where the frame goes. The viewport fits the frame's aspect ratio into the
+// back buffer (the core clears the borders); effects may run at the smaller
+// render size and be scaled up by the final draw, so their cost follows the
+// render scale rather than the source resolution.
+struct PipelineOutput {
+    int x;
+    int y;
+    int width;
+    int height;
+    int renderWidth;   // At most the frame size
+    int renderHeight;
+};
+
+// Estimated GPU memory of one texture or group of buffers, for the memory
+// statistics (see Renderer::getMemoryUsage)
+struct GpuAllocation {
+    std::string name;
+    size_t bytes;
+};
+
+// What the playback core shares with its pipeline while it is initialized
+struct PipelineSetup {
+    ImageLoader* imageLoader;
+    ShaderReloader* shaderReloader;
+    FrameStats* frameStats;
+    FullscreenQuad* quad;     // Bound to ShaderProgram's attribute locations
+    bool gles3;               // ES 3.x context (ES 2.0 otherwise)
+    TimingMode timingMode;    // Requested; initialize() sets Off if its timers are unavailable
+};
+
+// How a frame gets from its texture to the back buffer.
+// Renderer owns everything the ways of drawing have in common (EGL, the
+// render thread, pacing, playback controls, uploads and frame statistics) and
+// hands each frame to a pipeline, so improvements to any of those reach every
+// pipeline at once. All methods but addShaders() run with the renderer's
+// context current: initialize() on the thread calling Renderer::start(),
+// the rest on the render thread.
+class RenderPipeline {
+public:
+    virtual ~RenderPipeline() {}
+
+    // Short name for logs and benchmark results
+    virtual const char* getName() const = 0;
+
+    // Oldest ES client version the pipeline runs on (2 or 3)
+    virtual int getMinimumClientVersion() const = 0;
+
+    // Frames must be stored as RGBA8 (e.g. to be bound as rgba8 image units):
+    // smaller formats are expanded and block-compressed frames are not uploaded as-is
+    virtual bool requiresRGBA() const { return false; }
+
+    // Whether YUV frames can be handed over as planes for the pipeline to
+    // convert on the GPU; otherwise they are converted to RGB on the CPU
+    virtual bool supportsPlanarFrames() const { return false; }
+
+    // Whether frames can come from a GPU-resident sequence, and whether that
+    // may be a texture array; enableTextureArrays() prepares drawing layers
+    // of one and is called before the sequence is made resident
+    virtual bool supportsResidentFrames() const { return false; }
+    virtual bool enableTextureArrays() { return false; }
+
+    // Register the pipeline's shader files (before Renderer::start)
+    virtual void addShaders(ShaderReloader& reloader) = 0;
+
+    // Build programs and GL objects. Returns false if the pipeline cannot run.
+    virtual bool initialize(PipelineSetup& setup) = 0;
+    // Release its GL objects
+    virtual void destroy() = 0;
+
+    // Swap in programs rebuilt (shader reloads) or selected (variant switches)
+    // since the last frame; true if the picture changed
+    virtual bool applyReloadedShaders() = 0;
+
+    // Draw a frame into the output viewport of the bound back buffer,
+    // recording GPU timings into the stats
+    virtual void render(const PipelineFrame& frame, const PipelineOutput& output) = 0;
+
+    // Batched export: how many frames processBatch() takes at once (1 = the
+    // pipeline only draws frames one by one with render())
+    virtual int getBatchSize() const { return 1; }
+    // Process count frames, the first layers of a GL_TEXTURE_2D_ARRAY (layers),
+    // together; returns false, processing nothing, if they must be rendered one by one
+    virtual bool processBatch(const PipelineFrame& layers, int count) { return false; }
+    // Draw layer of the last processed batch into the output viewport (as render() would have)
+    virtual void presentBatchLayer(int layer, const PipelineOutput& output) {}
+
+    // 3D LUT grading (ES3, see LutCache): the .cube file later frames are
+    // graded with, empty for none (any thread). Ignored by pipelines without the stage.
+    virtual void setLut(const std::string& path) {}
+
+    // Print measurements of the pipeline's own, with the periodic frame statistics
+    virtual void reportStats(std::ostream& out) {}
+
+    // Append the textures and buffers the pipeline allocates itself
+    // (intermediates, scaled copies of the frame), with their estimated size
+    virtual void addGpuAllocations(std::vector<GpuAllocation>& allocations) const {}
+
+    // Pipeline by name: "fragment" or "compute". Returns null for other names.
+    static std::unique_ptr<RenderPipeline> create(const std::string& name);
+
+protected:
+    static void checkGLError(const char* msg);
+};
@@ -1,28 +1,138 @@
 ﻿#include "Renderer.h"
+#include "GpuTrace.h"
+#include "FragmentPipeline.h"
+#include "ShaderProgram.h"
 
-Renderer::Renderer(HWND hWnd, int width, int height, ImageLoader& imageLoader)
-    : hWnd(hWnd), width(width), height(height), imageLoader(imageLoader),
-      currentImageIndex(0), paused(false), shouldStepForward(false),
-      shouldStepBackward(false), running(false),
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <d3d11.h>
+#include <dxgi.h>
+
+Renderer::Renderer(HWND hWnd, int width, int height, ImageLoader& imageLoader, std::unique_ptr<RenderPipeline> pipeline)
+    : hWnd(hWnd), width(width), height(height), resizePending(false), requestedWidth(width),
+      requestedHeight(height), renderScale(1.0f), imageLoader(imageLoader),
+      currentImageIndex(0), playbackDirection(1), paused(false), shouldStepForward(false),
+      shouldStepBackward(false), running(false), redrawRequested(false), lutIndex(-1), stepEvent(nullptr), presentedFrame(0), stepPending(false),
+      seekRequest(NoSeek), scrubRequest(0), uploadedFrame(0), shownFrame(0), exactFramePending(false),
+      showUploadedFrame(false), lazyFrames(false), placeholderWidth(0), placeholderHeight(0), loopStarted(false),
       display(EGL_NO_DISPLAY), config(nullptr), context(EGL_NO_CONTEXT),
-      surface(EGL_NO_SURFACE), shaderProgram(0), texture(0), lastFrameTime(0.0),
-      frameCount(0), totalRenderTime(0.0), lastFrameTimePoint(std::chrono::steady_clock::now()),
-      frameStartTime(std::chrono::steady_clock::now()), frameEndTime(std::chrono::steady_clock::now()), statsResetInterval(60) {
-    // Get all loaded image names
-    imageNames = imageLoader.getImageNames();
+      surface(EGL_NO_SURFACE), gles3(false), pipeline(std::move(pipeline)),
+      residentFrameLimit(60), residentMemoryBudget(512ull * 1024 * 1024),
+      adaptiveQuality(false), vsync(true), lowLatency(false), maxFrameLatency(1), timingMode(TimingMode::GpuTimer), frameCount(0),
+      statsResetInterval(60),
+      exportFormat(FrameExporter::Format::PNG), exportFinished(false), exportSucceeded(false),
+      outputGroup(nullptr), holdsSharedFrame(false), sharedFrameIndex(0) {
+    if (!this->pipeline) {
+        this->pipeline.reset(new FragmentPipeline());
+    }
+    
+    // Frames are fetched by index; the loader's table is fixed once loading is done
+    imageCount = imageLoader.getImageCount();
+    
+    // The pipeline's programs are rebuilt from their files when one changes
+    this->pipeline->addShaders(shaderReloader);
 }
 
 Renderer::~Renderer() {
     stop();
+    if (stepEvent) {
+        CloseHandle(stepEvent);
+    }
 }
 
 bool Renderer::start() {
     if (running) {
         return true; // Already running
     }
+    
+    // Draw at the window's actual client size rather than the size it was created with
+    RECT clientRect;
+    if (hWnd && GetClientRect(hWnd, &clientRect)) {
+        width = clientRect.right - clientRect.left;
+        height = clientRect.bottom - clientRect.top;
+    }
+
+    // Display and context of our own, or in the output group's share group
+    if (!(outputGroup ? joinOutputGroup() : createDisplayAndContext())) {
+        return false;
+    }
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    
+    // Create window surface; with low latency requested, ANGLE presents
+    // through a flip-model DirectComposition swap chain instead of a blt one
+    bool directComposition = lowLatency && hWnd && extensions && strstr(extensions, "EGL_ANGLE_direct_composition");
+    if (lowLatency && hWnd && !directComposition) {
+        std::cout << "EGL_ANGLE_direct_composition not available, using the default swap chain" << std::endl;
+    }
+    const EGLint windowAttribs[] = { directComposition ? EGL_DIRECT_COMPOSITION_ANGLE : EGL_NONE, EGL_TRUE, EGL_NONE };
+    const EGLint pbufferAttribs[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+    surface = hWnd ? eglCreateWindowSurface(display, config, (EGLNativeWindowType)hWnd, windowAttribs)
+                   : eglCreatePbufferSurface(display, config, pbufferAttribs);
+    if (surface == EGL_NO_SURFACE) {
+        std::cerr << "Failed to create EGL surface" << std::endl;
+        checkEGLError("eglCreateWindowSurface");
+        eglDestroyContext(display, context);
+        context = EGL_NO_CONTEXT;
+        releaseDisplay();
+        return false;
+    }
+    
+    if (lowLatency && hWnd && !limitFrameLatency()) {
+        std::cout << "Frame latency limit unavailable, the driver default applies" << std::endl;
+    }
+    
+    // 在主线程中初始化OpenGL资源
+    if (!initializeGL()) {
+        std::cerr << "Failed to initialize OpenGL resources" << std::endl;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+        eglDestroySurface(display, surface);
+        releaseDisplay();
+        return false;
+    }
+    
+    // 确保主线程不再使用EGL上下文
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglReleaseThread();
+    
+    // Shader edits are compiled in a second context that shares this one's objects
+    const EGLint reloadContextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, gles3 ? 3 : 2, EGL_NONE };
+    shaderReloader.setReadyCallback(&Renderer::wakeRenderLoop, this);
+    if (!shaderReloader.start(display, config, context, reloadContextAttribs)) {
+        std::cout << "Shader hot reload disabled" << std::endl;
+    }
+    
+    // Start render loop in a new thread and wait until it owns the context
+    if (!stepEvent) {
+        stepEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    }
+    // A group's outputs share the decodes, so none of them records their times
+    if (!outputGroup) {
+        imageLoader.setDecodeTimeCallback(&FrameStats::recordDecodeTime, &frameStats);
+    }
+    running = true;
+    loopStarted = false;
+    renderThread = std::thread(&Renderer::renderLoop, this);
+    {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        stateChanged.wait(lock, [this] { return loopStarted; });
+    }
+    if (!running) {
+        stop(); // The render thread could not bind the context; tear everything down
+        return false;
+    }
 
+    std::cout << "Renderer started (" << pipeline->getName() << " pipeline)" << std::endl;
+    std::cout << "Controls: Space = Pause/Resume, Left Arrow = Previous Frame, Right Arrow = Next Frame, Home/End = First/Last Frame, Page Up/Down = Scrub" << std::endl;
+    
+    return true;
+}
+
+bool Renderer::createDisplayAndContext() {
     // Get EGL display
-    display = eglGetDisplay(GetDC(hWnd));
+    // Without a window (benchmarks) the frames go to an offscreen pbuffer
+    display = displayBackend.open(hWnd ? static_cast<EGLNativeDisplayType>(GetDC(hWnd)) : EGL_DEFAULT_DISPLAY);
     if (display == EGL_NO_DISPLAY) {
         std::cerr << "Failed to get EGL display" << std::endl;
         return false;
@@ -31,7 +141,7 @@ bool Renderer::start() {
     // Initialize EGL
     EGLint majorVersion, minorVersion;
     if (!eglInitialize(display, &majorVersion, &minorVersion)) {
-        std::cerr << "Failed to initialize EGL" << std::endl;
+        std::cerr << "Failed to initialize EGL (" << displayBackend.getName() << " backend)" << std::endl;
         checkEGLError("eglInitialize");
         return false;
     }
@@ -45,91 +155,116 @@ bool Renderer::start() {
     // Print EGL extensions
     const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
     std::cout << "EGL Extensions: " << (extensions ? extensions : "<null>") << std::endl;
+    // Which workarounds the backend applies, after any overrides
+    displayBackend.logFeatures(display, std::cout);
     
-    // EGL configuration attributes
-    const EGLint configAttribs[] = {
-        EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
-        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
-        EGL_RED_SIZE, 8,
-        EGL_GREEN_SIZE, 8,
-        EGL_BLUE_SIZE, 8,
-        EGL_ALPHA_SIZE, 8,
-        EGL_NONE
-    };
+    // Prefer an ES 3.0 context for immutable texture storage, fall back to ES 2.0
+    // where the pipeline can run on it
+    const EGLint clientVersions[] = { 3, 2 };
+    for (EGLint clientVersion : clientVersions) {
+        if (clientVersion < pipeline->getMinimumClientVersion()) {
+            break;
+        }
+        // EGL configuration attributes
+        const EGLint configAttribs[] = {
+            EGL_SURFACE_TYPE, hWnd ? EGL_WINDOW_BIT : EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, clientVersion == 3 ? EGL_OPENGL_ES3_BIT_KHR : EGL_OPENGL_ES2_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_ALPHA_SIZE, 8,
+            EGL_NONE
+        };
+        
+        // Choose EGL configuration
+        EGLint numConfigs;
+        if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs <= 0) {
+            continue;
+        }
+        
+        // EGL context attributes
+        const EGLint contextAttribs[] = {
+            EGL_CONTEXT_CLIENT_VERSION, clientVersion,
+            EGL_NONE
+        };
+        
+        // Create EGL context
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+        if (context != EGL_NO_CONTEXT) {
+            gles3 = clientVersion >= 3;
+            break;
+        }
+    }
     
-    // Choose EGL configuration
-    EGLint numConfigs;
-    if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs <= 0) {
-        std::cerr << "Failed to choose EGL configuration" << std::endl;
-        checkEGLError("eglChooseConfig");
+    if (context == EGL_NO_CONTEXT) {
+        std::cerr << "Failed to create EGL context" << std::endl;
+        checkEGLError("eglCreateContext");
         eglTerminate(display);
         return false;
     }
-    
-    // Create window surface
-    surface = eglCreateWindowSurface(display, config, (EGLNativeWindowType)hWnd, NULL);
-    if (surface == EGL_NO_SURFACE) {
-        std::cerr << "Failed to create EGL surface" << std::endl;
-        checkEGLError("eglCreateWindowSurface");
-        eglTerminate(display);
+    std::cout << "OpenGL ES context version: " << (gles3 ? "3.0" : "2.0") << std::endl;
+    return true;
+}
+
+bool Renderer::joinOutputGroup() {
+    display = outputGroup->getDisplay();
+    config = outputGroup->getConfig();
+    gles3 = outputGroup->isGLES3();
+    if (display == EGL_NO_DISPLAY) {
+        std::cerr << "The output group is not open" << std::endl;
         return false;
     }
-    
-    // EGL context attributes
-    const EGLint contextAttribs[] = {
-        EGL_CONTEXT_CLIENT_VERSION, 2,
-        EGL_NONE
-    };
-    
-    // Create EGL context
-    context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if ((gles3 ? 3 : 2) < pipeline->getMinimumClientVersion()) {
+        std::cerr << "The " << pipeline->getName() << " pipeline needs a newer context than the output group's" << std::endl;
+        display = EGL_NO_DISPLAY;
+        return false;
+    }
+    const EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, gles3 ? 3 : 2, EGL_NONE };
+    context = eglCreateContext(display, config, outputGroup->getShareContext(), contextAttribs);
     if (context == EGL_NO_CONTEXT) {
-        std::cerr << "Failed to create EGL context" << std::endl;
+        std::cerr << "Failed to create EGL context in the output group" << std::endl;
         checkEGLError("eglCreateContext");
-        eglDestroySurface(display, surface);
-        eglTerminate(display);
+        display = EGL_NO_DISPLAY;
         return false;
     }
-    
-    // 在主线程中初始化OpenGL资源
-    if (!initializeGL()) {
-        std::cerr << "Failed to initialize OpenGL resources" << std::endl;
-        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
-        eglDestroyContext(display, context);
-        eglDestroySurface(display, surface);
+    std::cout << "OpenGL ES context version: " << (gles3 ? "3.0" : "2.0") << " (output group)" << std::endl;
+    return true;
+}
+
+void Renderer::releaseDisplay() {
+    // The group's display stays up for its other outputs
+    if (!outputGroup) {
         eglTerminate(display);
-        return false;
     }
-    
-    // 确保主线程不再使用EGL上下文
-    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
-    eglReleaseThread();
-    
-    // Start render loop in a new thread
-    running = true;
-    std::thread renderThread(&Renderer::renderLoop, this);
-    renderThread.detach(); // Detach the thread so it runs independently
-
-    std::cout << "Renderer started" << std::endl;
-    std::cout << "Controls: Space = Pause/Resume, Left Arrow = Previous Frame, Right Arrow = Next Frame" << std::endl;
-    
-    return true;
+    display = EGL_NO_DISPLAY;
 }
 
 void Renderer::stop() {
-    if (!running) {
+    if (!renderThread.joinable()) {
         return;
     }
 
-    // Signal the render loop to stop
+    // Signal the render loop to stop and cut its frame wait short; it exits
+    // after finishing at most the frame in flight and releasing its GL objects
     running = false;
+    framePacer.interrupt();
+    renderThread.join();
+    if (!outputGroup) {
+        imageLoader.setDecodeTimeCallback(nullptr, nullptr);
+    }
     
-    // Allow the thread to exit gracefully
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (!statsExportPath.empty()) {
+        frameStats.appendCsv(statsExportPath + ".csv", statsLabel);
+        frameStats.writeJson(statsExportPath + ".json", statsLabel);
+    }
+    
+    // The reload context shares objects with the main one, so it goes first
+    shaderReloader.stop();
 
     // Clean up OpenGL resources
     if (display != EGL_NO_DISPLAY) {
         // 不需要在这里调用eglMakeCurrent，因为渲染线程会自己解绑
+        // The thread has been joined, so nothing uses the context any more
         
         if (context != EGL_NO_CONTEXT) {
             eglDestroyContext(display, context);
@@ -141,21 +276,134 @@ void Renderer::stop() {
             surface = EGL_NO_SURFACE;
         }
         
-        eglTerminate(display);
-        display = EGL_NO_DISPLAY;
+        releaseDisplay();
     }
 
     std::cout << "Renderer stopped" << std::endl;
 }
 
+void Renderer::setTimingMode(TimingMode mode) {
+    // Queries are created in initializeGL, so the mode must be chosen before start()
+    if (!running) {
+        timingMode = mode;
+    }
+}
+
+void Renderer::setStatsExport(const std::string& basePath, const std::string& label) {
+    statsExportPath = basePath;
+    statsLabel = label;
+}
+
+bool Renderer::addLayer(ImageLoader& loader, float opacity, LayerCompositor::BlendMode mode) {
+    return !running && layerCompositor.addLayer(loader, opacity, mode);
+}
+
+void Renderer::setOutputGroup(OutputGroup* group) {
+    if (!running) {
+        outputGroup = group;
+    }
+}
+
+void Renderer::setBatchExport(const std::string& directory, FrameExporter::Format format) {
+    if (!running) {
+        exportDirectory = directory;
+        exportFormat = format;
+    }
+}
+
+bool Renderer::waitForExport() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    stateChanged.wait(lock, [this] { return exportFinished; });
+    return exportSucceeded;
+}
+
+void Renderer::setFrameRate(double fps) {
+    framePacer.setFrameRate(fps);
+}
+
+void Renderer::setVsync(bool enabled) {
+    // The swap interval is applied when the render thread binds the context
+    vsync = enabled;
+}
+
+void Renderer::setDisplayBackend(const DisplayBackend& backend) {
+    displayBackend = backend;
+}
+
+void Renderer::setLowLatencyPresentation(bool enabled, int latency) {
+    lowLatency = enabled;
+    maxFrameLatency = std::min(std::max(latency, 1), 16);
+}
+
+bool Renderer::limitFrameLatency() {
+    // ANGLE does not hand out the swap chain's waitable object, but its D3D11
+    // device is reachable through EGL_EXT_device_query; the DXGI frame latency
+    // set there bounds how many presents may queue ahead of the display
+    auto queryDisplayAttrib = reinterpret_cast<PFNEGLQUERYDISPLAYATTRIBEXTPROC>(eglGetProcAddress("eglQueryDisplayAttribEXT"));
+    auto queryDeviceAttrib = reinterpret_cast<PFNEGLQUERYDEVICEATTRIBEXTPROC>(eglGetProcAddress("eglQueryDeviceAttribEXT"));
+    EGLAttrib device = 0;
+    EGLAttrib d3dDevice = 0;
+    if (!queryDisplayAttrib || !queryDeviceAttrib || !queryDisplayAttrib(display, EGL_DEVICE_EXT, &device) ||
+        !queryDeviceAttrib(reinterpret_cast<EGLDeviceEXT>(device), EGL_D3D11_DEVICE_ANGLE, &d3dDevice) || !d3dDevice) {
+        return false;
+    }
+    IDXGIDevice1* dxgiDevice = nullptr;
+    if (FAILED(reinterpret_cast<ID3D11Device*>(d3dDevice)->QueryInterface(__uuidof(IDXGIDevice1), reinterpret_cast<void**>(&dxgiDevice)))) {
+        return false;
+    }
+    bool limited = SUCCEEDED(dxgiDevice->SetMaximumFrameLatency(maxFrameLatency));
+    dxgiDevice->Release();
+    if (limited) {
+        std::cout << "Maximum frame latency: " << maxFrameLatency << std::endl;
+    }
+    return limited;
+}
+
+void Renderer::setResidentFrameLimit(size_t frameLimit, size_t memoryBudget) {
+    // Residency is decided while initializing GL, so this must be called before start()
+    if (!running) {
+        residentFrameLimit = frameLimit;
+        residentMemoryBudget = memoryBudget;
+    }
+}
+
+void Renderer::setShaderDirectory(const std::string& directory) {
+    // Programs are built while initializing GL, so this must be called before start()
+    if (!running) {
+        shaderReloader.setDirectory(directory);
+    }
+}
+
+void Renderer::resize(int newWidth, int newHeight) {
+    if (!hWnd) {
+        return;
+    }
+    requestedWidth = std::max(newWidth, 0);
+    requestedHeight = std::max(newHeight, 0);
+    resizePending = true;
+    framePacer.interrupt(); // Redraw at the new size without waiting for the next frame
+}
+
+void Renderer::setRenderScale(float scale) {
+    renderScale = std::min(std::max(scale, 0.25f), 1.0f);
+    invalidate(); // Redrawn at the new scale while paused too
+}
+
+void Renderer::setAdaptiveQuality(float minScale, float maxScale) {
+    adaptiveQuality = true;
+    qualityController.setBounds(minScale, maxScale);
+}
+
 void Renderer::togglePause() {
     paused = !paused;
+    framePacer.interrupt(); // Resume without waiting out the paused frame interval
     std::cout << (paused ? "Playback paused" : "Playback resumed") << std::endl;
 }
 
 void Renderer::stepForward() {
     if (paused) {
         shouldStepForward = true;
+        framePacer.interrupt(); // Present the step now rather than at the next frame deadline
         std::cout << "Step forward" << std::endl;
     }
 }
@@ -163,6 +411,7 @@ void Renderer::stepForward() {
 void Renderer::stepBackward() {
     if (paused) {
         shouldStepBackward = true;
+        framePacer.interrupt();
         std::cout << "Step backward" << std::endl;
     }
 }
@@ -171,69 +420,205 @@ bool Renderer::isPaused() const {
     return paused;
 }
 
+void Renderer::seek(size_t frameIndex) {
+    seekRequest = frameIndex;
+    scrubRequest = 0; // Relative moves before the seek no longer apply
+    framePacer.interrupt();
+}
+
+void Renderer::scrub(long long delta) {
+    scrubRequest += delta;
+    framePacer.interrupt();
+}
+
+void Renderer::invalidate() {
+    redrawRequested = true;
+    framePacer.interrupt();
+}
+
+void Renderer::setLuts(const std::vector<std::string>& paths) {
+    lutPaths = paths;
+    lutIndex = paths.empty() ? -1 : 0;
+    pipeline->setLut(paths.empty() ? std::string() : paths[0]);
+}
+
+void Renderer::cycleLut() {
+    if (lutPaths.empty()) {
+        return;
+    }
+    // The pipeline uploads each LUT once and keeps it, so cycling back is free
+    int next = lutIndex + 1 < static_cast<int>(lutPaths.size()) ? lutIndex + 1 : -1;
+    lutIndex = next;
+    pipeline->setLut(next < 0 ? std::string() : lutPaths[next]);
+    std::cout << "LUT: " << (next < 0 ? "none" : lutPaths[next]) << std::endl;
+    invalidate(); // Show the change while paused too
+}
+
+void Renderer::wakeRenderLoop(void* renderer) {
+    static_cast<Renderer*>(renderer)->framePacer.interrupt();
+}
+
+void Renderer::notifyLoopStarted() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        loopStarted = true;
+    }
+    stateChanged.notify_all();
+}
+
 void Renderer::renderLoop() {
     // 在渲染线程中绑定 EGL context
     if (!eglMakeCurrent(display, surface, surface, context)) {
         std::cerr << "Failed to bind EGL context in render thread" << std::endl;
         checkEGLError("eglMakeCurrent in renderLoop");
         running = false;
+        notifyLoopStarted();
         return;
     }
+    notifyLoopStarted();
     
-    // 设置视口
-    glViewport(0, 0, width, height);
+    // Lay out the first frame from its header, so the window shows where it will appear
+    if (lazyFrames && imageCount > 0 && !imageLoader.getFrameSize(currentImageIndex, placeholderWidth, placeholderHeight)) {
+        placeholderWidth = placeholderHeight = 0;
+    }
     
     // 加载初始纹理
     updateTexture();
     
-    // Frame timing variables for 30 FPS
-    const std::chrono::milliseconds frameTime(33); // ~30 FPS (1000ms / 30 = 33.33ms)
+    // A batch export renders the sequence once and skips playback altogether
+    bool exporting = !exportDirectory.empty();
+    if (exporting) {
+        exportFrames();
+    }
+    
+    // Streamed sequences are prepared on a producer thread from here on; the
+    // texture uploaded above is shown until its first frame arrives
+    if (!exporting && !outputGroup && gles3 && !residentFrames.isResident() && imageCount > 0) {
+        const EGLint producerContextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE };
+        frameProducer.setRequireRGBA(pipeline->requiresRGBA());
+        frameProducer.setStats(&frameStats);
+        if (!frameProducer.start(imageLoader, display, config, context, producerContextAttribs,
+                                 currentImageIndex, producerSlotCount)) {
+            std::cout << "Frame producer unavailable, uploading on the render thread" << std::endl;
+        }
+    }
+    if (frameProducer.isRunning()) {
+        exactFramePending = false; // A first frame that was not ready comes from the producer
+    }
+    
+    // With vsync the swap lands on the display refresh; the pacer decides which
+    // source frame is shown and sleeps between frames instead of spinning
+    eglSwapInterval(display, vsync ? 1 : 0);
+    framePacer.reset();
+    uint64_t presentCount = 0;
     
-    while (running) {
+    // The scale starts at the maximum and drops once the GPU time exceeds the budget
+    if (adaptiveQuality) {
+        qualityController.setFrameBudget(adaptiveBudgetShare * 1000.0 / framePacer.getFrameRate());
+        qualityController.reset(frameStats);
+        renderScale = qualityController.getScale();
+        if (timingMode == TimingMode::Off) {
+            std::cout << "Adaptive quality needs GPU timing, keeping render scale " << renderScale << std::endl;
+        } else {
+            std::cout << "Adaptive quality: render scale " << qualityController.getMinScale() << " - "
+                      << qualityController.getMaxScale() << " for a " << qualityController.getFrameBudget()
+                      << " ms GPU budget" << std::endl;
+        }
+    }
+    bool redraw = true; // The first frame is always drawn
+    
+    while (running && !exporting) {
+        // Swap in shaders that were edited and rebuilt since the last frame
+        redraw = pipeline->applyReloadedShaders() || redraw;
+        redraw = redrawRequested.exchange(false) || redraw;
+        
         // Handle single step controls
         if (shouldStepForward) {
             nextFrame();
             shouldStepForward = false;
+            stepPending = true;
+            redraw = true;
         } else if (shouldStepBackward) {
             previousFrame();
             shouldStepBackward = false;
+            stepPending = true;
+            redraw = true;
         }
+        redraw = handleSeekRequests() || redraw;
+        redraw = applyResize() || redraw;
+        redraw = uploadExactFrameIfReady() || redraw;
         
-        // Calculate time since last frame
-        auto currentTime = std::chrono::steady_clock::now();
-        auto elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(
-            currentTime - lastFrameTimePoint);
-        
-        // Only render if enough time has passed (for 30 FPS) and not paused
-        if (!paused) {
-            // Update texture with next image
-            nextFrame();
-            
-            // Update last frame time
-            lastFrameTimePoint = currentTime;
+        if (paused) {
+            // Keep the playback clock parked on the current frame
+            framePacer.reset();
+        } else {
+            // Advance by the number of source frames due; more than one means
+            // presentation fell behind and the frames in between are dropped
+            int framesDue = framePacer.advance();
+            if (framesDue > 0) {
+                nextFrame(framesDue);
+            }
+            redraw = true;
         }
         
-        // Always render the current frame
-        // Clear the screen
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+        // Switch to the newest produced frame that is due. One that arrives
+        // while paused (a step that was not ready yet) is shown as well, and a
+        // seek's stand-in stays up until the producer has the target.
+        if (frameProducer.isRunning() && frameProducer.update()) {
+            showUploadedFrame = false;
+            redraw = true;
+        }
         
-        // Render the textured quad
-        renderTexturedQuad();
+        // A paused frame that did not change is already on screen; a minimized window shows nothing
+        if (redraw && width > 0 && height > 0) {
+            drawFrame();
+            
+            // Copy the upcoming frame into a pixel buffer while the GPU works on this one
+            stageNextFrame();
+            
+            // Swap buffers
+            {
+                TRACE_ZONE("Present");
+                FrameStats::Scope timing(&frameStats, FrameStage::Present);
+                eglSwapBuffers(display, surface);
+            }
+            TRACE_FRAME(presentCount++);
+            reportFrameStats();
+            if (adaptiveQuality) {
+                adaptQuality();
+            }
+            redraw = false;
+            
+            // Tell the UI once the stepped-to frame is on screen; a streamed frame
+            // still being produced is reported on the swap that first shows it
+            if (stepPending && shownFrame == currentImageIndex) {
+                presentedFrame = shownFrame;
+                stepPending = false;
+                SetEvent(stepEvent);
+            }
+        }
         
-        // Swap buffers
-        eglSwapBuffers(display, surface);
+        // Paused with the frame on screen, nothing changes until a control call,
+        // resize or shader reload interrupts the pacer: sleep until then
+        // instead of waking every frame interval. A step or seek whose frame is
+        // still being decoded or produced keeps polling at the frame rate.
+        if (paused && !stepPending && !exactFramePending && !redraw) {
+            TRACE_ZONE("Idle");
+            framePacer.waitForWake();
+            continue;
+        }
         
-        // Sleep to avoid excessive CPU usage
-//        if (paused) {
-//            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-//        } else {
-//            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-//        }
+        // Sleep until the next source frame is due
+        TRACE_ZONE("Wait for next frame");
+        framePacer.waitForNextFrame();
     }
     
+    // Release GL objects while the context is still current on this thread
+    destroyGL();
+    
     // 在线程结束前解绑 EGL context
     eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglReleaseThread();
 }
 
 bool Renderer::initializeGL() {
@@ -244,24 +629,65 @@ bool Renderer::initializeGL() {
         return false;
     }
     
-    // Create shader program
-    shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
-    if (!shaderProgram) {
-        std::cerr << "Failed to create shader program" << std::endl;
+    const char* glRenderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    rendererString = glRenderer ? glRenderer : "";
+    std::cout << "GL renderer: " << rendererString << " (" << displayBackend.getName() << " backend)" << std::endl;
+    
+    // Static vertex buffer for the quad (plus a vertex array object on ES3);
+    // every program binds its attributes to ShaderProgram's locations
+    if (!quad.create(gles3, ShaderProgram::PositionLocation, ShaderProgram::TexCoordLocation)) {
+        std::cerr << "Failed to create fullscreen quad" << std::endl;
         return false;
     }
     
-    // Create texture
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    // Programs and GPU timers of the pipeline
+    PipelineSetup setup = { &imageLoader, &shaderReloader, &frameStats, &quad, gles3, timingMode };
+    if (!pipeline->initialize(setup)) {
+        std::cerr << "Failed to initialize the " << pipeline->getName() << " pipeline" << std::endl;
+        return false;
+    }
+    timingMode = setup.timingMode;
     
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Layer textures and the composite program, generated for the layers added
+    if (layerCompositor.hasLayers() && !layerCompositor.initialize(&quad, &frameStats, gles3)) {
+        std::cerr << "Failed to initialize layer compositing" << std::endl;
+        return false;
+    }
+    
+    // Create texture; storage is allocated on the first upload (for uniform sequences, below)
+    textureUploader.setRequireRGBA(pipeline->requiresRGBA());
+    textureUploader.create(gles3);
+    
+    // Block-compressed frames go to the GPU as-is where S3TC is available,
+    // unless the pipeline needs RGBA8 frames
+    if (pipeline->requiresRGBA()) {
+        std::cout << "The " << pipeline->getName() << " pipeline needs RGBA8 frames, compressed frames are decompressed on the CPU" << std::endl;
+    } else if (textureUploader.enableCompressedUploads()) {
+        std::cout << "S3TC texture compression available, compressed frames are uploaded directly" << std::endl;
+    } else {
+        std::cout << "S3TC texture compression not available, compressed frames are decompressed on the CPU" << std::endl;
+    }
+    
+    // YUV frames go up as planes for the pipeline to convert on the GPU, unless
+    // layers are composited over them (the compositor samples RGB frames)
+    if (pipeline->supportsPlanarFrames() && !layerCompositor.hasLayers()) {
+        textureUploader.enablePlanarUploads();
+    }
+    
+    // Triple-buffered pixel unpack buffers for asynchronous uploads (ES3 only)
+    textureUploader.enablePixelBuffers(pixelBufferCount);
+    
+    // Short loops are uploaded once and played back from GPU memory. Otherwise
+    // a sequence of uniform frames gets its texture storage now, once.
+    FrameLayout layout;
+    if (!makeSequenceResident() && !outputGroup && imageLoader.getSequenceLayout(layout) &&
+        textureUploader.reserve(layout)) {
+        std::cout << "Uniform sequence: frame texture allocated once at " << layout.width << "x" << layout.height
+                  << std::endl;
+    }
     
     checkGLError("initializeGL");
+    updateMemoryUsage();
     
     // 初始化完成后解绑 context，让渲染线程去绑定
     eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
@@ -269,226 +695,530 @@ bool Renderer::initializeGL() {
     return true;
 }
 
-void Renderer::cleanupGL() {
-    // 注意：此方法不再调用 OpenGL 函数，因为它可能在不同的线程中被调用
-    // 所有的 OpenGL 资源清理都应该在渲染线程中完成
-    shaderProgram = 0;
-    texture = 0;
+void Renderer::destroyGL() {
+    releaseSharedFrame();
+    frameProducer.stop();
+    textureUploader.destroy();
+    residentFrames.destroy();
+    frameBatch.destroy();
+    layerCompositor.destroy();
+    quad.destroy();
+    pipeline->destroy();
 }
 
-GLuint Renderer::compileShader(GLenum type, const char* source) {
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, NULL);
-    glCompileShader(shader);
+bool Renderer::makeSequenceResident() {
+    if (outputGroup || lazyFrames || !pipeline->supportsResidentFrames() || residentFrameLimit == 0 || imageCount == 0 ||
+        imageCount > residentFrameLimit) {
+        return false;
+    }
     
-    // Check compilation status
-    GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        GLchar infoLog[512];
-        glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
-        std::cerr << "Shader compilation error: " << infoLog << std::endl;
-        glDeleteShader(shader);
-        return 0;
+    bool textureArrays = pipeline->enableTextureArrays();
+    if (!residentFrames.upload(imageLoader, textureArrays, true, residentMemoryBudget)) {
+        std::cout << "Sequence could not be made GPU-resident (texture budget or frame layout), uploading frames on demand" << std::endl;
+        return false;
     }
     
-    return shader;
+    std::cout << "Sequence resident on GPU: " << residentFrames.getFrameCount() << " frames as "
+              << (residentFrames.getMode() == ResidentSequence::Mode::TextureArray ? "a texture array" : "separate textures")
+              << std::endl;
+    
+    // Frames are never uploaded during playback now
+    textureUploader.destroy();
+    return true;
 }
 
-GLuint Renderer::createShaderProgram(const char* vertexSource, const char* fragmentSource) {
-    // Compile vertex shader
-    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
-    if (!vertexShader) {
-        std::cerr << "Failed to compile vertex shader" << std::endl;
-        return 0;
+void Renderer::updateTexture() {
+    if (imageCount == 0) {
+        std::cerr << "No images available" << std::endl;
+        return;
     }
-
-    // Compile fragment shader
-    // If fragmentShaderSourcePart2Ptr is not null, combine it with fragmentSource
-//    GLuint fragmentShader =  compileShader(GL_FRAGMENT_SHADER, fragmentSource);
-    GLuint fragmentShader;
-    if (fragmentShaderSourcePart2Ptr) {
-        // Combine fragment shader sources
-        std::string combinedSource = fragmentSource;
-        combinedSource += fragmentShaderSourcePart2Ptr;
-        fragmentShader = compileShader(GL_FRAGMENT_SHADER, combinedSource.c_str());
-    } else {
-        // Use single fragment shader source
-        fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    if (residentFrames.isResident()) {
+        return; // Playback only selects the frame at draw time
     }
-    
-    if (!fragmentShader) {
-        std::cerr << "Failed to compile fragment shader" << std::endl;
-        glDeleteShader(vertexShader);
-        return 0;
+    if (lazyFrames && !imageLoader.tryAcquireImage(currentImageIndex)) {
+        // Not decoded yet: the last ready frame stays up and
+        // uploadExactFrameIfReady() shows this one once the prefetcher has it
+        exactFramePending = true;
+        return;
     }
-
-    // Create program and attach shaders
-    GLuint program = glCreateProgram();
-    glAttachShader(program, vertexShader);
-    glAttachShader(program, fragmentShader);
-
-    // Link program
-    glLinkProgram(program);
-
-    // Check link status
-    GLint linked;
-    glGetProgramiv(program, GL_LINK_STATUS, &linked);
-    if (!linked) {
-        GLint infoLen = 0;
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLen);
-        if (infoLen > 1) {
-            std::vector<char> infoLog(infoLen);
-            glGetProgramInfoLog(program, infoLen, NULL, infoLog.data());
-            std::cerr << "Error linking program: " << infoLog.data() << std::endl;
+    if (outputGroup) {
+        acquireSharedFrame(currentImageIndex);
+        return;
+    }
+    
+    TRACE_ZONE("Upload frame");
+    std::shared_ptr<const ImageData> imageData = imageLoader.acquireImage(currentImageIndex);
+    
+    if (imageData && imageData->isValid()) {
+        // Sequential playback of mostly static content only replaces the tiles
+        // that changed since the frame in the texture. Otherwise, upload the image
+        // data; storage is only reallocated when the frame layout changes.
+        // If stageNextFrame() already copied this frame into a pixel buffer, the upload is GPU-side.
+        FrameStats::Scope timing(&frameStats, FrameStage::Upload);
+        DirtyTiles tiles;
+        if (imageLoader.getChangedTiles(uploadedFrame, currentImageIndex, tiles) &&
+            textureUploader.uploadTiles(*imageData, tiles)) {
+            timing.addBytes(static_cast<uint64_t>(imageData->data.size() * tiles.dirtyFraction()));
+        } else if (textureUploader.upload(*imageData, currentImageIndex)) {
+            timing.addBytes(imageData->data.size());
         }
-        glDeleteProgram(program);
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-        return 0;
+        uploadedFrame = currentImageIndex;
+        exactFramePending = false;
+        
+        checkGLError("updateTexture");
+    } else {
+        std::cerr << "Invalid image data for: " << imageLoader.getImageName(currentImageIndex) << std::endl;
     }
+}
 
-    // Detach and delete shaders (no longer needed after linking)
-    glDetachShader(program, vertexShader);
-    glDetachShader(program, fragmentShader);
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+bool Renderer::handleSeekRequests() {
+    if (imageCount == 0) {
+        return false;
+    }
+    size_t target = seekRequest.exchange(NoSeek);
+    long long delta = scrubRequest.exchange(0);
+    if (target == NoSeek && delta == 0) {
+        return false;
+    }
+    
+    size_t base = target != NoSeek ? std::min(target, imageCount - 1) : currentImageIndex;
+    long long count = static_cast<long long>(imageCount);
+    size_t index = static_cast<size_t>(((static_cast<long long>(base) + delta) % count + count) % count);
+    int direction = delta < 0 || (delta == 0 && index < currentImageIndex) ? -1 : 1;
+    seekTo(index, direction);
+    stepPending = true;
+    return true;
+}
 
-    // Get uniform locations
-    uTextureLocation = glGetUniformLocation(program, "uTexture");
+void Renderer::seekTo(size_t index, int direction) {
+    currentImageIndex = index;
+    playbackDirection = direction;
+    framePacer.reset(); // Playback continues from the target
+    if (residentFrames.isResident()) {
+        return; // Every frame is on the GPU already
+    }
+    
+    // Point the prefetcher at the target first so it is decoded next, then
+    // show the closest frame that needs no decode while that happens
+    imageLoader.seekPlaybackPosition(index, direction);
+    if (frameProducer.isRunning()) {
+        frameProducer.seek(index);
+    }
+    size_t nearest = index;
+    std::shared_ptr<const ImageData> imageData = imageLoader.acquireNearestImage(index, nearest);
+    if (imageData && imageData->isValid() && textureUploader.upload(*imageData)) {
+        uploadedFrame = nearest;
+        showUploadedFrame = frameProducer.isRunning();
+        releaseSharedFrame(); // The stand-in is drawn until the exact frame is shared
+    }
+    // The producer delivers the exact frame itself; otherwise poll the cache for it
+    exactFramePending = !frameProducer.isRunning() && uploadedFrame != index;
+}
 
-    return program;
+bool Renderer::uploadExactFrameIfReady() {
+    if (!exactFramePending) {
+        return false;
+    }
+    std::shared_ptr<const ImageData> imageData = imageLoader.tryAcquireImage(currentImageIndex);
+    if (outputGroup) {
+        // Decoded now: the group uploads it unless another output already has
+        return imageData && acquireSharedFrame(currentImageIndex);
+    }
+    if (imageData && imageData->isValid() && textureUploader.upload(*imageData)) {
+        uploadedFrame = currentImageIndex;
+        exactFramePending = false;
+        return true;
+    }
+    return false;
 }
 
-void Renderer::updateTexture() {
-    if (imageNames.empty()) {
-        std::cerr << "No images available" << std::endl;
+void Renderer::stageNextFrame() {
+    if (paused || imageCount == 0 || residentFrames.isResident() || frameProducer.isRunning() || outputGroup) {
         return;
     }
     
-    const std::string& currentImageName = imageNames[currentImageIndex];
-    const ImageData* imageData = imageLoader.getImage(currentImageName);
-    
+    TRACE_ZONE("Stage next frame");
+    size_t nextIndex = (currentImageIndex + 1) % imageCount;
+    DirtyTiles tiles;
+    if (imageLoader.getChangedTiles(currentImageIndex, nextIndex, tiles) && tiles.dirtyFraction() <= 0.5) {
+        return; // The next frame goes up as a few tiles; staging all of it would cost more
+    }
+    // Lazy frames never wait for a decode here either: a frame that is not
+    // ready yet is left to updateTexture(), which keeps the shown one up
+    std::shared_ptr<const ImageData> imageData =
+        lazyFrames ? imageLoader.tryAcquireImage(nextIndex) : imageLoader.acquireImage(nextIndex);
     if (imageData && imageData->isValid()) {
-        // Bind the texture
-        glBindTexture(GL_TEXTURE_2D, texture);
-        
-        // Determine the format based on channels
-        GLenum format = (imageData->channels == 4) ? GL_RGBA : GL_RGB;
-        
-        // Upload the image data
-        glTexImage2D(GL_TEXTURE_2D, 0, format, imageData->width, imageData->height, 0, 
-                     format, GL_UNSIGNED_BYTE, imageData->data.data());
-        
-        checkGLError("updateTexture");
-    } else {
-        std::cerr << "Invalid image data for: " << currentImageName << std::endl;
+        FrameStats::Scope timing(&frameStats, FrameStage::Upload);
+        textureUploader.stage(*imageData, nextIndex);
     }
 }
 
-void Renderer::nextFrame() {
-    if (imageNames.empty()) {
+bool Renderer::acquireSharedFrame(size_t index) {
+    // Unpinned first, so the group can reuse its texture if every other one is pinned
+    releaseSharedFrame();
+    if (!outputGroup->acquire(index, playbackDirection, sharedFrame, &frameStats)) {
+        return false;
+    }
+    holdsSharedFrame = true;
+    sharedFrameIndex = index;
+    exactFramePending = false;
+    return true;
+}
+
+void Renderer::releaseSharedFrame() {
+    if (holdsSharedFrame) {
+        outputGroup->release(sharedFrameIndex);
+        holdsSharedFrame = false;
+    }
+}
+
+void Renderer::nextFrame(size_t count) {
+    if (imageCount == 0) {
         return;
     }
     
-    // Advance to next image
-    currentImageIndex = (currentImageIndex + 1) % imageNames.size();
+    // Advance to next image (skipping frames that were dropped)
+    currentImageIndex = (currentImageIndex + count) % imageCount;
+    playbackDirection = 1;
+    if (frameProducer.isRunning()) {
+        // The producer owns the loader's playback position while it runs
+        frameProducer.advance(count);
+        return;
+    }
+    if (!outputGroup) {
+        imageLoader.setPlaybackPosition(currentImageIndex, 1);
+    }
     updateTexture();
 }
 
 void Renderer::previousFrame() {
-    if (imageNames.empty()) {
+    if (imageCount == 0) {
         return;
     }
     
     // Go to previous image
+    playbackDirection = -1;
     if (currentImageIndex == 0) {
-        currentImageIndex = imageNames.size() - 1;
+        currentImageIndex = imageCount - 1;
     } else {
         currentImageIndex--;
     }
+    if (frameProducer.isRunning()) {
+        frameProducer.seek(currentImageIndex);
+        return;
+    }
+    if (!outputGroup) {
+        imageLoader.setPlaybackPosition(currentImageIndex, -1);
+    }
     
     updateTexture();
 }
 
-void Renderer::renderTexturedQuad() {
-    if (!shaderProgram || !texture) {
-        return;
+bool Renderer::getCurrentFrame(PipelineFrame& frame) {
+    if (residentFrames.isResident()) {
+        bool fromArray = residentFrames.getMode() == ResidentSequence::Mode::TextureArray;
+        frame.texture = fromArray ? residentFrames.getArrayTexture() : residentFrames.getFrameTexture(currentImageIndex);
+        frame.target = fromArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+        frame.layer = static_cast<int>(currentImageIndex);
+        frame.width = residentFrames.getFrameWidth(currentImageIndex);
+        frame.height = residentFrames.getFrameHeight(currentImageIndex);
+        frame.internalFormat = residentFrames.getFrameFormat(currentImageIndex);
+        shownFrame = currentImageIndex;
+        return frame.texture != 0;
     }
     
-    // Use the shader program
-    glUseProgram(shaderProgram);
-    
-    // Get attribute locations
-    GLint positionLoc = glGetAttribLocation(shaderProgram, "aPosition");
-    GLint texCoordLoc = glGetAttribLocation(shaderProgram, "aTexCoord");
-    
-    // Vertex data for a quad (x, y, z, u, v)
-    const float vertices[] = {
-        // Positions    // Texture Coords
-        -1.0f,  1.0f, 0.0f,  0.0f, 0.0f,  // Top-left
-         1.0f,  1.0f, 0.0f,  1.0f, 0.0f,  // Top-right
-        -1.0f, -1.0f, 0.0f,  0.0f, 1.0f,  // Bottom-left
-         1.0f, -1.0f, 0.0f,  1.0f, 1.0f   // Bottom-right
-    };
-    
-    // Enable vertex attributes
-    glEnableVertexAttribArray(positionLoc);
-    glEnableVertexAttribArray(texCoordLoc);
-    
-    // Set vertex attribute pointers
-    glVertexAttribPointer(positionLoc, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), vertices);
-    glVertexAttribPointer(texCoordLoc, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), vertices + 3);
+    // The producer's newest frame, unless a seek's stand-in is up in textureUploader
+    frame.target = GL_TEXTURE_2D;
+    frame.layer = 0;
+    if (holdsSharedFrame) {
+        frame.texture = sharedFrame.texture;
+        frame.width = sharedFrame.width;
+        frame.height = sharedFrame.height;
+        frame.internalFormat = sharedFrame.internalFormat;
+        shownFrame = sharedFrameIndex;
+    } else if (frameProducer.isRunning() && frameProducer.getTexture() && !showUploadedFrame) {
+        frame.texture = frameProducer.getTexture();
+        frame.width = frameProducer.getWidth();
+        frame.height = frameProducer.getHeight();
+        frame.internalFormat = frameProducer.getInternalFormat();
+        shownFrame = frameProducer.getFrameIndex();
+    } else {
+        frame.texture = textureUploader.getTexture();
+        frame.width = textureUploader.getWidth();
+        frame.height = textureUploader.getHeight();
+        frame.internalFormat = textureUploader.getInternalFormat();
+        frame.planes = textureUploader.getPlaneFormat();
+        frame.chromaTextures[0] = textureUploader.getChromaTexture(0);
+        frame.chromaTextures[1] = textureUploader.getChromaTexture(1);
+        shownFrame = uploadedFrame;
+    }
+    return frame.texture != 0;
+}
+
+PipelineOutput Renderer::fitOutput(const PipelineFrame& frame) const {
+    // Largest viewport with the frame's aspect ratio, centred in the back buffer
+    PipelineOutput output = { 0, 0, width, height, width, height };
+    if (frame.width > 0 && frame.height > 0) {
+        double frameAspect = static_cast<double>(frame.width) / frame.height;
+        if (width > height * frameAspect) {
+            output.width = std::max(static_cast<int>(height * frameAspect + 0.5), 1);
+            output.x = (width - output.width) / 2;
+        } else {
+            output.height = std::max(static_cast<int>(width / frameAspect + 0.5), 1);
+            output.y = (height - output.height) / 2;
+        }
+    }
     
-    // Set active texture and uniform
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glUniform1i(uTextureLocation, 0);
+    // Effects never run above the source resolution
+    float scale = renderScale;
+    output.renderWidth = std::max(static_cast<int>(output.width * scale + 0.5f), 1);
+    output.renderHeight = std::max(static_cast<int>(output.height * scale + 0.5f), 1);
+    if (frame.width > 0 && frame.height > 0) {
+        output.renderWidth = std::min(output.renderWidth, frame.width);
+        output.renderHeight = std::min(output.renderHeight, frame.height);
+    }
+    return output;
+}
 
-    // 强制 GPU 同步以确保准确的性能测量
-   glFinish();
-    // Start timing this frame
-    frameStartTime = std::chrono::high_resolution_clock::now();
+bool Renderer::applyResize() {
+    if (!resizePending.exchange(false)) {
+        return false;
+    }
+    int newWidth = requestedWidth;
+    int newHeight = requestedHeight;
+    if (newWidth == width && newHeight == height) {
+        return false;
+    }
+    width = newWidth;
+    height = newHeight;
+    std::cout << "Output resized to " << width << "x" << height << std::endl;
+    return true;
+}
+
+void Renderer::drawFrame() {
+    // Clear the whole back buffer; the borders around a fitted frame stay black
+    glViewport(0, 0, width, height);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
     
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    PipelineFrame frame;
+    if (getCurrentFrame(frame)) {
+        // With layers the pipeline draws their composite, which has the frame's size
+        PipelineFrame composite;
+        if (layerCompositor.hasLayers() && layerCompositor.composite(frame, shownFrame, playbackDirection, composite)) {
+            frame = composite;
+        }
+        pipeline->render(frame, fitOutput(frame));
+    } else if (placeholderWidth > 0 && placeholderHeight > 0) {
+        // Nothing decoded yet: a grey rectangle where the frame will appear
+        PipelineFrame placeholder = { 0, GL_TEXTURE_2D, 0, placeholderWidth, placeholderHeight, GL_RGBA };
+        PipelineOutput output = fitOutput(placeholder);
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(output.x, output.y, output.width, output.height);
+        glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDisable(GL_SCISSOR_TEST);
+    }
+}
+
+void Renderer::exportFrames() {
+    lazyFrames = false; // Every frame is written, so each one waits for its decode
+    bool ok = frameExporter.start(exportDirectory, exportFormat, gles3);
+    auto startTime = std::chrono::high_resolution_clock::now();
+    size_t exported = 0;
     
-    // 确保所有渲染完成
-   glFinish();
+    // Layers are composited per frame; resident frames are not uploaded at all
+    bool batching = pipeline->getBatchSize() > 1 && !layerCompositor.hasLayers() && !residentFrames.isResident();
+    if (batching) {
+        std::cout << "Batched export: up to " << pipeline->getBatchSize() << " frames per dispatch" << std::endl;
+    }
     
-    // 结束渲染计时
-    auto renderEndTime = std::chrono::high_resolution_clock::now();
-    double renderTime = std::chrono::duration<double, std::milli>(renderEndTime - frameStartTime).count();
+    // Frames are uploaded on this thread in order, so every one is drawn exactly
+    // once; the readback of frame i completes while frames i+1.. are drawn
+    size_t i = 0;
+    while (ok && running && i < imageCount) {
+        if (batching) {
+            size_t batched = exportBatch(i, exported);
+            if (batched > 0) {
+                i += batched;
+                continue;
+            }
+        }
+        if (i != currentImageIndex) {
+            nextFrame(i - currentImageIndex);
+        }
+        ++i;
+        drawFrame();
+        stageNextFrame();
+        
+        PipelineFrame frame;
+        if (!getCurrentFrame(frame)) {
+            std::cerr << "No frame to export for: " << imageLoader.getImageName(currentImageIndex) << std::endl;
+            continue;
+        }
+        PipelineOutput output = fitOutput(frame);
+        {
+            TRACE_ZONE("Export frame");
+            FrameStats::Scope timing(&frameStats, FrameStage::Present);
+            if (frameExporter.capture(output.x, output.y, output.width, output.height,
+                                      imageLoader.getImageName(currentImageIndex))) {
+                timing.addBytes(static_cast<uint64_t>(output.width) * output.height * 4);
+                ++exported;
+            }
+        }
+        TRACE_FRAME(currentImageIndex);
+        reportFrameStats();
+    }
+    ok = frameExporter.finish() && ok;
     
-    // Disable vertex attributes
-    glDisableVertexAttribArray(positionLoc);
-    glDisableVertexAttribArray(texCoordLoc);
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+    std::cout << "Exported " << frameExporter.getWrittenCount() << " of " << imageCount << " frames to "
+              << exportDirectory << " in " << seconds << " s";
+    if (seconds > 0.0) {
+        std::cout << " (" << exported / seconds << " fps)";
+    }
+    std::cout << std::endl;
+    if (frameExporter.getFailedCount() > 0) {
+        std::cerr << frameExporter.getFailedCount() << " frame(s) could not be written" << std::endl;
+    }
     
-    // Unbind shader program
-    glUseProgram(0);
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        exportFinished = true;
+        exportSucceeded = ok && exported == imageCount;
+    }
+    stateChanged.notify_all();
+}
+
+size_t Renderer::exportBatch(size_t first, size_t& exported) {
+    int capacity = pipeline->getBatchSize();
+    if (capacity <= 1) {
+        return 0; // The pipeline gave up on batches
+    }
     
-    // End timing this frame
-    frameEndTime = std::chrono::high_resolution_clock::now();
-    lastFrameTime = std::chrono::duration<double, std::milli>(frameEndTime - frameStartTime).count();
+    // A batch ends early at a frame of another size, which starts the next one
+    frameBatch.begin(capacity);
+    {
+        TRACE_ZONE("Upload batch");
+        FrameStats::Scope timing(&frameStats, FrameStage::Upload);
+        for (size_t i = first; i < imageCount && !frameBatch.isFull(); ++i) {
+            imageLoader.setPlaybackPosition(i, 1);
+            std::shared_ptr<const ImageData> imageData = imageLoader.acquireImage(i);
+            if (!imageData || !frameBatch.add(*imageData)) {
+                break;
+            }
+            timing.addBytes(imageData->data.size());
+        }
+        checkGLError("exportBatch upload");
+    }
+    int count = frameBatch.getCount();
+    PipelineFrame layers = frameBatch.getFrame();
+    if (count == 0 || !pipeline->processBatch(layers, count)) {
+        return 0;
+    }
+    PipelineOutput output = fitOutput(layers);
     
-    // Update frame statistics
-    frameCount++;
-    totalRenderTime += lastFrameTime; // 使用每次迭代的平均时间
+    // Each layer is presented and read back like a frame drawn on its own
+    for (int layer = 0; layer < count; ++layer) {
+        currentImageIndex = first + layer;
+        glViewport(0, 0, width, height);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        pipeline->presentBatchLayer(layer, output);
+        {
+            TRACE_ZONE("Export frame");
+            FrameStats::Scope timing(&frameStats, FrameStage::Present);
+            if (frameExporter.capture(output.x, output.y, output.width, output.height,
+                                      imageLoader.getImageName(currentImageIndex))) {
+                timing.addBytes(static_cast<uint64_t>(output.width) * output.height * 4);
+                ++exported;
+            }
+        }
+        TRACE_FRAME(currentImageIndex);
+        reportFrameStats();
+    }
+    return static_cast<size_t>(count);
+}
 
-    // Check if we need to report and reset statistics
+void Renderer::reportFrameStats() {
+    // Percentiles cover the last samples of each stage, not just this interval
+    frameStats.markFrame();
+    frameCount++;
     if (frameCount >= statsResetInterval) {
-        double averageRenderTime = totalRenderTime / frameCount;
         std::cout << "\n===== Performance Statistics =====" << std::endl;
-        std::cout << "Frames rendered: " << frameCount << std::endl;
-        std::cout << "Total render time: " << totalRenderTime << " ms" << std::endl;
-        std::cout << "Average render time per iteration: " << averageRenderTime << " ms" << std::endl;
+        std::cout << "Timing: " << (timingMode == TimingMode::Precise ? "glFinish (precise)" : "GPU timer query") << std::endl;
+        std::cout << "Source frames dropped: " << framePacer.getDroppedFrames() << std::endl;
+        frameStats.report(std::cout);
+        pipeline->reportStats(std::cout);
+        updateMemoryUsage();
+        getMemoryUsage().print(std::cout);
         std::cout << "================================\n" << std::endl;
-        
-        // Reset statistics
         frameCount = 0;
-        totalRenderTime = 0.0;
+    }
+}
+
+size_t MemoryUsage::getGpuBytes() const {
+    size_t bytes = 0;
+    for (const GpuAllocation& allocation : gpu) {
+        bytes += allocation.bytes;
+    }
+    return bytes;
+}
+
+void MemoryUsage::print(std::ostream& out) const {
+    const double MB = 1024.0 * 1024.0;
+    loader.print(out);
+    out << std::fixed << std::setprecision(1);
+    if (exportQueueBytes > 0) {
+        out << "  export queue " << exportQueueBytes / MB << " MB" << std::endl;
+    }
+    out << "GPU memory (estimated): " << getGpuBytes() / MB << " MB" << std::endl;
+    for (const GpuAllocation& allocation : gpu) {
+        out << "  " << allocation.name << " " << allocation.bytes / MB << " MB" << std::endl;
+    }
+    out << std::defaultfloat;
+}
+
+MemoryUsage Renderer::getMemoryUsage() const {
+    std::lock_guard<std::mutex> lock(memoryMutex);
+    return memoryUsage;
+}
+
+void Renderer::updateMemoryUsage() {
+    MemoryUsage usage;
+    usage.loader = imageLoader.getMemoryUsage();
+    usage.exportQueueBytes = frameExporter.getQueuedBytes();
+    
+    std::vector<GpuAllocation> allocations = {
+        { "Frame texture", textureUploader.getMemoryBytes() },
+        { "Resident frames", residentFrames.getMemoryBytes() },
+        { "Producer slots", frameProducer.getMemoryBytes() },
+        { "Export readback", frameExporter.getBufferBytes() },
+        { "Export batch", frameBatch.getMemoryBytes() },
+    };
+    layerCompositor.addGpuAllocations(allocations);
+    pipeline->addGpuAllocations(allocations);
+    // Only what is allocated; most of these are idle in any one mode
+    for (GpuAllocation& allocation : allocations) {
+        if (allocation.bytes > 0) {
+            usage.gpu.push_back(std::move(allocation));
+        }
     }
     
-    checkGLError("renderTexturedQuad");
+    std::lock_guard<std::mutex> lock(memoryMutex);
+    memoryUsage = std::move(usage);
+}
+
+void Renderer::adaptQuality() {
+    float previous = renderScale;
+    double gpuTime = qualityController.getAverageGpuTime();
+    float scale = qualityController.update(frameStats);
+    if (scale != previous) {
+        // Effects run at the new size from the next frame on
+        renderScale = scale;
+        std::cout << "Adaptive quality: render scale " << previous << " -> " << scale << " (GPU "
+                  << gpuTime << " ms of " << qualityController.getFrameBudget() << " ms)" << std::endl;
+    }
 }
 
 void Renderer::checkEGLError(const char* msg) {
@@ -7,14 +7,49 @@
 #include <Windows.h>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 #include <string>
 #include "../reader/ImageLoader.h"
+#include "RenderPipeline.h"
+#include "DisplayBackend.h"
+#include "TextureUploader.h"
+#include "GpuTimer.h"
+#include "FrameStats.h"
+#include "FramePacer.h"
+#include "FullscreenQuad.h"
+#include "ResidentSequence.h"
+#include "ShaderReloader.h"
+#include "FrameProducer.h"
+#include "FrameExporter.h"
+#include "FrameBatch.h"
+#include "LayerCompositor.h"
+#include "OutputGroup.h"
+#include "QualityController.h"
 
+// RAM and estimated GPU memory of a renderer and its loader, see Renderer::getMemoryUsage
+struct MemoryUsage {
+    LoaderMemoryUsage loader;
+    size_t exportQueueBytes = 0;     // Frames read back by a batch export and waiting to be encoded
+    std::vector<GpuAllocation> gpu;  // Per texture or group of buffers
+    
+    size_t getGpuBytes() const;
+    void print(std::ostream& out) const;
+};
+
+// Playback and presentation of an image sequence: EGL setup, the render
+// thread, frame pacing, playback controls, uploads and frame statistics. How
+// a frame is drawn is up to the RenderPipeline (see RenderPipeline::create),
+// chosen at construction.
 class Renderer {
 public:
-    Renderer(HWND hWnd, int width, int height, ImageLoader& imageLoader);
+    // A null hWnd renders headless into a width x height pbuffer (benchmarks).
+    // A null pipeline selects the fragment pipeline.
+    Renderer(HWND hWnd, int width, int height, ImageLoader& imageLoader,
+             std::unique_ptr<RenderPipeline> pipeline = nullptr);
     ~Renderer();
 
     // Start the rendering loop in a separate thread
@@ -27,86 +62,299 @@ public:
     void stepForward();
     void stepBackward();
     bool isPaused() const;
+    
+    // Jump to a frame, playing or paused (any thread). The nearest frame that
+    // is already decoded is shown at once and replaced by the exact frame as
+    // soon as it is ready; completion is reported through the step event.
+    void seek(size_t frameIndex);
+    // Move the playhead by delta frames; calls made before the render thread
+    // catches up accumulate
+    void scrub(long long delta);
+    
+    // Draw the current frame again (any thread), e.g. after changing a pipeline
+    // setting while paused. A paused renderer otherwise sleeps until a step,
+    // seek, resize, shader reload or one of these calls arrives.
+    void invalidate();
+    
+    // Auto-reset event set once a requested step is on screen, for UI loops
+    // that block in MsgWaitForMultipleObjects; getPresentedFrame() is the
+    // frame that step displayed
+    HANDLE getStepEvent() const { return stepEvent; }
+    size_t getPresentedFrame() const { return presentedFrame; }
+    
+    // The pipeline drawing the frames, e.g. to configure it before start
+    RenderPipeline& getPipeline() { return *pipeline; }
+
+    // .cube files cycleLut() steps through (call before start; see LutCache);
+    // the first one grades the frames from the start
+    void setLuts(const std::vector<std::string>& paths);
+    // Grade with the next LUT of the list, or none after the last (any thread)
+    void cycleLut();
+    
+    // Choose how frame times are measured (call before start)
+    void setTimingMode(TimingMode mode);
+    
+    // Per-stage frame timing (decode, upload, compute, draw, present) of recent frames.
+    // Thread-safe, e.g. to clear() it after a benchmark warm-up.
+    FrameStats& getFrameStats() { return frameStats; }
+    // When the renderer stops, append the stage percentiles to basePath.csv and
+    // write them to basePath.json, tagged with label (e.g. the build); empty = off
+    void setStatsExport(const std::string& basePath, const std::string& label);
+    // Memory held for frames on the CPU and, estimated from the sizes and
+    // formats of the textures and buffers, on the GPU (any thread). Taken
+    // when the renderer starts and with every statistics report, which prints it.
+    MemoryUsage getMemoryUsage() const;
+    // Frames between the statistics printed to the console (call before start; default 60)
+    void setStatsInterval(int frames) { statsResetInterval = frames > 0 ? frames : 1; }
+    
+    // Playback pacing: source frame rate and whether presentation waits for vsync
+    void setFrameRate(double fps);
+    void setVsync(bool enabled);
+    
+    // ANGLE backend, device, adapter and feature overrides to render with (call
+    // before start). The features in effect are logged when the display is up.
+    void setDisplayBackend(const DisplayBackend& backend);
+    // GL_RENDERER of the running context, e.g. "ANGLE (NVIDIA, ... Direct3D11 ...)",
+    // which names the backend and GPU that were actually used
+    const std::string& getRendererString() const { return rendererString; }
+    
+    // Low-latency presentation (call before start; windowed only): a
+    // DirectComposition flip-model swap chain where ANGLE offers one, and at
+    // most maxFrameLatency frames queued ahead of the display. In a borderless
+    // window covering the monitor, DWM can then flip the swap chain directly.
+    void setLowLatencyPresentation(bool enabled, int maxFrameLatency = 1);
+    
+    // Sequences of up to frameLimit frames that fit in memoryBudget bytes of
+    // texture memory are uploaded once and looped from the GPU, if the
+    // pipeline can draw them (call before start; a limit of 0 disables residency)
+    void setResidentFrameLimit(size_t frameLimit, size_t memoryBudget);
+    
+    // Never wait for a decode on the render thread (call before start). A frame
+    // the loader does not have yet leaves the last ready one on screen and is
+    // shown as soon as the prefetcher delivers it; until the first frame is
+    // decoded a grey placeholder of its size (read from the file header) is
+    // drawn. Meant for streamed sequences, so the first frame appears as soon
+    // as the window does; sequences are not made GPU-resident, since that
+    // would decode every frame up front.
+    void setLazyFrames(bool enabled) { lazyFrames = enabled; }
+    
+    // Directory the shaders are loaded from and watched in (call before start).
+    // Missing files fall back to the built-in sources.
+    void setShaderDirectory(const std::string& directory);
+    
+    // New client area size of the window, e.g. from WM_SIZE (any thread). The
+    // frame is refitted on the next iteration and ANGLE resizes the swap chain
+    // on the following swap; a 0 x 0 (minimized) window is not drawn. Headless
+    // renderers keep their pbuffer size.
+    void resize(int width, int height);
+    
+    // Fraction of the displayed size that effects are computed at (any thread;
+    // clamped to 0.25 - 1). The final draw scales the result up, so effect cost
+    // follows the size on screen and the scale rather than the source resolution.
+    void setRenderScale(float scale);
+    
+    // Let the render scale follow the GPU load between minScale and maxScale
+    // (call before start; see QualityController), so effects lose resolution
+    // before frames are dropped. The budget is adaptiveBudgetShare of the
+    // source frame interval, leaving the rest for uploads and presentation.
+    // Needs GPU timing; replaces the scale given to setRenderScale.
+    void setAdaptiveQuality(float minScale, float maxScale = 1.0f);
+    
+    // Blend another sequence over the frames before the pipeline draws them
+    // (call before start; see LayerCompositor). Layers are drawn in the order
+    // added; loader must outlive the renderer and should share its
+    // PrefetchScheduler with the main loader's.
+    bool addLayer(ImageLoader& loader, float opacity = 1.0f,
+                  LayerCompositor::BlendMode mode = LayerCompositor::BlendMode::Normal);
+    
+    // Present the group's frames in this renderer's window (call before start;
+    // the group must be open and outlive the renderer). Uploads are shared
+    // with the group's other outputs; the sequence is not made resident and
+    // no producer thread runs, the group's textures take their place.
+    void setOutputGroup(OutputGroup* group);
+    
+    // Batch export (call before start; headless): instead of playing, the
+    // render thread draws every frame of the loader once, in order and as fast
+    // as the GPU allows (no pacing, vsync or producer), and FrameExporter writes
+    // each output viewport to directory as <frame name>.png or .rgba. Pipelines
+    // with a batch size above 1 (RenderPipeline::getBatchSize) process runs of
+    // frames with one dispatch each, unless layers are composited.
+    void setBatchExport(const std::string& directory, FrameExporter::Format format);
+    // Block until the batch export has finished; false if a frame was not written
+    bool waitForExport();
 
 private:
-    // Window properties
+    // Window properties; width and height are the back buffer size, owned by
+    // the render thread once it runs
     HWND hWnd;
     int width;
     int height;
     
+    // Resize requests and render scale, consumed by the render thread
+    std::atomic<bool> resizePending;
+    std::atomic<int> requestedWidth;
+    std::atomic<int> requestedHeight;
+    std::atomic<float> renderScale;
+    
     // Image loader reference
     ImageLoader& imageLoader;
-    std::vector<std::string> imageNames;
+    size_t imageCount;  // Frames in the loader's table, addressed by index
     size_t currentImageIndex;
+    int playbackDirection;  // +1 after moving forward, -1 after stepping back
 
     // Playback control variables
     std::atomic<bool> paused;
     std::atomic<bool> shouldStepForward;
     std::atomic<bool> shouldStepBackward;
     std::atomic<bool> running;
+    std::atomic<bool> redrawRequested;  // invalidate() was called
+
+    // LUTs to cycle through and the one selected, -1 for none
+    std::vector<std::string> lutPaths;
+    std::atomic<int> lutIndex;
+    
+    // Step completion reported back to the UI thread
+    HANDLE stepEvent;
+    std::atomic<size_t> presentedFrame;
+    bool stepPending;  // Render thread: a step was taken but its frame is not on screen yet
+    
+    // Seek and scrub requests, consumed by the render thread
+    static const size_t NoSeek = static_cast<size_t>(-1);
+    std::atomic<size_t> seekRequest;
+    std::atomic<long long> scrubRequest;
+    
+    // Render thread: which frame each texture shows
+    size_t uploadedFrame;      // Frame in textureUploader
+    size_t shownFrame;         // Frame drawn by the last drawFrame
+    bool exactFramePending;    // textureUploader holds a stand-in until the seek target is decoded
+    bool showUploadedFrame;    // Draw textureUploader instead of the producer's frame (stand-in)
+    
+    // Frames are taken only once decoded (setLazyFrames); the placeholder has
+    // the first frame's size until one is
+    bool lazyFrames;
+    int placeholderWidth;
+    int placeholderHeight;
+
+    // Render thread lifecycle: start() waits until the thread has bound the
+    // context (or failed to), stop() wakes and joins it
+    std::thread renderThread;
+    std::mutex stateMutex;
+    std::condition_variable stateChanged;
+    bool loopStarted;
 
     // EGL variables
     EGLDisplay display;
     EGLConfig config;
     EGLContext context;
     EGLSurface surface;
+    bool gles3; // True when an ES 3.0 context was created (immutable texture storage available)
 
-    // Shader program and texture variables
-    GLuint shaderProgram;
-    GLuint texture;
+    // Draws each frame
+    std::unique_ptr<RenderPipeline> pipeline;
+    
+    // Texture the current frame is uploaded to on the render thread
+    TextureUploader textureUploader;
+    
+    // Vertex buffer for the fullscreen quad, shared by the pipeline's programs
+    FullscreenQuad quad;
+    
+    // Sequences blended over the frames before they reach the pipeline
+    LayerCompositor layerCompositor;
+    
+    // Whole-sequence residency for short loops
+    ResidentSequence residentFrames;
+    size_t residentFrameLimit;
+    size_t residentMemoryBudget;
     
-    // Uniform location
-    GLint uTextureLocation;
+    // Shader files of the pipeline, rebuilt on a worker thread when they change
+    ShaderReloader shaderReloader;
     
-    // Performance measurement
-    std::chrono::high_resolution_clock::time_point frameStartTime;
-    std::chrono::high_resolution_clock::time_point frameEndTime;
-    std::chrono::steady_clock::time_point lastFrameTimePoint;
-    double lastFrameTime; // in milliseconds
+    // Number of pixel unpack buffers used to stage uploads ahead of time
+    const int pixelBufferCount = 3;
+    
+    // Streamed playback on ES3: frames are decoded and uploaded on a producer
+    // thread and the render thread only picks the newest one due
+    FrameProducer frameProducer;
+    const int producerSlotCount = 4;
+    
+    // Frame pacing
+    FramePacer framePacer;
+    bool adaptiveQuality;
+    QualityController qualityController;  // Render thread, with adaptiveQuality
+    const double adaptiveBudgetShare = 0.75;
+    bool vsync;
+    bool lowLatency;
+    int maxFrameLatency;
+    DisplayBackend displayBackend;
+    std::string rendererString;
+    
+    // Performance measurement (the pipeline times its GPU work)
+    TimingMode timingMode;
     
     // Frame statistics
-    int frameCount;
-    double totalRenderTime; // Total render time in milliseconds
-    const int statsResetInterval = 60; // Reset statistics every 100 frames
-
-    // Shader sources
-    const char* vertexShaderSource = R"(
-        attribute vec4 aPosition;
-        attribute vec2 aTexCoord;
-        varying vec2 vTexCoord;
-        void main() {
-            gl_Position = aPosition;
-            vTexCoord = aTexCoord;
-        }
-    )";
-
-    const char* fragmentShaderSourceOld = R"(
-        precision mediump float;
-        varying vec2 vTexCoord;
-        uniform sampler2D uTexture;
-        void main() {
-            gl_FragColor = texture2D(uTexture, vTexCoord);
-        }
-    )";
-
-    // 组合着色器代码片段
-//    const char* fragmentShaderSource = fragmentShaderSourcePart1;
-//    const char* fragmentShaderSourcePart2Ptr = fragmentShaderSourcePart2;
-     const char* fragmentShaderSource = fragmentShaderSourceOld;
-     const char* fragmentShaderSourcePart2Ptr = nullptr;
+    FrameStats frameStats;
+    int frameCount;  // Frames presented since the last report
+    int statsResetInterval;  // Report statistics every statsResetInterval frames
+    std::string statsExportPath;
+    std::string statsLabel;
+    
+    // Newest memory snapshot, taken on the thread with the context current
+    mutable std::mutex memoryMutex;
+    MemoryUsage memoryUsage;
+    
+    // Batch export; completion is reported through stateMutex/stateChanged
+    std::string exportDirectory;
+    FrameExporter::Format exportFormat;
+    FrameExporter frameExporter;
+    FrameBatch frameBatch;  // Frames of a batched dispatch
+    bool exportFinished;
+    bool exportSucceeded;
+    
+    // Shared display, context share group and frame textures (null = own display)
+    OutputGroup* outputGroup;
+    OutputGroup::Frame sharedFrame;  // Pinned group texture of the frame shown
+    bool holdsSharedFrame;
+    size_t sharedFrameIndex;
 
     // Private methods
     void renderLoop();
+    void updateMemoryUsage();
+    void notifyLoopStarted();
+    bool createDisplayAndContext();
+    bool joinOutputGroup();
+    void releaseDisplay();
     bool initializeGL();
-    void cleanupGL();
-    GLuint compileShader(GLenum type, const char* source);
-    GLuint createShaderProgram(const char* vertexSource, const char* fragmentSource);
+    void destroyGL();
     void updateTexture();
-    void renderTexturedQuad();
-    void nextFrame();
+    bool getCurrentFrame(PipelineFrame& frame);
+    PipelineOutput fitOutput(const PipelineFrame& frame) const;
+    bool applyResize();
+    void drawFrame();
+    void stageNextFrame();
+    bool makeSequenceResident();
+    void nextFrame(size_t count = 1);
     void previousFrame();
+    bool handleSeekRequests();
+    void seekTo(size_t index, int direction);
+    bool uploadExactFrameIfReady();
+    // ShaderReloader::ReadyCallback: a rebuilt program wakes a paused render loop
+    static void wakeRenderLoop(void* renderer);
+    // Render thread: pin the group's texture of a frame instead of the previous one
+    bool acquireSharedFrame(size_t index);
+    void releaseSharedFrame();
+    // Render thread: draw and write every frame for setBatchExport
+    void exportFrames();
+    // Upload, process and write up to a batch of frames from first on; returns
+    // how many were written, 0 if first must go frame by frame
+    size_t exportBatch(size_t first, size_t& exported);
 
+    // Count a presented frame and print the statistics every statsResetInterval frames
+    void reportFrameStats();
+    // Render thread: apply the scale the quality controller picks after a presented frame
+    void adaptQuality();
+    
     // Helper functions
+    bool limitFrameLatency();
     void checkEGLError(const char* msg);
     void checkGLError(const char* msg);
 };
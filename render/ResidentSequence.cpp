@@ -0,0 +1,188 @@
+#include "ResidentSequence.h"
+#include "../reader/BlockCompressor.h"
+
+// Texture memory a frame occupies once uploaded. RGB frames are stored as
+// RGBA by the D3D11 backend, compressed frames without S3TC support are
+// expanded to RGBA8, and so are YUV frames.
+static size_t textureBytes(const ImageData& image, bool compressedUploads) {
+    if (image.compression != BlockFormat::None &&
+        compressedUploads && TextureUploader::isBlockFormatSupported(image.compression)) {
+        return image.data.size();
+    }
+    if (image.sampleFormat == SampleFormat::Float16) {
+        return static_cast<size_t>(image.width) * image.height * 8; // RGBA16F
+    }
+    size_t bytesPerPixel = image.channels == 1 && !image.isPlanar() ? 1 : 4;
+    return static_cast<size_t>(image.width) * image.height * bytesPerPixel;
+}
+
+ResidentSequence::ResidentSequence()
+    : mode(Mode::None), frameCount(0), arrayTexture(0), arrayWidth(0), arrayHeight(0), arrayFormat(GL_NONE) {
+}
+
+bool ResidentSequence::upload(const ImageLoader& loader, bool allowTextureArray, bool compressedUploads, size_t memoryBudget) {
+    destroy();
+    if (loader.getImageCount() == 0) {
+        return false;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Rows are tightly packed
+
+    if (allowTextureArray && uploadArray(loader, compressedUploads, memoryBudget)) {
+        mode = Mode::TextureArray;
+    } else if (uploadRing(loader, compressedUploads, memoryBudget)) {
+        mode = Mode::TextureRing;
+    } else {
+        destroy();
+        return false;
+    }
+    frameCount = loader.getImageCount();
+    return true;
+}
+
+void ResidentSequence::destroy() {
+    if (arrayTexture) {
+        glDeleteTextures(1, &arrayTexture);
+        arrayTexture = 0;
+    }
+    for (auto& texture : ringTextures) {
+        texture.destroy();
+    }
+    ringTextures.clear();
+    mode = Mode::None;
+    frameCount = 0;
+}
+
+size_t ResidentSequence::getMemoryBytes() const {
+    if (mode == Mode::TextureArray) {
+        return TextureUploader::estimateBytes(arrayFormat, arrayWidth, arrayHeight, static_cast<int>(frameCount));
+    }
+    size_t bytes = 0;
+    for (const TextureUploader& texture : ringTextures) {
+        bytes += texture.getMemoryBytes();
+    }
+    return bytes;
+}
+
+bool ResidentSequence::uploadArray(const ImageLoader& loader, bool compressedUploads, size_t memoryBudget) {
+    size_t count = loader.getImageCount();
+
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    if (count > static_cast<size_t>(maxLayers)) {
+        return false;
+    }
+
+    // The first frame fixes the layout every layer must share
+    std::shared_ptr<const ImageData> first = loader.acquireImage(0);
+    if (!first || !first->isValid() || first->sampleFormat != SampleFormat::UNorm8 || first->isPlanar()) {
+        return false; // Layers are interleaved 8-bit formats only; YUV frames go to the ring, as RGBA8
+    }
+    bool compressed = first->compression != BlockFormat::None &&
+                      compressedUploads && TextureUploader::isBlockFormatSupported(first->compression);
+    if (textureBytes(*first, compressedUploads) * count > memoryBudget) {
+        return false;
+    }
+
+    GLenum sizedFormat = GL_NONE;
+    GLenum format = GL_NONE;
+    if (compressed) {
+        sizedFormat = first->compression == BlockFormat::BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                                                             : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    } else {
+        int channels = first->compression != BlockFormat::None ? 4 : first->channels;
+        if (!TextureUploader::formatForChannels(channels, true, sizedFormat, format)) {
+            return false;
+        }
+    }
+    int width = first->width;
+    int height = first->height;
+    BlockFormat firstCompression = first->compression;
+    first.reset();
+
+    glGenTextures(1, &arrayTexture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, arrayTexture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (sizedFormat == GL_R8) {
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_G, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    }
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, sizedFormat, width, height, static_cast<GLsizei>(count));
+
+    bool complete = true;
+    for (size_t i = 0; i < count; ++i) {
+        std::shared_ptr<const ImageData> image = loader.acquireImage(i);
+        if (!image || !image->isValid() || image->width != width || image->height != height ||
+            image->compression != firstCompression || image->sampleFormat != SampleFormat::UNorm8 ||
+            image->isPlanar()) {
+            complete = false; // Layout differs from the first frame
+            break;
+        }
+
+        GLint layer = static_cast<GLint>(i);
+        if (compressed) {
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1,
+                                      sizedFormat, static_cast<GLsizei>(image->data.size()), image->data.data());
+            continue;
+        }
+
+        // Frames the GPU cannot sample compressed are expanded here, once
+        ImageData decompressed;
+        const ImageData* pixels = image.get();
+        if (image->compression != BlockFormat::None) {
+            if (!BlockCompressor::decompress(*image, decompressed)) {
+                complete = false;
+                break;
+            }
+            pixels = &decompressed;
+        }
+        GLenum frameSized, frameFormat;
+        if (!TextureUploader::formatForChannels(pixels->channels, true, frameSized, frameFormat) ||
+            frameSized != sizedFormat) {
+            complete = false;
+            break;
+        }
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1,
+                        format, GL_UNSIGNED_BYTE, pixels->data.data());
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    if (!complete || glGetError() != GL_NO_ERROR) {
+        glDeleteTextures(1, &arrayTexture);
+        arrayTexture = 0;
+        return false;
+    }
+    arrayWidth = width;
+    arrayHeight = height;
+    arrayFormat = sizedFormat;
+    return true;
+}
+
+bool ResidentSequence::uploadRing(const ImageLoader& loader, bool compressedUploads, size_t memoryBudget) {
+    size_t count = loader.getImageCount();
+    size_t totalBytes = 0;
+
+    ringTextures.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::shared_ptr<const ImageData> image = loader.acquireImage(i);
+        if (!image || !image->isValid()) {
+            return false;
+        }
+        totalBytes += textureBytes(*image, compressedUploads);
+        if (totalBytes > memoryBudget) {
+            return false;
+        }
+
+        TextureUploader& texture = ringTextures[i];
+        texture.create(false);
+        if (compressedUploads) {
+            texture.enableCompressedUploads();
+        }
+        if (!texture.upload(*image)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <angle_gl.h>
+#include <vector>
+#include "../reader/ImageLoader.h"
+#include "TextureUploader.h"
+
+// Whole-sequence GPU residency for short loops.
+// All frames are uploaded once, after which playback only selects a frame:
+// a layer of one GL_TEXTURE_2D_ARRAY when every frame shares a layout and
+// the array limits allow it (ES3), otherwise one 2D texture per frame. Looping
+// playback then costs no CPU to GPU bandwidth at all.
+class ResidentSequence {
+public:
+    enum class Mode {
+        None,          // Not resident; frames are uploaded as they are shown
+        TextureArray,  // One layer per frame in a 2D array texture
+        TextureRing    // One 2D texture per frame
+    };
+
+    ResidentSequence();
+
+    // Upload every frame of the loader. Fails (leaving Mode::None) if the frames
+    // would need more than memoryBudget bytes of texture memory or a frame
+    // cannot be read. Needs a current context.
+    bool upload(const ImageLoader& loader, bool allowTextureArray, bool compressedUploads, size_t memoryBudget);
+    void destroy();
+
+    Mode getMode() const { return mode; }
+    bool isResident() const { return mode != Mode::None; }
+    size_t getFrameCount() const { return frameCount; }
+    // Estimated texture memory of the resident frames
+    size_t getMemoryBytes() const;
+
+    // Array texture (Mode::TextureArray)
+    GLuint getArrayTexture() const { return arrayTexture; }
+
+    // Texture of one frame (Mode::TextureRing)
+    GLuint getFrameTexture(size_t index) const { return ringTextures[index].getTexture(); }
+
+    // Size and internal format of a frame (either mode)
+    int getFrameWidth(size_t index) const { return mode == Mode::TextureArray ? arrayWidth : ringTextures[index].getWidth(); }
+    int getFrameHeight(size_t index) const { return mode == Mode::TextureArray ? arrayHeight : ringTextures[index].getHeight(); }
+    GLenum getFrameFormat(size_t index) const { return mode == Mode::TextureArray ? arrayFormat : ringTextures[index].getInternalFormat(); }
+
+private:
+    Mode mode;
+    size_t frameCount;
+    GLuint arrayTexture;
+    int arrayWidth;
+    int arrayHeight;
+    GLenum arrayFormat;
+    std::vector<TextureUploader> ringTextures;
+
+    bool uploadArray(const ImageLoader& loader, bool compressedUploads, size_t memoryBudget);
+    bool uploadRing(const ImageLoader& loader, bool compressedUploads, size_t memoryBudget);
+};
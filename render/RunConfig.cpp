@@ -0,0 +1,359 @@
+#include "RunConfig.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "Renderer.h"
+#include "../computeRenderer/ComputePipeline.h"
+#include "../computeRenderer/EffectLibrary.h"
+
+static const char* kTimingNames[] = { "off", "gpu", "precise" };
+
+static std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+static bool parseBool(const std::string& text, bool& value) {
+    if (text == "true" || text == "1" || text == "on" || text == "yes") {
+        value = true;
+    } else if (text == "false" || text == "0" || text == "off" || text == "no") {
+        value = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool parseInteger(const std::string& text, int minimum, int& value) {
+    char* end = nullptr;
+    errno = 0;
+    long parsed = strtol(text.c_str(), &end, 10);
+    if (text.empty() || !end || *end != '\0' || errno == ERANGE || parsed < minimum || parsed > INT_MAX) {
+        return false;
+    }
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+static bool parseNumber(const std::string& text, double& value) {
+    char* end = nullptr;
+    value = strtod(text.c_str(), &end);
+    return !text.empty() && end && *end == '\0';
+}
+
+std::vector<RunConfig::Setting> RunConfig::settings() const {
+    RunConfig* self = const_cast<RunConfig*>(this);
+    std::vector<Setting> table = {
+        { "photos", Type::Text, &self->photos, nullptr, "directory of the frame sequence" },
+        { "pipeline", Type::Text, &self->pipeline, nullptr, "fragment or compute, a list cycles over the windows" },
+        { "window-size", Type::Size, &self->windowWidth, &self->windowHeight, "WxH of each window" },
+        { "windows", Type::Int, &self->windows, nullptr, "number of windows", 1 },
+        { "frame-rate", Type::Double, &self->frameRate, nullptr, "source frames per second" },
+        { "vsync", Type::Bool, &self->vsync, nullptr, "wait for vsync on present" },
+        { "low-latency", Type::Bool, &self->lowLatency, nullptr, "borderless flip-model windows, one frame queued" },
+        { "timing", Type::Timing, &self->timingMode, nullptr, "off, gpu (timer queries) or precise (glFinish)" },
+        { "backend", Type::Backend, &self->backend, nullptr,
+          "default, d3d11, d3d11-warp, d3d9, vulkan, vulkan-swiftshader or gl" },
+        { "adapter", Type::Int, &self->backend.adapterIndex, nullptr, "DXGI adapter index, -1 = ANGLE's choice", -1 },
+        { "angle-features", Type::Features, &self->angleFeatures, nullptr, "ANGLE feature overrides file" },
+        { "render-scale", Type::Float, &self->renderScale, nullptr, "effect resolution, 0.25-1" },
+        { "adaptive-quality", Type::Float, &self->adaptiveQuality, nullptr, "minimum adaptive render scale, 0 = off" },
+        { "stats-interval", Type::Int, &self->statsInterval, nullptr, "frames between statistics reports", 1 },
+        { "lazy", Type::Bool, &self->lazy, nullptr, "never wait for a decode on the render thread" },
+        { "record", Type::Text, &self->recordControls, nullptr, "write the playback controls given to this file" },
+        { "replay", Type::Text, &self->replayControls, nullptr,
+          "replay recorded controls at their times, then report and exit" },
+        { "luts", Type::Text, &self->luts, nullptr, ".cube files L cycles through, the first grades from the start" },
+        { "max-images", Type::Int, &self->maxImages, nullptr, "frames loaded, 0 = all" },
+        { "decode-threads", Type::Int, &self->decodeThreads, nullptr, "0 = one per hardware thread" },
+        { "cache-budget-mb", Type::Int, &self->cacheBudgetMB, nullptr, "memory for decoded frames when streaming" },
+        { "memory-limit-mb", Type::Int, &self->memoryLimitMB, nullptr,
+          "hard limit on frame memory: full loads refuse frames past it, 0 = none" },
+        { "disk-cache-limit-mb", Type::Int, &self->diskCacheLimitMB, nullptr, "size cap of the frame cache directory" },
+        { "prefetch-ahead", Type::Int, &self->prefetchAhead, nullptr, "frames decoded ahead of the playhead" },
+        { "prefetch-behind", Type::Int, &self->prefetchBehind, nullptr, "frames kept behind the playhead" },
+        { "io-depth", Type::Int, &self->ioDepth, nullptr, "overlapped reads ahead of the decoders, 0 = off" },
+        { "unbuffered-io", Type::Bool, &self->unbufferedIO, nullptr, "with io-depth, bypass the file cache" },
+        { "raw-size", Type::Size, &self->rawWidth, &self->rawHeight, "WxH of headerless RGBA/NV12/I420 frames" },
+        { "high-precision", Type::Bool, &self->highPrecision, nullptr, "half-float decodes and intermediates" },
+        { "present", Type::Text, &self->present, nullptr, "compute present path: draw, blit or fused" },
+        { "work-group-size", Type::Size, &self->workGroupWidth, &self->workGroupHeight,
+          "WxH of the default compute pass" },
+        { "work-group-tuning", Type::Bool, &self->workGroupTuning, nullptr, "time sizes on the first frame, keep the fastest" },
+        { "luminance-stats", Type::Bool, &self->luminanceStats, nullptr, "GPU luminance histogram of every frame" },
+        { "effects", Type::Text, &self->effects, nullptr,
+          "compute passes instead of the tint, e.g. blur:4,unsharp:2:0.8,curve (see EffectLibrary)" },
+    };
+    table.erase(std::remove_if(table.begin(), table.end(), [this](const Setting& setting) {
+                    return std::find(excluded.begin(), excluded.end(), setting.key) != excluded.end();
+                }), table.end());
+    return table;
+}
+
+void RunConfig::exclude(const std::vector<std::string>& keys) {
+    excluded.insert(excluded.end(), keys.begin(), keys.end());
+}
+
+bool RunConfig::assign(const Setting& setting, const std::string& value) {
+    double number = 0.0;
+    switch (setting.type) {
+    case Type::Text:
+        *static_cast<std::string*>(setting.value) = value;
+        return true;
+    case Type::Bool:
+        return parseBool(value, *static_cast<bool*>(setting.value));
+    case Type::Int:
+        return parseInteger(value, setting.minimum, *static_cast<int*>(setting.value));
+    case Type::Float:
+        if (!parseNumber(value, number)) {
+            return false;
+        }
+        *static_cast<float*>(setting.value) = static_cast<float>(number);
+        return true;
+    case Type::Double:
+        return parseNumber(value, *static_cast<double*>(setting.value));
+    case Type::Size: {
+        int width = 0;
+        int height = 0;
+        char extra = 0;
+        if (sscanf(value.c_str(), "%dx%d%c", &width, &height, &extra) != 2 || width <= 0 || height <= 0) {
+            return false;
+        }
+        *static_cast<int*>(setting.value) = width;
+        *setting.second = height;
+        return true;
+    }
+    case Type::Timing:
+        for (int i = 0; i < 3; ++i) {
+            if (value == kTimingNames[i]) {
+                *static_cast<TimingMode*>(setting.value) = static_cast<TimingMode>(i);
+                return true;
+            }
+        }
+        return false;
+    case Type::Backend: {
+        // The adapter and feature overrides are settings of their own
+        DisplayBackend& current = *static_cast<DisplayBackend*>(setting.value);
+        DisplayBackend parsed = current;
+        if (!DisplayBackend::parse(value, parsed)) {
+            return false;
+        }
+        current.api = parsed.api;
+        current.device = parsed.device;
+        return true;
+    }
+    case Type::Features:
+        backend.enabledFeatures.clear();
+        backend.disabledFeatures.clear();
+        if (!backend.loadFeatureOverrides(value)) {
+            return false;
+        }
+        *static_cast<std::string*>(setting.value) = value;
+        return true;
+    }
+    return false;
+}
+
+std::string RunConfig::format(const Setting& setting) const {
+    std::ostringstream text;
+    switch (setting.type) {
+    case Type::Text:
+    case Type::Features:
+        text << *static_cast<const std::string*>(setting.value);
+        break;
+    case Type::Bool:
+        text << (*static_cast<const bool*>(setting.value) ? "true" : "false");
+        break;
+    case Type::Int:
+        text << *static_cast<const int*>(setting.value);
+        break;
+    case Type::Float:
+        text << *static_cast<const float*>(setting.value);
+        break;
+    case Type::Double:
+        text << *static_cast<const double*>(setting.value);
+        break;
+    case Type::Size:
+        text << *static_cast<const int*>(setting.value) << "x" << *setting.second;
+        break;
+    case Type::Timing:
+        text << kTimingNames[static_cast<int>(*static_cast<const TimingMode*>(setting.value))];
+        break;
+    case Type::Backend: {
+        // Without the adapter suffix, which is printed as its own setting
+        DisplayBackend name = *static_cast<const DisplayBackend*>(setting.value);
+        name.adapterIndex = -1;
+        text << name.getName();
+        break;
+    }
+    }
+    return text.str();
+}
+
+bool RunConfig::set(const std::string& key, const std::string& value) {
+    for (const Setting& setting : settings()) {
+        if (key == setting.key) {
+            if (!assign(setting, value)) {
+                std::cerr << "Invalid value for " << key << ": " << value << std::endl;
+                return false;
+            }
+            return true;
+        }
+    }
+    std::cerr << "Unknown setting: " << key << std::endl;
+    return false;
+}
+
+bool RunConfig::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot read configuration " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    int lineNumber = 0;
+    bool ok = true;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue; // Blank or comment
+        }
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            std::cerr << path << ":" << lineNumber << ": expected key = value" << std::endl;
+            ok = false;
+        } else if (!set(trim(line.substr(0, equals)), trim(line.substr(equals + 1)))) {
+            std::cerr << "  at " << path << ":" << lineNumber << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int RunConfig::parseOption(int argc, char* argv[], int& index) {
+    const char* arg = argv[index];
+    if (strncmp(arg, "--", 2) != 0) {
+        return 0;
+    }
+    std::string key = arg + 2;
+    std::string value;
+    size_t equals = key.find('=');
+    bool inlineValue = equals != std::string::npos;
+    if (inlineValue) {
+        value = key.substr(equals + 1);
+        key = key.substr(0, equals);
+    }
+
+    if (key == "config") {
+        if (!inlineValue && index + 1 >= argc) {
+            std::cerr << "--config needs a path" << std::endl;
+            return -1;
+        }
+        return load(inlineValue ? value : argv[++index]) ? 1 : -1;
+    }
+    for (const Setting& setting : settings()) {
+        if (key != setting.key) {
+            continue;
+        }
+        if (!inlineValue) {
+            bool flag = false;
+            if (setting.type == Type::Bool) {
+                // "--flag false" as well as a bare flag, which switches it on
+                bool followedByBool = index + 1 < argc && parseBool(argv[index + 1], flag);
+                value = followedByBool ? argv[++index] : "true";
+            } else if (index + 1 < argc) {
+                value = argv[++index];
+            } else {
+                std::cerr << "--" << key << " needs a value" << std::endl;
+                return -1;
+            }
+        }
+        return set(key, value) ? 1 : -1;
+    }
+    return 0;
+}
+
+void RunConfig::applyTo(ImageLoadOptions& options) const {
+    options.maxImages = maxImages;
+    options.threadCount = decodeThreads;
+    options.cacheBudgetBytes = static_cast<size_t>(cacheBudgetMB) * 1024 * 1024;
+    options.memoryLimitBytes = memoryLimitMB > 0 ? static_cast<size_t>(memoryLimitMB) * 1024 * 1024 : 0;
+    options.cacheDirectoryLimit = static_cast<uint64_t>(diskCacheLimitMB) * 1024 * 1024;
+    options.prefetchAhead = prefetchAhead;
+    options.prefetchBehind = prefetchBehind;
+    options.ioQueueDepth = ioDepth;
+    options.unbufferedIO = unbufferedIO;
+    options.rawWidth = rawWidth;
+    options.rawHeight = rawHeight;
+    options.highBitDepth = highPrecision; // 16-bit PNGs keep their precision as half floats
+}
+
+void RunConfig::applyTo(Renderer& renderer) const {
+    renderer.setFrameRate(frameRate);
+    renderer.setVsync(vsync);
+    renderer.setTimingMode(timingMode);
+    renderer.setDisplayBackend(backend);
+    renderer.setStatsInterval(statsInterval);
+    renderer.setRenderScale(renderScale);
+    if (adaptiveQuality > 0.0f) {
+        // Scale between the minimum and render-scale, following the GPU load
+        renderer.setAdaptiveQuality(adaptiveQuality, renderScale);
+    }
+    renderer.setLazyFrames(lazy);
+    if (!luts.empty()) {
+        std::vector<std::string> paths;
+        std::istringstream list(luts);
+        std::string path;
+        while (std::getline(list, path, ',')) {
+            if (!trim(path).empty()) {
+                paths.push_back(trim(path));
+            }
+        }
+        renderer.setLuts(paths);
+    }
+}
+
+bool RunConfig::applyTo(ComputePipeline& compute) const {
+    ComputePipeline::PresentPath presentPath;
+    if (!present.empty()) {
+        if (!ComputePipeline::parsePresentPath(present, presentPath)) {
+            return false;
+        }
+        compute.setPresentPath(presentPath);
+    }
+    compute.setHighPrecision(highPrecision);
+    compute.setWorkGroupSize({ workGroupWidth, workGroupHeight });
+    compute.setWorkGroupTuning(workGroupTuning);
+    compute.setLuminanceStats(luminanceStats);
+    return effects.empty() || EffectLibrary::addEffects(compute, effects);
+}
+
+void RunConfig::print(std::ostream& out) const {
+    out << "Configuration:" << std::endl;
+    for (const Setting& setting : settings()) {
+        out << "  " << setting.key << " = " << format(setting) << std::endl;
+    }
+}
+
+void RunConfig::printUsage(std::ostream& out, const std::vector<std::string>& excludedKeys) {
+    RunConfig defaults;
+    defaults.exclude(excludedKeys);
+    out << "Settings (--key value, --key=value, or key = value lines in a --config file):" << std::endl;
+    for (const Setting& setting : defaults.settings()) {
+        std::string option = std::string("  --") + setting.key;
+        std::string value = defaults.format(setting);
+        out << option << std::string(option.size() < 24 ? 24 - option.size() : 1, ' ') << setting.help
+            << (value.empty() ? std::string() : " (default " + value + ")") << std::endl;
+    }
+}
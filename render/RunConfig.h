@@ -0,0 +1,123 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "../reader/ImageLoader.h"
+#include "DisplayBackend.h"
+#include "GpuTimer.h"
+
+class Renderer;
+class ComputePipeline;
+
+// Tunable settings of a run, so performance experiments need no rebuild.
+//
+// Every setting has a built-in default (the values the demo used to compile
+// in) and a key, which is both its name in a configuration file and its
+// command line option:
+//
+//     # shaderDemo.cfg
+//     photos = D:\sequences\street
+//     window-size = 1920x1080
+//     decode-threads = 8
+//     vsync = false
+//
+//     shaderDemo --config shaderDemo.cfg --frame-rate 60 --timing precise
+//
+// Settings apply in the order given, the last one winning, so options after
+// --config override the file and options before it are overridden by it.
+// print() lists the effective values, e.g. for benchmark logs.
+class RunConfig {
+public:
+    // Playback and presentation
+    std::string photos = R"(E:\code\shaderDemo\photo)";
+    std::string pipeline = "fragment";  // Comma-separated list, cycled over the windows
+    int windowWidth = 800;
+    int windowHeight = 600;
+    int windows = 1;
+    double frameRate = 30.0;
+    bool vsync = true;
+    bool lowLatency = false;
+    TimingMode timingMode = TimingMode::GpuTimer;
+    DisplayBackend backend;
+    std::string angleFeatures;  // Overrides file loaded into backend
+    float renderScale = 1.0f;
+    float adaptiveQuality = 0.0f;  // Minimum render scale; 0 = off
+    int statsInterval = 60;        // Frames between statistics reports
+    bool lazy = false;
+    std::string recordControls;    // Write the controls given to this file on exit (see ControlRecording)
+    std::string replayControls;    // Drive playback from this recording instead of the keyboard
+    std::string luts;              // Comma-separated .cube files L cycles through (see Renderer::setLuts)
+
+    // Loading
+    int maxImages = 0;
+    int decodeThreads = 0;
+    int cacheBudgetMB = 1024;
+    int memoryLimitMB = 0;  // Hard limit on frame memory; 0 = none
+    int diskCacheLimitMB = 8192;
+    int prefetchAhead = 8;
+    int prefetchBehind = 2;
+    int ioDepth = 0;
+    bool unbufferedIO = false;
+    int rawWidth = 0;
+    int rawHeight = 0;
+    bool highPrecision = false;
+
+    // Compute pipeline
+    std::string present;  // Empty = the pipeline's default
+    int workGroupWidth = 16;
+    int workGroupHeight = 16;
+    bool workGroupTuning = false;
+    bool luminanceStats = false;
+    std::string effects;  // EffectLibrary list replacing the default tint pass; empty = the tint
+
+    // Read "key = value" lines ('#' starts a comment). Returns false, naming
+    // the line, for unknown keys and malformed values.
+    bool load(const std::string& path);
+
+    // Set one setting from text. Returns false for unknown keys and malformed values.
+    bool set(const std::string& key, const std::string& value);
+
+    // Take the setting at argv[index] if it is one: "--key value",
+    // "--key=value", "--flag" or "--flag false" for booleans, or "--config
+    // PATH". index is moved to the last argument used. Returns 1 if taken, 0 if
+    // argv[index] is not a setting (for the program's own options) and -1 on a
+    // bad value.
+    int parseOption(int argc, char* argv[], int& index);
+
+    // Settings a program does not use (call before any are set): they are
+    // rejected as unknown and left out of print()
+    void exclude(const std::vector<std::string>& keys);
+
+    // Copy the settings each part takes (call before the part starts). The
+    // renderer gets pacing, timing, backend, statistics and quality settings;
+    // the compute pipeline returns false for an unknown present path or effect.
+    void applyTo(ImageLoadOptions& options) const;
+    void applyTo(Renderer& renderer) const;
+    bool applyTo(ComputePipeline& pipeline) const;
+
+    // The effective value of every setting, one "key = value" line each
+    void print(std::ostream& out) const;
+
+    // Usage lines for the settings, for a program's help text, without the excluded keys
+    static void printUsage(std::ostream& out, const std::vector<std::string>& excludedKeys = {});
+
+private:
+    enum class Type { Text, Bool, Int, Float, Double, Size, Timing, Backend, Features };
+
+    struct Setting {
+        const char* key;
+        Type type;
+        void* value;
+        int* second;  // Height of a Size (value is the width)
+        const char* help;
+        int minimum = 0;  // Least value of an Int
+    };
+
+    std::vector<std::string> excluded;  // Keys left out of the table (see exclude)
+
+    // The table of settings, pointing into this object
+    std::vector<Setting> settings() const;
+    bool assign(const Setting& setting, const std::string& value);
+    std::string format(const Setting& setting) const;
+};
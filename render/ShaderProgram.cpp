@@ -0,0 +1,133 @@
+#include "ShaderProgram.h"
+#include "ProgramCache.h"
+
+#include <iostream>
+#include <vector>
+
+namespace {
+
+// Log a failed link and delete the program
+void reportLinkError(GLuint program) {
+    GLint infoLen = 0;
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLen);
+    if (infoLen > 1) {
+        std::vector<char> infoLog(infoLen);
+        glGetProgramInfoLog(program, infoLen, NULL, infoLog.data());
+        std::cerr << "Error linking program: " << infoLog.data() << std::endl;
+    }
+    glDeleteProgram(program);
+}
+
+} // namespace
+
+GLuint ShaderProgram::compile(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    if (shader == 0) {
+        std::cerr << "Failed to create shader" << std::endl;
+        return 0;
+    }
+
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    GLint compiled;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+        GLint infoLen = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLen);
+        if (infoLen > 1) {
+            std::vector<char> infoLog(infoLen);
+            glGetShaderInfoLog(shader, infoLen, NULL, infoLog.data());
+            std::cerr << "Error compiling shader: " << infoLog.data() << std::endl;
+        }
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+GLuint ShaderProgram::create(const char* vertexSource, const char* fragmentSource) {
+    // A binary linked by an earlier run skips compilation entirely
+    GLuint cached = ProgramCache::load({vertexSource, fragmentSource});
+    if (cached) {
+        return cached;
+    }
+
+    GLuint vertexShader = compile(GL_VERTEX_SHADER, vertexSource);
+    if (!vertexShader) {
+        return 0;
+    }
+
+    GLuint fragmentShader = compile(GL_FRAGMENT_SHADER, fragmentSource);
+    if (!fragmentShader) {
+        glDeleteShader(vertexShader);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    if (program == 0) {
+        std::cerr << "Failed to create program" << std::endl;
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return 0;
+    }
+
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glBindAttribLocation(program, PositionLocation, "aPosition");
+    glBindAttribLocation(program, TexCoordLocation, "aTexCoord");
+    ProgramCache::prepare(program);
+    glLinkProgram(program);
+
+    // Shaders are no longer needed once the program is linked (or failed to link)
+    glDetachShader(program, vertexShader);
+    glDetachShader(program, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        reportLinkError(program);
+        return 0;
+    }
+
+    ProgramCache::store(program, {vertexSource, fragmentSource});
+    return program;
+}
+
+GLuint ShaderProgram::createCompute(const char* computeSource) {
+    GLuint cached = ProgramCache::load({computeSource});
+    if (cached) {
+        return cached;
+    }
+
+    GLuint computeShader = compile(GL_COMPUTE_SHADER, computeSource);
+    if (!computeShader) {
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    if (program == 0) {
+        std::cerr << "Failed to create program" << std::endl;
+        glDeleteShader(computeShader);
+        return 0;
+    }
+
+    glAttachShader(program, computeShader);
+    ProgramCache::prepare(program);
+    glLinkProgram(program);
+    glDetachShader(program, computeShader);
+    glDeleteShader(computeShader);
+
+    GLint linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        reportLinkError(program);
+        return 0;
+    }
+
+    ProgramCache::store(program, {computeSource});
+    return program;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <angle_gl.h>
+
+// Compiling and linking the pipelines' programs. Every link goes through the
+// on-disk ProgramCache, so a program built by an earlier run is restored
+// without compiling anything.
+class ShaderProgram {
+public:
+    // Compile one shader stage. Returns 0 and logs the info log on failure.
+    static GLuint compile(GLenum type, const char* source);
+
+    // Vertex + fragment program. aPosition and aTexCoord are bound to locations
+    // 0 and 1 before linking, so every program can draw from one quad's vertex array.
+    static GLuint create(const char* vertexSource, const char* fragmentSource);
+
+    // Compute program (ES 3.1)
+    static GLuint createCompute(const char* computeSource);
+
+    // Attribute locations create() binds
+    static const GLint PositionLocation = 0;
+    static const GLint TexCoordLocation = 1;
+};
@@ -0,0 +1,230 @@
+#include "ShaderReloader.h"
+
+#include <cwchar>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+// Editors often save in several steps (truncate, write, rename); changes are
+// collected for this long before rebuilding
+static const DWORD kSettleMilliseconds = 100;
+
+ShaderReloader::ShaderReloader(const std::string& directory)
+    : directory(directory), hasPending(false), readyCallback(nullptr), readyContext(nullptr),
+      directoryHandle(INVALID_HANDLE_VALUE), stopEvent(nullptr) {
+}
+
+ShaderReloader::~ShaderReloader() {
+    stop();
+}
+
+void ShaderReloader::setReadyCallback(ReadyCallback callback, void* context) {
+    readyCallback = callback;
+    readyContext = context;
+}
+
+int ShaderReloader::addProgram(const std::vector<std::string>& files, BuildFn build) {
+    programs.push_back({files, std::move(build), 0});
+    return static_cast<int>(programs.size() - 1);
+}
+
+bool ShaderReloader::readFile(const std::string& path, std::string& contents) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    contents = text.str();
+    return true;
+}
+
+bool ShaderReloader::readSources(int id, std::vector<std::string>& sources) const {
+    if (id < 0 || id >= static_cast<int>(programs.size())) {
+        return false;
+    }
+    sources.clear();
+    for (const std::string& file : programs[id].files) {
+        std::string contents;
+        if (!readFile((fs::path(directory) / file).string(), contents)) {
+            return false;
+        }
+        sources.push_back(std::move(contents));
+    }
+    return true;
+}
+
+bool ShaderReloader::start(EGLDisplay display, EGLConfig config, EGLContext shareContext, const EGLint* contextAttribs) {
+    stop();
+    if (programs.empty()) {
+        return false;
+    }
+
+    directoryHandle = CreateFileW(fs::path(directory).wstring().c_str(), FILE_LIST_DIRECTORY,
+                                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                  FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (directoryHandle == INVALID_HANDLE_VALUE) {
+        std::cerr << "Cannot watch shader directory " << directory << std::endl;
+        return false;
+    }
+
+    // Programs built in this context are visible to the renderer's
+    if (!workerContext.create(display, config, shareContext, contextAttribs)) {
+        stop();
+        return false;
+    }
+
+    stopEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    worker = std::thread(&ShaderReloader::watchLoop, this);
+    std::cout << "Watching " << directory << " for shader changes" << std::endl;
+    return true;
+}
+
+void ShaderReloader::stop() {
+    if (worker.joinable()) {
+        SetEvent(stopEvent);
+        worker.join();
+    }
+    if (stopEvent) {
+        CloseHandle(stopEvent);
+        stopEvent = nullptr;
+    }
+    if (directoryHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(directoryHandle);
+        directoryHandle = INVALID_HANDLE_VALUE;
+    }
+    workerContext.destroy();
+}
+
+bool ShaderReloader::takeProgram(int id, GLuint& program) {
+    if (!hasPending || id < 0 || id >= static_cast<int>(programs.size())) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    if (!programs[id].pending) {
+        return false;
+    }
+    program = programs[id].pending;
+    programs[id].pending = 0;
+
+    bool any = false;
+    for (const Program& entry : programs) {
+        any = any || entry.pending != 0;
+    }
+    hasPending = any;
+    return true;
+}
+
+void ShaderReloader::watchLoop() {
+    if (!workerContext.makeCurrent()) {
+        std::cerr << "Failed to bind shader reload context" << std::endl;
+        return;
+    }
+
+    // DWORD-aligned, as ReadDirectoryChangesW requires
+    std::vector<DWORD> buffer(16 * 1024 / sizeof(DWORD));
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+
+    while (true) {
+        ResetEvent(overlapped.hEvent);
+        if (!ReadDirectoryChangesW(directoryHandle, buffer.data(), static_cast<DWORD>(buffer.size() * sizeof(DWORD)),
+                                   FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE,
+                                   nullptr, &overlapped, nullptr)) {
+            std::cerr << "Watching shader directory failed (error " << GetLastError() << ")" << std::endl;
+            break;
+        }
+
+        HANDLE handles[2] = { overlapped.hEvent, stopEvent };
+        DWORD bytes = 0;
+        if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0) {
+            CancelIoEx(directoryHandle, &overlapped);
+            GetOverlappedResult(directoryHandle, &overlapped, &bytes, TRUE);
+            break;
+        }
+        if (!GetOverlappedResult(directoryHandle, &overlapped, &bytes, FALSE)) {
+            continue;
+        }
+
+        // No data means the change list overflowed; rebuild everything
+        std::vector<std::wstring> changed;
+        const BYTE* entry = reinterpret_cast<const BYTE*>(buffer.data());
+        while (bytes > 0) {
+            const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry);
+            changed.emplace_back(info->FileName, info->FileNameLength / sizeof(wchar_t));
+            if (info->NextEntryOffset == 0) {
+                break;
+            }
+            entry += info->NextEntryOffset;
+        }
+
+        // Further changes are buffered by the open handle until the next read
+        if (WaitForSingleObject(stopEvent, kSettleMilliseconds) == WAIT_OBJECT_0) {
+            break;
+        }
+        rebuild(changed, bytes == 0);
+    }
+    CloseHandle(overlapped.hEvent);
+
+    // Programs that were never taken belong to nobody
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        for (Program& program : programs) {
+            if (program.pending) {
+                glDeleteProgram(program.pending);
+                program.pending = 0;
+            }
+        }
+        hasPending = false;
+    }
+    workerContext.release();
+}
+
+void ShaderReloader::rebuild(const std::vector<std::wstring>& changedFiles, bool all) {
+    for (size_t i = 0; i < programs.size(); ++i) {
+        Program& program = programs[i];
+        bool affected = all;
+        for (const std::string& file : program.files) {
+            std::wstring name = fs::path(file).wstring();
+            for (const std::wstring& changed : changedFiles) {
+                affected = affected || _wcsicmp(name.c_str(), changed.c_str()) == 0;
+            }
+        }
+        if (!affected) {
+            continue;
+        }
+
+        std::string files;
+        for (const std::string& file : program.files) {
+            files += (files.empty() ? "" : ", ") + file;
+        }
+
+        std::vector<std::string> sources;
+        if (!readSources(static_cast<int>(i), sources)) {
+            continue; // Mid-save or deleted; the next change event retries
+        }
+        GLuint rebuilt = program.build(sources);
+        if (!rebuilt) {
+            std::cerr << "Shader reload failed for " << files << ", keeping the running program" << std::endl;
+            continue;
+        }
+
+        // The render thread may use the program as soon as it is published
+        glFinish();
+
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        if (program.pending) {
+            glDeleteProgram(program.pending); // Superseded before it was taken
+        }
+        program.pending = rebuilt;
+        hasPending = true;
+        std::cout << "Reloaded shaders: " << files << std::endl;
+        if (readyCallback) {
+            readyCallback(readyContext);
+        }
+    }
+}
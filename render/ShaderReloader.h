@@ -0,0 +1,84 @@
+#pragma once
+
+#include <angle_gl.h>
+#include <EGL/egl.h>
+#include <Windows.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SharedContext.h"
+
+// Shader files are read from here unless a renderer is given another directory.
+// The build points it at the source tree so edits there are picked up live.
+#ifndef SHADER_DIRECTORY
+#define SHADER_DIRECTORY "shaders"
+#endif
+
+// Hot reload of shader programs from files.
+// A worker thread watches the shader directory with ReadDirectoryChangesW and,
+// when a file a program uses changes, reads the sources and rebuilds the
+// program in its own EGL context that shares objects with the renderer's. The
+// render thread picks up finished programs with takeProgram() between frames
+// and swaps them in, so compiling never stalls playback and nothing else
+// (textures, decoded frames) is touched. A program that fails to compile is
+// reported and the running one is kept.
+class ShaderReloader {
+public:
+    // Builds a linked program from the file contents, in the order registered (0 on failure)
+    using BuildFn = std::function<GLuint(const std::vector<std::string>& sources)>;
+
+    explicit ShaderReloader(const std::string& directory = SHADER_DIRECTORY);
+    ~ShaderReloader();
+
+    void setDirectory(const std::string& directory) { this->directory = directory; }
+    const std::string& getDirectory() const { return directory; }
+
+    // Register a program made from files in the shader directory. Returns its id.
+    int addProgram(const std::vector<std::string>& files, BuildFn build);
+
+    // Read a program's files on the calling thread. Returns false if one is missing.
+    bool readSources(int id, std::vector<std::string>& sources) const;
+
+    // Watch the directory and rebuild programs in a context sharing objects with
+    // shareContext, created with the same attributes. Returns false if the
+    // directory cannot be watched or the context cannot be created.
+    bool start(EGLDisplay display, EGLConfig config, EGLContext shareContext, const EGLint* contextAttribs);
+    void stop();
+
+    // Take a rebuilt program, if one is ready (render thread). The caller owns
+    // it and deletes the program it replaces.
+    bool takeProgram(int id, GLuint& program);
+
+    // Called on the watcher thread each time a rebuilt program is ready to be
+    // taken, e.g. to wake a render thread that sleeps while paused (call before start)
+    typedef void (*ReadyCallback)(void* context);
+    void setReadyCallback(ReadyCallback callback, void* context);
+
+    static bool readFile(const std::string& path, std::string& contents);
+
+private:
+    struct Program {
+        std::vector<std::string> files;
+        BuildFn build;
+        GLuint pending;  // Rebuilt but not yet taken
+    };
+
+    std::string directory;
+    std::vector<Program> programs;
+    std::mutex pendingMutex;
+    std::atomic<bool> hasPending;
+    ReadyCallback readyCallback;
+    void* readyContext;
+
+    SharedContext workerContext;
+
+    HANDLE directoryHandle;
+    HANDLE stopEvent;
+    std::thread worker;
+
+    void watchLoop();
+    void rebuild(const std::vector<std::wstring>& changedFiles, bool all);
+};
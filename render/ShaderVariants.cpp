@@ -0,0 +1,90 @@
+#include "ShaderVariants.h"
+
+#include <iostream>
+
+ShaderVariants::ShaderVariants(const std::vector<std::string>& features, BuildFn build)
+    : features(features), buildProgram(build), programs(size_t(1) << features.size(), 0) {
+}
+
+std::vector<std::string> ShaderVariants::specialize(const std::vector<std::string>& sources, Key key) const {
+    std::string defines;
+    for (size_t i = 0; i < features.size(); ++i) {
+        if (key & (Key(1) << i)) {
+            defines += "#define " + features[i] + " 1\n";
+        }
+    }
+    std::vector<std::string> specialized;
+    for (const std::string& source : sources) {
+        specialized.push_back(insertDefines(source, defines));
+    }
+    return specialized;
+}
+
+std::string ShaderVariants::insertDefines(const std::string& source, const std::string& defines) {
+    // #version must stay the first directive
+    std::string text = source;
+    size_t version = text.find("#version");
+    if (version == std::string::npos) {
+        return defines + text;
+    }
+    size_t lineEnd = text.find('\n', version);
+    if (lineEnd == std::string::npos) {
+        return text + "\n" + defines;
+    }
+    text.insert(lineEnd + 1, defines);
+    return text;
+}
+
+void ShaderVariants::addShaders(ShaderReloader& reloader, const std::vector<std::string>& files) {
+    reloadIds.clear();
+    for (Key key = 0; key < programs.size(); ++key) {
+        reloadIds.push_back(reloader.addProgram(files,
+            [this, key](const std::vector<std::string>& sources) { return buildProgram(specialize(sources, key)); }));
+    }
+}
+
+bool ShaderVariants::readSources(const ShaderReloader& reloader, std::vector<std::string>& sources) const {
+    return !reloadIds.empty() && reloader.readSources(reloadIds[0], sources);
+}
+
+bool ShaderVariants::build(const std::vector<std::string>& sources) {
+    std::vector<GLuint> built;
+    for (Key key = 0; key < programs.size(); ++key) {
+        GLuint program = buildProgram(specialize(sources, key));
+        if (!program) {
+            std::cerr << "Shader variant " << key << " failed to build" << std::endl;
+            for (GLuint done : built) {
+                glDeleteProgram(done);
+            }
+            return false;
+        }
+        built.push_back(program);
+    }
+    destroy();
+    programs.swap(built);
+    return true;
+}
+
+bool ShaderVariants::applyReloaded(ShaderReloader& reloader) {
+    bool changed = false;
+    for (size_t key = 0; key < reloadIds.size(); ++key) {
+        GLuint program = 0;
+        if (reloader.takeProgram(reloadIds[key], program)) {
+            if (programs[key]) {
+                glDeleteProgram(programs[key]);
+            }
+            programs[key] = program;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void ShaderVariants::destroy() {
+    for (GLuint& program : programs) {
+        if (program) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+}
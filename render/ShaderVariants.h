@@ -0,0 +1,58 @@
+#pragma once
+
+#include <angle_gl.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include "ShaderReloader.h"
+
+// Compile-time specializations of one program. Every combination of a few
+// optional features is built up front as its own program, with the enabled
+// features #defined after #version, so the variant that runs carries no
+// branches for features that are off and switching features is a lookup
+// rather than a compile. Variants are built through the caller's function
+// (normally ShaderProgram, so each lands in the program binary cache under
+// its own specialized source) and are rebuilt on the reload thread when
+// their files change.
+class ShaderVariants {
+public:
+    // Bit i of a key enables features[i]
+    using Key = unsigned;
+
+    // Builds a linked program from the specialized sources (0 on failure), as for ShaderReloader
+    using BuildFn = ShaderReloader::BuildFn;
+
+    ShaderVariants(const std::vector<std::string>& features, BuildFn build);
+
+    size_t getVariantCount() const { return programs.size(); }
+
+    // Sources with the key's features defined
+    std::vector<std::string> specialize(const std::vector<std::string>& sources, Key key) const;
+
+    // Insert defines after the #version line (or in front of a source without one)
+    static std::string insertDefines(const std::string& source, const std::string& defines);
+
+    // Register every variant with the reloader so an edit of files rebuilds all of them
+    void addShaders(ShaderReloader& reloader, const std::vector<std::string>& files);
+    // Read the registered files (unspecialized). Returns false if one is missing.
+    bool readSources(const ShaderReloader& reloader, std::vector<std::string>& sources) const;
+
+    // Build every variant from sources (context current). Returns false, keeping
+    // the previous programs, if any variant fails.
+    bool build(const std::vector<std::string>& sources);
+
+    // Swap in the variants the reloader rebuilt (render thread); true if any changed
+    bool applyReloaded(ShaderReloader& reloader);
+
+    // Program of a variant, 0 before build() or for a key outside the features
+    GLuint get(Key key) const { return key < programs.size() ? programs[key] : 0; }
+
+    // Delete the programs (context current)
+    void destroy();
+
+private:
+    std::vector<std::string> features;
+    BuildFn buildProgram;
+    std::vector<GLuint> programs;  // Indexed by key
+    std::vector<int> reloadIds;    // Reloader program of each key
+};
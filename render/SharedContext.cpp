@@ -0,0 +1,56 @@
+#include "SharedContext.h"
+
+#include <cstring>
+#include <iostream>
+
+SharedContext::SharedContext()
+    : display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT), surface(EGL_NO_SURFACE) {
+}
+
+SharedContext::~SharedContext() {
+    destroy();
+}
+
+bool SharedContext::create(EGLDisplay eglDisplay, EGLConfig config, EGLContext shareContext, const EGLint* contextAttribs) {
+    destroy();
+    display = eglDisplay;
+
+    // Objects created in this context are visible in shareContext's
+    context = eglCreateContext(display, config, shareContext, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        std::cerr << "Failed to create shared EGL context (error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        return false;
+    }
+
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "EGL_KHR_surfaceless_context")) {
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+        if (surface == EGL_NO_SURFACE) {
+            std::cerr << "Failed to create pbuffer for shared EGL context" << std::endl;
+            destroy();
+            return false;
+        }
+    }
+    return true;
+}
+
+void SharedContext::destroy() {
+    if (surface != EGL_NO_SURFACE) {
+        eglDestroySurface(display, surface);
+        surface = EGL_NO_SURFACE;
+    }
+    if (context != EGL_NO_CONTEXT) {
+        eglDestroyContext(display, context);
+        context = EGL_NO_CONTEXT;
+    }
+}
+
+bool SharedContext::makeCurrent() {
+    return context != EGL_NO_CONTEXT && eglMakeCurrent(display, surface, surface, context);
+}
+
+void SharedContext::release() {
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglReleaseThread();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <EGL/egl.h>
+
+// Extra EGL context in the share group of a renderer's context, for worker
+// threads that create GL objects (programs, textures) used by the render
+// thread. It is surfaceless where EGL_KHR_surfaceless_context allows, and
+// otherwise bound to a 1x1 pbuffer.
+class SharedContext {
+public:
+    SharedContext();
+    ~SharedContext();
+
+    // Create the context with the same attributes as shareContext was created with
+    bool create(EGLDisplay display, EGLConfig config, EGLContext shareContext, const EGLint* contextAttribs);
+    // Destroy the context; it must not be current on any thread
+    void destroy();
+    bool isValid() const { return context != EGL_NO_CONTEXT; }
+    EGLContext getContext() const { return context; }
+
+    // Bind to / release from the calling (worker) thread
+    bool makeCurrent();
+    void release();
+
+private:
+    EGLDisplay display;
+    EGLContext context;
+    EGLSurface surface;
+};
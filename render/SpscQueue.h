@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. push() and pop() never block; they fail when the queue is full or
+// empty. Head and tail live on separate cache lines so the two threads do
+// not contend on every operation.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity)
+        : slots(capacity + 1), head(0), tail(0) {
+    }
+
+    // Producer side
+    bool push(const T& value) {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        size_t nextTail = increment(currentTail);
+        if (nextTail == head.load(std::memory_order_acquire)) {
+            return false; // Full
+        }
+        slots[currentTail] = value;
+        tail.store(nextTail, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T& value) {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire)) {
+            return false; // Empty
+        }
+        value = slots[currentHead];
+        head.store(increment(currentHead), std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: look at the oldest element without removing it
+    bool peek(T& value) const {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = slots[currentHead];
+        return true;
+    }
+
+    size_t capacity() const { return slots.size() - 1; }
+
+private:
+    std::vector<T> slots;  // One slot stays empty to tell full from empty
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+
+    size_t increment(size_t index) const {
+        return index + 1 == slots.size() ? 0 : index + 1;
+    }
+};
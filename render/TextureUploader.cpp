@@ -0,0 +1,553 @@
+#include "TextureUploader.h"
+#include "../reader/BlockCompressor.h"
+#include "../reader/PixelConvert.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+TextureUploader::TextureUploader()
+    : texture(0), immutable(false), width(0), height(0), internalFormat(GL_NONE),
+      uploadPlanar(false), planes(PlaneFormat::Interleaved), chromaTextures{0, 0}, uploadBC1(false), uploadBC3(false), requireRGBA(false),
+      nextPixelBuffer(0), hasStaged(false), stagedKey(NoKey), stagedSlot(0),
+      stagedWidth(0), stagedHeight(0), stagedChannels(0), stagedCompression(BlockFormat::None),
+      stagedSampleFormat(SampleFormat::UNorm8), stagedPlanes(PlaneFormat::Interleaved) {
+}
+
+void TextureUploader::create(bool useImmutableStorage) {
+    immutable = useImmutableStorage;
+
+    // Frame rows are tightly packed; the default 4-byte alignment would misread
+    // RGB and single-channel frames whose row size is not a multiple of 4
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    applySamplingParameters();
+}
+
+void TextureUploader::destroy() {
+    if (texture) {
+        glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+    releaseChromaTextures();
+    width = 0;
+    height = 0;
+    internalFormat = GL_NONE;
+
+    for (auto& slot : pixelBuffers) {
+        if (slot.fence) {
+            glDeleteSync(slot.fence);
+        }
+        glDeleteBuffers(1, &slot.buffer);
+    }
+    pixelBuffers.clear();
+    nextPixelBuffer = 0;
+    hasStaged = false;
+}
+
+bool TextureUploader::isBlockFormatSupported(BlockFormat format) {
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    if (!extensions) {
+        return false;
+    }
+    bool s3tc = strstr(extensions, "GL_EXT_texture_compression_s3tc") != nullptr;
+    switch (format) {
+        case BlockFormat::BC1:
+            return s3tc || strstr(extensions, "GL_EXT_texture_compression_dxt1") != nullptr;
+        case BlockFormat::BC3:
+            return s3tc || strstr(extensions, "GL_ANGLE_texture_compression_dxt5") != nullptr;
+        default:
+            return false;
+    }
+}
+
+bool TextureUploader::enableCompressedUploads() {
+    uploadBC1 = isBlockFormatSupported(BlockFormat::BC1);
+    uploadBC3 = isBlockFormatSupported(BlockFormat::BC3);
+    return uploadBC1 || uploadBC3;
+}
+
+bool TextureUploader::canUploadCompressed(BlockFormat format) const {
+    return (format == BlockFormat::BC1 && uploadBC1) || (format == BlockFormat::BC3 && uploadBC3);
+}
+
+bool TextureUploader::enablePlanarUploads() {
+    // R8 and RG8 are core in ES3; ES2's luminance formats have no two-channel red-green equivalent
+    uploadPlanar = immutable;
+    return uploadPlanar;
+}
+
+void TextureUploader::enablePixelBuffers(int ringSize) {
+    if (!immutable || ringSize <= 0 || !pixelBuffers.empty()) {
+        return; // Pixel unpack buffers need ES3
+    }
+
+    pixelBuffers.resize(ringSize);
+    for (auto& slot : pixelBuffers) {
+        glGenBuffers(1, &slot.buffer);
+    }
+    nextPixelBuffer = 0;
+}
+
+bool TextureUploader::stage(const ImageData& image, size_t key) {
+    if (pixelBuffers.empty() || !image.isValid()) {
+        return false;
+    }
+    if (hasStaged && stagedKey == key) {
+        return true; // Already waiting in a buffer
+    }
+    if (image.compression != BlockFormat::None && !canUploadCompressed(image.compression)) {
+        return false; // Will be decompressed on the CPU at upload time
+    }
+    if (image.isPlanar() && !uploadPlanar) {
+        return false; // Will be converted on the CPU at upload time
+    }
+
+    size_t slotIndex = nextPixelBuffer;
+    PixelBufferSlot& slot = pixelBuffers[slotIndex];
+
+    // Wait until the GPU has finished the transfer that last used this buffer.
+    // With a ring of several buffers this is normally already signalled.
+    if (slot.fence) {
+        glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+    }
+
+    bool expand = requireRGBA && image.compression == BlockFormat::None && !image.isPlanar() && image.channels != 4;
+    size_t pixelCount = static_cast<size_t>(image.width) * image.height;
+    GLsizeiptr size = static_cast<GLsizeiptr>(expand ? pixelCount * 4 : image.data.size());
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+    if (slot.capacity < size) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        slot.capacity = size;
+    }
+
+    // The fence above already guarantees the buffer is idle, so skip the driver's own sync
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!mapped) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return false;
+    }
+    if (expand) {
+        // Expand straight into driver memory instead of through a temporary copy
+        PixelConvert::expandToRGBA(image.data.data(), image.channels, pixelCount, static_cast<unsigned char*>(mapped));
+    } else {
+        memcpy(mapped, image.data.data(), image.data.size());
+    }
+    bool ok = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (!ok) {
+        return false; // Buffer contents were lost; upload from client memory instead
+    }
+
+    hasStaged = true;
+    stagedKey = key;
+    stagedSlot = slotIndex;
+    stagedWidth = image.width;
+    stagedHeight = image.height;
+    stagedChannels = image.channels;
+    stagedCompression = image.compression;
+    stagedSampleFormat = image.sampleFormat;
+    stagedPlanes = image.planes;
+    nextPixelBuffer = (nextPixelBuffer + 1) % pixelBuffers.size();
+    return true;
+}
+
+bool TextureUploader::isStaged(const ImageData& image, size_t key) const {
+    return hasStaged && key != NoKey && key == stagedKey && image.width == stagedWidth && image.height == stagedHeight &&
+           image.channels == stagedChannels && image.compression == stagedCompression &&
+           image.sampleFormat == stagedSampleFormat && image.planes == stagedPlanes;
+}
+
+size_t TextureUploader::getMemoryBytes() const {
+    size_t bytes = texture ? estimateBytes(internalFormat, width, height) : 0;
+    if (planes != PlaneFormat::Interleaved) {
+        // Interleaved U,V pairs or separate U and V planes, either way two bytes per 2x2 block
+        bytes += estimateBytes(GL_RG8, width / 2, height / 2);
+    }
+    for (const PixelBufferSlot& slot : pixelBuffers) {
+        bytes += static_cast<size_t>(slot.capacity);
+    }
+    return bytes;
+}
+
+size_t TextureUploader::estimateBytes(GLenum internalFormat, int width, int height, int layers) {
+    size_t texels = static_cast<size_t>(std::max(width, 0)) * std::max(height, 0) * std::max(layers, 0);
+    switch (internalFormat) {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: {
+            // Whole 4x4 blocks of 8 (BC1) or 16 (BC3) bytes
+            size_t blocks = static_cast<size_t>((std::max(width, 0) + 3) / 4) * ((std::max(height, 0) + 3) / 4) *
+                            std::max(layers, 0);
+            return blocks * (internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16);
+        }
+        case GL_R8:
+        case GL_LUMINANCE:
+            return texels;
+        case GL_RG8:
+        case GL_R16F:
+            return texels * 2;
+        case GL_RGBA16F:
+            return texels * 8;
+        case GL_RGBA32F:
+            return texels * 16;
+        case GL_NONE:
+            return 0;
+        default:
+            return texels * 4; // RGB8, RGBA8, R32F and the unsized ES2 formats
+    }
+}
+
+bool TextureUploader::formatForChannels(int channels, bool sizedFormats, GLenum& internalFormat, GLenum& format) {
+    switch (channels) {
+        case 1:
+            internalFormat = sizedFormats ? GL_R8 : GL_LUMINANCE;
+            format = sizedFormats ? GL_RED : GL_LUMINANCE;
+            return true;
+        case 3:
+            internalFormat = sizedFormats ? GL_RGB8 : GL_RGB;
+            format = GL_RGB;
+            return true;
+        case 4:
+            internalFormat = sizedFormats ? GL_RGBA8 : GL_RGBA;
+            format = GL_RGBA;
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool TextureUploader::storageFormat(int channels, BlockFormat compression, SampleFormat sampleFormat,
+                                    GLenum& sizedFormat, GLenum& format) const {
+    if (sampleFormat == SampleFormat::Float16) {
+        // Decoded as RGBA; unsized half-float formats would need an ES2 extension
+        if (!immutable || channels != 4) {
+            std::cerr << "Half-float frames need an ES3 context" << std::endl;
+            return false;
+        }
+        sizedFormat = GL_RGBA16F;
+        format = GL_RGBA;
+    } else if (compression != BlockFormat::None) {
+        sizedFormat = compression == BlockFormat::BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                                                      : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        format = GL_NONE;
+    } else if (!formatForChannels(channels, immutable, sizedFormat, format)) {
+        std::cerr << "Unsupported number of channels: " << channels << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TextureUploader::reserve(const FrameLayout& layout) {
+    if (!texture || layout.width <= 0 || layout.height <= 0) {
+        return false;
+    }
+    // As upload() will store the frames: YUV as planes, blocks the GPU cannot
+    // sample and YUV that cannot go up as planes as RGBA8, and RGBA8 if required
+    bool planar = layout.planes != PlaneFormat::Interleaved;
+    if (planar && uploadPlanar) {
+        if (layout.width % 2 != 0 || layout.height % 2 != 0) {
+            return false;
+        }
+        if (layout.width != width || layout.height != height || layout.planes != planes) {
+            allocatePlanes(layout.width, layout.height, layout.planes);
+        }
+        return true;
+    }
+    bool compressed = layout.compression != BlockFormat::None && canUploadCompressed(layout.compression);
+    int channels = (layout.compression != BlockFormat::None && !compressed) || planar ? 4 : layout.channels;
+    if (requireRGBA && !compressed) {
+        channels = 4;
+    }
+    if (compressed && !immutable) {
+        return false; // Mutable compressed storage is specified together with its first frame
+    }
+
+    GLenum sizedFormat, format;
+    if (!storageFormat(channels, compressed ? layout.compression : BlockFormat::None, layout.sampleFormat,
+                       sizedFormat, format)) {
+        return false;
+    }
+    if (layout.width != width || layout.height != height || sizedFormat != internalFormat ||
+        planes != PlaneFormat::Interleaved) {
+        allocate(layout.width, layout.height, sizedFormat, format);
+    }
+    return true;
+}
+
+bool TextureUploader::upload(const ImageData& image, size_t key) {
+    if (!image.isValid()) {
+        return false;
+    }
+
+    bool compressed = image.compression != BlockFormat::None;
+    if (compressed && !canUploadCompressed(image.compression)) {
+        // No S3TC support: expand the blocks on the CPU
+        ImageData decompressed;
+        if (!BlockCompressor::decompress(image, decompressed)) {
+            std::cerr << "Failed to decompress block-compressed frame" << std::endl;
+            return false;
+        }
+        return upload(decompressed);
+    }
+    if (image.isPlanar()) {
+        if (uploadPlanar) {
+            return uploadPlanes(image, key);
+        }
+        // No plane storage: convert to RGB on the CPU
+        ImageData converted;
+        if (!PixelConvert::yuvToRGBA(image, converted)) {
+            std::cerr << "Failed to convert YUV frame" << std::endl;
+            return false;
+        }
+        return upload(converted);
+    }
+
+    bool expand = requireRGBA && !compressed && image.channels != 4;
+    int channels = expand ? 4 : image.channels;
+    bool halfFloat = image.sampleFormat == SampleFormat::Float16;
+
+    GLenum sizedFormat, format;
+    if (!storageFormat(channels, image.compression, image.sampleFormat, sizedFormat, format)) {
+        return false;
+    }
+
+    bool fromPixelBuffer = isStaged(image, key);
+    GLsizei compressedSize = static_cast<GLsizei>(image.data.size());
+    const void* pixels = fromPixelBuffer ? nullptr : image.data.data();
+    if (fromPixelBuffer) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[stagedSlot].buffer);
+    } else if (expand) {
+        size_t pixelCount = static_cast<size_t>(image.width) * image.height;
+        expandBuffer.resize(pixelCount * 4);
+        PixelConvert::expandToRGBA(image.data.data(), image.channels, pixelCount, expandBuffer.data());
+        pixels = expandBuffer.data();
+    }
+
+    bool layoutChanged = image.width != width || image.height != height || sizedFormat != internalFormat ||
+                         planes != PlaneFormat::Interleaved;
+    if (layoutChanged && compressed && !immutable) {
+        // Mutable compressed storage is specified together with its first frame
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glCompressedTexImage2D(GL_TEXTURE_2D, 0, sizedFormat, image.width, image.height, 0,
+                               compressedSize, pixels);
+        width = image.width;
+        height = image.height;
+        internalFormat = sizedFormat;
+        releaseChromaTextures();
+    } else {
+        if (layoutChanged) {
+            allocate(image.width, image.height, sizedFormat, format);
+        } else {
+            glBindTexture(GL_TEXTURE_2D, texture);
+        }
+
+        if (compressed) {
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height,
+                                      sizedFormat, compressedSize, pixels);
+        } else {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height,
+                            format, halfFloat ? GL_HALF_FLOAT : GL_UNSIGNED_BYTE, pixels);
+        }
+    }
+
+    if (fromPixelBuffer) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        pixelBuffers[stagedSlot].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    hasStaged = false;
+    return true;
+}
+
+bool TextureUploader::uploadTiles(const ImageData& image, const DirtyTiles& tiles) {
+    if (!image.isValid() || !tiles.isValid() || !texture || image.compression != BlockFormat::None ||
+        image.sampleFormat != SampleFormat::UNorm8 || (requireRGBA && image.channels != 4) || tiles.dirtyFraction() > 0.5) {
+        return false;
+    }
+    GLenum sizedFormat, format;
+    if (image.isPlanar() || planes != PlaneFormat::Interleaved ||
+        !formatForChannels(image.channels, immutable, sizedFormat, format) ||
+        image.width != width || image.height != height || sizedFormat != internalFormat) {
+        return false;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (hasStaged) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        hasStaged = false; // The staged frame is superseded
+    }
+    size_t stride = static_cast<size_t>(image.width) * image.channels;
+    int size = tiles.tileSize;
+    if (immutable) {
+        // ES3: upload each run of dirty tiles straight out of the full frame
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, image.width);
+        for (int ty = 0; ty < tiles.tilesY; ++ty) {
+            int y = ty * size;
+            int rows = std::min(size, image.height - y);
+            for (int tx = 0; tx < tiles.tilesX; ++tx) {
+                if (!tiles.isDirty(tx, ty)) {
+                    continue;
+                }
+                int first = tx;
+                while (tx + 1 < tiles.tilesX && tiles.isDirty(tx + 1, ty)) {
+                    ++tx;
+                }
+                int x = first * size;
+                int columns = std::min((tx + 1) * size, image.width) - x;
+                const unsigned char* pixels = image.data.data() + stride * y + static_cast<size_t>(x) * image.channels;
+                glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, columns, rows, format, GL_UNSIGNED_BYTE, pixels);
+            }
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    } else {
+        // ES2: rows are contiguous, so upload full-width strips of consecutive dirty tile rows
+        auto rowDirty = [&tiles](int ty) {
+            for (int tx = 0; tx < tiles.tilesX; ++tx) {
+                if (tiles.isDirty(tx, ty)) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        for (int ty = 0; ty < tiles.tilesY; ++ty) {
+            if (!rowDirty(ty)) {
+                continue;
+            }
+            int first = ty;
+            while (ty + 1 < tiles.tilesY && rowDirty(ty + 1)) {
+                ++ty;
+            }
+            int y = first * size;
+            int rows = std::min((ty + 1) * size, image.height) - y;
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, image.width, rows, format, GL_UNSIGNED_BYTE,
+                            image.data.data() + stride * y);
+        }
+    }
+    return true;
+}
+
+bool TextureUploader::ensureStorage(int w, int h, GLenum sizedFormat) {
+    if (w == width && h == height && sizedFormat == internalFormat && planes == PlaneFormat::Interleaved) {
+        return true;
+    }
+
+    GLenum format;
+    switch (sizedFormat) {
+        case GL_R8:    format = GL_RED; break;
+        case GL_RGB8:  format = GL_RGB; break;
+        case GL_RGBA8: format = GL_RGBA; break;
+        case GL_RGBA16F: format = GL_RGBA; break;
+        default:
+            std::cerr << "Unsupported texture storage format: 0x" << std::hex << sizedFormat << std::dec << std::endl;
+            return false;
+    }
+    allocate(w, h, sizedFormat, format);
+    return true;
+}
+
+void TextureUploader::allocate(int w, int h, GLenum sizedFormat, GLenum format) {
+    if (immutable) {
+        // Immutable storage cannot be re-specified, so replace the texture object
+        if (texture) {
+            glDeleteTextures(1, &texture);
+        }
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        applySamplingParameters();
+        glTexStorage2D(GL_TEXTURE_2D, 1, sizedFormat, w, h);
+
+        if (sizedFormat == GL_R8) {
+            // Show single-channel frames as grey, like GL_LUMINANCE on ES2
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+        }
+    } else {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        GLenum type = sizedFormat == GL_RGBA16F ? GL_HALF_FLOAT : GL_UNSIGNED_BYTE;
+        glTexImage2D(GL_TEXTURE_2D, 0, sizedFormat, w, h, 0, format, type, nullptr);
+    }
+
+    // Interleaved storage has no chroma planes
+    releaseChromaTextures();
+
+    width = w;
+    height = h;
+    internalFormat = sizedFormat;
+}
+
+void TextureUploader::allocatePlanes(int w, int h, PlaneFormat format) {
+    allocate(w, h, GL_R8, GL_RED);
+
+    // Chroma is sampled at the luma texture coordinates; filtering interpolates it between 2x2 blocks
+    int count = format == PlaneFormat::NV12 ? 1 : 2;
+    for (int i = 0; i < count; ++i) {
+        glGenTextures(1, &chromaTextures[i]);
+        glBindTexture(GL_TEXTURE_2D, chromaTextures[i]);
+        applySamplingParameters();
+        glTexStorage2D(GL_TEXTURE_2D, 1, format == PlaneFormat::NV12 ? GL_RG8 : GL_R8, w / 2, h / 2);
+    }
+    planes = format;
+}
+
+void TextureUploader::releaseChromaTextures() {
+    for (GLuint& chroma : chromaTextures) {
+        if (chroma) {
+            glDeleteTextures(1, &chroma);
+            chroma = 0;
+        }
+    }
+    planes = PlaneFormat::Interleaved;
+}
+
+bool TextureUploader::uploadPlanes(const ImageData& image, size_t key) {
+    if (image.width % 2 != 0 || image.height % 2 != 0 ||
+        image.data.size() != PixelConvert::yuvSize(image.width, image.height)) {
+        std::cerr << "Invalid YUV frame of " << image.width << "x" << image.height << std::endl;
+        return false;
+    }
+    if (image.width != width || image.height != height || image.planes != planes) {
+        allocatePlanes(image.width, image.height, image.planes);
+    }
+
+    // Planes are taken from the staged copy in the pixel buffer, or from the frame, at the same offsets
+    bool fromPixelBuffer = isStaged(image, key);
+    if (fromPixelBuffer) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[stagedSlot].buffer);
+    }
+    auto plane = [&](size_t offset) -> const void* {
+        return fromPixelBuffer ? reinterpret_cast<const void*>(offset) : image.data.data() + offset;
+    };
+    size_t lumaSize = static_cast<size_t>(image.width) * image.height;
+    int chromaWidth = image.width / 2;
+    int chromaHeight = image.height / 2;
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, GL_RED, GL_UNSIGNED_BYTE, plane(0));
+    glBindTexture(GL_TEXTURE_2D, chromaTextures[0]);
+    if (image.planes == PlaneFormat::NV12) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, chromaWidth, chromaHeight, GL_RG, GL_UNSIGNED_BYTE, plane(lumaSize));
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, chromaWidth, chromaHeight, GL_RED, GL_UNSIGNED_BYTE, plane(lumaSize));
+        glBindTexture(GL_TEXTURE_2D, chromaTextures[1]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, chromaWidth, chromaHeight, GL_RED, GL_UNSIGNED_BYTE,
+                        plane(lumaSize + lumaSize / 4));
+    }
+
+    if (fromPixelBuffer) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        pixelBuffers[stagedSlot].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    hasStaged = false;
+    return true;
+}
+
+void TextureUploader::applySamplingParameters() {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <angle_gl.h>
+#include <vector>
+#include "../reader/ImageLoader.h"
+#include "../reader/DirtyTiles.h"
+
+// Owns a 2D texture whose storage is allocated once per resolution and format.
+// Steady-state uploads only replace the texel data with glTexSubImage2D; the
+// storage is re-specified only when a frame's size or channel count changes.
+// With immutable storage (ES3) that means creating a new texture object, so
+// callers should fetch getTexture() after every upload.
+//
+// On ES3 an optional ring of pixel unpack buffers lets the next frame be
+// copied into driver memory (stage) while the current frame is being drawn;
+// the following upload() of that frame is then a GPU-side copy. Each buffer is
+// guarded by a fence so it is only rewritten once the GPU has consumed it.
+//
+// Block-compressed frames (BC1/BC3) are uploaded with glCompressedTexSubImage2D
+// once enableCompressedUploads() has found S3TC support; otherwise they are
+// decompressed on the CPU and uploaded as RGBA8. Half-float frames are stored
+// RGBA16F, which needs ES3.
+//
+// YUV frames (NV12, I420) go up as their planes once enablePlanarUploads()
+// is on: luma into the R8 texture getTexture() returns, chroma into an RG8
+// texture (NV12) or two R8 textures (I420) of half the size, for the
+// pipeline to convert while sampling. Otherwise they are converted to RGBA8
+// on the CPU.
+class TextureUploader {
+public:
+    // Key for uploads that were not staged
+    static const size_t NoKey = static_cast<size_t>(-1);
+
+    TextureUploader();
+
+    // Create the texture object. useImmutableStorage selects glTexStorage2D (ES3).
+    void create(bool useImmutableStorage);
+    // Delete the texture object and pixel buffers (needs the owning context to be current)
+    void destroy();
+
+    // Upload block-compressed frames as-is if the context exposes the S3TC
+    // extensions. Returns false if neither BC1 nor BC3 can be uploaded directly.
+    bool enableCompressedUploads();
+
+    // Upload YUV frames as planes (ES3, for R8/RG8 storage) instead of RGBA8.
+    // Returns false if planes cannot be stored.
+    bool enablePlanarUploads();
+
+    // Always store RGBA8 (YUV planes excepted, see enablePlanarUploads): 1- and 3-channel frames are expanded on the CPU during
+    // staging or upload (e.g. for textures bound as rgba8 image units)
+    void setRequireRGBA(bool enabled) { requireRGBA = enabled; }
+
+    // Use a ring of ringSize pixel unpack buffers for staged uploads (ES3 only)
+    void enablePixelBuffers(int ringSize);
+
+    // Copy a frame into the next pixel buffer of the ring, identified by key
+    // (e.g. the frame index). Returns false if staging is not available.
+    bool stage(const ImageData& image, size_t key);
+
+    // Upload a frame, reallocating the storage only if its layout changed.
+    // If the frame was staged under the same key, it is sourced from the pixel buffer.
+    bool upload(const ImageData& image, size_t key = NoKey);
+
+    // Replace only the given tiles, for a texture that holds the frame the
+    // tiles were computed against. Runs of adjacent tiles go up as one
+    // glTexSubImage2D (whole tile rows on ES2, which has no UNPACK_ROW_LENGTH).
+    // Returns false, uploading nothing, if the frame needs a full upload
+    // instead (different layout, compressed or needing expansion, or more than
+    // half the tiles changed, where one full upload is cheaper).
+    bool uploadTiles(const ImageData& image, const DirtyTiles& tiles);
+
+    // Allocate the storage every frame of the layout will be uploaded into, up
+    // front (e.g. for a sequence of uniform frames, see
+    // ImageLoader::getSequenceLayout), so no upload re-specifies it. Returns
+    // false if storage can only be specified with the first frame.
+    bool reserve(const FrameLayout& layout);
+
+    // Make sure the texture has storage of the given size and sized internal
+    // format (R8, RGB8, RGBA8 or RGBA16F) without uploading any data (e.g. for
+    // compute shader output)
+    bool ensureStorage(int width, int height, GLenum internalFormat);
+
+    GLuint getTexture() const { return texture; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    GLenum getInternalFormat() const { return internalFormat; }
+    // Layout of the frame in the texture; for YUV, getTexture() holds luma
+    // and getChromaTexture(0) the U,V pairs (NV12) or U, with V in getChromaTexture(1) (I420)
+    PlaneFormat getPlaneFormat() const { return planes; }
+    GLuint getChromaTexture(int plane) const { return chromaTextures[plane]; }
+
+    // Estimated texture memory of the storage, chroma planes and pixel buffers
+    size_t getMemoryBytes() const;
+
+    // Texture memory of width x height texels of a format, times layers: a
+    // driver may pad or align further, and RGB8 counts as RGBA8, which is
+    // how the D3D11 backend stores it
+    static size_t estimateBytes(GLenum internalFormat, int width, int height, int layers = 1);
+
+    // Map a channel count to the internal format and pixel format used for upload
+    static bool formatForChannels(int channels, bool sizedFormats, GLenum& internalFormat, GLenum& format);
+
+    // Whether the current context can sample a block format directly
+    static bool isBlockFormatSupported(BlockFormat format);
+
+private:
+    GLuint texture;
+    bool immutable;
+    int width;
+    int height;
+    GLenum internalFormat;
+
+    // Chroma planes of a YUV frame
+    bool uploadPlanar;
+    PlaneFormat planes;
+    GLuint chromaTextures[2];
+
+    // Block formats uploaded without CPU decompression
+    bool uploadBC1;
+    bool uploadBC3;
+
+    // Expand frames to RGBA before upload, with a reusable buffer for client-memory uploads
+    bool requireRGBA;
+    std::vector<unsigned char> expandBuffer;
+
+    // Pixel unpack buffer ring
+    struct PixelBufferSlot {
+        GLuint buffer = 0;
+        GLsizeiptr capacity = 0;
+        GLsync fence = nullptr;  // Signalled once the GPU has finished reading the buffer
+    };
+    std::vector<PixelBufferSlot> pixelBuffers;
+    size_t nextPixelBuffer;
+
+    // The frame currently waiting in a pixel buffer
+    bool hasStaged;
+    size_t stagedKey;
+    size_t stagedSlot;
+    int stagedWidth;
+    int stagedHeight;
+    int stagedChannels;
+    BlockFormat stagedCompression;
+    SampleFormat stagedSampleFormat;
+    PlaneFormat stagedPlanes;
+
+    // Whether the frame is the one waiting in a pixel buffer under key
+    bool isStaged(const ImageData& image, size_t key) const;
+
+    // Sized internal format and pixel format a frame of this layout is stored in
+    bool storageFormat(int channels, BlockFormat compression, SampleFormat sampleFormat,
+                       GLenum& sizedFormat, GLenum& format) const;
+    // (Re)allocate storage for the given size and format
+    void allocate(int w, int h, GLenum sizedFormat, GLenum format);
+    // (Re)allocate luma and chroma storage for YUV frames of the given size
+    void allocatePlanes(int w, int h, PlaneFormat format);
+    void releaseChromaTextures();
+    bool uploadPlanes(const ImageData& image, size_t key);
+    void applySamplingParameters();
+    bool canUploadCompressed(BlockFormat format) const;
+};
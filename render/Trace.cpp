@@ -0,0 +1,50 @@
+#include "Trace.h"
+
+#if SHADERDEMO_TRACING
+
+#include <TraceLoggingProvider.h>
+#include <evntrace.h>
+
+// {5c7e2a1d-8b34-4f0e-9d62-1a4b7c3e9f05}
+TRACELOGGING_DEFINE_PROVIDER(traceProvider, "ShaderDemo",
+    (0x5c7e2a1d, 0x8b34, 0x4f0e, 0x9d, 0x62, 0x1a, 0x4b, 0x7c, 0x3e, 0x9f, 0x05));
+
+namespace Trace {
+
+void initialize() {
+    TraceLoggingRegister(traceProvider);
+}
+
+void shutdown() {
+    TraceLoggingUnregister(traceProvider);
+}
+
+Zone::Zone(const char* name) : name(name), activity(), enabled(TraceLoggingProviderEnabled(traceProvider, 0, 0)) {
+    // Without a listening session a zone costs one flag check
+    if (!enabled) {
+        return;
+    }
+    EventActivityIdControl(EVENT_ACTIVITY_CTRL_CREATE_ID, &activity);
+    TraceLoggingWriteActivity(traceProvider, "Zone", &activity, nullptr,
+                              TraceLoggingOpcode(WINEVENT_OPCODE_START), TraceLoggingString(name, "Name"));
+}
+
+Zone::~Zone() {
+    if (enabled) {
+        TraceLoggingWriteActivity(traceProvider, "Zone", &activity, nullptr,
+                                  TraceLoggingOpcode(WINEVENT_OPCODE_STOP), TraceLoggingString(name, "Name"));
+    }
+}
+
+void frameMark(uint64_t frame) {
+    TraceLoggingWrite(traceProvider, "Frame", TraceLoggingUInt64(frame, "Frame"));
+}
+
+void gpuTime(const char* name, double milliseconds) {
+    TraceLoggingWrite(traceProvider, "GpuTime", TraceLoggingString(name, "Name"),
+                      TraceLoggingFloat64(milliseconds, "Milliseconds"));
+}
+
+} // namespace Trace
+
+#endif
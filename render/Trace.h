@@ -0,0 +1,68 @@
+#pragma once
+
+// Optional trace events for Windows Performance Analyzer. Configure with
+// -DSHADERDEMO_TRACING=ON to emit ETW TraceLogging events from the provider
+// "ShaderDemo" {5c7e2a1d-8b34-4f0e-9d62-1a4b7c3e9f05}; otherwise every macro
+// below compiles to nothing.
+//
+// Record a session with a WPR profile that enables the provider, or with
+//   tracelog -start sd -f sd.etl -guid #5c7e2a1d-8b34-4f0e-9d62-1a4b7c3e9f05
+//   ... tracelog -stop sd
+// and open the .etl in WPA. Zones are start/stop activity pairs named by their
+// "Name" field, frames are "Frame" events and GPU times "GpuTime" events.
+
+#include <cstdint>
+
+#if SHADERDEMO_TRACING
+
+#include <Windows.h>
+
+namespace Trace {
+
+// Register the provider; events written before this or after shutdown() are dropped
+void initialize();
+void shutdown();
+
+// CPU zone on the calling thread, from construction to destruction. name must
+// outlive the zone (string literals in practice).
+class Zone {
+public:
+    explicit Zone(const char* name);
+    ~Zone();
+
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+private:
+    const char* name;
+    GUID activity;
+    bool enabled;  // A session was listening when the zone began
+};
+
+// One presented frame, marked right after eglSwapBuffers
+void frameMark(uint64_t frame);
+
+// A GPU duration measured with timer queries (reported when the result arrives)
+void gpuTime(const char* name, double milliseconds);
+
+} // namespace Trace
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_INITIALIZE() Trace::initialize()
+#define TRACE_SHUTDOWN() Trace::shutdown()
+#define TRACE_ZONE(name) Trace::Zone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_FRAME(frame) Trace::frameMark(frame)
+#define TRACE_GPU_TIME(name, milliseconds) Trace::gpuTime(name, milliseconds)
+
+#else
+
+// The arguments are still evaluated, so a frame counter kept only for the
+// trace is neither unused nor left behind
+#define TRACE_INITIALIZE() ((void)0)
+#define TRACE_SHUTDOWN() ((void)0)
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_FRAME(frame) ((void)(frame))
+#define TRACE_GPU_TIME(name, milliseconds) ((void)(milliseconds))
+
+#endif
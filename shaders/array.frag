@@ -0,0 +1,10 @@
+#version 300 es
+precision mediump float;
+precision mediump sampler2DArray;
+in vec2 vTexCoord;
+uniform sampler2DArray uFrames;
+uniform float uLayer;
+out vec4 fragColor;
+void main() {
+    fragColor = texture(uFrames, vec3(vTexCoord, uLayer));
+}
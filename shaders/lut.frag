@@ -0,0 +1,14 @@
+#version 300 es
+precision mediump float;
+precision mediump sampler3D;
+in vec2 vTexCoord;
+uniform sampler2D uTexture;
+uniform sampler3D uLut;
+uniform vec3 uLutScale;   // Maps a color in the LUT's domain to texel centers
+uniform vec3 uLutOffset;
+out vec4 fragColor;
+// One trilinear lookup replaces the whole grade; alpha is kept
+void main() {
+    vec4 color = texture(uTexture, vTexCoord);
+    fragColor = vec4(texture(uLut, color.rgb * uLutScale + uLutOffset).rgb, color.a);
+}
@@ -0,0 +1,15 @@
+precision highp float;
+varying vec2 vTexCoord;
+uniform sampler2D uTexture;
+uniform float uQuantizeStep;
+
+// Writes the half-float result of the compute passes to the back buffer
+// (the compute pipeline's high precision present). Up to half a step of
+// ordered noise per pixel turns the rounding into a fine, stable grain
+// instead of bands in smooth gradients.
+void main() {
+    vec4 color = texture2D(uTexture, vTexCoord);
+    float noise = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    color.rgb += (noise - 0.5) * uQuantizeStep;
+    gl_FragColor = clamp(color, 0.0, 1.0);
+}
@@ -0,0 +1,28 @@
+precision mediump float;
+varying vec2 vTexCoord;
+uniform sampler2D uTexture;
+uniform float uBrightThreshold;
+uniform float uBrightGain;
+
+// The default tint effect applied while drawing to the screen (the compute
+// pipeline's fused present path). Variants as in tint.comp.
+void main() {
+    vec2 texCoord = vTexCoord;
+#ifdef FLIP
+    texCoord.y = 1.0 - texCoord.y;
+#endif
+    vec4 texColor = texture2D(uTexture, texCoord);
+
+#if defined(TINT) || defined(BRIGHTEN)
+    float luminance = dot(texColor.rgb, vec3(0.299, 0.587, 0.114));
+    float bright = step(uBrightThreshold, luminance);
+#endif
+#ifdef BRIGHTEN
+    texColor.rgb *= mix(1.0, uBrightGain, bright);
+#endif
+#ifdef TINT
+    texColor.rgb *= mix(vec3(0.8, 0.9, 1.1), vec3(1.0), bright);
+#endif
+
+    gl_FragColor = clamp(texColor, 0.0, 1.0);
+}
@@ -0,0 +1,20 @@
+precision mediump float;
+varying vec2 vTexCoord;
+uniform sampler2D uTexture;   // Y plane
+uniform sampler2D uChromaU;   // U plane (I420), or the interleaved U,V pairs (NV12)
+uniform sampler2D uChromaV;   // V plane (I420), or the U,V pairs again (NV12)
+uniform vec2 uChromaSelect;   // Picks V from uChromaV: (1, 0) for I420, (0, 1) for NV12
+
+// 4:2:0 YUV frames converted to RGB while drawing: video-range BT.709
+// (Y 16-235, chroma 16-240). The half-size chroma planes are filtered up to
+// the luma resolution by the samplers.
+void main() {
+    vec3 yuv = vec3(texture2D(uTexture, vTexCoord).r,
+                    texture2D(uChromaU, vTexCoord).r,
+                    dot(texture2D(uChromaV, vTexCoord).rg, uChromaSelect));
+    yuv -= vec3(0.0627451, 0.5019608, 0.5019608);
+    vec3 rgb = mat3(1.1643836, 1.1643836, 1.1643836,
+                    0.0, -0.2132486, 2.1124018,
+                    1.7927411, -0.5329093, 0.0) * yuv;
+    gl_FragColor = vec4(clamp(rgb, 0.0, 1.0), 1.0);
+}
@@ -0,0 +1,297 @@
+// Headless batch render of a frame sequence to image files.
+//
+// Every frame of the directory is drawn once through the chosen pipeline into
+// an offscreen pbuffer, as fast as the GPU allows, and written to the output
+// directory under its own name. Readbacks go through a ring of pixel pack
+// buffers and encoding runs on a thread pool (see FrameExporter), so the GPU
+// keeps drawing while earlier frames are read back and written.
+//
+// With --adapters the sequence is split into contiguous frame ranges, one per
+// GPU. Each range gets its own headless renderer on an EGL display of that
+// adapter (ANGLE's D3D11 device selection by LUID) and its own streaming
+// loader over the range; the loaders decode with one shared set of prefetch
+// threads. The GPUs export in parallel into the same output directory, and as
+// every frame keeps its name the result is the same sequence a single GPU writes.
+//
+// Usage: shaderDemoExport <photo directory> <output directory> [options]
+//   --renderer NAME  pipeline: fragment or compute (default fragment)
+//   --format NAME    png or raw (RGBA8, top row first; default png)
+//   --size WxH       output resolution (default: the first frame's size)
+//   --backend NAME   ANGLE backend: default, d3d11, d3d11-warp, d3d9, vulkan,
+//                    vulkan-swiftshader or gl (default: ANGLE's choice)
+//   --adapter N      DXGI adapter index for the D3D backends
+//   --adapters LIST  export on several adapters in parallel: comma-separated
+//                    DXGI indices (e.g. 0,1) or "all" for every hardware adapter
+//   --angle-features PATH  ANGLE feature overrides ("enable X" / "disable X" lines)
+//   --present PATH   how the compute pipeline presents: draw, blit or fused (default blit)
+//   --high-precision decode 16-bit PNGs to half floats and give the compute
+//                    pipeline RGBA16F intermediates with a quantizing present
+//   --luminance-stats compute pipeline: histogram and min/max/mean of each
+//                    frame on the GPU, printed with the frame statistics
+//   --batch N        compute pipeline: tint up to N frames of a size with one
+//                    dispatch over a texture array (default 1, frame by frame)
+//   --effects LIST   compute pipeline: passes of the effect library instead of
+//                    the tint, e.g. blur:4,unsharp:2:0.8,curve (see EffectLibrary)
+//   --lut PATH       grade every frame with a 3D LUT from a .cube file (see LutCache)
+
+#include "reader/FrameCache.h"
+#include "reader/ImageLoader.h"
+#include "render/LutCache.h"
+#include "render/Renderer.h"
+#include "render/Trace.h"
+#include "computeRenderer/ComputePipeline.h"
+#include "computeRenderer/EffectLibrary.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Frame rate requested from the renderer; export ignores pacing, this only keeps the pacer out of the way
+const double kExportFrameRate = 10000.0;
+
+bool parseSize(const char* text, int& width, int& height) {
+    return sscanf(text, "%dx%d", &width, &height) == 2 && width > 0 && height > 0;
+}
+
+// "0,1,..." or "all"; false for empty lists, negative or repeated indices (two
+// renderers on one adapter would share, and tear down, one EGL display)
+bool parseAdapters(const std::string& text, std::vector<int>& adapters) {
+    if (text == "all") {
+        adapters = DisplayBackend::findHardwareAdapters();
+        if (adapters.empty()) {
+            std::cerr << "No hardware adapters found" << std::endl;
+            return false;
+        }
+        return true;
+    }
+    adapters.clear();
+    std::istringstream list(text);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        char* end = nullptr;
+        long index = strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || index < 0 ||
+            std::find(adapters.begin(), adapters.end(), static_cast<int>(index)) != adapters.end()) {
+            std::cerr << "Invalid adapter list: " << text << std::endl;
+            return false;
+        }
+        adapters.push_back(static_cast<int>(index));
+    }
+    if (adapters.empty()) {
+        std::cerr << "Invalid adapter list: " << text << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// The pipeline one GPU's renderer draws with, configured from the options
+std::unique_ptr<RenderPipeline> createPipeline(const std::string& rendererName, ComputePipeline::PresentPath presentPath,
+                                               bool highPrecision, int batchSize, bool luminanceStats,
+                                               const std::string& effects) {
+    std::unique_ptr<RenderPipeline> pipeline = RenderPipeline::create(rendererName);
+    ComputePipeline* compute = dynamic_cast<ComputePipeline*>(pipeline.get());
+    if (compute) {
+        compute->setPresentPath(presentPath);
+        compute->setHighPrecision(highPrecision);
+        compute->setBatchSize(batchSize);
+        compute->setLuminanceStats(luminanceStats);
+        if (!effects.empty() && !EffectLibrary::addEffects(*compute, effects)) {
+            return nullptr;
+        }
+    }
+    return pipeline;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <photo directory> <output directory> [--renderer fragment|compute] "
+                  << "[--format png|raw] [--size WxH] [--backend NAME] [--adapter N] [--adapters LIST|all] [--angle-features PATH] "
+                  << "[--present draw|blit|fused] [--high-precision] [--luminance-stats] [--batch N] [--effects LIST] [--lut PATH]" << std::endl;
+        return 1;
+    }
+
+    std::string rendererName = "fragment";
+    FrameExporter::Format format = FrameExporter::Format::PNG;
+    int width = 0;
+    int height = 0;
+    DisplayBackend backend;
+    ComputePipeline::PresentPath presentPath = ComputePipeline::PresentPath::Blit;
+    bool highPrecision = false;
+    bool luminanceStats = false;
+    int batchSize = 1;
+    std::string effects;
+    std::string lutPath;
+    std::vector<int> adapters;
+    // Frames are streamed, so sequences of any length export in bounded memory
+    ImageLoadOptions loadOptions;
+    loadOptions.verbose = false;
+    loadOptions.threadCount = 0;
+    loadOptions.streaming = true;
+    for (int i = 3; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--renderer") == 0 && hasValue) {
+            rendererName = argv[++i];
+        } else if (strcmp(argv[i], "--format") == 0 && hasValue) {
+            if (!FrameExporter::parseFormat(argv[++i], format)) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--size") == 0 && hasValue) {
+            if (!parseSize(argv[++i], width, height)) {
+                std::cerr << "Invalid size: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--backend") == 0 && hasValue) {
+            if (!DisplayBackend::parse(argv[++i], backend)) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--adapter") == 0 && hasValue) {
+            backend.adapterIndex = std::max(atoi(argv[++i]), 0);
+        } else if (strcmp(argv[i], "--adapters") == 0 && hasValue) {
+            if (!parseAdapters(argv[++i], adapters)) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--angle-features") == 0 && hasValue) {
+            if (!backend.loadFeatureOverrides(argv[++i])) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--present") == 0 && hasValue) {
+            if (!ComputePipeline::parsePresentPath(argv[++i], presentPath)) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--high-precision") == 0) {
+            highPrecision = true;
+            loadOptions.highBitDepth = true;
+        } else if (strcmp(argv[i], "--luminance-stats") == 0) {
+            luminanceStats = true;
+        } else if (strcmp(argv[i], "--batch") == 0 && hasValue) {
+            batchSize = std::max(atoi(argv[++i]), 1);
+        } else if (strcmp(argv[i], "--effects") == 0 && hasValue) {
+            effects = argv[++i];
+        } else if (strcmp(argv[i], "--lut") == 0 && hasValue) {
+            lutPath = argv[++i];
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    // Every GPU builds the same pipeline; this one only checks the options (both report what is wrong)
+    if (!createPipeline(rendererName, presentPath, highPrecision, batchSize, luminanceStats, effects)) {
+        return 1;
+    }
+    // Read once here as well, so a bad file stops the export before any GPU starts
+    CubeLut lut;
+    if (!lutPath.empty() && !lut.load(lutPath)) {
+        return 1;
+    }
+
+    // The loaders of all GPUs decode with the same threads
+    unsigned hardwareThreads = std::thread::hardware_concurrency();
+    int decodeThreads = hardwareThreads > 0 ? static_cast<int>(hardwareThreads) : 2;
+    loadOptions.prefetchScheduler = std::make_shared<PrefetchScheduler>(0, decodeThreads);
+
+    std::unique_ptr<ImageLoader> sequence(new ImageLoader());
+    if (!sequence->loadImagesFromDirectory(argv[1], loadOptions)) {
+        std::cerr << "No frames to export in " << argv[1] << std::endl;
+        return 1;
+    }
+    if (width == 0) {
+        std::shared_ptr<const ImageData> first = sequence->acquireImage(0);
+        if (!first || !first->isValid()) {
+            std::cerr << "Cannot read the first frame of " << argv[1] << std::endl;
+            return 1;
+        }
+        width = first->width;
+        height = first->height;
+    }
+    size_t frameCount = sequence->getImageCount();
+    std::cout << "Exporting " << frameCount << " frames at " << width << "x" << height << std::endl;
+
+    // One contiguous range per GPU, so each loader streams its files in order;
+    // a GPU without frames (more adapters than frames) is left out
+    std::vector<std::unique_ptr<ImageLoader>> loaders;
+    std::vector<DisplayBackend> backends;
+    if (adapters.size() <= 1) {
+        if (!adapters.empty()) {
+            backend.adapterIndex = adapters[0];
+        }
+        loaders.push_back(std::move(sequence));
+        backends.push_back(backend);
+    } else {
+        sequence.reset(); // Its prefetch window would only decode frames again
+        size_t gpuCount = std::min(adapters.size(), frameCount);
+        for (size_t gpu = 0; gpu < gpuCount; ++gpu) {
+            size_t first = frameCount * gpu / gpuCount;
+            size_t last = frameCount * (gpu + 1) / gpuCount;
+            ImageLoadOptions rangeOptions = loadOptions;
+            rangeOptions.startFrame = static_cast<int>(first);
+            rangeOptions.maxImages = static_cast<int>(last - first);
+            std::unique_ptr<ImageLoader> loader(new ImageLoader());
+            if (!loader->loadImagesFromDirectory(argv[1], rangeOptions)) {
+                std::cerr << "Cannot load frames " << first << "-" << last - 1 << " of " << argv[1] << std::endl;
+                return 1;
+            }
+            std::cout << "Adapter " << adapters[gpu] << ": frames " << first << "-" << last - 1 << std::endl;
+            loaders.push_back(std::move(loader));
+            backends.push_back(backend);
+            backends.back().adapterIndex = adapters[gpu];
+        }
+    }
+
+    TRACE_INITIALIZE();
+    auto startTime = std::chrono::high_resolution_clock::now();
+    std::vector<std::unique_ptr<Renderer>> renderers;
+    bool ok = true;
+    for (size_t gpu = 0; gpu < loaders.size() && ok; ++gpu) {
+        renderers.emplace_back(new Renderer(nullptr, width, height, *loaders[gpu],
+                                            createPipeline(rendererName, presentPath, highPrecision, batchSize, luminanceStats, effects)));
+        Renderer& renderer = *renderers.back();
+        renderer.setDisplayBackend(backends[gpu]);
+        renderer.setVsync(false);
+        renderer.setFrameRate(kExportFrameRate);
+        renderer.setBatchExport(argv[2], format);
+        if (!lutPath.empty()) {
+            renderer.setLuts({ lutPath });
+        }
+        ok = renderer.start();
+        if (!ok) {
+            std::cerr << "Failed to start the " << backends[gpu].getName() << " renderer at " << width << "x" << height << std::endl;
+        }
+    }
+    // Without every GPU the export is incomplete, so the others are stopped right away
+    for (size_t gpu = 0; gpu < renderers.size() && ok; ++gpu) {
+        Renderer& renderer = *renderers[gpu];
+        ok = renderer.waitForExport() && ok;
+        if (renderers.size() > 1) {
+            std::cout << backends[gpu].getName() << ", ";
+        }
+        std::cout << "GL renderer: " << renderer.getRendererString() << std::endl;
+        renderer.getFrameStats().report(std::cout);
+    }
+    if (ok && renderers.size() > 1) {
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+        std::cout << "Exported " << frameCount << " frames on " << renderers.size() << " adapters in " << seconds << " s";
+        if (seconds > 0.0) {
+            std::cout << " (" << frameCount / seconds << " fps)";
+        }
+        std::cout << std::endl;
+    }
+    for (std::unique_ptr<Renderer>& renderer : renderers) {
+        renderer->stop();
+    }
+    renderers.clear();
+    TRACE_SHUTDOWN();
+    return ok ? 0 : 1;
+}
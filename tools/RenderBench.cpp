@@ -0,0 +1,333 @@
+// Headless benchmark of the fragment shader and compute shader pipelines.
+//
+// Renders a fixed frame sequence into an offscreen pbuffer (no window) and
+// reports throughput, frame-time percentiles, upload bandwidth and peak memory
+// for every combination of pipeline, resolution and pacing mode.
+//
+// Usage: shaderDemoBench <photo directory> [options]
+//   --frames N       frames measured per run, after a warm-up (default 600)
+//   --size WxH       render resolution; repeat for several (default 1280x720 and 1920x1080)
+//   --renderer NAME  pipeline: fragment, compute or both (default both)
+//   --paced          also run each configuration paced at 60 fps with vsync requested
+//   --resident       let the fragment pipeline keep short sequences in texture memory
+//   --csv PATH       append the per-stage results of every run to PATH
+//   --loader-sweep LIST  only profile loading the directory with each thread
+//                        count in LIST (e.g. 1,2,4,8) and exit
+//   --config PATH, --<setting> VALUE  run settings (see RunConfig), e.g.
+//                    --backend, --adapter, --angle-features, --present (default
+//                    blit), --high-precision, --max-images (default 120),
+//                    --decode-threads, --io-depth, --unbuffered-io, --raw-size,
+//                    --timing, --work-group-size, --render-scale, --lazy.
+//                    The effective settings are printed ahead of the results.
+//                    Pacing, sizes, pipelines and the sequence are the bench's
+//                    own options, so photos, pipeline, window-size, windows,
+//                    frame-rate, vsync, low-latency and record are rejected.
+//                    --replay PATH drives each run, after the warm-up, with the
+//                    controls recorded in PATH (shaderDemo --record PATH) at
+//                    their times instead of measuring --frames frames.
+
+#include "reader/ImageLoader.h"
+#include "render/Renderer.h"
+#include "render/RunConfig.h"
+#include "render/ControlRecording.h"
+#include "render/Trace.h"
+#include "computeRenderer/ComputePipeline.h"
+
+#include <Windows.h>
+#include <psapi.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct BenchSize {
+    int width;
+    int height;
+};
+
+struct BenchOptions {
+    int frames = 600;
+    int warmupFrames = 60;
+    std::vector<BenchSize> sizes;
+    bool fragment = true;
+    bool compute = true;
+    bool paced = false;
+    bool resident = false;
+    std::string csvPath;
+    ControlRecording replay;  // Controls each run plays back (empty = measure frames)
+    RunConfig config;  // Backend, compute settings and timing of every run
+};
+
+// Settings of the interactive program the runs replace with their own
+const std::vector<std::string> kUnusedSettings = { "photos", "pipeline", "window-size", "windows",
+                                                   "frame-rate", "vsync", "low-latency", "record" };
+
+// Frames per second the unpaced runs ask for; far above what either pipeline reaches
+const double kUnpacedFrameRate = 10000.0;
+const double kPacedFrameRate = 60.0;
+
+// A run with no new frame for this long is abandoned
+const std::chrono::seconds kStallTimeout(10);
+
+size_t peakMemoryBytes() {
+    PROCESS_MEMORY_COUNTERS counters = {};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+}
+
+// Wait until the renderer has presented `count` frames since its stats were
+// last cleared. Returns false if presentation stalls.
+bool waitForFrames(FrameStats& stats, uint64_t count) {
+    uint64_t lastSeen = 0;
+    auto lastProgress = std::chrono::steady_clock::now();
+    for (;;) {
+        uint64_t presented = stats.getTotals(FrameStage::Present).samples;
+        if (presented >= count) {
+            return true;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (presented != lastSeen) {
+            lastSeen = presented;
+            lastProgress = now;
+        } else if (now - lastProgress > kStallTimeout) {
+            return false;
+        }
+        Sleep(5);
+    }
+}
+
+// Give the renderer the recorded controls at their times. Returns false if
+// presentation stalls.
+bool replayControls(Renderer& renderer, ComputePipeline* compute, FrameStats& stats, const ControlRecording& recording) {
+    ControlReplay replay(recording);
+    replay.start();
+    uint64_t lastSeen = 0;
+    auto lastProgress = std::chrono::steady_clock::now();
+    while (!replay.isFinished()) {
+        Sleep(std::min<DWORD>(replay.getWaitMilliseconds(), 5));
+        for (const ControlEvent* event = replay.takeDue(); event; event = replay.takeDue()) {
+            if (event->action == ControlAction::Quit) {
+                return true;
+            }
+            ControlRecording::apply(*event, renderer, compute);
+        }
+        // A paused renderer presents nothing, so only a run playing back can stall
+        uint64_t presented = stats.getTotals(FrameStage::Present).samples;
+        auto now = std::chrono::steady_clock::now();
+        if (presented != lastSeen || renderer.isPaused()) {
+            lastSeen = presented;
+            lastProgress = now;
+        } else if (now - lastProgress > kStallTimeout) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Warm up, measure options.frames frames (or replay options.replay) with the
+// named pipeline and print one result line
+bool runBench(const char* name, ImageLoader& loader, const BenchOptions& options, const BenchSize& size, bool paced) {
+    std::unique_ptr<RenderPipeline> pipeline = RenderPipeline::create(name);
+    ComputePipeline* compute = dynamic_cast<ComputePipeline*>(pipeline.get());
+    if (compute && !options.config.applyTo(*compute)) {
+        return false;
+    }
+    Renderer renderer(nullptr, size.width, size.height, loader, std::move(pipeline));
+    // Every renderer setting the bench accepts; pacing is the run's own
+    options.config.applyTo(renderer);
+    renderer.setVsync(paced);
+    renderer.setFrameRate(paced ? kPacedFrameRate : kUnpacedFrameRate);
+    // Resident sequences never upload, which would hide the upload path being measured
+    if (!options.resident) {
+        renderer.setResidentFrameLimit(0, 0);
+    }
+    if (!renderer.start()) {
+        std::cerr << name << ": failed to start at " << size.width << "x" << size.height << std::endl;
+        return false;
+    }
+
+    // Shader compilation, first uploads and the producer's fill happen during the warm-up
+    FrameStats& stats = renderer.getFrameStats();
+    bool ok = waitForFrames(stats, static_cast<uint64_t>(options.warmupFrames));
+    auto start = std::chrono::steady_clock::now();
+    if (ok) {
+        stats.clear();
+        ok = options.replay.isEmpty() ? waitForFrames(stats, static_cast<uint64_t>(options.frames))
+                                      : replayControls(renderer, compute, stats, options.replay);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    renderer.stop();
+    if (!ok) {
+        std::cerr << name << ": presentation stalled at " << size.width << "x" << size.height << std::endl;
+        return false;
+    }
+
+    // The backend is part of the label so CSV rows of different backends can be compared
+    std::string label = std::string(name) + (compute ? " " + options.config.present : std::string()) +
+                        (compute && options.config.highPrecision ? " fp16" : "") + " " +
+                        options.config.backend.getName() + " " + std::to_string(size.width) + "x" + std::to_string(size.height) +
+                        (paced ? " paced" : " unpaced") + (options.replay.isEmpty() ? "" : " replay");
+    uint64_t presented = stats.getTotals(FrameStage::Present).samples;
+    StageSummary frame = stats.summarize(FrameStage::Frame);
+    std::cout << std::fixed << std::setprecision(2)
+              << std::left << std::setw(40) << label << std::right
+              << std::setw(9) << presented / seconds
+              << std::setw(9) << frame.p50 << std::setw(9) << frame.p95
+              << std::setw(9) << frame.p99 << std::setw(9) << frame.max
+              << std::setw(12) << stats.getTotals(FrameStage::Upload).megabytesPerSecond()
+              << std::setw(10) << peakMemoryBytes() / (1024 * 1024) << std::endl
+              << std::defaultfloat;
+    std::cout << "GL renderer: " << renderer.getRendererString() << std::endl;
+    stats.report(std::cout);
+    renderer.getMemoryUsage().print(std::cout);
+    std::cout << std::endl;
+
+    if (!options.csvPath.empty()) {
+        stats.appendCsv(options.csvPath, label);
+    }
+    return true;
+}
+
+bool parseSize(const char* text, BenchSize& size) {
+    return sscanf(text, "%dx%d", &size.width, &size.height) == 2 && size.width > 0 && size.height > 0;
+}
+
+bool parseThreadCounts(const char* text, std::vector<int>& counts) {
+    std::string list = text;
+    size_t begin = 0;
+    while (begin <= list.size()) {
+        size_t end = list.find(',', begin);
+        int count = atoi(list.substr(begin, end - begin).c_str());
+        if (count <= 0) {
+            return false;
+        }
+        counts.push_back(count);
+        if (end == std::string::npos) {
+            break;
+        }
+        begin = end + 1;
+    }
+    return !counts.empty();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <photo directory> [--frames N] [--size WxH]... "
+                  << "[--renderer fragment|compute|both] [--paced] [--resident] [--csv PATH] "
+                  << "[--loader-sweep 1,2,4,...] [--config PATH] [--<setting> VALUE]..." << std::endl;
+        RunConfig::printUsage(std::cerr, kUnusedSettings);
+        return 1;
+    }
+
+    BenchOptions options;
+    std::vector<int> loaderSweep;
+    // The benchmark's own defaults, before the command line
+    options.config.exclude(kUnusedSettings);
+    options.config.maxImages = 120;
+    options.config.present = "blit";
+    for (int i = 2; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        int taken = options.config.parseOption(argc, argv, i);
+        if (taken < 0) {
+            return 1;
+        } else if (taken > 0) {
+            continue;
+        } else if (strcmp(argv[i], "--frames") == 0 && hasValue) {
+            options.frames = std::max(atoi(argv[++i]), 1);
+        } else if (strcmp(argv[i], "--size") == 0 && hasValue) {
+            BenchSize size;
+            if (!parseSize(argv[++i], size)) {
+                std::cerr << "Invalid size: " << argv[i] << std::endl;
+                return 1;
+            }
+            options.sizes.push_back(size);
+        } else if (strcmp(argv[i], "--renderer") == 0 && hasValue) {
+            std::string name = argv[++i];
+            options.fragment = name == "fragment" || name == "both";
+            options.compute = name == "compute" || name == "both";
+            if (!options.fragment && !options.compute) {
+                std::cerr << "Unknown renderer: " << name << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--paced") == 0) {
+            options.paced = true;
+        } else if (strcmp(argv[i], "--resident") == 0) {
+            options.resident = true;
+        } else if (strcmp(argv[i], "--csv") == 0 && hasValue) {
+            options.csvPath = argv[++i];
+        } else if (strcmp(argv[i], "--loader-sweep") == 0 && hasValue) {
+            if (!parseThreadCounts(argv[++i], loaderSweep)) {
+                std::cerr << "Invalid thread counts: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    ComputePipeline::PresentPath presentPath;
+    if (!ComputePipeline::parsePresentPath(options.config.present, presentPath)) {
+        return 1;
+    }
+    if (!options.config.replayControls.empty() && !options.replay.load(options.config.replayControls)) {
+        return 1;
+    }
+    ImageLoadOptions loadOptions;
+    options.config.applyTo(loadOptions);
+    loadOptions.verbose = false;
+    loadOptions.expandToRGBA = true;
+    if (!loaderSweep.empty()) {
+        // Startup cost only: where loading the sequence spends its time and how it scales with threads
+        return ImageLoader::profileThreadCounts(argv[1], loadOptions, loaderSweep, std::cout) ? 0 : 1;
+    }
+    if (options.sizes.empty()) {
+        options.sizes = { { 1280, 720 }, { 1920, 1080 } };
+    }
+
+    // The whole sequence is decoded up front, so decode speed does not skew the runs
+    ImageLoader loader;
+    if (!loader.loadImagesFromDirectory(argv[1], loadOptions)) {
+        std::cerr << "No frames to benchmark in " << argv[1] << std::endl;
+        return 1;
+    }
+    std::cout << "Benchmarking " << loader.getImageCount() << " frames, ";
+    if (options.replay.isEmpty()) {
+        std::cout << options.frames << " frames per run" << std::endl;
+    } else {
+        std::cout << "replaying " << options.replay.getEvents().size() << " control events per run" << std::endl;
+    }
+    std::cout << "Pbuffer swaps do not wait for the display; paced runs reproduce a 60 Hz vsync cadence with the frame pacer" << std::endl;
+    options.config.print(std::cout);
+    std::cout << std::endl;
+    std::cout << std::left << std::setw(40) << "run" << std::right << std::setw(9) << "fps"
+              << std::setw(9) << "p50" << std::setw(9) << "p95" << std::setw(9) << "p99" << std::setw(9) << "max"
+              << std::setw(12) << "upload MB/s" << std::setw(10) << "peak MB" << std::endl;
+
+    // Zones of every run land in one trace when a session has the provider enabled
+    TRACE_INITIALIZE();
+    bool ok = true;
+    for (const BenchSize& size : options.sizes) {
+        for (int mode = 0; mode < (options.paced ? 2 : 1); ++mode) {
+            bool paced = mode == 1;
+            if (options.fragment) {
+                ok = runBench("fragment", loader, options, size, paced) && ok;
+            }
+            if (options.compute) {
+                ok = runBench("compute", loader, options, size, paced) && ok;
+            }
+        }
+    }
+    TRACE_SHUTDOWN();
+    return ok ? 0 : 1;
+}
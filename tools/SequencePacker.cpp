@@ -0,0 +1,67 @@
+// Packs a directory of PNG frames into a memory-mappable .sdseq sequence file.
+//
+// Usage: sequencePacker <photo directory> <output.sdseq> [--bc]
+//   --bc  store BC1/BC3 block-compressed frames instead of raw pixels
+
+#include "reader/ImageLoader.h"
+#include "reader/SequenceFile.h"
+
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <photo directory> <output.sdseq> [--bc]" << std::endl;
+        return 1;
+    }
+
+    std::string directory = argv[1];
+    std::string outputPath = argv[2];
+
+    // Stream the frames so that packing long sequences does not need them all in memory;
+    // the prefetcher keeps decoding ahead while frames are written out
+    ImageLoadOptions options;
+    options.verbose = false;
+    options.threadCount = 0;
+    options.streaming = true;
+    options.cacheBudgetBytes = 0;
+    options.prefetchAhead = 16;
+    options.prefetchBehind = 0;
+    for (int i = 3; i < argc; ++i) {
+        if (strcmp(argv[i], "--bc") == 0) {
+            options.blockCompression = true;
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    ImageLoader loader;
+    if (!loader.loadImagesFromDirectory(directory, options)) {
+        std::cerr << "No frames to pack in " << directory << std::endl;
+        return 1;
+    }
+
+    SequenceWriter writer;
+    if (!writer.create(outputPath)) {
+        return 1;
+    }
+
+    for (size_t i = 0; i < loader.getImageCount(); ++i) {
+        loader.setPlaybackPosition(i, 1);
+        std::shared_ptr<const ImageData> image = loader.acquireImage(i);
+        if (!image || !image->isValid()) {
+            std::cerr << "Skipping frame " << loader.getImageName(i) << std::endl;
+            continue;
+        }
+        if (!writer.writeFrame(loader.getImageName(i), *image)) {
+            return 1;
+        }
+    }
+
+    if (!writer.finish()) {
+        return 1;
+    }
+    std::cout << "Packed " << writer.getFrameCount() << " frames into " << outputPath << std::endl;
+    return 0;
+}